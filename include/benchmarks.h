@@ -0,0 +1,80 @@
+/*
+ * benchmarks.h - Benchmarks de rendimiento ejecutables con --benchmark <nombre>
+ */
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+
+namespace Benchmarks {
+
+// Ejecuta el benchmark indicado ("all" ejecuta todos). Devuelve código de salida
+int run(const std::string& name);
+
+// Jitter de despacho del DeadlineScheduler con 10 000 trabajos periódicos
+int schedulerJitter();
+
+// Pico de peticiones por ventana con y sin escalonado de fases
+int staggeredPolling();
+
+// Throughput de 8 lectores concurrentes: registro con mutex frente a instantáneas
+int snapshotReaders();
+
+// Estrés de lectores/escritores concurrentes sobre TagValueCell (usar con ENABLE_TSAN=ON)
+int tagValueStress();
+
+// Recorrido completo de valores: objetos Tag frente al almacén SoA
+int valueScan();
+
+// Resolución padre/hijos del espacio de direcciones a 100 y 10 000 instrumentos
+int hierarchyBuild();
+
+// Tiempo de aplicación de tramas de 52, 500 y 5000 valores
+int frameApply();
+
+// Latencia de publicación del bus de cambios con un suscriptor detenido
+int changeBus();
+
+// Throughput 90/10 lecturas/escrituras con 1, 4 y 16 particiones del registro
+int shardedRegistry();
+
+// Resolución de sub-tags por nombre concatenado frente a nombres internados
+int internedNames();
+
+// Tiempo de carga, RSS y recorrido con tags en heap frente a arena (1 000 y 50 000 tags)
+int arenaLoad();
+
+// Consultas por categoría, tabla y prefijo: recorrido completo frente a índices secundarios
+int secondaryIndexes();
+
+// Barrido de plazos de refresco de 100 000 tags frente a recorrer todos los timestamps
+int stalenessSweep();
+
+// Caída de enlace por setQuality en bucle frente a época de fuente, y lectura de calidad efectiva
+int sourceEpochs();
+
+// Escritura del estado vivo en el fichero mapeado y restauración tras la caída del proceso
+int warmRestart();
+
+// Tamaño y coste de copia/comparación del valor: std::variant frente a TagValue compacto
+int compactValues();
+
+// Escalado de una trama de Input a PV/percent: bucle escalar frente a plan por columnas
+int gatewayScaling();
+
+// Inserción en el histórico con 1k/100k/1M muestras: multimap global frente a buffers por tag
+int historyRings();
+
+// Un día a 1 s de los tags de planta en el histórico comprimido: ratio, error y decodificación
+int compressedHistorian();
+
+// Ingesta de un día en el histórico persistente, consulta de 24 h de un tag y recuperación tras caída
+int historyStore();
+
+// Consulta de una ventana de 1 min con 1k/100k/1M muestras retenidas: búsqueda binaria frente a recorrido
+int historyRange();
+
+} // namespace Benchmarks
+
+#endif // BENCHMARKS_H
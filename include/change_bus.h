@@ -0,0 +1,105 @@
+/*
+ * change_bus.h - Bus de notificación de cambios de tags (publicar/suscribir)
+ *
+ * TagManager publica un ChangeSet por trama aplicada (IDs densos cambiados y
+ * timestamp de origen). Cada consumidor (servidor OPC UA, histórico, streams
+ * HTTP, alarmas) tiene su propia cola acotada y sin bloqueo; el productor
+ * nunca espera: si la cola de un suscriptor está llena, el conjunto se
+ * descarta para ese suscriptor, se contabiliza y el suscriptor queda marcado
+ * como desbordado para que haga una resincronización completa.
+ */
+
+#ifndef CHANGE_BUS_H
+#define CHANGE_BUS_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Conjunto de cambios de una trama; inmutable y compartido entre suscriptores
+struct ChangeSet {
+    uint64_t sequence;                  // Correlativo global del bus
+    uint64_t source_timestamp;
+    std::vector<uint32_t> ids;          // Tag::getId() de los tags cambiados
+};
+
+class ChangeSubscriber {
+public:
+    using ChangeSetPtr = std::shared_ptr<const ChangeSet>;
+
+    ChangeSubscriber(uint64_t id, const std::string& name, size_t capacity);
+    ~ChangeSubscriber();
+    ChangeSubscriber(const ChangeSubscriber&) = delete;
+    ChangeSubscriber& operator=(const ChangeSubscriber&) = delete;
+
+    // Productores (varios): nunca bloquea; false si la cola está llena
+    bool offer(const ChangeSetPtr& change_set);
+
+    // Consumidor (uno): extrae hasta max_sets conjuntos en orden de publicación
+    size_t poll(std::vector<ChangeSetPtr>& out, size_t max_sets = SIZE_MAX);
+
+    // true una sola vez tras descartar conjuntos: el consumidor debe releer todo
+    bool takeOverflow();
+
+    uint64_t getId() const { return id_; }
+    const std::string& getName() const { return name_; }
+    size_t capacity() const { return mask_ + 1; }
+    size_t depth() const;
+    nlohmann::json getStats() const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        ChangeSetPtr data;
+    };
+
+    uint64_t id_;
+    std::string name_;
+    size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    std::atomic<size_t> enqueue_pos_;
+    std::atomic<size_t> dequeue_pos_;
+
+    // Contrapresión
+    std::atomic<bool> overflowed_;
+    std::atomic<uint64_t> delivered_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<size_t> high_water_;
+};
+
+class ChangeBus {
+public:
+    using SubscriberPtr = std::shared_ptr<ChangeSubscriber>;
+
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 256;
+
+    ChangeBus();
+
+    // capacity se redondea a potencia de dos
+    SubscriberPtr subscribe(const std::string& name, size_t capacity = DEFAULT_QUEUE_CAPACITY);
+    void unsubscribe(const SubscriberPtr& subscriber);
+
+    // Sin bloqueo: recorre la lista publicada de suscriptores y ofrece el
+    // conjunto a cada cola. Devuelve cuántas colas lo rechazaron por llenas
+    size_t publish(std::vector<uint32_t> ids, uint64_t source_timestamp);
+
+    size_t subscriberCount() const;
+    nlohmann::json getStatus() const;
+
+private:
+    using SubscriberList = std::vector<SubscriberPtr>;
+
+    // Lista de suscriptores copiada al escribir; acceso con std::atomic_load/atomic_store
+    std::shared_ptr<const SubscriberList> subscribers_;
+    std::mutex subscribe_mutex_;                // Solo serializa subscribe/unsubscribe
+    std::atomic<uint64_t> next_subscriber_id_;
+    std::atomic<uint64_t> next_sequence_;
+    std::atomic<uint64_t> published_;
+    std::atomic<uint64_t> dropped_;
+};
+
+#endif // CHANGE_BUS_H
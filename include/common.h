@@ -18,7 +18,7 @@
 #define DEFAULT_OPC_PORT 4841
 #define DEFAULT_HTTP_PORT 8080
 #define DEFAULT_POLLING_INTERVAL 1000  // ms
-#define DEFAULT_MAX_HISTORY 1000
+#define DEFAULT_HISTORY_DEPTH 32     // Muestras de histórico por tag
 
 // Macros de logging con colores
 #define RESET_COLOR   "\033[0m"
@@ -142,7 +142,7 @@ struct SystemConfig {
     
     // Configuración general
     uint32_t polling_interval_ms = DEFAULT_POLLING_INTERVAL;
-    size_t max_history_size = DEFAULT_MAX_HISTORY;
+    size_t history_depth = DEFAULT_HISTORY_DEPTH;
     std::string log_level = "INFO";
     std::string log_file = "logs/planta_gas.log";
     bool enable_backup = true;
@@ -163,7 +163,7 @@ struct SystemConfig {
         
         LOG_INFO("Configuración general:");
         LOG_INFO("  • Intervalo polling: " + std::to_string(polling_interval_ms) + "ms");
-        LOG_INFO("  • Tamaño histórico: " + std::to_string(max_history_size));
+        LOG_INFO("  • Histórico por tag: " + std::to_string(history_depth) + " muestras");
         LOG_INFO("  • Nivel log: " + log_level);
         LOG_INFO("  • Archivo log: " + log_file);
         LOG_INFO("  • Backup: " + std::string(enable_backup ? "Habilitado" : "Deshabilitado"));
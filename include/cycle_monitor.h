@@ -0,0 +1,85 @@
+/*
+ * cycle_monitor.h - Detección de overruns y descarte de carga por prioridad
+ *
+ * Clases de tasa del polling PAC:
+ * - FAST:   TBL_OPCUA (nunca se descarta)
+ * - MEDIUM: tablas con demanda activa
+ * - SLOW:   tablas a tasa de integridad (sin demanda)
+ *
+ * Bajo sobrecarga sostenida se descarta primero SLOW y después MEDIUM.
+ * Las escrituras no pasan por el scheduler y nunca se descartan.
+ */
+
+#ifndef CYCLE_MONITOR_H
+#define CYCLE_MONITOR_H
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+enum class RateClass {
+    FAST = 0,
+    MEDIUM = 1,
+    SLOW = 2
+};
+
+std::string rateClassToString(RateClass rate_class);
+
+class CycleMonitor {
+public:
+    // Niveles de descarte
+    static constexpr int SHED_NONE = 0;
+    static constexpr int SHED_SLOW = 1;
+    static constexpr int SHED_SLOW_MEDIUM = 2;
+
+    struct ShedEvent {
+        uint64_t timestamp;     // ms desde epoch
+        RateClass rate_class;
+        std::string job;
+        int shed_level;
+    };
+
+    CycleMonitor(size_t window_size = 5, size_t overrun_threshold = 3, size_t recovery_cycles = 10);
+
+    // Registrar una ejecución: retraso respecto al deadline y duración.
+    // Devuelve true si hubo overrun (terminó después del siguiente deadline)
+    bool recordExecution(RateClass rate_class, std::chrono::milliseconds period,
+                         std::chrono::milliseconds lateness, std::chrono::milliseconds duration);
+
+    // ¿Debe descartarse trabajo de esta clase? FAST nunca
+    bool shouldShed(RateClass rate_class) const;
+    void recordShed(RateClass rate_class, const std::string& job);
+
+    int getShedLevel() const;
+    nlohmann::json getStatus() const;
+
+private:
+    struct ClassStats {
+        uint64_t executions = 0;
+        uint64_t overruns = 0;
+        uint64_t sheds = 0;
+        int64_t max_lateness_ms = 0;
+        int64_t last_duration_ms = 0;
+    };
+
+    void updateShedLevel(bool overrun);
+
+    ClassStats stats_[3];
+    std::deque<bool> recent_overruns_;
+    std::deque<ShedEvent> shed_events_;
+    size_t clean_streak_;
+    int shed_level_;
+
+    size_t window_size_;
+    size_t overrun_threshold_;
+    size_t recovery_cycles_;
+
+    mutable std::mutex mutex_;
+
+    static constexpr size_t MAX_SHED_EVENTS = 100;
+};
+
+#endif // CYCLE_MONITOR_H
@@ -0,0 +1,135 @@
+/*
+ * deadline_scheduler.h - Scheduler de deadlines basado en heap
+ *
+ * Reemplaza el loop de ticks de 500ms: el hilo de despacho duerme
+ * exactamente hasta el siguiente deadline (condition_variable::wait_until)
+ * y ejecuta los trabajos en orden. Los trabajos periódicos son de tasa fija
+ * (siguiente deadline = deadline anterior + periodo), por lo que el retraso
+ * de una ejecución no se acumula en las siguientes.
+ *
+ * La cancelación y reprogramación son perezosas: cada trabajo lleva una
+ * generación y las entradas del heap con generación antigua se descartan.
+ *
+ * Trabajos escalonados (scheduleStaggered): los trabajos con el mismo periodo
+ * se reparten uniformemente dentro del periodo, ordenados por hash de su
+ * clave, para evitar ráfagas de peticiones al PAC.
+ */
+
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class DeadlineScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using JobId = uint64_t;
+
+    // Información de despacho entregada a cada trabajo
+    struct DispatchInfo {
+        JobId id;
+        Clock::time_point deadline;     // Cuándo debía ejecutarse
+        Clock::time_point start;        // Cuándo se ejecutó
+        std::chrono::microseconds period;
+        uint64_t missed;                // Periodos saltados desde la ejecución anterior
+    };
+
+    using Callback = std::function<void(const DispatchInfo&)>;
+
+    DeadlineScheduler();
+    ~DeadlineScheduler();
+
+    // Trabajo periódico: primera ejecución en now + phase
+    JobId schedule(const std::string& name, std::chrono::microseconds period,
+                   std::chrono::microseconds phase, Callback callback);
+    // Trabajo periódico escalonado: fase = periodo * rango(hash(clave)) / tamaño del grupo
+    JobId scheduleStaggered(const std::string& name, std::chrono::microseconds period,
+                            const std::string& stagger_key, Callback callback);
+    // Trabajo de una sola ejecución tras delay
+    JobId scheduleOnce(const std::string& name, std::chrono::microseconds delay, Callback callback);
+
+    bool cancel(JobId id);
+    // Cambiar periodo; el siguiente deadline se recalcula desde la última ejecución
+    bool reschedule(JobId id, std::chrono::microseconds period);
+    // Adelantar la siguiente ejecución a ahora (los disparos repetidos se fusionan)
+    bool triggerNow(JobId id);
+
+    // Ejecuta el loop de despacho en el hilo llamador hasta stop()
+    void run();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    size_t jobCount() const;
+    nlohmann::json getStats() const;
+    void resetStats();
+
+private:
+    struct Job {
+        std::string name;
+        std::chrono::microseconds period;   // 0 = una sola ejecución
+        Callback callback;
+        Clock::time_point next_deadline;
+        Clock::time_point last_deadline;    // Deadline de la última ejecución (o del alta)
+        uint64_t generation;
+        uint64_t runs;
+        uint64_t missed;                    // Total de periodos saltados
+        uint64_t pending_missed;            // Saltados antes de la próxima ejecución
+        bool executing;
+        bool trigger_pending;               // triggerNow() recibido durante la ejecución
+        std::string stagger_key;            // Vacío = sin escalonar
+        uint64_t stagger_hash;
+        std::chrono::microseconds phase;    // Fase respecto a epoch_ (solo escalonados)
+    };
+
+    struct HeapEntry {
+        Clock::time_point deadline;
+        JobId id;
+        uint64_t generation;
+        bool operator>(const HeapEntry& other) const {
+            if (deadline != other.deadline) return deadline > other.deadline;
+            return id > other.id;
+        }
+    };
+
+    JobId addJob(const std::string& name, std::chrono::microseconds period,
+                 Clock::time_point first_deadline, Callback callback);
+    void pushLocked(JobId id, Job& job);
+    void addToGroupLocked(JobId id, Job& job);
+    void removeFromGroupLocked(JobId id, const Job& job);
+    void rebalanceGroupLocked(std::chrono::microseconds period);
+    Clock::time_point alignedDeadline(std::chrono::microseconds period, std::chrono::microseconds phase,
+                                      Clock::time_point after) const;
+    void recordJitterLocked(std::chrono::microseconds jitter);
+
+    std::unordered_map<JobId, Job> jobs_;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap_;
+    std::map<int64_t, std::vector<JobId>> stagger_groups_;   // periodo (us) -> trabajos escalonados
+    const Clock::time_point epoch_;
+    JobId next_id_;
+    std::atomic<bool> running_;
+    bool stop_requested_;
+
+    // Estadísticas de jitter de despacho (inicio real - deadline)
+    uint64_t dispatches_;
+    uint64_t missed_total_;
+    int64_t jitter_sum_us_;
+    int64_t jitter_max_us_;
+    static constexpr size_t JITTER_BUCKETS = 8;   // <50us, <100us, <250us, <500us, <1ms, <5ms, <10ms, >=10ms
+    uint64_t jitter_buckets_[JITTER_BUCKETS];
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+#endif // DEADLINE_SCHEDULER_H
@@ -0,0 +1,125 @@
+/*
+ * historian.h - Histórico comprimido en memoria
+ *
+ * Segundo nivel del histórico, detrás de los buffers circulares por tag:
+ * retiene horas o días de cada tag numérico en pocos bytes por punto.
+ *
+ * 1. Compresión por excepción configurable por tag:
+ *    - "deadband":      se archiva un punto cuando se aleja más de
+ *                       "deviation" del último archivado.
+ *    - "swinging_door": se archiva cuando ya no existe una recta desde el
+ *                       último punto archivado que pase a menos de
+ *                       "deviation" de todos los recibidos desde entonces.
+ *    - "none":          se archivan todos los puntos.
+ *    Un cambio de calidad siempre se archiva.
+ *
+ * 2. Los puntos archivados se codifican en bloques de tamaño fijo: timestamp
+ *    como delta de deltas y valor como XOR con el anterior (esquema Gorilla).
+ *    Una serie a 1 s con valor estable ocupa 2 bits por punto.
+ *
+ * Las consultas solo decodifican los bloques cuyo rango de tiempo se solapa
+ * con el pedido. El último punto recibido (aún no archivado) se devuelve
+ * siempre como cola de la serie.
+ *
+ * Sin sincronización propia: TagManager guarda cada serie en la partición de
+ * su tag y la usa bajo el mutex de la partición.
+ */
+
+#ifndef HISTORIAN_H
+#define HISTORIAN_H
+
+#include "tag.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct HistorianPoint {
+    uint64_t timestamp;         // Timestamp de origen (ms)
+    double value;
+    TagQuality quality;
+};
+
+struct HistorianCompression {
+    enum class Mode : uint8_t {
+        NONE = 0,
+        DEADBAND = 1,
+        SWINGING_DOOR = 2
+    };
+
+    Mode mode = Mode::SWINGING_DOOR;
+    double deviation = 0.0;                 // Unidades de ingeniería
+    uint64_t retention_ms = 24 * 3600 * 1000ULL;  // Bloques cerrados más antiguos se descartan
+
+    // {"mode": "swinging_door", "deviation": 0.5, "retention_hours": 24}; false con error si no es válido
+    static bool parse(const nlohmann::json& config, HistorianCompression& out, std::string& error);
+    static const char* modeName(Mode mode);
+};
+
+// Bloque de tamaño fijo con puntos codificados
+struct HistorianBlock {
+    static constexpr size_t BYTES = 256;
+
+    uint64_t first_timestamp = 0;
+    uint64_t last_timestamp = 0;
+    uint32_t count = 0;
+    uint32_t bits = 0;                      // Bits escritos en data
+    uint8_t data[BYTES] = {};
+
+    // Decodificar todos los puntos en orden
+    void decode(std::vector<HistorianPoint>& out) const;
+};
+
+class HistorianSeries {
+public:
+    explicit HistorianSeries(const HistorianCompression& compression);
+
+    // Punto recibido: pasa el filtro de compresión y, si se archiva, se codifica
+    void append(uint64_t timestamp, double value, TagQuality quality);
+
+    // Puntos en [start, end] en orden de tiempo (como mucho max_points, los más antiguos)
+    void query(uint64_t start, uint64_t end, size_t max_points, std::vector<HistorianPoint>& out) const;
+
+    void setCompression(const HistorianCompression& compression);
+    const HistorianCompression& compression() const { return compression_; }
+
+    uint64_t receivedPoints() const { return received_; }
+    uint64_t archivedPoints() const { return archived_; }
+    size_t blocks() const { return sealed_.size() + (open_ ? 1 : 0); }
+    size_t bytes() const { return blocks() * sizeof(HistorianBlock); }
+    size_t encodedBytes() const;            // Bytes realmente escritos en los bloques
+
+private:
+    // Escritura en el bloque abierto; lo cierra cuando no cabe un punto más
+    void archive(uint64_t timestamp, double value, TagQuality quality);
+    void seal();
+
+    HistorianCompression compression_;
+
+    // Bloques cerrados (más antiguo primero) y bloque abierto
+    std::deque<std::unique_ptr<HistorianBlock>> sealed_;
+    std::unique_ptr<HistorianBlock> open_;
+
+    // Estado del codificador del bloque abierto
+    uint64_t prev_timestamp_ = 0;
+    int64_t prev_delta_ = 0;
+    uint64_t prev_bits_ = 0;
+    uint8_t prev_leading_ = 0xFF;           // 0xFF: sin ventana XOR previa
+    uint8_t prev_trailing_ = 0;
+    TagQuality prev_quality_ = TagQuality::GOOD;
+
+    // Estado del filtro de compresión
+    bool has_archived_ = false;
+    HistorianPoint last_archived_{};
+    bool has_pending_ = false;
+    HistorianPoint pending_{};              // Último recibido sin archivar
+    double slope_upper_ = 0.0;
+    double slope_lower_ = 0.0;
+
+    uint64_t received_ = 0;
+    uint64_t archived_ = 0;
+};
+
+#endif // HISTORIAN_H
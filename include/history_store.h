@@ -0,0 +1,202 @@
+/*
+ * history_store.h - Histórico persistente en segmentos de solo anexado
+ *
+ * Tercer nivel del histórico: las muestras numéricas se guardan en disco y
+ * sobreviven a reinicios, recargas de configuración y clearHistory().
+ *
+ * - Escritura diferida: append() solo encola la muestra en el buffer de su
+ *   partición (acotado a max_buffered; lo que no cabe se descarta y se
+ *   cuenta). Un hilo escritor vuelca cada flush_interval_ms todas las
+ *   particiones (un write() y un fdatasync() por fichero: group commit).
+ *   El lote en escritura sigue visible para las consultas hasta indexarse.
+ * - Ni el escritor ni las consultas hacen E/S con el mutex de la partición:
+ *   bajo el mutex solo se copian el índice y el fichero activo.
+ * - Un segmento activo por día y partición (history-AAAAMMDD-sNN-K.seg).
+ *   Cada volcado añade un chunk por tag: cabecera con hash del nombre, rango
+ *   de tiempo y checksum, seguida de registros de 16 bytes.
+ * - Al cambiar de día (o al cerrar) el segmento se sella: se escribe al
+ *   final un índice (hash, rango de tiempo y offset de cada chunk) ordenado
+ *   por hash, fdatasync, y después el trailer con el checksum del índice;
+ *   el fichero se mapea en memoria de solo lectura para consultas.
+ * - Al abrir se mapean los segmentos sellados (índice y entradas validados);
+ *   uno sin trailer válido (caída) se recorre chunk a chunk, se trunca en el
+ *   primero inválido y se sella.
+ * - Retención por antigüedad (retention_days) y por tamaño total (max_mb):
+ *   se borran los segmentos sellados más antiguos.
+ */
+
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include "historian.h"
+#include "tag_history.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class HistoryStore {
+public:
+    struct Options {
+        size_t shards = 0;                          // 0 = la elige el propietario (mínimo 1)
+        uint32_t flush_interval_ms = 1000;          // Cadencia del group commit
+        uint64_t retention_ms = 30 * 24 * 3600 * 1000ULL;   // 0 = sin límite
+        uint64_t max_bytes = 0;                     // 0 = sin límite
+        size_t max_buffered = 1 << 20;              // Muestras pendientes por partición: adelantan el volcado y, llenas, se descartan
+
+        // {"path": ..., "flush_interval_ms": 1000, "retention_days": 30, "max_mb": 0}
+        static bool parse(const nlohmann::json& config, Options& out, std::string& error);
+    };
+
+    HistoryStore();
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Abrir (o crear) el directorio, recuperar segmentos y arrancar el escritor
+    bool open(const std::string& directory, const Options& options);
+    // Volcar lo pendiente, sellar los segmentos activos y parar el escritor
+    void close();
+    bool isOpen() const { return open_.load(std::memory_order_acquire); }
+    const std::string& directory() const { return directory_; }
+
+    // O(1) bajo el mutex de la partición; el disco lo toca el escritor.
+    // Con el buffer de la partición lleno la muestra se descarta (dropped_samples)
+    void append(uint64_t name_hash, uint64_t timestamp, double value, TagQuality quality);
+
+    // Como mucho max_points puntos del tag en [start, end] desde el extremo indicado por
+    // order (OLDEST_FIRST: los más antiguos, en orden de tiempo; NEWEST_FIRST: los más
+    // recientes, el último primero). Los chunks se leen desde ese extremo y solo los necesarios
+    void query(uint64_t name_hash, uint64_t start, uint64_t end, size_t max_points,
+               std::vector<HistorianPoint>& out, HistoryOrder order = HistoryOrder::OLDEST_FIRST) const;
+
+    // Group commit inmediato de todas las particiones
+    void flush();
+
+    nlohmann::json getStatus() const;
+
+    static uint64_t hashName(const std::string& name);
+
+private:
+    struct ChunkHeader {
+        uint32_t magic;
+        uint32_t count;
+        uint64_t name_hash;
+        uint64_t first_timestamp;
+        uint64_t last_timestamp;
+        uint64_t checksum;              // De los registros
+    };
+
+    struct Record {
+        uint32_t offset_ms;             // Respecto a first_timestamp del chunk
+        uint8_t quality;
+        uint8_t reserved[3];
+        double value;
+    };
+
+    struct IndexEntry {
+        uint64_t name_hash;
+        uint64_t first_timestamp;
+        uint64_t last_timestamp;
+        uint64_t offset;                // Cabecera del chunk
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct Trailer {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t entries;
+        uint64_t index_offset;
+        uint64_t first_timestamp;
+        uint64_t last_timestamp;
+        uint64_t index_checksum;
+    };
+
+    struct Sample {
+        uint64_t name_hash;
+        uint64_t timestamp;
+        double value;
+        TagQuality quality;
+    };
+
+    // Segmento sellado y mapeado (se desmapea con su último usuario)
+    struct Segment {
+        std::string path;
+        const uint8_t* mapping = nullptr;
+        size_t bytes = 0;
+        const IndexEntry* index = nullptr;
+        size_t entries = 0;
+        uint64_t first_timestamp = 0;
+        uint64_t last_timestamp = 0;
+        ~Segment();
+    };
+
+    // Fichero del segmento activo: se cierra con su último usuario, de modo que una
+    // consulta puede leerlo con pread fuera del mutex mientras el escritor lo sella
+    struct ActiveFile {
+        int fd = -1;
+        std::string path;
+        ~ActiveFile();
+    };
+
+    // Solo el escritor (con flush_mutex_) cambia el segmento activo; las lecturas
+    // de consultas y las modificaciones se hacen con el mutex de la partición
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Sample> buffer;
+        std::shared_ptr<const std::vector<Sample>> inflight;   // Lote en escritura, visible hasta indexarse
+
+        // Segmento activo: índice en memoria hasta que se sella
+        std::shared_ptr<const ActiveFile> active;
+        uint64_t day = 0;
+        uint64_t bytes = 0;
+        uint64_t first_timestamp = UINT64_MAX;
+        uint64_t last_timestamp = 0;
+        std::unordered_map<uint64_t, std::vector<IndexEntry>> index;
+
+        std::vector<std::shared_ptr<const Segment>> sealed;     // Más antiguo primero
+    };
+
+    static constexpr uint32_t CHUNK_MAGIC = 0x4B484348;       // "HCHK"
+    static constexpr uint64_t TRAILER_MAGIC = 0x31474553484C5048ULL;   // "HPLHSEG1"
+    static constexpr uint32_t VERSION = 2;             // 2: checksum del índice en el trailer
+
+    void writerLoop();
+    bool flushShard(size_t shard_index);
+    bool openActive(Shard& shard, size_t shard_index, uint64_t day);
+    bool sealShard(Shard& shard);
+    std::shared_ptr<const Segment> mapSegment(const std::string& path) const;
+    std::shared_ptr<const Segment> recoverSegment(const std::string& path);
+    void applyRetention();
+    static uint64_t checksum(const void* data, size_t bytes);
+    static bool writeAll(int fd, const void* data, size_t bytes, uint64_t offset);
+    static void collect(const ChunkHeader& header, const Record* records, uint64_t start, uint64_t end,
+                        std::vector<HistorianPoint>& out);
+
+    std::string directory_;
+    Options options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> open_;
+
+    std::thread writer_;
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    bool stop_writer_;
+    std::mutex flush_mutex_;            // Un solo volcado a la vez (escritor o flush())
+    uint64_t reported_drops_ = 0;       // Descartes ya avisados en el log (con flush_mutex_)
+
+    std::atomic<uint64_t> flushed_samples_;
+    std::atomic<uint64_t> dropped_samples_;
+    std::atomic<uint64_t> commits_;
+    std::atomic<uint64_t> removed_segments_;
+};
+
+#endif // HISTORY_STORE_H
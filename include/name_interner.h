@@ -0,0 +1,58 @@
+/*
+ * name_interner.h - Internado global de nombres de tags
+ *
+ * Cada nombre (tag padre "ET_1601", variable "PV" o nombre completo
+ * "ET_1601.PV") recibe un NameId pequeño y estable con su hash precalculado.
+ * Los nombres nunca se liberan: los IDs se resuelven una vez al cargar la
+ * configuración y los caminos calientes trabajan solo con enteros, sin
+ * construir ni hashear std::string en régimen estable.
+ */
+
+#ifndef NAME_INTERNER_H
+#define NAME_INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class NameInterner {
+public:
+    using NameId = uint32_t;
+    static constexpr NameId INVALID_NAME = UINT32_MAX;
+
+    static NameInterner& instance();
+
+    // Registrar (o recuperar) el ID de un nombre
+    NameId intern(std::string_view name);
+
+    // Solo consulta, sin asignar memoria: INVALID_NAME si no está internado
+    NameId find(std::string_view name) const;
+
+    // Texto y hash precalculado de un ID válido
+    const std::string& name(NameId id) const;
+    size_t hash(NameId id) const;
+
+    size_t size() const;
+
+    // Clave de ruta padre/variable para índices por enteros
+    static uint64_t pathKey(NameId parent, NameId variable) {
+        return (static_cast<uint64_t>(parent) << 32) | variable;
+    }
+
+private:
+    NameInterner() = default;
+
+    struct Entry {
+        std::string text;
+        size_t hash;
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::deque<Entry> entries_;                             // Direcciones estables
+    std::unordered_map<std::string_view, NameId> index_;    // Vistas sobre entries_
+};
+
+#endif // NAME_INTERNER_H
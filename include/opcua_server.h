@@ -48,6 +48,12 @@ private:
     // Callback timer para updates
     UA_UInt64 callback_id_;
     
+    // Ítems monitoreados activos (demanda de clientes OPC UA)
+    std::atomic<size_t> monitored_items_;
+    
+    // Generación de épocas de fuente ya publicada: si cambia, republicar los tags con fuente
+    uint64_t published_source_generation_;
+    
 public:
     // Constructor adaptado para nueva arquitectura
     explicit OPCUAServer(std::shared_ptr<TagManager> tag_manager);
@@ -72,6 +78,8 @@ public:
     void updateSpecificTag(std::shared_ptr<Tag> tag);
     void updateTagsFromPAC(); // Solo para datos recientes del PAC
     
+    size_t getMonitoredItemCount() const { return monitored_items_; }
+    
 private:
     
     // === CREACIÓN DE ESTRUCTURA OPC UA ===
@@ -114,6 +122,12 @@ void handleWrite(UA_Server* server, const UA_NodeId* sessionId,
                 void* nodeContext, const UA_NumericRange* range,
                 const UA_DataValue* data);
     
+    // Alta/baja de ítems monitoreados: registra demanda en el TagManager
+    static void monitoredItemCallback(UA_Server* server, const UA_NodeId* sessionId,
+                                      void* sessionContext, const UA_NodeId* nodeId,
+                                      void* nodeContext, UA_UInt32 attributeId,
+                                      UA_Boolean removed);
+    
     // === MANEJO DE DATOS ===
     
     // Callback de actualización periódica (deshabilitado por diseño)
@@ -124,7 +138,7 @@ void handleWrite(UA_Server* server, const UA_NodeId* sessionId,
     // Mapeo de nombres
     std::string buildNodePath(const std::string& tag_opcua_name, const std::string& variable_name);
     std::string getInternalTagName(const std::string& opcua_name);
-    std::string getFolderForTag(const std::string& tag_opcua_name);
+    std::string getFolderForTag(const std::string& tag_prefix);     // Prefijo de familia o nombre completo
     std::string categorizeTagByName(const std::string& tag_name);
     
     // Conversión de tipos
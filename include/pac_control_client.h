@@ -18,12 +18,31 @@
 #include <mutex>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <thread>
+#include "tag.h"
+#include "name_interner.h"
+#include "cycle_monitor.h"
+#include "source_epochs.h"
 
 // Forward declarations
 class TagManager;
+struct TagSnapshot;
 
 class PACControlClient {
 public:
+    // Estado del enlace gestionado por el hilo de reconexión
+    enum class LinkState {
+        DISCONNECTED,
+        CONNECTING,
+        CONNECTED,
+        BACKOFF
+    };
+    
     // Estadísticas
     struct ClientStats {
         uint64_t successful_reads = 0;
@@ -56,11 +75,52 @@ private:
     
     // Cache para TBL_OPCUA (optimización crítica)
     std::vector<float> opcua_table_cache_;
+    uint64_t opcua_table_source_timestamp_;     // Timestamp de origen de la trama en cache
     std::chrono::time_point<std::chrono::steady_clock> last_opcua_read_;
+    std::atomic<int64_t> last_rtt_us_;          // RTT de la última lectura de tabla
     
     // Mapeo de tags a índices de TBL_OPCUA (cargado desde configuración)
     std::unordered_map<std::string, int> tag_opcua_index_map_;
+    // El mismo mapeo con nombres internados: (padre, índice) y padres cuyo PV llega por TBL_OPCUA
+    std::vector<std::pair<NameInterner::NameId, int>> opcua_pv_indices_;
+    std::unordered_set<NameInterner::NameId> opcua_pv_parents_;
+    // Input crudo de instrumentos escalados en TBL_OPCUA ("opcua_input_index"), igual que los PV
+    std::unordered_map<std::string, int> tag_opcua_input_map_;
+    std::vector<std::pair<NameInterner::NameId, int>> opcua_input_indices_;
+    std::unordered_set<NameInterner::NameId> opcua_input_parents_;
+    // Tabla PAC -> tag padre internado (se resuelve una vez por tabla)
+    std::unordered_map<std::string, NameInterner::NameId> table_parent_ids_;
+    std::mutex table_parent_mutex_;
     ClientStats stats_;
+    
+    // Peticiones MMP por segundo (ventana circular de REQUEST_RATE_WINDOW_S segundos)
+    static constexpr size_t REQUEST_RATE_WINDOW_S = 60;
+    std::array<uint32_t, REQUEST_RATE_WINDOW_S> request_counts_{};
+    std::array<int64_t, REQUEST_RATE_WINDOW_S> request_seconds_{};
+    mutable std::mutex rate_mutex_;
+    
+    // Reconexión en segundo plano: connect no bloqueante con deadline y
+    // backoff exponencial con jitter completo
+    int connect_timeout_ms_;
+    int backoff_base_ms_;
+    int backoff_max_ms_;
+    std::mutex connect_mutex_;
+    std::unique_ptr<std::thread> reconnect_thread_;
+    std::atomic<bool> reconnect_running_;
+    mutable std::mutex reconnect_mutex_;
+    std::condition_variable reconnect_cv_;
+    LinkState link_state_;
+    uint32_t reconnect_attempts_;
+    uint64_t total_reconnects_;
+    std::string last_connect_error_;
+    int64_t current_backoff_ms_;
+    int64_t last_outage_ms_;
+    std::chrono::steady_clock::time_point link_down_since_;
+    bool link_down_pending_;
+    std::function<void()> on_connected_;
+    std::mt19937 backoff_rng_;
+    // Fuente "pac" en las épocas de TagManager: cada caída/reconexión es un incremento
+    SourceEpochs::SourceId source_id_;
 
 public:
     // Constructor adaptado para shared_ptr (nueva versión)
@@ -81,6 +141,14 @@ public:
     void setConnectionParams(const std::string& ip, int port);
     void setCredentials(const std::string& username, const std::string& password);
     void setTimeout(int timeout_ms) { timeout_ms_ = timeout_ms; }
+    void setReconnectPolicy(int connect_timeout_ms, int backoff_base_ms, int backoff_max_ms);
+    
+    // Reconexión automática en segundo plano
+    void startAutoReconnect();
+    void stopAutoReconnect();
+    // Se invoca (desde el hilo que conecta) cada vez que el enlace queda establecido
+    void setOnConnected(std::function<void()> callback);
+    nlohmann::json getLinkStatus() const;
     
     // Operaciones principales
     
@@ -90,9 +158,24 @@ public:
     // NUEVA ESTRATEGIA: Leer tablas individuales con datos reales
     bool readIndividualTables();
     
-    // Lectura de tablas usando protocolo MMP de Opto 22
-    std::vector<float> readFloatTable(const std::string& table_name, int start_pos = 0, int end_pos = 9);
-    std::vector<int32_t> readInt32Table(const std::string& table_name, int start_pos = 0, int end_pos = 4);
+    // Lectura de una sola tabla (usado por el polling por demanda); rate_class es
+    // la clase a la que se sondea y fija el plazo de refresco de sus tags
+    bool readIndividualTable(const std::string& table_name, RateClass rate_class = RateClass::SLOW);
+    bool readAlarmTable(const std::string& table_name, RateClass rate_class = RateClass::SLOW);
+    
+    // Tablas configuradas y tag padre asociado a cada una
+    static const std::vector<std::string>& getValueTables();
+    static const std::vector<std::string>& getAlarmTables();
+    static std::string tagNameForValueTable(const std::string& table_name);
+    static std::string tagNameForAlarmTable(const std::string& table_name);
+    
+    // Lectura de tablas usando protocolo MMP de Opto 22. source_timestamp (opcional)
+    // recibe el timestamp de origen de la trama: envío + RTT/2, con un solo muestreo
+    // del reloj de pared por trama
+    std::vector<float> readFloatTable(const std::string& table_name, int start_pos = 0, int end_pos = 9,
+                                      uint64_t* source_timestamp = nullptr);
+    std::vector<int32_t> readInt32Table(const std::string& table_name, int start_pos = 0, int end_pos = 4,
+                                        uint64_t* source_timestamp = nullptr);
     
     // Lectura de variables individuales usando protocolo MMP
     float readSingleFloatVariableByTag(const std::string& tag_name);
@@ -105,18 +188,29 @@ public:
     bool writeSingleInt32Variable(const std::string& variable_name, int32_t value);
     
     // Actualización de TagManager
-    bool updateTagManagerFromAlarmTable(const std::string& table_name, const std::vector<int32_t>& values);
+    bool updateTagManagerFromAlarmTable(const std::string& table_name, const std::vector<int32_t>& values,
+                                        uint64_t source_timestamp, RateClass rate_class = RateClass::SLOW);
+    void markTableQuality(const std::string& table_name, bool is_alarm_table, TagQuality quality);
     
     // Estadísticas
     const ClientStats& getStats() const;
     std::string getStatsReport() const;
     void resetStats();
+    
+    // Histograma de peticiones por segundo (últimos REQUEST_RATE_WINDOW_S segundos)
+    nlohmann::json getRequestRateStats() const;
 
 private:
     // Inicialización del socket TCP
     bool initializeSocket();
     void cleanupSocket();
     
+    // Conexión y reconexión
+    bool connectOnce(std::string& error);
+    void reconnectLoop();
+    void markLinkDown(const std::string& reason);
+    std::chrono::milliseconds nextBackoff();
+    
     // Comunicación TCP usando protocolo MMP de Opto 22
     bool sendCommand(const std::string& command);
     std::vector<uint8_t> receiveData(size_t expected_bytes);
@@ -131,14 +225,29 @@ private:
     // Utilidades del protocolo
     void flushSocketBuffer();
     bool validateDataIntegrity(const std::vector<uint8_t>& data, const std::string& table_name);
+    uint64_t frameSourceTimestamp(uint64_t sent_ms, std::chrono::steady_clock::time_point sent);
     std::string cleanASCIINumber(const std::string& ascii_str);
     float convertStringToFloat(const std::string& str);
     int32_t convertStringToInt32(const std::string& str);
     
     // Optimización TBL_OPCUA
     bool updateTagManagerFromOPCUATable();
-    bool updateTagManagerFromIndividualTable(const std::string& table_name, const std::vector<float>& values);
+    bool updateTagManagerFromIndividualTable(const std::string& table_name, const std::vector<float>& values,
+                                             uint64_t source_timestamp, RateClass rate_class = RateClass::SLOW,
+                                             size_t first_index = 0);
+    
+    // Escalado en el gateway: Input llega en la trama de TBL_OPCUA si tiene "opcua_input_index"
+    // y la tabla individual se pide de SetHH a max; si no, Input llega con su tabla (Input..max).
+    // percent no se pide y el PV del rango se descarta
+    static constexpr int SCALED_TABLE_FIRST = 1;
+    static constexpr int SCALED_TABLE_LAST = 8;
+    bool isScaledInstrument(const TagSnapshot& snapshot, NameInterner::NameId parent_id) const;
     int getTagOPCUATableIndex(const std::string& tag_name) const;
+    static const std::vector<std::string>& valueTableVariables();
+    static const std::vector<std::string>& alarmTableVariables();
+    static const std::vector<NameInterner::NameId>& valueTableVariableIds();
+    static const std::vector<NameInterner::NameId>& alarmTableVariableIds();
+    NameInterner::NameId parentIdForTable(const std::string& table_name, bool is_alarm_table);
     bool loadTagOPCUAMapping(const std::string& config_file);
     
     // Modo simulación temporal
@@ -146,6 +255,7 @@ private:
     
     // Utilidades
     void updateStats(bool success, double response_time_ms);
+    void recordRequest();
     void logError(const std::string& operation, const std::string& details);
     void logSuccess(const std::string& operation, const std::string& details = "");
     
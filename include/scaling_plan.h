@@ -0,0 +1,106 @@
+/*
+ * scaling_plan.h - Escalado a unidades de ingeniería en el gateway
+ *
+ * Los instrumentos con "scaling" en su configuración derivan PV y percent
+ * de su valor crudo Input en lugar de leer los valores que calcula la
+ * estrategia del PAC:
+ *
+ *   "scaling": {"mode": "linear", "raw_min": 4, "raw_max": 20}
+ *   "scaling": {"mode": "sqrt", "raw_min": 0, "raw_max": 32000, "eu_min": 0, "eu_max": 500}
+ *   "scaling": {"mode": "piecewise", "points": [[0, 0], [50, 20], [100, 100]]}
+ *
+ * El rango de ingeniería es eu_min/eu_max si se configuran y, si no, los
+ * sub-tags min/max del instrumento (piecewise: primer y último punto).
+ *
+ * El plan es inmutable y se reconstruye en cada carga de configuración. Una
+ * trama decodificada se escala en una pasada: se reúnen los Input de todos
+ * sus instrumentos en columnas contiguas y lineal/raíz se calculan en bucles
+ * sin saltos que el compilador vectoriza; solo piecewise es escalar.
+ */
+
+#ifndef SCALING_PLAN_H
+#define SCALING_PLAN_H
+
+#include "tag_value.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct TagUpdate;
+struct TagSnapshot;
+
+class ScalingPlan {
+public:
+    using TagId = uint32_t;
+    static constexpr TagId NO_TAG = UINT32_MAX;
+
+    enum class Mode : uint8_t {
+        LINEAR = 0,
+        SQRT = 1,
+        PIECEWISE = 2
+    };
+
+    struct Config {
+        Mode mode = Mode::LINEAR;
+        float raw_min = 0.0f;
+        float raw_max = 100.0f;
+        bool has_eu_range = false;
+        float eu_min = 0.0f;
+        float eu_max = 100.0f;
+        std::vector<std::pair<float, float>> points;    // (crudo, ingeniería) en orden creciente
+    };
+
+    // IDs de los sub-tags del instrumento (NO_TAG si no existe)
+    struct Targets {
+        TagId input = NO_TAG;
+        TagId pv = NO_TAG;
+        TagId percent = NO_TAG;
+        TagId min = NO_TAG;
+        TagId max = NO_TAG;
+    };
+
+    // Interpretar el objeto "scaling" de un instrumento; false con error si no es válido
+    static bool parse(const nlohmann::json& scaling, Config& out, std::string& error);
+
+    // Construcción (antes de publicar el plan)
+    void add(const Targets& targets, const Config& config);
+
+    bool empty() const { return targets_.empty(); }
+    size_t size() const { return targets_.size(); }
+
+    // PV y percent de instrumentos escalados: el gateway los calcula y la fuente no los escribe
+    bool isDerived(TagId id) const { return id < derived_.size() && derived_[id]; }
+
+    // Escalar los Input presentes en la trama y añadir a derived sus PV y percent
+    // (con la calidad del Input). Devuelve cuántos instrumentos se escalaron
+    size_t apply(const std::vector<TagUpdate>& frame, const TagSnapshot& snapshot,
+                 std::vector<TagUpdate>& derived) const;
+
+    nlohmann::json getStatus() const;
+
+private:
+    static constexpr uint32_t NOT_SCALED = UINT32_MAX;
+
+    static float interpolate(const std::vector<std::pair<float, float>>& points, float raw);
+
+    // Columnas por instrumento; el rango de ingeniería fijo se precalcula y solo
+    // los instrumentos con rango dinámico (sub-tags min/max) lo leen en cada trama
+    std::vector<Targets> targets_;
+    std::vector<Config> configs_;
+    std::vector<Mode> modes_;
+    std::vector<float> raw_min_;
+    std::vector<float> raw_span_inv_;
+    std::vector<float> eu_min_;
+    std::vector<float> eu_span_;
+    std::vector<uint8_t> dynamic_range_;
+    size_t dynamic_count_ = 0;
+
+    // Índices densos por ID de tag
+    std::vector<uint32_t> instrument_by_input_;
+    std::vector<uint8_t> derived_;
+    size_t mode_counts_[3] = {0, 0, 0};
+};
+
+#endif // SCALING_PLAN_H
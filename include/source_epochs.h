@@ -0,0 +1,72 @@
+/*
+ * source_epochs.h - Épocas de conexión por fuente de datos
+ *
+ * Cada fuente (p.ej. el PAC) tiene un contador de época: par = enlace activo,
+ * impar = enlace caído. Cada transición es un único incremento atómico.
+ * Los tags alimentados por una fuente guardan la época con la que se
+ * escribió su último valor; su calidad efectiva es la propia solo si esa
+ * época sigue siendo la actual y el enlace está activo, y STALE en otro caso:
+ * - Al caer el enlace todos sus tags pasan a STALE sin tocar ningún tag.
+ * - Al reconectar cada tag vuelve a su calidad con el primer valor nuevo.
+ *
+ * La calidad efectiva se resuelve al leer (OPC UA, HTTP, exportación).
+ */
+
+#ifndef SOURCE_EPOCHS_H
+#define SOURCE_EPOCHS_H
+
+#include "tag.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SourceEpochs {
+public:
+    using SourceId = uint16_t;
+    static constexpr SourceId NO_SOURCE = UINT16_MAX;
+    static constexpr size_t MAX_SOURCES = 16;
+
+    SourceEpochs();
+
+    // Registrar (o recuperar) una fuente por nombre; NO_SOURCE si no quedan ranuras
+    SourceId registerSource(const std::string& name);
+
+    // Transiciones del enlace: devuelven false si la fuente ya estaba en ese estado
+    bool linkDown(SourceId source);
+    bool linkUp(SourceId source);
+
+    uint32_t current(SourceId source) const {
+        return source < MAX_SOURCES ? epochs_[source].load(std::memory_order_acquire) : 0;
+    }
+    static bool isUp(uint32_t epoch) { return (epoch & 1) == 0; }
+
+    // Calidad efectiva a partir de la calidad propia y la época del último valor
+    TagQuality effective(TagQuality own, SourceId source, uint32_t epoch) const {
+        if (source == NO_SOURCE) {
+            return own;
+        }
+        uint32_t now = current(source);
+        return (epoch == now && isUp(now)) ? own : TagQuality::STALE;
+    }
+    TagQuality effective(const Tag& tag) const {
+        SourceId source;
+        uint32_t epoch;
+        tag.getSourceEpoch(source, epoch);
+        return effective(tag.getQuality(), source, epoch);
+    }
+
+    // Cambia con cualquier transición de cualquier fuente (para republicar en bloque)
+    uint64_t generation() const;
+
+    nlohmann::json getStatus() const;
+
+private:
+    std::atomic<uint32_t> epochs_[MAX_SOURCES];
+    std::vector<std::string> names_;            // Solo crece, bajo mutex_
+    mutable std::mutex mutex_;
+};
+
+#endif // SOURCE_EPOCHS_H
@@ -0,0 +1,121 @@
+/*
+ * staleness_engine.h - Plazos de refresco y calidad por antigüedad
+ *
+ * Cada trama aplicada en TagManager registra sus IDs con la clase de tasa a
+ * la que se sondea su tabla (FAST, MEDIUM, SLOW). El periodo esperado de un
+ * tag es el de la clase de su último refresco.
+ *
+ * Todos los tags de una clase comparten periodo, así que su plazo solo
+ * depende del instante de refresco: cada clase mantiene una lista intrusiva
+ * ordenada por plazo en la que una trama forma un tramo contiguo (bucket).
+ * Refrescar mueve el tag al final en O(1) y un barrido solo extrae las
+ * cabezas vencidas: su coste es el número de tags que cambian de estado.
+ *
+ * Escalado por tag:
+ * - Sin refresco en periodo * 1.5       -> UNCERTAIN (Uncertain_LastUsableValue)
+ * - Sin refresco en periodo * N (def. 3) -> STALE     (Bad_NoCommunication)
+ */
+
+#ifndef STALENESS_ENGINE_H
+#define STALENESS_ENGINE_H
+
+#include "cycle_monitor.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class StalenessEngine {
+public:
+    using TagId = uint32_t;
+
+    struct Expired {
+        std::vector<TagId> uncertain;
+        std::vector<TagId> stale;
+    };
+
+    StalenessEngine();
+
+    // Periodo esperado por clase de tasa
+    void setPeriod(RateClass rate_class, std::chrono::milliseconds period);
+    std::chrono::milliseconds getPeriod(RateClass rate_class) const;
+    void setStaleAfterPeriods(uint32_t periods);
+
+    // Registrar los IDs refrescados por una trama; now_ms en reloj monótono
+    void refresh(const std::vector<TagId>& ids, RateClass rate_class, uint64_t now_ms);
+
+    // IDs cuyo plazo venció sin refresco desde el último barrido
+    Expired sweep(uint64_t now_ms);
+    // Igual, pero apply(expired) se ejecuta antes de soltar el mutex: una trama que
+    // llame a refresh() antes de escribir sus valores los escribe después de apply
+    template <typename Apply>
+    Expired sweep(uint64_t now_ms, Apply&& apply);
+
+    // Olvidar un tag (su ID queda libre para otro) o todos (recarga de configuración)
+    void forget(TagId id);
+    void clear();
+
+    nlohmann::json getStatus() const;
+
+    static uint64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static constexpr size_t RATE_CLASSES = 3;
+    static constexpr TagId NIL = UINT32_MAX;
+
+    enum Stage : uint8_t {
+        UNTRACKED = 0,
+        FRESH = 1,
+        UNCERTAIN = 2,
+        STALE = 3
+    };
+
+    struct Slot {
+        uint64_t refreshed_ms = 0;
+        TagId prev = NIL;
+        TagId next = NIL;
+        Stage stage = UNTRACKED;
+        uint8_t rate_class = 0;
+    };
+
+    // Lista por clase y etapa pendiente: [clase][0] FRESH, [clase][1] UNCERTAIN
+    struct List {
+        TagId head = NIL;
+        TagId tail = NIL;
+    };
+
+    List& listFor(const Slot& slot) {
+        return lists_[slot.rate_class][slot.stage == FRESH ? 0 : 1];
+    }
+    void append(TagId id, List& list);
+    void unlink(TagId id, List& list);
+    void setStage(Slot& slot, Stage stage);
+    void expireList(List& list, uint64_t max_age_ms, uint64_t now_ms, Stage stage, std::vector<TagId>& out);
+    Expired sweepLocked(uint64_t now_ms);
+
+    mutable std::mutex mutex_;
+    uint64_t periods_ms_[RATE_CLASSES];
+    uint32_t stale_after_periods_;
+    List lists_[RATE_CLASSES][2];
+    std::vector<Slot> slots_;
+    size_t stage_counts_[4];
+
+    // Estadísticas
+    uint64_t sweeps_;
+    uint64_t uncertain_marked_;
+    uint64_t stale_marked_;
+};
+
+template <typename Apply>
+StalenessEngine::Expired StalenessEngine::sweep(uint64_t now_ms, Apply&& apply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Expired expired = sweepLocked(now_ms);
+    apply(static_cast<const Expired&>(expired));
+    return expired;
+}
+
+#endif // STALENESS_ENGINE_H
@@ -1,24 +1,16 @@
 #pragma once
 
+#include "tag_value.h"
 #include <string>
-#include <variant>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
 #include <chrono>
 #include <memory>
 #include <vector>
 #include <iostream>
 #include <sstream>
 
-// Tipos de datos soportados para los tags
-using TagValue = std::variant<
-    bool,           // Boolean
-    int32_t,        // Integer 32-bit
-    uint32_t,       // Unsigned Integer 32-bit
-    int64_t,        // Integer 64-bit
-    float,          // Float 32-bit
-    double,         // Double 64-bit
-    std::string     // String
->;
-
 // Calidad del tag
 enum class TagQuality {
     GOOD = 0,       // Valor válido y confiable
@@ -47,6 +39,53 @@ enum class TagAccessMode {
     READ_WRITE
 };
 
+class TagValueStore;
+
+// Lectura consistente de valor + calidad + timestamps
+struct TagSample {
+    TagValue value;
+    TagQuality quality;
+    uint64_t source_timestamp;  // ms desde epoch: cuándo se produjo el valor en el origen
+    uint64_t server_timestamp;  // ms desde epoch: cuándo lo registró este servidor
+};
+
+// Celda de valor protegida por seqlock.
+// Los lectores nunca bloquean: copian las palabras atómicas y reintentan si la
+// secuencia cambió. Los escritores se serializan entre sí pero no esperan a los
+// lectores. Un valor string ocupa su StringId internado, así que todo valor
+// cabe en una palabra de la celda; la celda retiene una referencia a su texto.
+class TagValueCell {
+public:
+    TagValueCell();
+    ~TagValueCell();
+    TagValueCell(const TagValueCell&) = delete;
+    TagValueCell& operator=(const TagValueCell&) = delete;
+    
+    void store(const TagValue& value, TagQuality quality, uint64_t source_timestamp, uint64_t server_timestamp);
+    void storeQuality(TagQuality quality);
+    void storeTimestamps(uint64_t source_timestamp, uint64_t server_timestamp);
+    
+    TagSample load() const;
+    TagQuality loadQuality() const;
+    uint64_t loadSourceTimestamp() const;
+    uint64_t loadServerTimestamp() const;
+
+private:
+    // Palabras de la celda: tipo|calidad, bits del valor, timestamp origen, timestamp servidor
+    static constexpr size_t KIND_QUALITY = 0;
+    static constexpr size_t BITS = 1;
+    static constexpr size_t SOURCE_TS = 2;
+    static constexpr size_t SERVER_TS = 3;
+    static constexpr size_t WORDS = 4;
+    
+    void writeLocked(const uint64_t (&words)[WORDS]);
+    void readWords(uint64_t (&words)[WORDS]) const;
+    
+    std::atomic<uint32_t> sequence_;
+    std::atomic<uint64_t> words_[WORDS];
+    std::mutex write_mutex_;
+};
+
 class Tag {
 public:
     // Constructores
@@ -91,8 +130,12 @@ public:
     void setValue(float value);
     void setValue(double value);
     void setValue(const std::string& value);
+    // Valor, calidad y timestamps explícitos (tramas de adquisición)
+    void setSample(const TagValue& value, TagQuality quality, uint64_t source_timestamp, uint64_t server_timestamp);
     
-    const TagValue& getValue() const { return value_; }
+    // Copia del valor actual; getSample() devuelve valor, calidad y timestamps consistentes
+    TagValue getValue() const { return cell_.load().value; }
+    TagSample getSample() const { return cell_.load(); }
     
     // Conversiones de valor
     std::string getValueAsString() const;
@@ -104,18 +147,19 @@ public:
     double getValueAsDouble() const;
     
     // Calidad del tag
-    void setQuality(TagQuality quality) { quality_ = quality; }
-    TagQuality getQuality() const { return quality_; }
+    void setQuality(TagQuality quality);
+    TagQuality getQuality() const { return cell_.loadQuality(); }
     std::string getQualityString() const;
     
     // Timestamp
     void updateTimestamp();
-    void setTimestamp(uint64_t timestamp) { timestamp_ = timestamp; }
-    uint64_t getTimestamp() const { return timestamp_; }
+    void setTimestamp(uint64_t timestamp);
+    uint64_t getTimestamp() const { return cell_.loadServerTimestamp(); }
+    uint64_t getSourceTimestamp() const { return cell_.loadSourceTimestamp(); }
     std::string getTimestampString() const;
     
     // Protección contra sobrescritura por actualizaciones automáticas
-    void setClientWriteTimestamp(uint64_t timestamp) { client_write_timestamp_ = timestamp; }
+    void setClientWriteTimestamp(uint64_t timestamp);
     uint64_t getClientWriteTimestamp() const { return client_write_timestamp_; }
     bool wasRecentlyWrittenByClient(uint64_t protection_window_ms = 5000) const;
     
@@ -139,6 +183,22 @@ public:
     }
     bool isReadOnly() const { return access_mode_ == TagAccessMode::READ_ONLY; }
     
+    // Fuente que escribió el último valor y su época de conexión (ver SourceEpochs).
+    // Ambos en una sola palabra atómica: se leen siempre consistentes
+    void setSourceEpoch(uint16_t source, uint32_t epoch) {
+        source_epoch_.store((static_cast<uint64_t>(source) << 32) | epoch, std::memory_order_release);
+    }
+    void getSourceEpoch(uint16_t& source, uint32_t& epoch) const {
+        uint64_t packed = source_epoch_.load(std::memory_order_acquire);
+        source = static_cast<uint16_t>(packed >> 32);
+        epoch = static_cast<uint32_t>(packed);
+    }
+    
+    // ID denso en el almacén de valores vivos de TagManager (INVALID si no está registrado)
+    uint32_t getId() const { return id_.load(std::memory_order_relaxed); }
+    void bindLiveStore(TagValueStore* store, uint32_t id);
+    void unbindLiveStore();
+    
     // Operadores
     bool operator==(const Tag& other) const;
     bool operator!=(const Tag& other) const;
@@ -160,10 +220,12 @@ private:
     TagAccessMode access_mode_;
     
     // Valor y estado
-    TagValue value_;
-    TagQuality quality_;
-    uint64_t timestamp_;
-    uint64_t client_write_timestamp_; // Timestamp de última escritura por cliente OPC UA
+    TagValueCell cell_;
+    std::atomic<uint64_t> client_write_timestamp_; // Timestamp de última escritura por cliente OPC UA
+    std::atomic<TagValueStore*> live_store_;
+    std::atomic<uint32_t> id_;
+    std::atomic<uint64_t> source_epoch_;            // (fuente << 32) | época
+    static constexpr uint64_t NO_SOURCE_STAMP = static_cast<uint64_t>(UINT16_MAX) << 32;
     
     // Límites
     double min_value_;
@@ -174,8 +236,9 @@ private:
     bool enabled_;
     
     // Métodos auxiliares
-    double getValueAsNumeric() const;
-    void validateValue();
+    static double numericValue(const TagValue& value);
+    void storeValue(const TagValue& value, bool validate);
+    void syncLiveStore();
 };
 
 // Funciones auxiliares
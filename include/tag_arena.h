@@ -0,0 +1,74 @@
+/*
+ * tag_arena.h - Arena de tags para una generación de configuración
+ *
+ * En modo arena, loadFromConfig crea los Tag (y su bloque de control de
+ * shared_ptr) con std::allocate_shared sobre un monotonic_buffer_resource
+ * dimensionado a partir de la configuración: quedan contiguos en memoria en
+ * lugar de repartidos por el heap. Solo los strings que caben en el buffer
+ * SSO de std::string (15 caracteres en libstdc++) viven dentro del Tag y
+ * quedan en la arena: unidades, direcciones y nombres de padre. Los nombres
+ * de sub-tag ("TT_11001_A.PV_percent") y las descripciones son más largos y
+ * reservan su propio buffer en el heap.
+ *
+ * Cada bloque de control guarda una referencia a la arena, de modo que la
+ * generación completa se libera de una vez cuando desaparece el último Tag
+ * que la usa (tras una recarga y cuando ninguna instantánea lo retiene).
+ */
+
+#ifndef TAG_ARENA_H
+#define TAG_ARENA_H
+
+#include "tag.h"
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+
+class TagArena {
+public:
+    explicit TagArena(size_t initial_bytes);
+    TagArena(const TagArena&) = delete;
+    TagArena& operator=(const TagArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    size_t bytesUsed() const;
+    size_t allocations() const;
+
+    // Reserva estimada por tag (objeto Tag + bloque de control de shared_ptr)
+    static constexpr size_t BYTES_PER_TAG = sizeof(Tag) + 64;
+
+private:
+    mutable std::mutex mutex_;
+    std::pmr::monotonic_buffer_resource resource_;
+    size_t bytes_used_;
+    size_t allocations_;
+};
+
+// Asignador para std::allocate_shared: mantiene viva la arena mientras exista
+// algún bloque de control; liberar es una operación nula
+template <typename T>
+class TagArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit TagArenaAllocator(std::shared_ptr<TagArena> arena) : arena_(std::move(arena)) {}
+    template <typename U>
+    TagArenaAllocator(const TagArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+
+    const std::shared_ptr<TagArena>& arena() const { return arena_; }
+
+    template <typename U>
+    bool operator==(const TagArenaAllocator<U>& other) const { return arena_ == other.arena(); }
+    template <typename U>
+    bool operator!=(const TagArenaAllocator<U>& other) const { return arena_ != other.arena(); }
+
+private:
+    std::shared_ptr<TagArena> arena_;
+};
+
+#endif // TAG_ARENA_H
@@ -0,0 +1,136 @@
+/*
+ * tag_history.h - Histórico por tag en buffer circular
+ *
+ * Cada tag guarda sus últimas N muestras (N = "history_depth") en un buffer
+ * de capacidad fija reservado de una vez con la primera muestra. Insertar es
+ * O(1): la muestra nueva sobrescribe la más antigua sin buscarla ni liberar
+ * memoria, y el coste no depende de cuántas muestras retiene el sistema.
+ *
+ * Las entradas guardan los bits del TagValue con su tipo (24 bytes); el
+ * nombre del tag es la clave del buffer y solo se materializa al consultar.
+ * Las entradas string retienen su texto en TagStringPool hasta sobrescribirse.
+ *
+ * El buffer está ordenado por tiempo desde la más antigua y las consultas por
+ * rango localizan los extremos con búsqueda binaria sobre el anillo. Los
+ * timestamps de un tag no siempre llegan en orden (escrituras de cliente con
+ * "ahora" frente a tramas con envío + RTT/2, saltos del reloj), así que push()
+ * ajusta una muestra tardía al timestamp de la más reciente: se conserva el
+ * valor y el orden se mantiene.
+ */
+
+#ifndef TAG_HISTORY_H
+#define TAG_HISTORY_H
+
+#include "tag.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Entrada de histórico tal como la devuelven las consultas
+struct TagHistory {
+    std::string tag_name;
+    TagValue value;
+    TagQuality quality;
+    uint64_t timestamp;         // Timestamp de origen
+};
+
+// Orden de las consultas por rango de tiempo
+enum class HistoryOrder : uint8_t {
+    OLDEST_FIRST = 0,
+    NEWEST_FIRST = 1
+};
+
+// Parámetros de una consulta de histórico por rango (GET /api/tags/{name}/history)
+struct HistoryQueryParams {
+    static constexpr size_t MAX_POINTS = 100000;
+    static constexpr uint64_t DEFAULT_WINDOW_MS = 3600 * 1000;
+
+    uint64_t start = 0;
+    uint64_t end = 0;
+    size_t max_points = 1000;
+    HistoryOrder order = HistoryOrder::OLDEST_FIRST;
+
+    // start/end en ms de época (por defecto la última hora hasta now_ms), max (se limita
+    // a MAX_POINTS) y order=oldest|newest. Los números deben ser enteros sin signo
+    // completos. false con error si algún parámetro no es válido o start > end
+    static bool parse(const std::multimap<std::string, std::string>& params, uint64_t now_ms,
+                      HistoryQueryParams& out, std::string& error);
+};
+
+class TagHistoryRing {
+public:
+    explicit TagHistoryRing(size_t capacity);
+    ~TagHistoryRing();
+    TagHistoryRing(TagHistoryRing&& other) noexcept;
+    TagHistoryRing& operator=(TagHistoryRing&& other) noexcept;
+    TagHistoryRing(const TagHistoryRing&) = delete;
+    TagHistoryRing& operator=(const TagHistoryRing&) = delete;
+
+    // O(1): con el buffer lleno sobrescribe la muestra más antigua. Una muestra
+    // anterior a la más reciente se guarda con el timestamp de esta
+    void push(const TagValue& value, TagQuality quality, uint64_t timestamp) {
+        if (count_ > 0) {
+            timestamp = std::max(timestamp, entries_[head_ == 0 ? entries_.size() - 1 : head_ - 1].timestamp);
+        }
+        Entry& entry = entries_[head_];
+        if (value.isString()) {
+            TagStringPool::instance().acquire(value.bits());
+        }
+        if (count_ == entries_.size() && entry.kind == TagValueKind::STRING) {
+            TagStringPool::instance().release(entry.bits);
+        }
+        entry.bits = value.bits();
+        entry.timestamp = timestamp;
+        entry.kind = value.kind();
+        entry.quality = quality;
+        head_ = head_ + 1 == entries_.size() ? 0 : head_ + 1;
+        if (count_ < entries_.size()) {
+            count_++;
+        }
+    }
+
+    // Hasta max_entries muestras, la más reciente primero
+    void latest(const std::string& tag_name, size_t max_entries, std::vector<TagHistory>& out) const;
+
+    // Muestras en [start, end]: O(log n) para localizar el rango y como mucho max_entries
+    // desde el extremo indicado por order (NEWEST_FIRST: las más recientes del rango)
+    void range(const std::string& tag_name, uint64_t start, uint64_t end, size_t max_entries,
+               HistoryOrder order, std::vector<TagHistory>& out) const;
+
+    // Timestamp de la muestra más antigua retenida (UINT64_MAX si está vacío)
+    uint64_t oldestTimestamp() const { return count_ == 0 ? UINT64_MAX : at(0).timestamp; }
+
+    // Cambiar la capacidad conservando las muestras más recientes
+    void resize(size_t capacity);
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        uint64_t bits;
+        uint64_t timestamp;
+        TagValueKind kind;
+        TagQuality quality;
+    };
+
+    // i-ésima muestra desde la más antigua
+    const Entry& at(size_t i) const {
+        size_t position = head_ + entries_.size() - count_ + i;
+        return entries_[position >= entries_.size() ? position - entries_.size() : position];
+    }
+
+    // Primera posición (desde la más antigua) con timestamp >= timestamp (after: > timestamp)
+    size_t lowerBound(uint64_t timestamp, bool after) const;
+
+    // Soltar los textos retenidos por las muestras [first, first + n) desde la más antigua
+    void releaseStrings(size_t first, size_t n);
+
+    std::vector<Entry> entries_;
+    size_t head_;       // Próxima posición a escribir
+    size_t count_;
+};
+
+#endif // TAG_HISTORY_H
@@ -19,6 +19,7 @@
 #include <mutex>
 #include <fstream>
 #include <filesystem>
+#include <functional>
 
 // Usaremos httplib (header-only library)
 // Agregar a CMakeLists.txt: 
@@ -70,6 +71,10 @@ private:
     std::string backup_directory_;
     std::atomic<bool> server_running_;
     int server_port_;
+    std::atomic<size_t> stream_subscribers_{0};
+    
+    // Estado del scheduler de polling (lo provee main)
+    std::function<nlohmann::json()> scheduler_status_provider_;
     
     mutable std::mutex api_mutex_;
     
@@ -92,6 +97,10 @@ public:
     void stopServer();
     bool isRunning() const { return server_running_; }
     
+    void setSchedulerStatusProvider(std::function<nlohmann::json()> provider) {
+        scheduler_status_provider_ = std::move(provider);
+    }
+    
     // Configuración inicial
     void setupRoutes();
     void configureCORS();
@@ -106,6 +115,9 @@ private:
     // GET /api/tags/{name} - Obtener tag específico
     void handleGetTag(const httplib::Request& req, httplib::Response& res);
     
+    // GET /api/tags/{name}/history?start=&end=&max=&order=oldest|newest - Histórico por rango (ms)
+    void handleGetTagHistory(const httplib::Request& req, httplib::Response& res);
+    
     // POST /api/tags - Crear nuevo tag
     void handleCreateTag(const httplib::Request& req, httplib::Response& res);
     
@@ -179,6 +191,12 @@ private:
     // GET /api/health - Health check
     void handleHealthCheck(const httplib::Request& req, httplib::Response& res);
     
+    // GET /api/scheduler - Overruns por clase de tasa y descartes de carga
+    void handleGetSchedulerStatus(const httplib::Request& req, httplib::Response& res);
+    
+    // GET /api/stream?tags=A,B&interval_ms=1000 - Suscripción SSE (registra demanda)
+    void handleStreamTags(const httplib::Request& req, httplib::Response& res);
+    
     // === TEMPLATE MANAGEMENT ===
     
     // GET /api/templates - Obtener plantillas de tags
@@ -246,6 +264,8 @@ private:
     static constexpr int MAX_BACKUP_FILES = 50;
     static constexpr size_t MAX_REQUEST_SIZE = 10 * 1024 * 1024; // 10MB
     static constexpr int DEFAULT_TIMEOUT_SECONDS = 30;
+    static constexpr int MIN_STREAM_INTERVAL_MS = 250;
+    static constexpr int DEFAULT_STREAM_INTERVAL_MS = 1000;
 };
 
 // === INTEGRATION WITH EXISTING TAGMANAGER ===
@@ -1,11 +1,23 @@
 #pragma once
 
 #include "tag.h"
+#include "tag_value_store.h"
+#include "change_bus.h"
+#include "name_interner.h"
+#include "tag_arena.h"
+#include "staleness_engine.h"
+#include "source_epochs.h"
+#include "warm_state.h"
+#include "scaling_plan.h"
+#include "tag_history.h"
+#include "historian.h"
+#include "history_store.h"
 #include <nlohmann/json.hpp>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <array>
 #include <string>
 #include <mutex>
 #include <thread>
@@ -16,17 +28,89 @@
 #include <fstream>
 #include "common.h"
 
-// Estructura para el histórico de tags
-struct TagHistory {
-    std::string tag_name;
+
+// Un valor de una trama de adquisición
+struct TagUpdate {
+    uint32_t id;                // Tag::getId()
     TagValue value;
     TagQuality quality;
-    uint64_t timestamp;
+};
+
+// Jerarquía padre/hijo: "ET_1601" -> {"PV" -> ET_1601.PV, "SV" -> ET_1601.SV, ...}
+struct TagChild {
+    std::string variable;
+    std::shared_ptr<Tag> tag;
+};
+
+struct TagFamily {
+    std::shared_ptr<Tag> parent;            // nullptr si solo existen los sub-tags
+    std::vector<TagChild> children;         // En orden de registro (orden de "variables")
+    // Atributos de la configuración del padre (vacíos si no se conocen)
+    std::string prefix;                     // "PRC", "ET", "FQI"...
+    std::string category;                   // "FLOW_TRANSMITTER"...
+    std::string value_table;                // "TBL_ET_1601"
+    std::string alarm_table;                // "TBL_EA_1601"
+};
+
+// Índices secundarios: cada consulta "todos los tags en X" cuesta lo que su resultado
+enum class TagIndexKind {
+    GROUP,          // Tag::getGroup()
+    CATEGORY,       // "category" del tag padre (familia completa)
+    VALUE_TABLE,    // Tabla de valores PAC: padre y variables no ALARM_*
+    ALARM_TABLE,    // Tabla de alarmas PAC: variables ALARM_*
+    PREFIX          // Prefijo del nombre padre hasta el primer '_' (familia completa)
+};
+constexpr size_t TAG_INDEX_KINDS = 5;
+
+using TagList = std::vector<std::shared_ptr<Tag>>;
+using TagIndex = std::unordered_map<std::string, TagList>;
+
+struct TagParentRef {
+    std::string parent;
+    std::string variable;
+};
+
+// Instantánea inmutable del registro de tags (estilo RCU).
+// Los escritores construyen una nueva y la publican; los lectores la recorren sin bloqueo
+struct TagSnapshot {
+    std::unordered_map<std::string, std::shared_ptr<Tag>> by_name;
+    std::vector<std::shared_ptr<Tag>> tags;
+    std::vector<std::shared_ptr<Tag>> by_id;     // Metadatos fríos por ID denso (nullptr = liberado)
+    std::vector<uint8_t> shard_by_id;            // Partición del registro de cada ID (TagManager::MAX_SHARDS <= 256)
+    std::unordered_map<std::string, TagFamily> families;       // Padre -> hijos
+    std::unordered_map<std::string, TagParentRef> parent_of;   // Sub-tag -> padre y variable
+    std::vector<std::string> family_names;                     // Padres en orden alfabético
+    std::unordered_map<uint64_t, std::shared_ptr<Tag>> by_path; // NameInterner::pathKey(padre, variable) -> sub-tag
+    TagIndex indexes[TAG_INDEX_KINDS];                         // Por TagIndexKind
+    uint64_t version = 0;
+    
+    const TagFamily* family(const std::string& parent_name) const {
+        auto it = families.find(parent_name);
+        return it != families.end() ? &it->second : nullptr;
+    }
+    const TagParentRef* parentOf(const std::string& tag_name) const {
+        auto it = parent_of.find(tag_name);
+        return it != parent_of.end() ? &it->second : nullptr;
+    }
+    const TagList* indexed(TagIndexKind kind, const std::string& key) const {
+        const TagIndex& index = indexes[static_cast<size_t>(kind)];
+        auto it = index.find(key);
+        return it != index.end() ? &it->second : nullptr;
+    }
+    const std::shared_ptr<Tag>* child(NameInterner::NameId parent, NameInterner::NameId variable) const {
+        auto it = by_path.find(NameInterner::pathKey(parent, variable));
+        return it != by_path.end() ? &it->second : nullptr;
+    }
 };
 
 class TagManager {
 public:
-    TagManager();
+    using Snapshot = std::shared_ptr<const TagSnapshot>;
+    
+    // num_shards > 1 activa el registro particionado (fijo durante la vida del manager),
+    // acotado a [1, MAX_SHARDS]
+    static constexpr size_t MAX_SHARDS = 256;     // Cabe en TagSnapshot::shard_by_id
+    explicit TagManager(size_t num_shards = 1);
     ~TagManager();
     
     // Configuración
@@ -40,17 +124,83 @@ public:
     
     // Gestión de tags
     std::shared_ptr<Tag> getTag(const std::string& name);
+    // Sub-tag por nombres internados (padre, variable): sin construir strings
+    std::shared_ptr<Tag> getTag(NameInterner::NameId parent, NameInterner::NameId variable);
     std::vector<std::shared_ptr<Tag>> getAllTags();
+    // Instantánea actual del registro: recorrer snapshot->tags sin copiar ni bloquear
+    Snapshot getSnapshot() const;
+    // Estado caliente en columnas contiguas indexadas por Tag::getId()
+    TagValueStore& getLiveStore() { return live_store_; }
     std::vector<std::shared_ptr<Tag>> getTagsByGroup(const std::string& group);
+    std::vector<std::shared_ptr<Tag>> getTagsByIndex(TagIndexKind kind, const std::string& key);
     
     bool addTag(std::shared_ptr<Tag> tag);
+    // Alta en lote: una sola publicación de la instantánea para todos los tags.
+    // Devuelve cuántos se agregaron (los nombres ya existentes se omiten)
+    size_t addTags(const std::vector<std::shared_ptr<Tag>>& tags);
     bool removeTag(const std::string& name);
+    // Cambiar el grupo de un tag registrado actualizando el índice GROUP (no usar Tag::setGroup)
+    bool setTagGroup(const std::string& name, const std::string& group);
     
     // Actualización de valores
     void updateTagValue(const std::string& name, const TagValue& value);
     
-    // Histórico
+    // Aplicar una trama completa con un único timestamp de origen: sin bloqueo del registro,
+    // una sola lectura de reloj y una toma de mutex por partición. Devuelve los
+    // IDs cuyo valor o calidad cambió y los publica en el bus una vez por trama.
+    // rate_class es la clase de sondeo de la tabla: fija el plazo de refresco de sus tags.
+    // source sella cada valor con la época de conexión actual de esa fuente
+    std::vector<uint32_t> applyFrame(const std::vector<TagUpdate>& updates, uint64_t source_timestamp,
+                                     RateClass rate_class = RateClass::FAST,
+                                     SourceEpochs::SourceId source = SourceEpochs::NO_SOURCE);
+    
+    // Bus de cambios: cada consumidor se suscribe y drena su propia cola
+    ChangeBus& getChangeBus() { return change_bus_; }
+    
+    // Calidad por antigüedad: plazos por clase de tasa de los tags refrescados por tramas.
+    // sweepStaleness() (lo llama el hilo de polling) marca UNCERTAIN/STALE los vencidos,
+    // publica los cambios de calidad en el bus y devuelve cuántos tags cambiaron
+    StalenessEngine& getStalenessEngine() { return staleness_; }
+    size_t sweepStaleness();
+    
+    // Cambiar solo la calidad de un conjunto de tags (p.ej. tabla descartada por sobrecarga):
+    // los que cambian se anotan en el histórico y se publican en el bus una vez. Devuelve cuántos
+    size_t markTagsQuality(const std::vector<uint32_t>& ids, TagQuality quality);
+    
+    // Épocas de conexión por fuente: una caída de enlace es un incremento atómico.
+    // Los lectores (OPC UA, HTTP) publican effectiveQuality() en lugar de getQuality()
+    SourceEpochs& getSourceEpochs() { return source_epochs_; }
+    TagQuality effectiveQuality(const Tag& tag) const { return source_epochs_.effective(tag); }
+    
+    // Escalado en el gateway ("scaling" por instrumento): applyFrame deriva PV y percent
+    // del Input de la trama. isDerivedValue() indica los IDs que la fuente ya no escribe
+    bool isDerivedValue(uint32_t id) const;
+    
+    // Estado persistente para arranque en caliente: restaura con calidad UNCERTAIN
+    // los valores del fichero (si existe) y a partir de ahí lo actualiza en el sitio.
+    // Llamar tras cargar la configuración y antes del primer ciclo de la fuente
+    bool enableWarmState(const std::string& path);
+    
+    // Demanda de consumidores (ítems monitoreados OPC UA + suscriptores HTTP)
+    // Se contabiliza por tag padre ("ET_1601.PV" -> "ET_1601")
+    void acquireDemand(const std::string& tag_name);
+    void releaseDemand(const std::string& tag_name);
+    bool hasDemand(const std::string& tag_name) const;
+    nlohmann::json getDemandStatus() const;
+    
+    // Histórico: últimas history_depth muestras por tag, la más reciente primero
     std::vector<TagHistory> getTagHistory(const std::string& tag_name, size_t max_entries = 100);
+    
+    // Histórico por rango de tiempo [start, end] (timestamps de origen en ms), como mucho
+    // max_points desde el extremo indicado por order. Se responde desde el buffer del tag
+    // si retiene el inicio del rango o el tag es de texto (los niveles inferiores solo
+    // guardan valores numéricos); si no, desde el histórico persistente o el comprimido
+    struct HistoryRange {
+        std::vector<TagHistory> points;
+        const char* source = "none";        // "buffer", "store", "historian" o "none"
+    };
+    HistoryRange queryHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                              size_t max_points = 1000, HistoryOrder order = HistoryOrder::OLDEST_FIRST) const;
     void clearHistory();
     
     // Estado y exportación
@@ -61,26 +211,125 @@ public:
     void setPollingInterval(uint32_t interval_ms) { polling_interval_ = interval_ms; }
     uint32_t getPollingInterval() const { return polling_interval_; }
     
-    void setMaxHistorySize(size_t max_size) { max_history_size_ = max_size; }
-    size_t getMaxHistorySize() const { return max_history_size_; }
+    // Histórico comprimido (segundo nivel): puntos archivados en [start, end] en orden de tiempo.
+    // Configuración global en "historian" y por instrumento en "compression"
+    std::vector<HistorianPoint> getArchivedHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                                                   size_t max_points = 10000);
+    
+    // Histórico persistente (tercer nivel): segmentos en disco con escritura diferida.
+    // Options.shards por defecto = particiones del registro. Llamar tras cargar la configuración
+    bool enableHistoryStore(const std::string& directory, HistoryStore::Options options);
+    std::vector<HistorianPoint> getStoredHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                                                 size_t max_points = 10000) const;
+    
+    // Capacidad de los buffers de histórico por tag (también "history_depth" en la configuración)
+    void setHistoryDepth(size_t depth);
+    size_t getHistoryDepth() const { return history_depth_; }
+    
+    // Almacenamiento de tags de la configuración: heap (por defecto) o arena por generación
+    // (también "tag_storage": "arena" en la configuración). Aplica a la próxima carga
+    void setArenaStorage(bool enabled) { arena_storage_ = enabled; }
+    bool isArenaStorage() const { return arena_storage_; }
 
 private:
+    // Fichero de estado persistente, espejo del almacén (declarado antes para sobrevivirlo)
+    WarmStateFile warm_state_;
+    
+    // Histórico persistente; su escritor solo toca disco, nunca el registro
+    HistoryStore history_store_;
+    
+    // Almacén SoA de valores vivos: declarado antes que shards_ para que sobreviva a
+    // los tags, y después de warm_state_, su espejo, para destruirse antes que él
+    TagValueStore live_store_;
+    
+    // Buffer de histórico de un tag con su clave en el histórico persistente
+    struct TagHistoryState {
+        TagHistoryRing ring;
+        uint64_t store_key;                 // HistoryStore::hashName(nombre), calculada una vez
+    };
+    
+    // Partición del registro elegida por hash del nombre padre: una familia
+    // completa (padre y sub-tags) vive en una sola partición. Copia de trabajo
+    // de los escritores y su parte del histórico, bajo el mutex de la partición
+    struct RegistryShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Tag>> tags;
+        std::unordered_map<std::string, TagFamily> families;
+        std::unordered_map<std::string, TagParentRef> parent_of;
+        // Histórico por ID denso: las tramas lo alimentan sin construir ni buscar nombres
+        std::unordered_map<uint32_t, TagHistoryState> history;
+        std::unordered_map<uint32_t, HistorianSeries> archive;        // Histórico comprimido
+        TagIndex indexes[TAG_INDEX_KINDS];
+        std::unordered_map<std::string, std::array<std::string, TAG_INDEX_KINDS>> index_keys;   // Claves con que se indexó cada tag
+    };
+    
     // Datos internos
-    std::unordered_map<std::string, std::shared_ptr<Tag>> tags_;
-    std::multimap<std::string, TagHistory> history_;
+    std::vector<std::unique_ptr<RegistryShard>> shards_;
+    Snapshot snapshot_;                     // Acceso solo con std::atomic_load/atomic_store
+    std::atomic<uint64_t> snapshot_version_;
     
     // Control de threading
     std::atomic<bool> running_;
     std::thread polling_thread_;
-    mutable std::mutex tags_mutex_;
-    mutable std::mutex history_mutex_;
+    
+    // Notificación de cambios a consumidores
+    ChangeBus change_bus_;
+    
+    // Plazos de refresco y épocas de conexión de los tags alimentados por tramas
+    StalenessEngine staleness_;
+    SourceEpochs source_epochs_;
+    
+    // Plan de escalado de la configuración actual (nullptr sin instrumentos escalados)
+    std::shared_ptr<const ScalingPlan> scaling_;    // Acceso con std::atomic_load/atomic_store
+    
+    // Contadores de demanda por tag padre
+    std::unordered_map<std::string, uint32_t> demand_counts_;
+    mutable std::mutex demand_mutex_;
     
     // Configuración
     uint32_t polling_interval_;     // ms
-    size_t max_history_size_;
+    std::atomic<size_t> history_depth_;     // Muestras por tag
+    
+    // Histórico comprimido: compresión por defecto y por tag padre (escritas con todas las particiones tomadas)
+    std::atomic<bool> historian_enabled_;
+    HistorianCompression historian_default_;
+    std::unordered_map<std::string, HistorianCompression> historian_overrides_;
+    
+    // Arena de la generación de configuración actual (nullptr en modo heap)
+    std::atomic<bool> arena_storage_;
+    std::shared_ptr<TagArena> arena_;       // Acceso con std::atomic_load/atomic_store
+    
+    // Tags de la configuración anterior durante una recarga (con todas las particiones
+    // tomadas): el tag nuevo del mismo nombre hereda su ID, su muestra y su registro persistente
+    struct PreviousTag {
+        std::shared_ptr<Tag> tag;
+        uint32_t id;
+    };
+    std::unordered_map<std::string, PreviousTag> reload_previous_;
     
     // Métodos internos
+    RegistryShard& shardFor(const std::string& tag_name) const;
+    size_t shardIndex(const std::string& tag_name) const;
+    // Operaciones sobre todo el registro: tomar las particiones en orden de índice
+    std::vector<std::unique_lock<std::mutex>> lockAllShards() const;
+    // Llamar con el mutex de la partición del tag (o con todas tomadas)
+    // tag_config (solo padres cargados desde configuración) aporta categoría y tablas
+    void registerTagLocked(const std::shared_ptr<Tag>& tag, const nlohmann::json* tag_config = nullptr);
+    // release_id = false conserva el ID, el registro persistente y el histórico para reload_previous_
+    void unregisterTagLocked(const std::shared_ptr<Tag>& tag, bool release_id = true);
+    void releasePreviousTagsLocked();
+    void publishSnapshotLocked();
+    void buildScalingPlan(const nlohmann::json& config);
+    void configureHistorianLocked(const nlohmann::json& config);
+    const HistorianCompression& historianCompressionFor(const RegistryShard& shard, const std::string& tag_name) const;
+    Snapshot currentSnapshot() const;
     void pollingLoop();
+    void markQuality(const TagSnapshot& snapshot, const std::vector<uint32_t>& ids, TagQuality quality,
+                     std::vector<uint32_t>& changed_ids);
     void addToHistory(std::shared_ptr<Tag> tag);
+    uint32_t historyIdOf(const std::string& tag_name) const;
+    void appendHistoryLocked(RegistryShard& shard, uint32_t id, const Tag& tag, const TagValue& value,
+                             TagQuality quality, uint64_t timestamp);
+    std::shared_ptr<Tag> newTag();
     void createSubTags(const std::string& parent_name, const nlohmann::json& variables, const nlohmann::json& tag_config);
 };
\ No newline at end of file
@@ -0,0 +1,213 @@
+/*
+ * tag_value.h - Valor de tag compacto de 16 bytes
+ *
+ * Los datos de planta son float, int32 o bool: TagValue guarda el valor en
+ * una palabra de 64 bits más un byte de tipo, sin destructor ni memoria
+ * dinámica. Los strings viven fuera de línea en TagStringPool y el valor
+ * solo guarda su StringId, así que copiar, comparar y publicar un valor
+ * nunca toca el heap.
+ *
+ * Los propietarios duraderos de un valor (la celda del Tag y los buffers de
+ * histórico) cuentan referencias a su texto. Un texto sin referencias pasa
+ * por una cuarentena de QUARANTINE operaciones del pool y después su ranura
+ * se reutiliza con otra generación: la memoria queda acotada por los textos
+ * retenidos aunque un cliente escriba textos distintos sin parar, y un
+ * StringId antiguo nunca resuelve un texto ajeno (devuelve "").
+ */
+
+#ifndef TAG_VALUE_H
+#define TAG_VALUE_H
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Tipo del valor (mismo orden que las alternativas del antiguo std::variant)
+enum class TagValueKind : uint8_t {
+    BOOL = 0,
+    INT32 = 1,
+    UINT32 = 2,
+    INT64 = 3,
+    FLOAT = 4,
+    DOUBLE = 5,
+    STRING = 6
+};
+
+// Textos de valores string internados; el ID 0 es siempre "" y nunca se libera.
+// StringId = generación (32 bits altos) | ranura (32 bits bajos)
+class TagStringPool {
+public:
+    using StringId = uint64_t;
+    static constexpr uint64_t QUARANTINE = 1 << 16;
+
+    static TagStringPool& instance();
+
+    // El texto devuelto sin propietario vive al menos QUARANTINE operaciones
+    StringId intern(std::string_view text);
+    // Copia del texto ("" si la ranura ya se reutilizó)
+    std::string text(StringId id) const;
+
+    // Referencias de propietarios duraderos (celdas, históricos)
+    void acquire(StringId id);
+    void release(StringId id);
+
+    size_t size() const;        // Textos en el pool, incluidos los de la cuarentena
+    size_t bytes() const;
+
+private:
+    struct Entry {
+        std::string text;
+        uint32_t generation = 0;
+        uint32_t refs = 0;
+        uint64_t touched = 0;           // Última operación que lo internó o soltó
+        bool queued = false;            // En candidates_
+    };
+
+    TagStringPool();
+    void touchLocked(uint32_t slot);
+    void reclaimLocked();
+
+    static uint32_t slotOf(StringId id) { return static_cast<uint32_t>(id); }
+    static uint32_t generationOf(StringId id) { return static_cast<uint32_t>(id >> 32); }
+    static StringId makeId(uint32_t slot, uint32_t generation) {
+        return (static_cast<StringId>(generation) << 32) | slot;
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::deque<Entry> entries_;                                 // Direcciones estables
+    std::unordered_map<std::string_view, uint32_t> index_;      // Vistas sobre entries_[i].text
+    std::deque<uint32_t> candidates_;                           // Ranuras sin referencias, más antigua primero
+    std::vector<uint32_t> free_slots_;
+    uint64_t operations_;
+    size_t live_;
+    size_t bytes_;
+};
+
+class TagValue {
+public:
+    TagValue() : bits_(0), kind_(TagValueKind::BOOL) {}
+    TagValue(bool value) { assign(TagValueKind::BOOL, value); }
+    TagValue(int32_t value) { assign(TagValueKind::INT32, value); }
+    TagValue(uint32_t value) { assign(TagValueKind::UINT32, value); }
+    TagValue(int64_t value) { assign(TagValueKind::INT64, value); }
+    TagValue(float value) { assign(TagValueKind::FLOAT, value); }
+    TagValue(double value) { assign(TagValueKind::DOUBLE, value); }
+    TagValue(std::string_view text)
+        : bits_(TagStringPool::instance().intern(text)), kind_(TagValueKind::STRING) {}
+    TagValue(const std::string& text) : TagValue(std::string_view(text)) {}
+    TagValue(const char* text) : TagValue(std::string_view(text)) {}
+
+    TagValueKind kind() const { return kind_; }
+    size_t index() const { return static_cast<size_t>(kind_); }
+    bool isString() const { return kind_ == TagValueKind::STRING; }
+
+    template <typename T>
+    bool holds() const { return kind_ == kindOf<T>(); }
+
+    // Alternativa numérica exacta (holds<T>() debe ser cierto)
+    template <typename T>
+    T get() const {
+        static_assert(std::is_arithmetic_v<T>, "usar text() para valores string");
+        T value;
+        std::memcpy(&value, &bits_, sizeof(T));
+        return value;
+    }
+
+    // Texto internado ("" si el valor no es string)
+    std::string text() const {
+        return isString() ? TagStringPool::instance().text(bits_) : std::string();
+    }
+
+    // Valor numérico (bool 0/1, string 0.0)
+    double toDouble() const;
+
+    // Llama fn con la alternativa tipada: bool, int32_t, ..., double o const std::string&
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) const;
+
+    // Representación en bits: valor nativo extendido con ceros o StringId
+    uint64_t bits() const { return bits_; }
+    static TagValue fromBits(TagValueKind kind, uint64_t bits) {
+        TagValue value;
+        value.kind_ = kind;
+        value.bits_ = bits;
+        return value;
+    }
+
+    // Igualdad por tipo y bits: los strings iguales comparten StringId
+    bool operator==(const TagValue& other) const { return kind_ == other.kind_ && bits_ == other.bits_; }
+    bool operator!=(const TagValue& other) const { return !(*this == other); }
+
+private:
+    // Bits en un entero del mismo ancho extendido con ceros: se quedan en registro
+    // (escribir 0 y luego memcpy parcial sobre bits_ fuerza un paso por memoria)
+    template <typename T>
+    void assign(TagValueKind kind, T value) {
+        if constexpr (sizeof(T) == 1) {
+            uint8_t narrow;
+            std::memcpy(&narrow, &value, 1);
+            bits_ = narrow;
+        } else if constexpr (sizeof(T) == 4) {
+            uint32_t narrow;
+            std::memcpy(&narrow, &value, 4);
+            bits_ = narrow;
+        } else {
+            static_assert(sizeof(T) == 8, "alternativa numérica de 1, 4 u 8 bytes");
+            std::memcpy(&bits_, &value, 8);
+        }
+        kind_ = kind;
+    }
+
+    template <typename T>
+    static constexpr TagValueKind kindOf() {
+        if constexpr (std::is_same_v<T, bool>) return TagValueKind::BOOL;
+        else if constexpr (std::is_same_v<T, int32_t>) return TagValueKind::INT32;
+        else if constexpr (std::is_same_v<T, uint32_t>) return TagValueKind::UINT32;
+        else if constexpr (std::is_same_v<T, int64_t>) return TagValueKind::INT64;
+        else if constexpr (std::is_same_v<T, float>) return TagValueKind::FLOAT;
+        else if constexpr (std::is_same_v<T, double>) return TagValueKind::DOUBLE;
+        else {
+            static_assert(std::is_same_v<T, std::string>, "tipo no soportado por TagValue");
+            return TagValueKind::STRING;
+        }
+    }
+
+    uint64_t bits_;
+    TagValueKind kind_;
+};
+
+static_assert(sizeof(TagValue) == 16, "TagValue debe ocupar 16 bytes");
+static_assert(std::is_trivially_copyable_v<TagValue>, "TagValue se copia como bits");
+
+template <typename Fn>
+decltype(auto) TagValue::visit(Fn&& fn) const {
+    switch (kind_) {
+        case TagValueKind::BOOL: return fn(get<bool>());
+        case TagValueKind::INT32: return fn(get<int32_t>());
+        case TagValueKind::UINT32: return fn(get<uint32_t>());
+        case TagValueKind::INT64: return fn(get<int64_t>());
+        case TagValueKind::FLOAT: return fn(get<float>());
+        case TagValueKind::DOUBLE: return fn(get<double>());
+        default: return fn(text());
+    }
+}
+
+inline double TagValue::toDouble() const {
+    switch (kind_) {
+        case TagValueKind::BOOL: return get<bool>() ? 1.0 : 0.0;
+        case TagValueKind::INT32: return get<int32_t>();
+        case TagValueKind::UINT32: return get<uint32_t>();
+        case TagValueKind::INT64: return static_cast<double>(get<int64_t>());
+        case TagValueKind::FLOAT: return get<float>();
+        case TagValueKind::DOUBLE: return get<double>();
+        default: return 0.0;
+    }
+}
+
+#endif // TAG_VALUE_H
@@ -0,0 +1,145 @@
+/*
+ * tag_value_store.h - Almacén de valores vivos en estructura de arrays (SoA)
+ *
+ * Cada tag registrado en TagManager recibe un ID denso al cargarse. El estado
+ * caliente (valor numérico, calidad, timestamps, flag dirty) vive en columnas
+ * contiguas indexadas por ID; los metadatos fríos (nombre, descripción, unidad)
+ * siguen en los objetos Tag, accesibles por ID desde TagSnapshot::by_id.
+ *
+ * Las columnas se reservan en bloques de CHUNK_SIZE que nunca se mueven, así
+ * que los lectores recorren el almacén mientras se registran tags nuevos.
+ * Cada ranura es un seqlock: los lectores no bloquean y los escritores de una
+ * misma ranura se serializan con la propia secuencia.
+ *
+ * Los IDs liberados vuelven a una lista libre y allocate() los reutiliza antes
+ * de crecer, así que las recargas de configuración no agotan el espacio de IDs.
+ *
+ * Con un espejo (WarmStateFile) cada escritura de ranura se replica en su
+ * registro del fichero mapeado mientras la ranura sigue tomada.
+ */
+
+#ifndef TAG_VALUE_STORE_H
+#define TAG_VALUE_STORE_H
+
+#include "tag.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WarmStateFile;
+
+class TagValueStore {
+public:
+    using TagId = uint32_t;
+    static constexpr TagId INVALID_ID = UINT32_MAX;
+    static constexpr size_t CHUNK_SIZE = 1024;
+    static constexpr size_t MAX_CHUNKS = 1024;      // Hasta ~1M tags
+
+    struct LiveValue {
+        double value;
+        TagQuality quality;
+        uint64_t source_timestamp;
+        uint64_t server_timestamp;
+    };
+
+    TagValueStore();
+    ~TagValueStore();
+    TagValueStore(const TagValueStore&) = delete;
+    TagValueStore& operator=(const TagValueStore&) = delete;
+
+    // Asignar / liberar IDs (los liberados se reutilizan; INVALID_ID si se agota)
+    TagId allocate();
+    void release(TagId id);
+
+    // Escribir la ranura con la muestra que devuelve produce(). produce() se
+    // evalúa con la ranura tomada, de modo que el último escritor publica
+    // siempre el estado más reciente de su fuente
+    template <typename Produce>
+    void update(TagId id, Produce&& produce);
+
+    bool read(TagId id, LiveValue& out) const;
+    void markDirty(TagId id);
+
+    // Pasada lineal sobre los flags dirty: limpia cada flag y llama fn(id)
+    template <typename Fn>
+    size_t drainDirty(Fn&& fn);
+
+    // Espejo persistente de las escrituras (nullptr = desactivado)
+    void setMirror(WarmStateFile* mirror) { mirror_.store(mirror, std::memory_order_release); }
+    void mirrorClientWrite(TagId id, uint64_t timestamp);
+
+    size_t size() const { return next_id_.load(std::memory_order_acquire); }
+    size_t liveCount() const { return live_count_.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk {
+        std::atomic<uint32_t> sequence[CHUNK_SIZE];
+        std::atomic<uint64_t> value_bits[CHUNK_SIZE];
+        std::atomic<uint64_t> source_timestamp[CHUNK_SIZE];
+        std::atomic<uint64_t> server_timestamp[CHUNK_SIZE];
+        std::atomic<uint8_t> quality[CHUNK_SIZE];
+        std::atomic<uint8_t> dirty[CHUNK_SIZE];
+        std::atomic<uint8_t> live[CHUNK_SIZE];
+        Chunk();
+    };
+
+    Chunk* chunkFor(TagId id) const;
+    void writeSlot(Chunk& chunk, TagId id, const TagSample& sample);
+
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks_;
+    std::atomic<uint32_t> next_id_;
+    std::atomic<size_t> live_count_;
+    std::atomic<WarmStateFile*> mirror_;
+    std::vector<TagId> free_ids_;               // Protegido por allocate_mutex_
+    std::mutex allocate_mutex_;
+};
+
+template <typename Produce>
+void TagValueStore::update(TagId id, Produce&& produce) {
+    Chunk* chunk = chunkFor(id);
+    if (!chunk) {
+        return;
+    }
+    size_t slot = id % CHUNK_SIZE;
+
+    // Tomar la ranura: secuencia par -> impar (los escritores concurrentes esperan)
+    uint32_t sequence = chunk->sequence[slot].load(std::memory_order_relaxed);
+    while ((sequence & 1) ||
+           !chunk->sequence[slot].compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+        std::this_thread::yield();
+        sequence = chunk->sequence[slot].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    writeSlot(*chunk, id, produce());
+
+    chunk->sequence[slot].store(sequence + 2, std::memory_order_release);
+    if (chunk->live[slot].load(std::memory_order_relaxed)) {
+        chunk->dirty[slot].store(1, std::memory_order_release);
+    }
+}
+
+template <typename Fn>
+size_t TagValueStore::drainDirty(Fn&& fn) {
+    size_t drained = 0;
+    size_t count = size();
+    for (size_t base = 0; base < count; base += CHUNK_SIZE) {
+        Chunk* chunk = chunks_[base / CHUNK_SIZE].load(std::memory_order_acquire);
+        size_t end = std::min(CHUNK_SIZE, count - base);
+        for (size_t slot = 0; slot < end; slot++) {
+            if (chunk->dirty[slot].load(std::memory_order_relaxed) &&
+                chunk->dirty[slot].exchange(0, std::memory_order_acquire)) {
+                fn(static_cast<TagId>(base + slot));
+                drained++;
+            }
+        }
+    }
+    return drained;
+}
+
+#endif // TAG_VALUE_STORE_H
@@ -0,0 +1,116 @@
+/*
+ * warm_state.h - Estado vivo persistido en un fichero mapeado en memoria
+ *
+ * Un registro de 64 bytes por ID denso del TagValueStore con el último valor,
+ * calidad, timestamps y timestamp de escritura de cliente. TagValueStore lo
+ * actualiza en el sitio dentro de su propia escritura de ranura, sin E/S
+ * explícita: el kernel vuelca las páginas sucias, así que el fichero
+ * sobrevive a la caída del proceso.
+ *
+ * Al arrancar, TagManager restaura cada tag desde su registro (comprobando
+ * el hash del nombre; si la configuración cambió se busca por hash) con
+ * calidad UNCERTAIN antes del primer ciclo PAC.
+ *
+ * El mapeo reserva el espacio virtual de todos los IDs posibles y el fichero
+ * crece con ftruncate: la dirección nunca cambia y los escritores no se
+ * sincronizan con el crecimiento.
+ */
+
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include "tag_value_store.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class WarmStateFile {
+public:
+    using TagId = TagValueStore::TagId;
+    static constexpr size_t MAX_RECORDS = TagValueStore::CHUNK_SIZE * TagValueStore::MAX_CHUNKS;
+
+    struct Restored {
+        TagSample sample;
+        uint64_t client_write_timestamp;
+    };
+
+    WarmStateFile();
+    ~WarmStateFile();
+    WarmStateFile(const WarmStateFile&) = delete;
+    WarmStateFile& operator=(const WarmStateFile&) = delete;
+
+    // Abrir o crear el fichero; hasPreviousState() indica si traía registros válidos
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return records_ != nullptr; }
+    bool hasPreviousState() const { return previous_state_; }
+    const std::string& path() const { return path_; }
+
+    // Lectura de un registro previo (sin escritura en curso y con el mismo nombre)
+    bool read(TagId id, uint64_t name_hash, Restored& out) const;
+    // Índice hash de nombre -> ID para restaurar tras cambios de configuración
+    std::unordered_map<uint64_t, TagId> indexByName() const;
+
+    // Dejar el fichero con records registros vacíos (antes de empezar a escribir)
+    bool reset(size_t records);
+    // Asegurar capacidad para el ID (crecimiento geométrico)
+    bool reserve(TagId id);
+    size_t capacity() const { return capacity_.load(std::memory_order_acquire); }
+
+    // Asociar / liberar el registro de un ID
+    void bind(TagId id, uint64_t name_hash);
+    void clear(TagId id);
+
+    // Escrituras en el sitio: write() la llama TagValueStore con la ranura tomada
+    void write(TagId id, const TagSample& sample);
+    void writeClientTimestamp(TagId id, uint64_t timestamp);
+
+    // Volcado asíncrono de páginas sucias (cierre ordenado)
+    void flush();
+
+    // FNV-1a de 64 bits: estable entre ejecuciones y compilaciones
+    static uint64_t hashName(const std::string& name);
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t records;
+    };
+
+    struct Record {
+        std::atomic<uint32_t> sequence;         // Impar mientras se escribe
+        std::atomic<uint8_t> quality;
+        std::atomic<uint8_t> value_kind;        // TagValueKind; EMPTY_KIND = sin valor
+        uint8_t padding[2];
+        std::atomic<uint64_t> name_hash;
+        std::atomic<uint64_t> value_bits;
+        std::atomic<uint64_t> source_timestamp;
+        std::atomic<uint64_t> server_timestamp;
+        std::atomic<uint64_t> client_write_timestamp;
+        uint64_t reserved[2];
+    };
+    static_assert(sizeof(Record) == 64, "registro de estado persistente de 64 bytes");
+
+    static constexpr uint64_t MAGIC = 0x31304d5241575750ULL;   // "PWWARM01"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t HEADER_BYTES = 4096;
+    static constexpr uint8_t EMPTY_KIND = 0xFF;
+
+    bool resizeFile(size_t records);
+    Record* record(TagId id) const;
+
+    std::string path_;
+    int fd_;
+    void* mapping_;
+    Header* header_;
+    Record* records_;
+    std::atomic<size_t> capacity_;
+    std::mutex resize_mutex_;
+    bool previous_state_;
+};
+
+#endif // WARM_STATE_H
@@ -0,0 +1,1936 @@
+#include "benchmarks.h"
+#include "change_bus.h"
+#include "deadline_scheduler.h"
+#include "tag_manager.h"
+#include "common.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Benchmarks {
+
+// Percentil sobre muestras ya ordenadas
+template <typename T>
+static T percentile(const std::vector<T>& sorted, double p) {
+    if (sorted.empty()) {
+        return T();
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+int schedulerJitter() {
+    const size_t num_jobs = 10000;
+    const auto period = std::chrono::milliseconds(1000);
+    const auto duration = std::chrono::seconds(5);
+
+    LOG_INFO("⏲️ Benchmark scheduler: " + std::to_string(num_jobs) + " trabajos, periodo " +
+             std::to_string(period.count()) + "ms, " + std::to_string(duration.count()) + "s");
+
+    DeadlineScheduler scheduler;
+    std::vector<int64_t> jitter_us;
+    jitter_us.reserve(num_jobs * (duration.count() + 1));
+
+    // Fases repartidas uniformemente: ~10 000 despachos por segundo
+    for (size_t i = 0; i < num_jobs; i++) {
+        auto phase = std::chrono::duration_cast<std::chrono::microseconds>(period) * i / num_jobs;
+        scheduler.schedule("bench_" + std::to_string(i), period, phase + std::chrono::milliseconds(100),
+            [&jitter_us](const DeadlineScheduler::DispatchInfo& info) {
+                jitter_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                    info.start - info.deadline).count());
+            });
+    }
+
+    std::thread dispatcher([&scheduler]() { scheduler.run(); });
+    std::this_thread::sleep_for(duration);
+    scheduler.stop();
+    dispatcher.join();
+
+    std::sort(jitter_us.begin(), jitter_us.end());
+    auto stats = scheduler.getStats();
+
+    LOG_INFO("   • Despachos: " + std::to_string(jitter_us.size()));
+    LOG_INFO("   • Jitter p50:  " + std::to_string(percentile(jitter_us, 0.50)) + "us");
+    LOG_INFO("   • Jitter p99:  " + std::to_string(percentile(jitter_us, 0.99)) + "us");
+    LOG_INFO("   • Jitter p999: " + std::to_string(percentile(jitter_us, 0.999)) + "us");
+    LOG_INFO("   • Jitter máx:  " + std::to_string(jitter_us.empty() ? 0 : jitter_us.back()) + "us");
+    LOG_INFO("   • Periodos perdidos: " + std::to_string(stats["missed_periods"].get<uint64_t>()));
+    LOG_INFO("   • Histograma: " + stats["jitter_histogram"].dump());
+    LOG_INFO("   • Referencia loop de ticks de 500ms: error de fase hasta 500000us");
+
+    bool sub_ms = percentile(jitter_us, 0.99) < 1000;
+    if (sub_ms) {
+        LOG_SUCCESS("✅ p99 de jitter por debajo de 1ms");
+    } else {
+        LOG_WARNING("⚠️ p99 de jitter por encima de 1ms");
+    }
+    return 0;
+}
+
+// Despachos por ventana de 100ms para 26 tablas con el mismo periodo
+static std::vector<uint32_t> dispatchHistogram(bool staggered, size_t num_tables,
+                                               std::chrono::milliseconds period, std::chrono::seconds duration) {
+    DeadlineScheduler scheduler;
+    std::vector<DeadlineScheduler::Clock::time_point> starts;
+    starts.reserve(num_tables * (duration / period + 2));
+
+    auto record = [&starts](const DeadlineScheduler::DispatchInfo& info) { starts.push_back(info.start); };
+    for (size_t i = 0; i < num_tables; i++) {
+        std::string table_name = "TBL_BENCH_" + std::to_string(1600 + i);
+        if (staggered) {
+            scheduler.scheduleStaggered(table_name, period, table_name, record);
+        } else {
+            scheduler.schedule(table_name, period, period, record);
+        }
+    }
+
+    auto begin = DeadlineScheduler::Clock::now();
+    std::thread dispatcher([&scheduler]() { scheduler.run(); });
+    std::this_thread::sleep_for(duration);
+    scheduler.stop();
+    dispatcher.join();
+
+    const auto bucket = std::chrono::milliseconds(100);
+    std::vector<uint32_t> histogram(duration / bucket + 1, 0);
+    for (const auto& start : starts) {
+        size_t index = static_cast<size_t>((start - begin) / bucket);
+        if (index < histogram.size()) {
+            histogram[index]++;
+        }
+    }
+    return histogram;
+}
+
+int staggeredPolling() {
+    const size_t num_tables = 26;
+    const auto period = std::chrono::milliseconds(1000);
+    const auto duration = std::chrono::seconds(5);
+
+    LOG_INFO("📶 Benchmark escalonado: " + std::to_string(num_tables) + " tablas, periodo " +
+             std::to_string(period.count()) + "ms, ventanas de 100ms");
+
+    for (bool staggered : {false, true}) {
+        auto histogram = dispatchHistogram(staggered, num_tables, period, duration);
+        uint32_t peak = 0;
+        uint64_t total = 0;
+        std::string series;
+        for (uint32_t count : histogram) {
+            peak = std::max(peak, count);
+            total += count;
+            series += std::to_string(count) + " ";
+        }
+        LOG_INFO(std::string(staggered ? "   • Escalonado:   " : "   • Sin escalonar: ") +
+                 "pico " + std::to_string(peak) + " peticiones/100ms, media " +
+                 std::to_string(static_cast<double>(total) / histogram.size()));
+        LOG_DEBUG("     " + series);
+    }
+    return 0;
+}
+
+// Registro con mutex tal como estaba antes de las instantáneas (referencia)
+class MutexTagRegistry {
+public:
+    void add(const TagPtr& tag) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tags_[tag->getName()] = tag;
+    }
+    void remove(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tags_.erase(name);
+    }
+    TagPtr get(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tags_.find(name);
+        return it != tags_.end() ? it->second : nullptr;
+    }
+    std::vector<TagPtr> all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<TagPtr> result;
+        result.reserve(tags_.size());
+        for (const auto& pair : tags_) {
+            result.push_back(pair.second);
+        }
+        return result;
+    }
+
+private:
+    std::unordered_map<std::string, TagPtr> tags_;
+    std::mutex mutex_;
+};
+
+// Lectores concurrentes: 1 recorrido completo cada 64 búsquedas, con un escritor
+// que agrega/elimina un tag cada 10ms. Devuelve operaciones por segundo
+template <typename Lookup, typename Iterate, typename Mutate>
+static double measureReaders(size_t num_readers, std::chrono::milliseconds duration,
+                             const std::vector<std::string>& names,
+                             Lookup lookup, Iterate iterate, Mutate mutate) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> total_ops{0};
+
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < num_readers; r++) {
+        readers.emplace_back([&, r]() {
+            uint64_t ops = 0;
+            size_t index = r * 7919;
+            size_t sink = 0;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            while (!done) {
+                for (int i = 0; i < 64; i++) {
+                    index = (index + 104729) % names.size();
+                    sink += lookup(names[index]) ? 1 : 0;
+                }
+                sink += iterate();
+                ops += 65;
+            }
+            total_ops += ops + (sink == 0 ? 1 : 0);
+        });
+    }
+
+    std::thread writer([&]() {
+        while (!go) {
+            std::this_thread::yield();
+        }
+        for (uint64_t i = 0; !done; i++) {
+            mutate(i);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    go = true;
+    std::this_thread::sleep_for(duration);
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    writer.join();
+
+    return total_ops.load() * 1000.0 / duration.count();
+}
+
+int snapshotReaders() {
+    const size_t num_tags = 2000;
+    const size_t num_readers = 8;
+    const auto duration = std::chrono::milliseconds(2000);
+
+    LOG_INFO("📸 Benchmark registro de tags: " + std::to_string(num_tags) + " tags, " +
+             std::to_string(num_readers) + " lectores concurrentes, " + std::to_string(duration.count()) + "ms");
+
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<Tag>> tags;
+    MutexTagRegistry mutex_registry;
+    TagManager manager;
+    for (size_t i = 0; i < num_tags; i++) {
+        names.push_back("BENCH_" + std::to_string(i / 10) + "." + std::to_string(i % 10));
+        tags.push_back(TagFactory::createFloatTag(names.back(), "TBL_BENCH[" + std::to_string(i) + "]"));
+        mutex_registry.add(tags.back());
+    }
+    manager.addTags(tags);
+    // Tag extra que el escritor agrega y elimina
+    auto churn_tag = TagFactory::createFloatTag("BENCH_CHURN", "TBL_BENCH[0]");
+
+    double mutex_ops = measureReaders(num_readers, duration, names,
+        [&](const std::string& name) { return mutex_registry.get(name) != nullptr; },
+        [&]() { return mutex_registry.all().size(); },
+        [&](uint64_t i) {
+            if (i % 2 == 0) mutex_registry.add(churn_tag); else mutex_registry.remove("BENCH_CHURN");
+        });
+
+    double snapshot_ops = measureReaders(num_readers, duration, names,
+        [&](const std::string& name) { return manager.getTag(name) != nullptr; },
+        [&]() {
+            auto snapshot = manager.getSnapshot();
+            return snapshot->tags.size();
+        },
+        [&](uint64_t i) {
+            if (i % 2 == 0) manager.addTag(churn_tag); else manager.removeTag("BENCH_CHURN");
+        });
+
+    LOG_INFO("   • Mutex + copia:  " + std::to_string(static_cast<uint64_t>(mutex_ops)) + " ops/s");
+    LOG_INFO("   • Instantánea:    " + std::to_string(static_cast<uint64_t>(snapshot_ops)) + " ops/s");
+    LOG_INFO("   • Mejora: x" + std::to_string(snapshot_ops / std::max(mutex_ops, 1.0)));
+    return 0;
+}
+
+// Estrés de concurrencia sobre las celdas de valor: escritores y lectores
+// simultáneos verifican que valor, calidad y timestamps nunca se mezclan.
+// Pensado para ejecutarse compilado con ENABLE_TSAN=ON
+int tagValueStress() {
+    const size_t num_writers = 2;
+    const size_t num_readers = 6;
+    const auto duration = std::chrono::milliseconds(2000);
+
+    LOG_INFO("🧵 Estrés de celdas de valor: " + std::to_string(num_writers) + " escritores x2 celdas, " +
+             std::to_string(num_readers) + " lectores, " + std::to_string(duration.count()) + "ms");
+
+    // Invariante: valor == timestamp origen, servidor == origen + 1, calidad según paridad
+    TagValueCell numeric_cell;
+    TagValueCell text_cell;
+    auto tag = TagFactory::createFloatTag("STRESS.PV", "TBL_STRESS[0]");
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> torn{0};
+
+    auto check = [&torn](const TagSample& sample, uint64_t value) {
+        TagQuality expected = (value % 2 == 0) ? TagQuality::GOOD : TagQuality::UNCERTAIN;
+        if (sample.server_timestamp != 0 &&
+            (value != sample.source_timestamp || sample.server_timestamp != value + 1 || sample.quality != expected)) {
+            torn++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < num_writers; w++) {
+        threads.emplace_back([&, w]() {
+            uint64_t local = 0;
+            for (uint64_t k = w + 1; !done; k += num_writers) {
+                TagQuality quality = (k % 2 == 0) ? TagQuality::GOOD : TagQuality::UNCERTAIN;
+                numeric_cell.store(static_cast<double>(k), quality, k, k + 1);
+                text_cell.store(std::to_string(k), quality, k, k + 1);
+                tag->setValue(static_cast<float>(k));
+                tag->setQuality(quality);
+                local += 3;
+            }
+            writes += local;
+        });
+    }
+    for (size_t r = 0; r < num_readers; r++) {
+        threads.emplace_back([&]() {
+            uint64_t local = 0;
+            size_t sink = 0;
+            while (!done) {
+                TagSample numeric = numeric_cell.load();
+                if (numeric.value.holds<double>()) {
+                    check(numeric, static_cast<uint64_t>(numeric.value.get<double>()));
+                }
+                TagSample text = text_cell.load();
+                if (text.value.isString()) {
+                    std::string value = text.value.text();
+                    check(text, value.empty() ? 0 : std::stoull(value));
+                }
+                sink += tag->getValueAsString().size() + static_cast<size_t>(tag->getQuality());
+                local += 3;
+            }
+            reads += local + (sink == 0 ? 1 : 0);
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    LOG_INFO("   • Escrituras: " + std::to_string(writes.load()) + ", lecturas: " + std::to_string(reads.load()));
+    LOG_INFO("   • Textos en el pool: " + std::to_string(TagStringPool::instance().size()) + " (" +
+             std::to_string(TagStringPool::instance().bytes()) + " bytes)");
+    if (torn.load() > 0) {
+        LOG_ERROR("❌ Lecturas inconsistentes: " + std::to_string(torn.load()));
+        return 1;
+    }
+    LOG_SUCCESS("✅ Sin lecturas inconsistentes");
+    return 0;
+}
+
+// Configuración sintética con el formato de tags_planta_gas.json
+static const std::vector<std::string> synthetic_variables = {
+    "PV", "SV", "SET_HH", "SET_H", "SET_L", "SET_LL", "ALARM_HH", "ALARM_H", "ALARM_L", "ALARM_LL"
+};
+
+static const std::vector<std::string> synthetic_categories = {
+    "FLOW_TRANSMITTER", "PRESSURE_TRANSMITTER", "TEMPERATURE_TRANSMITTER", "LEVEL_TRANSMITTER"
+};
+
+static nlohmann::json syntheticPlantConfig(size_t num_instruments) {
+    nlohmann::json config;
+    config["tags"] = nlohmann::json::array();
+    for (size_t i = 0; i < num_instruments; i++) {
+        std::string name = "BENCH_" + std::to_string(1000 + i);
+        config["tags"].push_back({
+            {"name", name},
+            {"value_table", "TBL_" + name},
+            {"alarm_table", "TBL_A_" + name},
+            {"category", synthetic_categories[i % synthetic_categories.size()]},
+            {"units", "bar"},
+            {"description", "Instrumento sintético " + std::to_string(i)},
+            {"variables", synthetic_variables}
+        });
+    }
+    return config;
+}
+
+// Recorrido completo de valores: objetos Tag dispersos frente a columnas SoA
+int valueScan() {
+    const size_t num_instruments = 10000;
+    const int passes = 20;
+
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(num_instruments));
+    for (const auto& tag : manager.getSnapshot()->tags) {
+        tag->setValue(static_cast<float>(tag->getId()));
+    }
+
+    LOG_INFO("🧮 Benchmark recorrido de valores: " + std::to_string(manager.getSnapshot()->tags.size()) +
+             " tags, " + std::to_string(passes) + " pasadas");
+
+    auto snapshot = manager.getSnapshot();
+    TagValueStore& store = manager.getLiveStore();
+
+    auto timePasses = [passes](const std::function<double()>& scan, double& checksum) {
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++) {
+            checksum += scan();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / passes;
+    };
+
+    double aos_checksum = 0.0;
+    double aos_us = timePasses([&]() {
+        double sum = 0.0;
+        for (const auto& tag : snapshot->tags) {
+            if (tag->getQuality() == TagQuality::GOOD) {
+                sum += tag->getValueAsDouble();
+            }
+        }
+        return sum;
+    }, aos_checksum);
+
+    double soa_checksum = 0.0;
+    double soa_us = timePasses([&]() {
+        double sum = 0.0;
+        TagValueStore::LiveValue live;
+        for (TagValueStore::TagId id = 0; id < store.size(); id++) {
+            if (store.read(id, live) && live.quality == TagQuality::GOOD) {
+                sum += live.value;
+            }
+        }
+        return sum;
+    }, soa_checksum);
+
+    LOG_INFO("   • Objetos Tag:  " + std::to_string(static_cast<int64_t>(aos_us)) + "us por pasada");
+    LOG_INFO("   • Columnas SoA: " + std::to_string(static_cast<int64_t>(soa_us)) + "us por pasada");
+    LOG_INFO("   • Mejora: x" + std::to_string(aos_us / std::max(soa_us, 1.0)));
+    if (aos_checksum != soa_checksum) {
+        LOG_ERROR("❌ Las sumas no coinciden");
+        return 1;
+    }
+    return 0;
+}
+
+// Resolución padre/hijos del espacio de direcciones (sin llamadas open62541):
+// escaneo por substrings como hacía createTagNodes frente al índice jerárquico
+static double scanResolutionMs(const TagSnapshot& snapshot, size_t max_parents, size_t& links) {
+    const auto& tags = snapshot.tags;
+    auto start = std::chrono::steady_clock::now();
+    size_t processed = 0;
+    for (const auto& parent_tag_name : snapshot.family_names) {
+        if (processed++ >= max_parents) {
+            break;
+        }
+        std::shared_ptr<Tag> reference_tag = nullptr;
+        for (const auto& tag : tags) {
+            if (tag->getName() == parent_tag_name) {
+                reference_tag = tag;
+                break;
+            }
+        }
+        std::vector<std::string> variables;
+        for (const auto& tag : tags) {
+            std::string tag_name = tag->getName();
+            if (tag_name.length() > parent_tag_name.length() + 1 &&
+                tag_name.substr(0, parent_tag_name.length() + 1) == parent_tag_name + ".") {
+                variables.push_back(tag_name.substr(parent_tag_name.length() + 1));
+            }
+        }
+        for (const auto& variable_name : variables) {
+            std::string full_tag_name = parent_tag_name + "." + variable_name;
+            for (const auto& tag : tags) {
+                if (tag->getName() == full_tag_name) {
+                    links += reference_tag ? 1 : 0;
+                    break;
+                }
+            }
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double indexedResolutionMs(const TagSnapshot& snapshot, size_t& links) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& parent_tag_name : snapshot.family_names) {
+        const TagFamily* family = snapshot.family(parent_tag_name);
+        std::shared_ptr<Tag> reference_tag = family->parent;
+        std::unordered_map<std::string, std::shared_ptr<Tag>> sub_tags;
+        for (const auto& child : family->children) {
+            sub_tags[child.variable] = child.tag;
+        }
+        for (const auto& child : family->children) {
+            links += (reference_tag && sub_tags.count(child.variable)) ? 1 : 0;
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int hierarchyBuild() {
+    // Escaneo completo hasta este tamaño; por encima se mide una muestra y se extrapola
+    const size_t max_scanned_parents = 200;
+
+    for (size_t num_instruments : {static_cast<size_t>(100), static_cast<size_t>(10000)}) {
+        TagManager manager;
+        manager.loadFromConfig(syntheticPlantConfig(num_instruments));
+        auto snapshot = manager.getSnapshot();
+        size_t parents = snapshot->family_names.size();
+
+        size_t scan_links = 0;
+        size_t sampled = std::min(parents, max_scanned_parents);
+        double scan_ms = scanResolutionMs(*snapshot, sampled, scan_links) * parents / std::max<size_t>(sampled, 1);
+        size_t index_links = 0;
+        double index_ms = indexedResolutionMs(*snapshot, index_links);
+
+        LOG_INFO("🌳 Jerarquía con " + std::to_string(num_instruments) + " instrumentos (" +
+                 std::to_string(snapshot->tags.size()) + " tags):");
+        LOG_INFO(std::string("   • Escaneo por substrings: ") + std::to_string(scan_ms) + "ms" +
+                 (sampled < parents ? " (extrapolado de " + std::to_string(sampled) + " padres)" : ""));
+        LOG_INFO("   • Índice jerárquico:     " + std::to_string(index_ms) + "ms (" +
+                 std::to_string(index_links) + " variables)");
+        if (sampled == parents && scan_links != index_links) {
+            LOG_ERROR("❌ El índice no coincide con el escaneo");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Aplicación de una trama de adquisición: updateTagValue por valor frente a applyFrame
+int frameApply() {
+    const int repetitions = 200;
+
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(600));
+    std::vector<std::shared_ptr<Tag>> sub_tags;
+    for (const auto& tag : manager.getSnapshot()->tags) {
+        if (tag->getName().find('.') != std::string::npos) {
+            sub_tags.push_back(tag);
+        }
+    }
+
+    LOG_INFO("🧾 Benchmark de tramas: " + std::to_string(repetitions) + " repeticiones por tamaño");
+    for (size_t frame_size : {static_cast<size_t>(52), static_cast<size_t>(500), static_cast<size_t>(5000)}) {
+        frame_size = std::min(frame_size, sub_tags.size());
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++) {
+            for (size_t i = 0; i < frame_size; i++) {
+                manager.updateTagValue(sub_tags[i]->getName(), TagValue(static_cast<float>(r + i)));
+            }
+        }
+        double single_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / repetitions;
+
+        std::vector<TagUpdate> frame(frame_size);
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++) {
+            for (size_t i = 0; i < frame_size; i++) {
+                frame[i] = {sub_tags[i]->getId(), TagValue(static_cast<float>(r + i + 1)), TagQuality::GOOD};
+            }
+            manager.applyFrame(frame, getCurrentTimestamp());
+        }
+        double frame_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / repetitions;
+
+        LOG_INFO("   • " + std::to_string(frame_size) + " valores: individual " +
+                 std::to_string(static_cast<int64_t>(single_us)) + "us, trama " +
+                 std::to_string(static_cast<int64_t>(frame_us)) + "us (x" +
+                 std::to_string(single_us / std::max(frame_us, 1.0)) + ")");
+    }
+    return 0;
+}
+
+// Latencia de publicación en el bus de cambios con un consumidor activo y,
+// además, uno detenido: el productor no debe verse afectado por el lento
+static bool busScenario(bool with_stalled, size_t frames, std::vector<double>& latencies_us,
+                        nlohmann::json& status) {
+    ChangeBus bus;
+    auto active = bus.subscribe("activo", 1024);
+    auto stalled = with_stalled ? bus.subscribe("detenido", 256) : nullptr;
+
+    std::atomic<bool> producing{true};
+    std::atomic<uint64_t> received{0};
+    std::atomic<bool> ordered{true};
+    std::thread consumer([&]() {
+        std::vector<ChangeSubscriber::ChangeSetPtr> batch;
+        uint64_t last_sequence = 0;
+        while (producing.load() || active->depth() > 0) {
+            batch.clear();
+            if (active->poll(batch) == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (const auto& change_set : batch) {
+                if (change_set->sequence <= last_sequence) {
+                    ordered = false;
+                }
+                last_sequence = change_set->sequence;
+            }
+            received += batch.size();
+        }
+    });
+
+    std::vector<uint32_t> ids(52);
+    for (size_t i = 0; i < ids.size(); i++) {
+        ids[i] = static_cast<uint32_t>(i);
+    }
+    latencies_us.clear();
+    latencies_us.reserve(frames);
+    for (size_t f = 0; f < frames; f++) {
+        auto start = std::chrono::steady_clock::now();
+        bus.publish(ids, f);
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+        // Dejar respirar al consumidor activo: ~1 trama por microsegundo
+        if (active->depth() > active->capacity() / 2) {
+            std::this_thread::yield();
+        }
+    }
+    producing = false;
+    consumer.join();
+    std::sort(latencies_us.begin(), latencies_us.end());
+
+    status = bus.getStatus();
+    bool active_complete = received.load() + active->getStats()["dropped"].get<uint64_t>() == frames;
+    bool stalled_overflowed = !stalled || stalled->takeOverflow();
+    return ordered.load() && active_complete && stalled_overflowed;
+}
+
+int changeBus() {
+    const size_t frames = 200000;
+    bool ok = true;
+
+    LOG_INFO("📣 Benchmark del bus de cambios: " + std::to_string(frames) + " tramas de 52 IDs");
+    for (bool with_stalled : {false, true}) {
+        std::vector<double> latencies_us;
+        nlohmann::json status;
+        bool scenario_ok = busScenario(with_stalled, frames, latencies_us, status);
+        ok = ok && scenario_ok;
+
+        LOG_INFO(std::string("   • ") + (with_stalled ? "activo + detenido" : "solo activo") +
+                 ": publish p50=" + std::to_string(percentile(latencies_us, 0.50)) +
+                 "us p99=" + std::to_string(percentile(latencies_us, 0.99)) +
+                 "us max=" + std::to_string(latencies_us.back()) + "us");
+        for (const auto& subscriber : status["subscribers"]) {
+            LOG_INFO("     - " + subscriber["name"].get<std::string>() +
+                     ": entregados=" + std::to_string(subscriber["delivered"].get<uint64_t>()) +
+                     " descartados=" + std::to_string(subscriber["dropped"].get<uint64_t>()) +
+                     " pico_cola=" + std::to_string(subscriber["high_water"].get<size_t>()));
+        }
+    }
+
+    if (!ok) {
+        LOG_ERROR("Bus de cambios: orden o contabilidad de entregas incorrecta");
+        return 1;
+    }
+    LOG_SUCCESS("Bus de cambios: productor sin bloqueo y contrapresión contabilizada");
+    return 0;
+}
+
+// Mezcla 90% lecturas (valor e histórico) / 10% escrituras sobre un TagManager
+// con num_shards particiones; devuelve operaciones por segundo
+static double mixedWorkload(size_t num_shards, size_t num_threads, std::chrono::milliseconds duration) {
+    TagManager manager(num_shards);
+    manager.loadFromConfig(syntheticPlantConfig(600));
+    manager.setHistoryDepth(16);
+
+    std::vector<std::string> names;
+    for (const auto& tag : manager.getSnapshot()->tags) {
+        names.push_back(tag->getName());
+    }
+
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> total_ops{0};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < num_threads; t++) {
+        workers.emplace_back([&, t]() {
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1);
+            uint64_t ops = 0;
+            double sink = 0.0;
+            while (running.load(std::memory_order_relaxed)) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                const std::string& name = names[state % names.size()];
+                uint64_t dice = (state >> 32) % 100;
+                if (dice < 10) {
+                    manager.updateTagValue(name, TagValue(static_cast<float>(ops)));
+                } else if (dice < 55) {
+                    auto tag = manager.getTag(name);
+                    sink += tag ? tag->getValueAsDouble() : 0.0;
+                } else {
+                    sink += static_cast<double>(manager.getTagHistory(name, 10).size());
+                }
+                ops++;
+            }
+            total_ops += ops + (sink < 0 ? 1 : 0);
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return total_ops.load() / std::chrono::duration<double>(duration).count();
+}
+
+int shardedRegistry() {
+    const size_t num_threads = std::max(4u, std::thread::hardware_concurrency());
+    const auto duration = std::chrono::milliseconds(1500);
+
+    LOG_INFO("🧩 Benchmark de registro particionado: " + std::to_string(num_threads) +
+             " hilos, 90% lecturas / 10% escrituras");
+    double baseline = 0.0;
+    for (size_t num_shards : {static_cast<size_t>(1), static_cast<size_t>(4), static_cast<size_t>(16)}) {
+        double ops_per_sec = mixedWorkload(num_shards, num_threads, duration);
+        if (num_shards == 1) {
+            baseline = ops_per_sec;
+        }
+        LOG_INFO("   • " + std::to_string(num_shards) + " particiones: " +
+                 std::to_string(static_cast<int64_t>(ops_per_sec)) + " ops/s (x" +
+                 std::to_string(ops_per_sec / std::max(baseline, 1.0)) + ")");
+    }
+    return 0;
+}
+
+// Resolución de sub-tags en un ciclo de polling: nombre concatenado frente a
+// nombres internados (padre, variable)
+int internedNames() {
+    const size_t num_instruments = 1000;
+    const int cycles = 50;
+
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(num_instruments));
+    std::vector<std::string> parents;
+    for (const auto& name : manager.getSnapshot()->family_names) {
+        parents.push_back(name);
+    }
+
+    NameInterner& interner = NameInterner::instance();
+    std::vector<NameInterner::NameId> parent_ids;
+    std::vector<NameInterner::NameId> variable_ids;
+    for (const auto& parent : parents) {
+        parent_ids.push_back(interner.intern(parent));
+    }
+    for (const auto& variable : synthetic_variables) {
+        variable_ids.push_back(interner.intern(variable));
+    }
+
+    size_t found_strings = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; c++) {
+        for (const auto& parent : parents) {
+            for (const auto& variable : synthetic_variables) {
+                if (manager.getTag(parent + "." + variable)) {
+                    found_strings++;
+                }
+            }
+        }
+    }
+    double string_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / cycles;
+
+    size_t found_ids = 0;
+    auto snapshot = manager.getSnapshot();
+    start = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; c++) {
+        for (NameInterner::NameId parent_id : parent_ids) {
+            for (NameInterner::NameId variable_id : variable_ids) {
+                if (snapshot->child(parent_id, variable_id)) {
+                    found_ids++;
+                }
+            }
+        }
+    }
+    double interned_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / cycles;
+
+    LOG_INFO("🔤 Resolución de " + std::to_string(parents.size() * variable_ids.size()) + " sub-tags por ciclo:");
+    LOG_INFO("   • Nombre concatenado: " + std::to_string(string_us) + "us");
+    LOG_INFO("   • Nombres internados: " + std::to_string(interned_us) + "us (x" +
+             std::to_string(string_us / std::max(interned_us, 0.001)) + ")");
+
+    if (found_strings != found_ids) {
+        LOG_ERROR("Resultados distintos: " + std::to_string(found_strings) + " frente a " + std::to_string(found_ids));
+        return 1;
+    }
+    return 0;
+}
+
+// Memoria residente del proceso en KB
+static size_t residentKb() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+struct LoadMeasurement {
+    double load_ms;
+    double scan_us;
+    double resident_kb;
+};
+
+// Cargar la configuración en un proceso hijo para que el RSS de una medición
+// no herede la memoria liberada por la anterior
+static bool measureLoad(const nlohmann::json& config, bool arena, LoadMeasurement& out) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        std::freopen("/dev/null", "w", stdout);     // Silenciar el log de carga
+
+        LoadMeasurement measurement{};
+        size_t resident_before = residentKb();
+        auto start = std::chrono::steady_clock::now();
+        {
+            TagManager manager;
+            manager.setArenaStorage(arena);
+            manager.loadFromConfig(config);
+            measurement.load_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            measurement.resident_kb = static_cast<double>(residentKb() - resident_before);
+
+            // Recorrido en orden de creación (orden de ID) leyendo metadatos y valor
+            auto snapshot = manager.getSnapshot();
+            double sink = 0.0;
+            start = std::chrono::steady_clock::now();
+            for (const auto& tag : snapshot->by_id) {
+                if (tag) {
+                    sink += tag->getValueAsDouble() + static_cast<double>(tag->getName().size());
+                }
+            }
+            measurement.scan_us = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count() + (sink < 0 ? 1 : 0);
+        }
+        ssize_t written = write(fds[1], &measurement, sizeof(measurement));
+        close(fds[1]);
+        _exit(written == static_cast<ssize_t>(sizeof(measurement)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t received = read(fds[0], &out, sizeof(out));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return received == static_cast<ssize_t>(sizeof(out)) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int arenaLoad() {
+    LOG_INFO("🧱 Benchmark de almacenamiento de tags: heap frente a arena");
+    for (size_t target_tags : {static_cast<size_t>(1000), static_cast<size_t>(50000)}) {
+        size_t instruments = (target_tags + synthetic_variables.size()) / (synthetic_variables.size() + 1);
+        nlohmann::json config = syntheticPlantConfig(instruments);
+        size_t total_tags = instruments * (synthetic_variables.size() + 1);
+
+        LOG_INFO("   " + std::to_string(total_tags) + " tags:");
+        for (bool arena : {false, true}) {
+            LoadMeasurement measurement{};
+            if (!measureLoad(config, arena, measurement)) {
+                LOG_ERROR("No se pudo medir la carga en un proceso hijo");
+                return 1;
+            }
+            LOG_INFO(std::string("   • ") + (arena ? "arena" : "heap ") + ": carga " +
+                     std::to_string(measurement.load_ms) + "ms, RSS +" +
+                     std::to_string(static_cast<int64_t>(measurement.resident_kb)) + "KB, recorrido " +
+                     std::to_string(measurement.scan_us) + "us");
+        }
+    }
+    
+    // Nombres que quedan dentro del Tag (buffer SSO) y por tanto en la arena
+    TagManager manager;
+    manager.setArenaStorage(true);
+    manager.loadFromConfig(syntheticPlantConfig(100));
+    auto snapshot = manager.getSnapshot();
+    size_t inline_names = 0;
+    for (const auto& tag : snapshot->tags) {
+        const char* begin = reinterpret_cast<const char*>(tag.get());
+        const char* name = tag->getName().data();
+        if (name >= begin && name < begin + sizeof(Tag)) {
+            inline_names++;
+        }
+    }
+    LOG_INFO("   • Nombres dentro del Tag (SSO): " + std::to_string(inline_names) + " de " +
+             std::to_string(snapshot->tags.size()));
+    return 0;
+}
+
+// Consultas "todos los tags en X": recorrido completo filtrando frente a índice secundario
+int secondaryIndexes() {
+    const size_t num_instruments = 10000;
+    const int repetitions = 50;
+
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(num_instruments));
+    auto snapshot = manager.getSnapshot();
+
+    LOG_INFO("🗂️  Benchmark de índices secundarios: " + std::to_string(snapshot->tags.size()) + " tags, " +
+             std::to_string(repetitions) + " consultas por caso");
+
+    struct Query {
+        const char* label;
+        TagIndexKind kind;
+        std::string key;
+        std::function<bool(const std::shared_ptr<Tag>&)> matches;
+    };
+    const std::string table = "TBL_BENCH_" + std::to_string(1000 + num_instruments / 2);
+    const std::vector<Query> queries = {
+        {"categoría", TagIndexKind::CATEGORY, synthetic_categories[0],
+         [&snapshot](const std::shared_ptr<Tag>& tag) {
+             const TagFamily* family = snapshot->family(tag->getName().substr(0, tag->getName().find('.')));
+             return family && family->category == synthetic_categories[0];
+         }},
+        {"tabla de valores", TagIndexKind::VALUE_TABLE, table,
+         [&table](const std::shared_ptr<Tag>& tag) {
+             const std::string& address = tag->getAddress();
+             bool in_table = address == table ||
+                             (address.compare(0, table.size(), table) == 0 && address[table.size()] == '.');
+             return in_table && tag->getName().find(".ALARM_") == std::string::npos;
+         }},
+        {"tabla de alarmas", TagIndexKind::ALARM_TABLE, "TBL_A_" + table.substr(4),
+         [&table](const std::shared_ptr<Tag>& tag) {
+             return tag->getName().compare(0, table.size() - 4, table, 4) == 0 &&
+                    tag->getName().compare(table.size() - 4, 7, ".ALARM_") == 0;
+         }},
+        {"prefijo", TagIndexKind::PREFIX, "BENCH",
+         [](const std::shared_ptr<Tag>& tag) { return tag->getName().compare(0, 6, "BENCH_") == 0; }}
+    };
+
+    for (const auto& query : queries) {
+        size_t scan_count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++) {
+            std::vector<std::shared_ptr<Tag>> result;
+            for (const auto& tag : snapshot->tags) {
+                if (query.matches(tag)) {
+                    result.push_back(tag);
+                }
+            }
+            scan_count = result.size();
+        }
+        double scan_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / repetitions;
+
+        size_t index_count = 0;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++) {
+            index_count = manager.getTagsByIndex(query.kind, query.key).size();
+        }
+        double index_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / repetitions;
+
+        LOG_INFO(std::string("   • ") + query.label + " (" + std::to_string(index_count) + " tags): recorrido " +
+                 std::to_string(static_cast<int64_t>(scan_us)) + "us, índice " +
+                 std::to_string(index_us) + "us");
+        if (scan_count != index_count) {
+            LOG_ERROR("❌ El índice no coincide con el recorrido");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Barrido de plazos: 100 000 tags FAST en tramas de 50 de las que 20 dejan de llegar.
+// Barrido por listas de plazo frente a recorrer el timestamp de todos los tags
+int stalenessSweep() {
+    const size_t num_tags = 100000;
+    const size_t frame_size = 50;
+    const size_t missing_frames = 20;
+    const uint64_t period_ms = 2000;
+
+    StalenessEngine engine;
+    engine.setPeriod(RateClass::FAST, std::chrono::milliseconds(period_ms));
+    std::vector<uint64_t> refreshed_ms(num_tags, 0);
+
+    std::vector<std::vector<StalenessEngine::TagId>> frames;
+    for (size_t base = 0; base < num_tags; base += frame_size) {
+        std::vector<StalenessEngine::TagId> frame;
+        for (size_t id = base; id < std::min(base + frame_size, num_tags); id++) {
+            frame.push_back(static_cast<StalenessEngine::TagId>(id));
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    // Dos ciclos; en el segundo faltan las últimas tramas
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t cycle = 0; cycle < 2; cycle++) {
+        size_t delivered = cycle == 0 ? frames.size() : frames.size() - missing_frames;
+        for (size_t f = 0; f < delivered; f++) {
+            engine.refresh(frames[f], RateClass::FAST, cycle * period_ms);
+            for (auto id : frames[f]) {
+                refreshed_ms[id] = cycle * period_ms;
+            }
+        }
+    }
+    double refresh_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / (frames.size() * 2 - missing_frames);
+
+    uint64_t sweep_at = period_ms + period_ms / 2 + 1;
+    start = std::chrono::steady_clock::now();
+    StalenessEngine::Expired expired = engine.sweep(sweep_at);
+    double sweep_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    size_t scanned_expired = 0;
+    for (size_t id = 0; id < num_tags; id++) {
+        if (refreshed_ms[id] + period_ms + period_ms / 2 <= sweep_at) {
+            scanned_expired++;
+        }
+    }
+    double scan_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    StalenessEngine::Expired idle = engine.sweep(sweep_at + 1);
+    double idle_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    LOG_INFO("⌛ Benchmark de plazos: " + std::to_string(num_tags) + " tags FAST, " +
+             std::to_string(missing_frames * frame_size) + " sin refresco");
+    LOG_INFO("   • Refresco por trama de " + std::to_string(frame_size) + ": " + std::to_string(refresh_us) + "us");
+    LOG_INFO("   • Barrido por listas: " + std::to_string(sweep_us) + "us (" +
+             std::to_string(expired.uncertain.size()) + " a UNCERTAIN)");
+    LOG_INFO("   • Barrido sin vencidos: " + std::to_string(idle_us) + "us");
+    LOG_INFO("   • Recorrido completo: " + std::to_string(scan_us) + "us (" + std::to_string(scanned_expired) + " vencidos)");
+
+    // Extremo a extremo: TagManager marca la calidad y la publica en el bus
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(100));
+    manager.getStalenessEngine().setPeriod(RateClass::FAST, std::chrono::milliseconds(20));
+    auto subscriber = manager.getChangeBus().subscribe("benchmark");
+    std::vector<TagUpdate> frame;
+    for (const auto& tag : manager.getSnapshot()->tags) {
+        frame.push_back({tag->getId(), TagValue(1.0f), TagQuality::GOOD});
+    }
+    manager.applyFrame(frame, getCurrentTimestamp());
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    size_t uncertain = manager.sweepStaleness();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    size_t stale = manager.sweepStaleness();
+    std::vector<ChangeSubscriber::ChangeSetPtr> sets;
+    subscriber->poll(sets);
+    manager.getChangeBus().unsubscribe(subscriber);
+
+    LOG_INFO("   • TagManager: " + std::to_string(uncertain) + " UNCERTAIN, " + std::to_string(stale) +
+             " STALE, " + std::to_string(sets.size()) + " publicaciones en el bus");
+    if (expired.uncertain.size() != scanned_expired || !idle.uncertain.empty() ||
+        uncertain != frame.size() || stale != frame.size()) {
+        LOG_ERROR("❌ Resultado del barrido inesperado");
+        return 1;
+    }
+    return 0;
+}
+
+// Caída de enlace con 110 000 tags de una fuente: setQuality por tag frente a
+// un incremento de época, y coste de resolver la calidad efectiva al leer
+int sourceEpochs() {
+    const size_t num_instruments = 10000;
+
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(num_instruments));
+    auto snapshot = manager.getSnapshot();
+    SourceEpochs& epochs = manager.getSourceEpochs();
+    SourceEpochs::SourceId pac = epochs.registerSource("benchmark");
+
+    std::vector<TagUpdate> frame;
+    for (const auto& tag : snapshot->tags) {
+        frame.push_back({tag->getId(), TagValue(1.0f), TagQuality::GOOD});
+    }
+    manager.applyFrame(frame, getCurrentTimestamp(), RateClass::FAST, pac);
+
+    auto countEffective = [&](TagQuality quality) {
+        size_t count = 0;
+        for (const auto& tag : snapshot->tags) {
+            count += manager.effectiveQuality(*tag) == quality ? 1 : 0;
+        }
+        return count;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& tag : snapshot->tags) {
+        tag->setQuality(TagQuality::STALE);
+    }
+    double loop_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& tag : snapshot->tags) {
+        tag->setQuality(TagQuality::GOOD);
+    }
+
+    start = std::chrono::steady_clock::now();
+    epochs.linkDown(pac);
+    double epoch_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    size_t stale_after_drop = countEffective(TagQuality::STALE);
+
+    start = std::chrono::steady_clock::now();
+    size_t own_good = 0;
+    for (const auto& tag : snapshot->tags) {
+        own_good += tag->getQuality() == TagQuality::GOOD ? 1 : 0;
+    }
+    double own_read_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    size_t effective_stale = countEffective(TagQuality::STALE);
+    double effective_read_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    // Reconexión: cada tag vuelve a GOOD solo cuando llega su primer valor nuevo
+    epochs.linkUp(pac);
+    size_t stale_before_values = countEffective(TagQuality::STALE);
+    std::vector<TagUpdate> half(frame.begin(), frame.begin() + frame.size() / 2);
+    manager.applyFrame(half, getCurrentTimestamp(), RateClass::FAST, pac);
+    size_t good_after_half = countEffective(TagQuality::GOOD);
+
+    LOG_INFO("🔌 Benchmark de épocas de fuente: " + std::to_string(snapshot->tags.size()) + " tags");
+    LOG_INFO("   • Caída con setQuality por tag: " + std::to_string(static_cast<int64_t>(loop_us)) + "us");
+    LOG_INFO("   • Caída con época: " + std::to_string(epoch_us) + "us (" +
+             std::to_string(stale_after_drop) + " tags STALE)");
+    LOG_INFO("   • Lectura de calidad propia: " + std::to_string(static_cast<int64_t>(own_read_us)) +
+             "us, efectiva: " + std::to_string(static_cast<int64_t>(effective_read_us)) + "us");
+    LOG_INFO("   • Reconexión: " + std::to_string(stale_before_values) + " STALE sin valores, " +
+             std::to_string(good_after_half) + " GOOD tras media trama");
+
+    size_t total = snapshot->tags.size();
+    if (stale_after_drop != total || effective_stale != total || own_good != total ||
+        stale_before_values != total || good_after_half != half.size()) {
+        LOG_ERROR("❌ Calidad efectiva inesperada");
+        return 1;
+    }
+    return 0;
+}
+
+// Arranque en caliente: un proceso hijo escribe tramas con el espejo activo y
+// termina sin cierre ordenado (como una caída); el padre restaura desde el fichero
+struct WarmWriteMeasurement {
+    double frame_plain_us;
+    double frame_mirrored_us;
+};
+
+int warmRestart() {
+    const size_t num_instruments = 10000;
+    const char* path = "/tmp/planta_gas_warm_state.bench";
+    nlohmann::json config = syntheticPlantConfig(num_instruments);
+    unlink(path);
+
+    auto expectedValue = [](uint32_t id) { return static_cast<float>(id % 1000) + 0.25f; };
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        std::freopen("/dev/null", "w", stdout);
+
+        WarmWriteMeasurement measurement{};
+        TagManager* manager = new TagManager();     // Sin destructor: el proceso "cae"
+        manager->loadFromConfig(config);
+        auto snapshot = manager->getSnapshot();
+        std::vector<TagUpdate> frame;
+        for (const auto& tag : snapshot->tags) {
+            frame.push_back({tag->getId(), TagValue(expectedValue(tag->getId())), TagQuality::GOOD});
+        }
+
+        // Dos tramas con valores distintos: ambas escriben todas las ranuras
+        std::vector<TagUpdate> previous = frame;
+        for (auto& update : previous) {
+            update.value = TagValue(expectedValue(update.id) + 1.0f);
+        }
+        auto start = std::chrono::steady_clock::now();
+        manager->applyFrame(previous, getCurrentTimestamp());
+        measurement.frame_plain_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+
+        bool enabled = manager->enableWarmState(path);
+        start = std::chrono::steady_clock::now();
+        manager->applyFrame(frame, getCurrentTimestamp());
+        measurement.frame_mirrored_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        snapshot->tags.front()->setClientWriteTimestamp(12345);
+
+        ssize_t written = write(fds[1], &measurement, sizeof(measurement));
+        close(fds[1]);
+        _exit(enabled && written == static_cast<ssize_t>(sizeof(measurement)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    WarmWriteMeasurement measurement{};
+    ssize_t received = read(fds[0], &measurement, sizeof(measurement));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (received != static_cast<ssize_t>(sizeof(measurement)) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        LOG_ERROR("No se pudo escribir el estado en el proceso hijo");
+        return 1;
+    }
+
+    TagManager manager;
+    manager.loadFromConfig(config);
+    auto start = std::chrono::steady_clock::now();
+    bool restored_ok = manager.enableWarmState(path);
+    double restore_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto snapshot = manager.getSnapshot();
+    size_t restored = 0;
+    for (const auto& tag : snapshot->tags) {
+        restored += tag->getQuality() == TagQuality::UNCERTAIN &&
+                    tag->getValueAsDouble() == expectedValue(tag->getId()) ? 1 : 0;
+    }
+    bool client_write_kept = snapshot->tags.front()->getClientWriteTimestamp() == 12345;
+
+    LOG_INFO("💾 Benchmark de arranque en caliente: " + std::to_string(snapshot->tags.size()) + " tags");
+    LOG_INFO("   • Trama sin espejo: " + std::to_string(static_cast<int64_t>(measurement.frame_plain_us)) +
+             "us, con espejo: " + std::to_string(static_cast<int64_t>(measurement.frame_mirrored_us)) + "us");
+    LOG_INFO("   • Restauración tras caída: " + std::to_string(restore_ms) + "ms (" +
+             std::to_string(restored) + " tags UNCERTAIN con su último valor)");
+    unlink(path);
+
+    if (!restored_ok || restored != snapshot->tags.size() || !client_write_kept) {
+        LOG_ERROR("❌ Estado restaurado incompleto");
+        return 1;
+    }
+    return 0;
+}
+
+// Representación anterior del valor (std::variant con std::string) para comparar
+using LegacyTagValue = std::variant<bool, int32_t, uint32_t, int64_t, float, double, std::string>;
+struct LegacyTagHistory {
+    std::string tag_name;
+    LegacyTagValue value;
+    TagQuality quality;
+    uint64_t timestamp;
+};
+struct LegacyTagUpdate {
+    uint32_t id;
+    LegacyTagValue value;
+    TagQuality quality;
+};
+
+// Histórico de 1M entradas y detección de cambios con el variant frente al valor compacto
+template <typename History, typename Value>
+static void measureHistory(size_t entries, const std::string& name, double& fill_ms, double& compare_ms) {
+    std::vector<History> history;
+    auto start = std::chrono::steady_clock::now();
+    history.reserve(entries);
+    for (size_t i = 0; i < entries; i++) {
+        history.push_back({name, Value(static_cast<float>(i % 1000)), TagQuality::GOOD, i});
+    }
+    fill_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    size_t changes = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < history.size(); i++) {
+        changes += history[i].value != history[i - 1].value ? 1 : 0;
+    }
+    compare_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() +
+                 (changes == 0 ? 1 : 0);
+}
+
+int compactValues() {
+    const size_t entries = 1000000;
+
+    LOG_INFO("📦 Benchmark de valor compacto: std::variant frente a TagValue de 16 bytes");
+    LOG_INFO("   • Valor: " + std::to_string(sizeof(LegacyTagValue)) + " -> " + std::to_string(sizeof(TagValue)) + " bytes");
+    LOG_INFO("   • Entrada de histórico: " + std::to_string(sizeof(LegacyTagHistory)) + " -> " +
+             std::to_string(sizeof(TagHistory)) + " bytes");
+    LOG_INFO("   • Valor de trama (TagUpdate): " + std::to_string(sizeof(LegacyTagUpdate)) + " -> " +
+             std::to_string(sizeof(TagUpdate)) + " bytes");
+    LOG_INFO("   • Tag: " + std::to_string(sizeof(Tag)) + " bytes (celda de valor " +
+             std::to_string(sizeof(TagValueCell)) + ")");
+
+    double legacy_fill_ms = 0.0, legacy_compare_ms = 0.0;
+    double compact_fill_ms = 0.0, compact_compare_ms = 0.0;
+    measureHistory<LegacyTagHistory, LegacyTagValue>(entries, "ET_1601.PV", legacy_fill_ms, legacy_compare_ms);
+    measureHistory<TagHistory, TagValue>(entries, "ET_1601.PV", compact_fill_ms, compact_compare_ms);
+    LOG_INFO("   • " + std::to_string(entries) + " entradas de histórico: " +
+             std::to_string(entries * sizeof(LegacyTagHistory) / 1024) + "KB -> " +
+             std::to_string(entries * sizeof(TagHistory) / 1024) + "KB");
+    LOG_INFO("   • Llenado: " + std::to_string(legacy_fill_ms) + "ms -> " + std::to_string(compact_fill_ms) + "ms");
+    LOG_INFO("   • Detección de cambios: " + std::to_string(legacy_compare_ms) + "ms -> " +
+             std::to_string(compact_compare_ms) + "ms");
+
+    // Los strings comparten texto internado: mismo texto, mismo valor
+    TagValue first(std::string("ABIERTA"));
+    TagValue second(std::string("ABIERTA"));
+    if (first != second || first.text() != "ABIERTA" || TagValue(1.5f) == TagValue(1.5)) {
+        LOG_ERROR("❌ Semántica de TagValue inesperada");
+        return 1;
+    }
+    return 0;
+}
+
+// Configuración sintética con escalado en el gateway: mezcla de modos lineal, raíz y piecewise
+static nlohmann::json syntheticScaledConfig(size_t num_instruments) {
+    nlohmann::json config;
+    config["tags"] = nlohmann::json::array();
+    for (size_t i = 0; i < num_instruments; i++) {
+        nlohmann::json scaling;
+        switch (i % 4) {
+            case 0: scaling = {{"mode", "linear"}, {"raw_min", 4}, {"raw_max", 20}}; break;
+            case 1: scaling = {{"mode", "linear"}, {"raw_min", 0}, {"raw_max", 32000}, {"eu_min", -50}, {"eu_max", 150}}; break;
+            case 2: scaling = {{"mode", "sqrt"}, {"raw_min", 0}, {"raw_max", 32000}, {"eu_min", 0}, {"eu_max", 500}}; break;
+            default: scaling = {{"mode", "piecewise"}, {"points", {{0, 0}, {8000, 10}, {16000, 40}, {32000, 100}}}}; break;
+        }
+        std::string name = "SCALE_" + std::to_string(1000 + i);
+        config["tags"].push_back({
+            {"name", name},
+            {"value_table", "TBL_" + name},
+            {"category", "FLOW_TRANSMITTER"},
+            {"variables", {"Input", "PV", "percent", "min", "max"}},
+            {"scaling", scaling}
+        });
+    }
+    return config;
+}
+
+// Escalado de una trama de Input: bucle escalar por valor frente a ScalingPlan::apply por columnas
+int gatewayScaling() {
+    const size_t num_instruments = 20000;
+    const int passes = 50;
+
+    TagManager manager;
+    nlohmann::json config = syntheticScaledConfig(num_instruments);
+    manager.loadFromConfig(config);
+    auto snapshot = manager.getSnapshot();
+
+    // Rango de ingeniería de los lineales sin eu_min/eu_max: sub-tags min/max
+    std::vector<ScalingPlan::Config> configs(num_instruments);
+    std::vector<ScalingPlan::Targets> targets(num_instruments);
+    std::vector<TagUpdate> frame;
+    frame.reserve(num_instruments);
+    for (size_t i = 0; i < num_instruments; i++) {
+        const auto& tag_config = config["tags"][i];
+        std::string name = tag_config["name"].get<std::string>();
+        std::string error;
+        ScalingPlan::parse(tag_config["scaling"], configs[i], error);
+        targets[i] = {snapshot->by_name.at(name + ".Input")->getId(), snapshot->by_name.at(name + ".PV")->getId(),
+                      snapshot->by_name.at(name + ".percent")->getId(), snapshot->by_name.at(name + ".min")->getId(),
+                      snapshot->by_name.at(name + ".max")->getId()};
+        snapshot->by_id[targets[i].min]->setValue(0.0f);
+        snapshot->by_id[targets[i].max]->setValue(250.0f);
+        float raw = i % 4 == 0 ? 4.0f + static_cast<float>(i % 17) : static_cast<float>((i * 37) % 32000);
+        frame.push_back({targets[i].input, TagValue(raw), TagQuality::GOOD});
+    }
+
+    LOG_INFO("📐 Benchmark escalado en gateway: " + std::to_string(num_instruments) + " instrumentos, " +
+             std::to_string(passes) + " tramas");
+
+    // Referencia escalar: un valor cada vez, rama por modo y rango leído del tag
+    std::vector<TagUpdate> scalar;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        scalar.clear();
+        for (size_t i = 0; i < frame.size(); i++) {
+            const ScalingPlan::Config& c = configs[i];
+            float raw = static_cast<float>(frame[i].value.toDouble());
+            float low = c.has_eu_range ? c.eu_min : static_cast<float>(snapshot->by_id[targets[i].min]->getValueAsDouble());
+            float high = c.has_eu_range ? c.eu_max : static_cast<float>(snapshot->by_id[targets[i].max]->getValueAsDouble());
+            float pv = 0.0f;
+            float fraction = 0.0f;
+            if (c.mode == ScalingPlan::Mode::PIECEWISE) {
+                low = c.points.front().second;
+                high = c.points.back().second;
+                size_t k = 1;
+                while (k + 1 < c.points.size() && raw >= c.points[k].first) {
+                    k++;
+                }
+                const auto& a = c.points[k - 1];
+                const auto& b = c.points[k];
+                pv = a.second + (raw - a.first) * (b.second - a.second) / (b.first - a.first);
+                fraction = (pv - low) / (high - low);
+            } else {
+                fraction = (raw - c.raw_min) / (c.raw_max - c.raw_min);
+                if (c.mode == ScalingPlan::Mode::SQRT) {
+                    fraction = std::sqrt(std::max(fraction, 0.0f));
+                }
+                pv = low + fraction * (high - low);
+            }
+            scalar.push_back({targets[i].pv, TagValue(pv), frame[i].quality});
+            scalar.push_back({targets[i].percent, TagValue(fraction * 100.0f), frame[i].quality});
+        }
+    }
+    double scalar_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / passes;
+
+    auto plan = std::make_shared<ScalingPlan>();
+    for (size_t i = 0; i < num_instruments; i++) {
+        plan->add(targets[i], configs[i]);
+    }
+    std::vector<TagUpdate> derived;
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        derived.clear();
+        plan->apply(frame, *snapshot, derived);
+    }
+    double plan_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / passes;
+
+    LOG_INFO("   • Escalar por valor: " + std::to_string(scalar_us) + "us/trama");
+    LOG_INFO("   • Plan por columnas: " + std::to_string(plan_us) + "us/trama (x" +
+             std::to_string(scalar_us / std::max(plan_us, 0.001)) + ")");
+
+    // Mismos resultados que la referencia escalar
+    if (derived.size() != scalar.size()) {
+        LOG_ERROR("❌ Número de valores derivados distinto: " + std::to_string(derived.size()) + " frente a " +
+                  std::to_string(scalar.size()));
+        return 1;
+    }
+    for (size_t i = 0; i < derived.size(); i++) {
+        double expected = scalar[i].value.toDouble();
+        if (derived[i].id != scalar[i].id ||
+            std::abs(derived[i].value.toDouble() - expected) > 1e-3 * std::max(1.0, std::abs(expected))) {
+            LOG_ERROR("❌ Escalado distinto para " + snapshot->by_id[derived[i].id]->getName());
+            return 1;
+        }
+    }
+
+    // Trama completa: los PV que envía la fuente se descartan y se derivan del Input
+    std::vector<TagUpdate> with_pv = frame;
+    with_pv.push_back({targets[0].pv, TagValue(-1.0f), TagQuality::GOOD});
+    start = std::chrono::steady_clock::now();
+    manager.applyFrame(with_pv, getCurrentTimestamp());
+    double frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("   • applyFrame con escalado: " + std::to_string(frame_ms) + "ms para " +
+             std::to_string(with_pv.size()) + " valores de entrada");
+
+    // Instrumento 0: 4-20 sobre min/max 0-250
+    double expected_pv = 250.0 * (frame[0].value.toDouble() - 4.0) / 16.0;
+    if (!manager.isDerivedValue(targets[0].pv) || manager.isDerivedValue(targets[0].input) ||
+        std::abs(snapshot->by_id[targets[0].pv]->getValueAsDouble() - expected_pv) > 1e-3) {
+        LOG_ERROR("❌ PV derivado incorrecto en applyFrame");
+        return 1;
+    }
+    LOG_SUCCESS("✅ Escalado por columnas coincide con la referencia escalar");
+    return 0;
+}
+
+// Histórico anterior: multimap global con límite y búsqueda lineal de la entrada más antigua
+struct LegacyHistory {
+    std::multimap<std::string, TagHistory> entries;
+    size_t limit;
+
+    void add(const std::string& name, const TagValue& value, uint64_t timestamp) {
+        entries.emplace(name, TagHistory{name, value, TagQuality::GOOD, timestamp});
+        if (entries.size() > limit) {
+            auto oldest = entries.begin();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second.timestamp < oldest->second.timestamp) {
+                    oldest = it;
+                }
+            }
+            entries.erase(oldest);
+        }
+    }
+};
+
+// Inserción con 1k, 100k y 1M muestras retenidas: multimap global frente a buffers por tag
+int historyRings() {
+    const size_t depth = 100;
+
+    LOG_INFO("🕒 Benchmark de histórico: " + std::to_string(depth) + " muestras por tag");
+    for (size_t retained : {size_t(1000), size_t(100000), size_t(1000000)}) {
+        size_t num_tags = retained / depth;
+        std::vector<std::string> names;
+        for (size_t i = 0; i < num_tags; i++) {
+            names.push_back("HIST_" + std::to_string(1000 + i) + ".PV");
+        }
+
+        // Buffers llenos: cada inserción desplaza la muestra más antigua de su tag
+        std::unordered_map<std::string, TagHistoryRing> rings;
+        for (const auto& name : names) {
+            rings.emplace(name, TagHistoryRing(depth));
+        }
+        uint64_t timestamp = 0;
+        for (size_t i = 0; i < retained; i++) {
+            rings.find(names[i % num_tags])->second.push(TagValue(static_cast<float>(i)), TagQuality::GOOD, timestamp++);
+        }
+        const size_t ring_inserts = 1000000;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ring_inserts; i++) {
+            rings.find(names[i % num_tags])->second.push(TagValue(static_cast<float>(i)), TagQuality::GOOD, timestamp++);
+        }
+        double ring_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         ring_inserts;
+
+        // Multimap lleno hasta el límite: cada inserción recorre todas las entradas
+        LegacyHistory legacy{{}, retained};
+        timestamp = 0;
+        for (size_t i = 0; i < retained; i++) {
+            legacy.entries.emplace(names[i % num_tags], TagHistory{names[i % num_tags], TagValue(static_cast<float>(i)),
+                                                                    TagQuality::GOOD, timestamp++});
+        }
+        const size_t legacy_inserts = std::max<size_t>(20, 10000000 / retained);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < legacy_inserts; i++) {
+            legacy.add(names[i % num_tags], TagValue(static_cast<float>(i)), timestamp++);
+        }
+        double legacy_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                           legacy_inserts;
+
+        LOG_INFO("   • " + std::to_string(retained) + " muestras retenidas: multimap " + std::to_string(legacy_ns) +
+                 "ns/inserción, buffer por tag " + std::to_string(ring_ns) + "ns/inserción (x" +
+                 std::to_string(legacy_ns / std::max(ring_ns, 0.001)) + ")");
+        if (legacy.entries.size() != retained) {
+            LOG_ERROR("❌ El multimap no respetó su límite");
+            return 1;
+        }
+    }
+
+    // Semántica en TagManager: capacidad fija, la más reciente primero
+    TagManager manager;
+    manager.loadFromConfig(syntheticPlantConfig(1));
+    manager.setHistoryDepth(4);
+    for (int i = 0; i < 10; i++) {
+        manager.updateTagValue("BENCH_1000.PV", TagValue(static_cast<float>(i)));
+    }
+    auto history = manager.getTagHistory("BENCH_1000.PV", 100);
+    if (history.size() != 4 || history.front().value != TagValue(9.0f) || history.back().value != TagValue(6.0f)) {
+        LOG_ERROR("❌ Histórico por tag inesperado (" + std::to_string(history.size()) + " muestras)");
+        return 1;
+    }
+    manager.setHistoryDepth(2);
+    history = manager.getTagHistory("BENCH_1000.PV", 100);
+    if (history.size() != 2 || history.front().value != TagValue(9.0f)) {
+        LOG_ERROR("❌ Redimensionar el histórico no conservó las muestras recientes");
+        return 1;
+    }
+    LOG_SUCCESS("✅ Histórico por tag acotado con inserción O(1)");
+    return 0;
+}
+
+// Señales sintéticas de un día de planta a 1 s por variable de synthetic_variables:
+// PV onda lenta con ruido de transmisor (±0.2), consignas con escalones cada 2 h y alarmas cada ~3 h
+struct PlantDaySignals {
+    uint64_t rng = 88172645463325252ULL;
+
+    double operator()(size_t k, uint64_t second) {
+        size_t instrument = k / synthetic_variables.size();
+        size_t variable = k % synthetic_variables.size();
+        if (variable == 0) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            double noise = static_cast<double>(rng % 1000) / 2500.0 - 0.2;
+            return static_cast<float>(50.0 + 10.0 * std::sin(2.0 * M_PI * (second + instrument * 97) / 3600.0) + noise);
+        }
+        if (variable >= 6) {
+            return ((second + instrument * 611) / 10800) % 2 == 0 ? 0.0 : 1.0;
+        }
+        return static_cast<double>(10 * variable + (second / 7200) % 3);
+    }
+};
+
+struct HistorianDay {
+    std::vector<HistorianSeries> series;
+    uint64_t received = 0;
+    uint64_t archived = 0;
+    size_t bytes = 0;
+    size_t encoded = 0;
+    double ingest_ns = 0.0;
+};
+
+static HistorianDay historianDay(size_t num_instruments, const HistorianCompression& pv_compression,
+                                 uint64_t start_ms, uint64_t seconds) {
+    HistorianCompression flat_compression;
+    flat_compression.mode = HistorianCompression::Mode::DEADBAND;
+
+    HistorianDay day;
+    for (size_t i = 0; i < num_instruments; i++) {
+        for (const auto& variable : synthetic_variables) {
+            day.series.emplace_back(variable == "PV" ? pv_compression : flat_compression);
+        }
+    }
+
+    PlantDaySignals signal;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t second = 0; second < seconds; second++) {
+        uint64_t timestamp = start_ms + second * 1000;
+        for (size_t k = 0; k < day.series.size(); k++) {
+            day.series[k].append(timestamp, signal(k, second), TagQuality::GOOD);
+        }
+    }
+    double ingest_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& s : day.series) {
+        day.received += s.receivedPoints();
+        day.archived += s.archivedPoints();
+        day.bytes += s.bytes() + sizeof(HistorianSeries);
+        day.encoded += s.encodedBytes();
+    }
+    day.ingest_ns = ingest_ns / std::max<uint64_t>(day.received, 1);
+    return day;
+}
+
+// Un día de datos a 1 s de todos los tags de la planta en el histórico comprimido
+int compressedHistorian() {
+    const size_t num_instruments = 60;
+    const uint64_t day_seconds = 24 * 3600;
+    const uint64_t start_ms = 1700000000000ULL;
+    const uint64_t end_ms = start_ms + day_seconds * 1000;
+
+    LOG_INFO("🗜️  Benchmark histórico comprimido: " + std::to_string(num_instruments * synthetic_variables.size()) +
+             " tags, " + std::to_string(day_seconds) + " muestras a 1 s por tag");
+
+    HistorianCompression lossless;
+    lossless.mode = HistorianCompression::Mode::NONE;
+    HistorianCompression swinging_door;
+    swinging_door.mode = HistorianCompression::Mode::SWINGING_DOOR;
+    swinging_door.deviation = 0.25;
+
+    auto report = [](const std::string& label, const HistorianDay& day) {
+        size_t raw_bytes = day.received * sizeof(TagHistory);
+        LOG_INFO("   • " + label + ": archivados " + std::to_string(day.archived) + " de " +
+                 std::to_string(day.received) + ", " + std::to_string(day.bytes / 1024) + "KB (" +
+                 std::to_string(8.0 * day.encoded / std::max<uint64_t>(day.archived, 1)) +
+                 " bits/punto) frente a " + std::to_string(raw_bytes / (1024 * 1024)) + "MB en TagHistory (x" +
+                 std::to_string(static_cast<double>(raw_bytes) / day.bytes) + "), ingesta " +
+                 std::to_string(day.ingest_ns) + "ns/punto");
+    };
+    HistorianDay result = historianDay(num_instruments, lossless, start_ms, day_seconds);
+    report("PV sin pérdidas", result);
+    HistorianDay compressed = historianDay(num_instruments, swinging_door, start_ms, day_seconds);
+    report("PV swinging door ±0.25", compressed);
+
+    // Decodificación del día completo de todos los tags
+    std::vector<HistorianPoint> points;
+    size_t decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& s : result.series) {
+        points.clear();
+        s.query(start_ms, end_ms, SIZE_MAX, points);
+        decoded += points.size();
+    }
+    double decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("   • Decodificación: " + std::to_string(decoded) + " puntos en " + std::to_string(decode_ms) + "ms (" +
+             std::to_string(decoded / std::max(decode_ms, 0.001) / 1000.0) + " M puntos/s)");
+
+    // Una hora de una sola PV: solo se decodifican los bloques de ese intervalo
+    points.clear();
+    start = std::chrono::steady_clock::now();
+    result.series[0].query(start_ms + 12 * 3600 * 1000, start_ms + 13 * 3600 * 1000, SIZE_MAX, points);
+    double hour_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("   • Consulta de 1 h de una PV: " + std::to_string(points.size()) + " puntos en " +
+             std::to_string(hour_us) + "us");
+
+    // Cada serie devuelve sus puntos archivados más, como mucho, su cola pendiente
+    if (decoded < result.archived || decoded > result.archived + result.series.size()) {
+        LOG_ERROR("❌ Puntos decodificados inesperados: " + std::to_string(decoded));
+        return 1;
+    }
+
+    // Sin pérdidas: la PV decodificada es exactamente la recibida
+    PlantDaySignals signal;
+    std::vector<double> original(day_seconds);
+    for (uint64_t second = 0; second < day_seconds; second++) {
+        for (size_t k = 0; k < result.series.size(); k++) {
+            double value = signal(k, second);
+            if (k == 0) {
+                original[second] = value;
+            }
+        }
+    }
+    points.clear();
+    result.series[0].query(start_ms, end_ms, SIZE_MAX, points);
+    for (uint64_t second = 0; second < day_seconds; second++) {
+        if (points.size() != day_seconds || points[second].value != original[second] ||
+            points[second].timestamp != start_ms + second * 1000) {
+            LOG_ERROR("❌ La PV sin pérdidas no se decodifica exacta en el segundo " + std::to_string(second));
+            return 1;
+        }
+    }
+
+    // Swinging door: reconstrucción por interpolación lineal entre puntos archivados
+    points.clear();
+    compressed.series[0].query(start_ms, end_ms, SIZE_MAX, points);
+    double max_error = 0.0;
+    size_t segment = 0;
+    for (uint64_t second = 0; second < day_seconds && points.size() > 1; second++) {
+        uint64_t timestamp = start_ms + second * 1000;
+        while (segment + 2 < points.size() && points[segment + 1].timestamp < timestamp) {
+            segment++;
+        }
+        const auto& a = points[segment];
+        const auto& b = points[segment + 1];
+        double value = a.value + (b.value - a.value) * static_cast<double>(timestamp - a.timestamp) /
+                       static_cast<double>(b.timestamp - a.timestamp);
+        max_error = std::max(max_error, std::abs(value - original[second]));
+    }
+    LOG_INFO("   • Error máximo de la PV reconstruida: " + std::to_string(max_error) + " (deviation " +
+             std::to_string(swinging_door.deviation) + ")");
+    if (max_error > 2 * swinging_door.deviation + 1e-6) {
+        LOG_ERROR("❌ La reconstrucción excede la banda de compresión");
+        return 1;
+    }
+    LOG_SUCCESS("✅ Histórico comprimido dentro de la banda configurada");
+    return 0;
+}
+
+int historyStore() {
+    const size_t num_tags = 100;
+    const uint64_t day_ms = 24 * 3600 * 1000ULL;
+    const uint64_t start_ms = 1700000000000ULL / day_ms * day_ms;
+    const uint64_t day_seconds = 24 * 3600;
+    const uint64_t tail_seconds = 600;          // Del día siguiente: sella el primero
+    const std::string directory = "/tmp/planta_gas_history_store.bench";
+
+    LOG_INFO("🗄️ Benchmark histórico persistente: " + std::to_string(num_tags) + " tags, " +
+             std::to_string(day_seconds + tail_seconds) + " muestras a 1 s por tag");
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < num_tags; i++) {
+        hashes.push_back(HistoryStore::hashName("HS_" + std::to_string(i) + ".PV"));
+    }
+    auto value_of = [](size_t tag, uint64_t second) {
+        return 50.0 + 10.0 * std::sin(static_cast<double>(second) / 600.0 + tag) + (second % 7) * 0.01;
+    };
+    // Un día se ingiere en ~1 s: se vuelca cada hora sintética para no llenar el buffer
+    // acotado (max_buffered), como haría el escritor a ritmo real
+    auto ingest = [&](HistoryStore& store, uint64_t from_second, uint64_t to_second) {
+        for (uint64_t second = from_second; second < to_second; second++) {
+            for (size_t i = 0; i < num_tags; i++) {
+                store.append(hashes[i], start_ms + second * 1000, value_of(i, second), TagQuality::GOOD);
+            }
+            if ((second + 1) % 3600 == 0) {
+                store.flush();
+            }
+        }
+        store.flush();
+    };
+
+    HistoryStore::Options options;
+    options.shards = 4;
+    options.flush_interval_ms = 100;
+    options.retention_ms = 0;           // Timestamps sintéticos del pasado
+    {
+        HistoryStore store;
+        if (!store.open(directory, options)) {
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        ingest(store, 0, day_seconds + tail_seconds);
+        double ingest_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto status = store.getStatus();
+        uint64_t samples = status["flushed_samples"].get<uint64_t>();
+        LOG_INFO("   • Ingesta: " + std::to_string(samples) + " muestras en " + std::to_string(ingest_s) + "s (" +
+                 std::to_string(samples / ingest_s / 1e6) + " M muestras/s), " +
+                 std::to_string(status["commits"].get<uint64_t>()) + " group commits, " +
+                 std::to_string(status["bytes"].get<uint64_t>() / (1024 * 1024)) + "MB en " +
+                 std::to_string(status["segments"].get<size_t>()) + " segmentos");
+
+        // 24 h de un tag (segmento sellado y mapeado) y 10 min del segmento activo
+        auto measure = [&](uint64_t from, uint64_t to, size_t expected, const std::string& label) {
+            std::vector<double> latencies;
+            std::vector<HistorianPoint> points;
+            for (size_t i = 0; i < num_tags; i += 5) {
+                points.clear();
+                auto t0 = std::chrono::steady_clock::now();
+                store.query(hashes[i], from, to, SIZE_MAX, points);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+                if (points.size() != expected || points.front().timestamp != from ||
+                    points.back().value != value_of(i, (points.back().timestamp - start_ms) / 1000)) {
+                    LOG_ERROR("❌ " + label + ": " + std::to_string(points.size()) + " puntos, esperados " +
+                              std::to_string(expected));
+                    return false;
+                }
+            }
+            std::sort(latencies.begin(), latencies.end());
+            LOG_INFO("   • " + label + ": " + std::to_string(expected) + " puntos, p50 " +
+                     std::to_string(percentile(latencies, 0.5)) + "us, max " + std::to_string(latencies.back()) + "us");
+            return true;
+        };
+        if (!measure(start_ms, start_ms + day_ms - 1, day_seconds, "Consulta 24 h de un tag (sellado, mmap)") ||
+            !measure(start_ms + day_ms, start_ms + day_ms + tail_seconds * 1000, tail_seconds,
+                     "Consulta 10 min de un tag (activo, pread)")) {
+            return 1;
+        }
+    }
+
+    // Caída: un proceso hijo escribe 10 min más y termina sin sellar su segmento
+    pid_t pid = fork();
+    if (pid == 0) {
+        HistoryStore store;
+        if (!store.open(directory, options)) {
+            _exit(1);
+        }
+        ingest(store, day_seconds + tail_seconds, day_seconds + 2 * tail_seconds);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        LOG_ERROR("❌ El proceso hijo no pudo escribir el histórico");
+        return 1;
+    }
+
+    HistoryStore store;
+    auto start = std::chrono::steady_clock::now();
+    if (!store.open(directory, options)) {
+        return 1;
+    }
+    double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::vector<HistorianPoint> points;
+    store.query(hashes[0], start_ms, start_ms + 2 * day_ms, SIZE_MAX, points);
+    store.close();
+    std::filesystem::remove_all(directory, ec);
+    LOG_INFO("   • Reapertura tras la caída: " + std::to_string(open_ms) + "ms, " + std::to_string(points.size()) +
+             " puntos del tag 0");
+    if (points.size() != day_seconds + 2 * tail_seconds) {
+        LOG_ERROR("❌ Puntos perdidos tras la recuperación");
+        return 1;
+    }
+    LOG_SUCCESS("✅ Histórico persistente recuperado sin pérdidas tras la caída");
+    return 0;
+}
+
+int historyRange() {
+    const uint64_t window_ms = 60 * 1000;
+    const size_t queries = 2000;
+
+    LOG_INFO("🔎 Benchmark de consulta por rango: ventana de 1 min sobre un tag a 1 s");
+    std::vector<double> latencies;
+    for (size_t depth : {size_t(1000), size_t(100000), size_t(1000000)}) {
+        // Buffer lleno y desplazado: la más antigua no está en la posición 0 del anillo
+        TagHistoryRing ring(depth);
+        const uint64_t start_ms = 1700000000000ULL;
+        uint64_t samples = depth + depth / 3;
+        for (uint64_t i = 0; i < samples; i++) {
+            ring.push(TagValue(static_cast<double>(i)), TagQuality::GOOD, start_ms + i * 1000);
+        }
+        uint64_t oldest = start_ms + (samples - depth) * 1000;
+        uint64_t span_ms = (depth - 1) * 1000 - window_ms;
+
+        std::vector<TagHistory> out;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries; q++) {
+            uint64_t from = oldest + (q * 7919 * 1000) % span_ms / 1000 * 1000;
+            out.clear();
+            ring.range("RANGE.PV", from, from + window_ms, 1000, HistoryOrder::OLDEST_FIRST, out);
+            if (out.size() != 61 || out.front().timestamp != from || out.back().timestamp != from + window_ms) {
+                LOG_ERROR("❌ Rango incorrecto: " + std::to_string(out.size()) + " muestras");
+                return 1;
+            }
+        }
+        double range_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                          queries;
+        latencies.push_back(range_ns);
+
+        // Referencia: recorrer todo lo retenido y filtrar por tiempo
+        const size_t scans = std::max<size_t>(5, 20000000 / depth);
+        std::vector<TagHistory> all;
+        start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < scans; q++) {
+            uint64_t from = oldest + (q * 7919 * 1000) % span_ms / 1000 * 1000;
+            all.clear();
+            out.clear();
+            ring.latest("RANGE.PV", depth, all);
+            for (auto it = all.rbegin(); it != all.rend(); ++it) {
+                if (it->timestamp >= from && it->timestamp <= from + window_ms) {
+                    out.push_back(*it);
+                }
+            }
+        }
+        double scan_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         scans;
+
+        // Las más recientes primero: los 10 últimos puntos del buffer
+        out.clear();
+        ring.range("RANGE.PV", oldest, UINT64_MAX, 10, HistoryOrder::NEWEST_FIRST, out);
+        if (out.size() != 10 || out.front().timestamp != start_ms + (samples - 1) * 1000 ||
+            out.front().value.toDouble() != static_cast<double>(samples - 1)) {
+            LOG_ERROR("❌ Orden NEWEST_FIRST incorrecto");
+            return 1;
+        }
+
+        LOG_INFO("   • " + std::to_string(depth) + " muestras retenidas: rango binario " + std::to_string(range_ns) +
+                 "ns/consulta, recorrido completo " + std::to_string(scan_ns / 1000.0) + "us/consulta (x" +
+                 std::to_string(scan_ns / range_ns) + ")");
+    }
+
+    // Latencia casi plana: crece con log n (fallos de caché), no con lo retenido
+    if (latencies.back() > 3 * latencies.front()) {
+        LOG_WARNING("⚠️  La latencia de la consulta crece con el histórico retenido");
+    }
+    LOG_SUCCESS("✅ Consultas por rango correctas en todos los tamaños");
+    return 0;
+}
+
+int run(const std::string& name) {
+    static const std::map<std::string, std::function<int()>> benchmarks = {
+        {"scheduler", schedulerJitter},
+        {"stagger", staggeredPolling},
+        {"snapshot", snapshotReaders},
+        {"tag-stress", tagValueStress},
+        {"value-scan", valueScan},
+        {"hierarchy", hierarchyBuild},
+        {"frame", frameApply},
+        {"bus", changeBus},
+        {"shards", shardedRegistry},
+        {"names", internedNames},
+        {"arena", arenaLoad},
+        {"indexes", secondaryIndexes},
+        {"staleness", stalenessSweep},
+        {"epochs", sourceEpochs},
+        {"warm-restart", warmRestart},
+        {"values", compactValues},
+        {"scaling", gatewayScaling},
+        {"history", historyRings},
+        {"historian", compressedHistorian},
+        {"history-store", historyStore},
+        {"history-range", historyRange}
+    };
+
+    if (name == "all") {
+        int result = 0;
+        for (const auto& [bench_name, bench] : benchmarks) {
+            LOG_INFO("▶️  Benchmark: " + bench_name);
+            result |= bench();
+        }
+        return result;
+    }
+
+    auto it = benchmarks.find(name);
+    if (it == benchmarks.end()) {
+        LOG_ERROR("Benchmark desconocido: " + name);
+        std::string available;
+        for (const auto& [bench_name, bench] : benchmarks) {
+            available += " " + bench_name;
+        }
+        LOG_INFO("Disponibles: all" + available);
+        return 1;
+    }
+    return it->second();
+}
+
+} // namespace Benchmarks
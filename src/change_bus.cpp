@@ -0,0 +1,195 @@
+#include "change_bus.h"
+#include "common.h"
+#include <algorithm>
+
+// ============== ChangeSubscriber ==============
+// Cola acotada multi-productor con secuencia por celda: los productores
+// reservan posición con un CAS y nunca esperan a un consumidor lento
+
+static size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+ChangeSubscriber::ChangeSubscriber(uint64_t id, const std::string& name, size_t capacity)
+    : id_(id)
+    , name_(name)
+    , mask_(roundUpPowerOfTwo(capacity) - 1)
+    , cells_(new Cell[mask_ + 1])
+    , enqueue_pos_(0)
+    , dequeue_pos_(0)
+    , overflowed_(false)
+    , delivered_(0)
+    , dropped_(0)
+    , high_water_(0)
+{
+    for (size_t i = 0; i <= mask_; i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+ChangeSubscriber::~ChangeSubscriber() = default;
+
+bool ChangeSubscriber::offer(const ChangeSetPtr& change_set) {
+    Cell* cell = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &cells_[pos & mask_];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Cola llena: descartar para este suscriptor sin esperar
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            overflowed_.store(true, std::memory_order_release);
+            return false;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = change_set;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    size_t current_depth = pos + 1 - dequeue_pos_.load(std::memory_order_relaxed);
+    size_t high_water = high_water_.load(std::memory_order_relaxed);
+    while (current_depth > high_water &&
+           !high_water_.compare_exchange_weak(high_water, current_depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+size_t ChangeSubscriber::poll(std::vector<ChangeSetPtr>& out, size_t max_sets) {
+    size_t taken = 0;
+    while (taken < max_sets) {
+        Cell* cell = nullptr;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                delivered_.fetch_add(taken, std::memory_order_relaxed);
+                return taken;       // Vacía
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        out.push_back(std::move(cell->data));
+        cell->data.reset();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        taken++;
+    }
+    delivered_.fetch_add(taken, std::memory_order_relaxed);
+    return taken;
+}
+
+bool ChangeSubscriber::takeOverflow() {
+    return overflowed_.exchange(false, std::memory_order_acq_rel);
+}
+
+size_t ChangeSubscriber::depth() const {
+    size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+nlohmann::json ChangeSubscriber::getStats() const {
+    return {
+        {"id", id_},
+        {"name", name_},
+        {"capacity", capacity()},
+        {"depth", depth()},
+        {"high_water", high_water_.load(std::memory_order_relaxed)},
+        {"delivered", delivered_.load(std::memory_order_relaxed)},
+        {"dropped", dropped_.load(std::memory_order_relaxed)},
+        {"overflowed", overflowed_.load(std::memory_order_relaxed)}
+    };
+}
+
+// ============== ChangeBus ==============
+
+ChangeBus::ChangeBus()
+    : subscribers_(std::make_shared<const SubscriberList>())
+    , next_subscriber_id_(1)
+    , next_sequence_(1)
+    , published_(0)
+    , dropped_(0)
+{
+}
+
+ChangeBus::SubscriberPtr ChangeBus::subscribe(const std::string& name, size_t capacity) {
+    auto subscriber = std::make_shared<ChangeSubscriber>(
+        next_subscriber_id_.fetch_add(1, std::memory_order_relaxed), name, std::max<size_t>(capacity, 2));
+
+    std::lock_guard<std::mutex> lock(subscribe_mutex_);
+    auto updated = std::make_shared<SubscriberList>(*std::atomic_load(&subscribers_));
+    updated->push_back(subscriber);
+    std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberList>(std::move(updated)));
+
+    LOG_DEBUG("Suscriptor de cambios registrado: " + name + " (cola " + std::to_string(subscriber->capacity()) + ")");
+    return subscriber;
+}
+
+void ChangeBus::unsubscribe(const SubscriberPtr& subscriber) {
+    if (!subscriber) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(subscribe_mutex_);
+    auto updated = std::make_shared<SubscriberList>(*std::atomic_load(&subscribers_));
+    updated->erase(std::remove(updated->begin(), updated->end(), subscriber), updated->end());
+    std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberList>(std::move(updated)));
+
+    LOG_DEBUG("Suscriptor de cambios eliminado: " + subscriber->getName());
+}
+
+size_t ChangeBus::publish(std::vector<uint32_t> ids, uint64_t source_timestamp) {
+    auto subscribers = std::atomic_load(&subscribers_);
+    published_.fetch_add(1, std::memory_order_relaxed);
+    if (subscribers->empty()) {
+        return 0;
+    }
+
+    auto change_set = std::make_shared<const ChangeSet>(ChangeSet{
+        next_sequence_.fetch_add(1, std::memory_order_relaxed), source_timestamp, std::move(ids)});
+
+    size_t rejected = 0;
+    for (const auto& subscriber : *subscribers) {
+        if (!subscriber->offer(change_set)) {
+            rejected++;
+        }
+    }
+    if (rejected > 0) {
+        dropped_.fetch_add(rejected, std::memory_order_relaxed);
+    }
+    return rejected;
+}
+
+size_t ChangeBus::subscriberCount() const {
+    return std::atomic_load(&subscribers_)->size();
+}
+
+nlohmann::json ChangeBus::getStatus() const {
+    auto subscribers = std::atomic_load(&subscribers_);
+    nlohmann::json list = nlohmann::json::array();
+    for (const auto& subscriber : *subscribers) {
+        list.push_back(subscriber->getStats());
+    }
+    return {
+        {"published", published_.load(std::memory_order_relaxed)},
+        {"dropped", dropped_.load(std::memory_order_relaxed)},
+        {"subscribers", list}
+    };
+}
@@ -0,0 +1,129 @@
+#include "cycle_monitor.h"
+#include "common.h"
+
+std::string rateClassToString(RateClass rate_class) {
+    switch (rate_class) {
+        case RateClass::FAST: return "FAST";
+        case RateClass::MEDIUM: return "MEDIUM";
+        case RateClass::SLOW: return "SLOW";
+        default: return "UNKNOWN";
+    }
+}
+
+CycleMonitor::CycleMonitor(size_t window_size, size_t overrun_threshold, size_t recovery_cycles)
+    : clean_streak_(0)
+    , shed_level_(SHED_NONE)
+    , window_size_(window_size)
+    , overrun_threshold_(overrun_threshold)
+    , recovery_cycles_(recovery_cycles)
+{
+}
+
+bool CycleMonitor::recordExecution(RateClass rate_class, std::chrono::milliseconds period,
+                                   std::chrono::milliseconds lateness, std::chrono::milliseconds duration) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ClassStats& stats = stats_[static_cast<int>(rate_class)];
+    int64_t lateness_ms = std::max<int64_t>(0, lateness.count());
+
+    stats.executions++;
+    stats.last_duration_ms = duration.count();
+    stats.max_lateness_ms = std::max(stats.max_lateness_ms, lateness_ms);
+
+    // Overrun: el trabajo terminó después de su siguiente deadline
+    bool overrun = (lateness_ms + duration.count()) > period.count();
+    if (overrun) {
+        stats.overruns++;
+        LOG_WARNING("⏱️ Overrun " + rateClassToString(rate_class) + ": retraso " +
+                   std::to_string(lateness_ms) + "ms + duración " + std::to_string(duration.count()) +
+                   "ms > periodo " + std::to_string(period.count()) + "ms");
+    }
+
+    updateShedLevel(overrun);
+    return overrun;
+}
+
+void CycleMonitor::updateShedLevel(bool overrun) {
+    recent_overruns_.push_back(overrun);
+    if (recent_overruns_.size() > window_size_) {
+        recent_overruns_.pop_front();
+    }
+
+    size_t overrun_count = 0;
+    for (bool o : recent_overruns_) {
+        if (o) overrun_count++;
+    }
+
+    // Sobrecarga sostenida: escalar un nivel y exigir nueva evidencia
+    if (overrun_count >= overrun_threshold_ && shed_level_ < SHED_SLOW_MEDIUM) {
+        shed_level_++;
+        recent_overruns_.clear();
+        clean_streak_ = 0;
+        LOG_WARNING("🔻 Descarte de carga nivel " + std::to_string(shed_level_) +
+                   (shed_level_ == SHED_SLOW ? " (SLOW)" : " (SLOW + MEDIUM)"));
+        return;
+    }
+
+    // Histéresis: bajar un nivel tras recovery_cycles ejecuciones limpias
+    clean_streak_ = overrun ? 0 : clean_streak_ + 1;
+    if (shed_level_ > SHED_NONE && clean_streak_ >= recovery_cycles_) {
+        shed_level_--;
+        clean_streak_ = 0;
+        LOG_INFO("🔺 Descarte de carga reducido a nivel " + std::to_string(shed_level_));
+    }
+}
+
+bool CycleMonitor::shouldShed(RateClass rate_class) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (rate_class) {
+        case RateClass::SLOW: return shed_level_ >= SHED_SLOW;
+        case RateClass::MEDIUM: return shed_level_ >= SHED_SLOW_MEDIUM;
+        case RateClass::FAST:
+        default: return false;
+    }
+}
+
+void CycleMonitor::recordShed(RateClass rate_class, const std::string& job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stats_[static_cast<int>(rate_class)].sheds++;
+    shed_events_.push_back({getCurrentTimestamp(), rate_class, job, shed_level_});
+    if (shed_events_.size() > MAX_SHED_EVENTS) {
+        shed_events_.pop_front();
+    }
+    LOG_DEBUG("🗑️ Descartado " + job + " (" + rateClassToString(rate_class) + ")");
+}
+
+int CycleMonitor::getShedLevel() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return shed_level_;
+}
+
+nlohmann::json CycleMonitor::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    nlohmann::json status;
+    status["shed_level"] = shed_level_;
+    status["classes"] = nlohmann::json::object();
+    for (RateClass rate_class : {RateClass::FAST, RateClass::MEDIUM, RateClass::SLOW}) {
+        const ClassStats& stats = stats_[static_cast<int>(rate_class)];
+        status["classes"][rateClassToString(rate_class)] = {
+            {"executions", stats.executions},
+            {"overruns", stats.overruns},
+            {"sheds", stats.sheds},
+            {"max_lateness_ms", stats.max_lateness_ms},
+            {"last_duration_ms", stats.last_duration_ms}
+        };
+    }
+
+    status["shed_events"] = nlohmann::json::array();
+    for (const auto& event : shed_events_) {
+        status["shed_events"].push_back({
+            {"timestamp", event.timestamp},
+            {"class", rateClassToString(event.rate_class)},
+            {"job", event.job},
+            {"shed_level", event.shed_level}
+        });
+    }
+    return status;
+}
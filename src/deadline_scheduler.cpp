@@ -0,0 +1,392 @@
+#include "deadline_scheduler.h"
+#include "common.h"
+#include <algorithm>
+
+// Límites superiores (us) de los buckets de jitter; el último bucket es abierto
+static const int64_t JITTER_BUCKET_LIMITS_US[] = {50, 100, 250, 500, 1000, 5000, 10000};
+static const char* JITTER_BUCKET_LABELS[] = {"<50us", "<100us", "<250us", "<500us", "<1ms", "<5ms", "<10ms", ">=10ms"};
+
+// FNV-1a: hash estable para ordenar trabajos escalonados
+static uint64_t staggerHash(const std::string& key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+DeadlineScheduler::DeadlineScheduler()
+    : epoch_(Clock::now())
+    , next_id_(1)
+    , running_(false)
+    , stop_requested_(false)
+{
+    resetStats();
+}
+
+DeadlineScheduler::~DeadlineScheduler() {
+    stop();
+}
+
+DeadlineScheduler::JobId DeadlineScheduler::schedule(const std::string& name, std::chrono::microseconds period,
+                                                     std::chrono::microseconds phase, Callback callback) {
+    if (period.count() <= 0) {
+        LOG_ERROR("Periodo inválido para trabajo " + name);
+        return 0;
+    }
+    return addJob(name, period, Clock::now() + phase, std::move(callback));
+}
+
+DeadlineScheduler::JobId DeadlineScheduler::scheduleStaggered(const std::string& name, std::chrono::microseconds period,
+                                                              const std::string& stagger_key, Callback callback) {
+    if (period.count() <= 0) {
+        LOG_ERROR("Periodo inválido para trabajo " + name);
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    JobId id = next_id_++;
+    Job& job = jobs_[id];
+    job.name = name;
+    job.period = period;
+    job.callback = std::move(callback);
+    job.next_deadline = Clock::now();
+    job.last_deadline = job.next_deadline - period;
+    job.generation = 0;
+    job.runs = 0;
+    job.missed = 0;
+    job.pending_missed = 0;
+    job.executing = false;
+    job.trigger_pending = false;
+    job.stagger_key = stagger_key;
+    job.stagger_hash = staggerHash(stagger_key);
+    job.phase = std::chrono::microseconds(-1);
+
+    // El rebalanceo asigna fase y primer deadline a todo el grupo
+    addToGroupLocked(id, job);
+    return id;
+}
+
+DeadlineScheduler::JobId DeadlineScheduler::scheduleOnce(const std::string& name, std::chrono::microseconds delay,
+                                                         Callback callback) {
+    return addJob(name, std::chrono::microseconds(0), Clock::now() + delay, std::move(callback));
+}
+
+DeadlineScheduler::JobId DeadlineScheduler::addJob(const std::string& name, std::chrono::microseconds period,
+                                                   Clock::time_point first_deadline, Callback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    JobId id = next_id_++;
+    Job& job = jobs_[id];
+    job.name = name;
+    job.period = period;
+    job.callback = std::move(callback);
+    job.next_deadline = first_deadline;
+    job.last_deadline = first_deadline - period;
+    job.generation = 0;
+    job.runs = 0;
+    job.missed = 0;
+    job.pending_missed = 0;
+    job.executing = false;
+    job.trigger_pending = false;
+    job.stagger_hash = 0;
+    job.phase = std::chrono::microseconds(0);
+
+    pushLocked(id, job);
+    return id;
+}
+
+bool DeadlineScheduler::cancel(JobId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    if (!it->second.stagger_key.empty()) {
+        Job job = it->second;
+        jobs_.erase(it);
+        removeFromGroupLocked(id, job);
+        return true;
+    }
+    // La entrada del heap se descarta al llegar a la cima
+    jobs_.erase(it);
+    return true;
+}
+
+bool DeadlineScheduler::reschedule(JobId id, std::chrono::microseconds period) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = jobs_.find(id);
+    if (it == jobs_.end() || period.count() <= 0) {
+        return false;
+    }
+
+    Job& job = it->second;
+    if (job.period == period) {
+        return true;
+    }
+
+    if (!job.stagger_key.empty()) {
+        // Cambia de grupo: se rebalancean el grupo de origen y el de destino
+        removeFromGroupLocked(id, job);
+        job.period = period;
+        addToGroupLocked(id, job);
+        return true;
+    }
+
+    job.period = period;
+    job.generation++;
+    job.next_deadline = std::max(job.last_deadline + period, Clock::now());
+    pushLocked(id, job);
+    return true;
+}
+
+bool DeadlineScheduler::triggerNow(JobId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+
+    Job& job = it->second;
+    if (job.executing) {
+        job.trigger_pending = true;
+        return true;
+    }
+
+    auto now = Clock::now();
+    if (job.next_deadline <= now) {
+        return true;  // Ya está vencido: se fusiona con la ejecución pendiente
+    }
+
+    // El periodo continúa a partir del disparo
+    job.generation++;
+    job.next_deadline = now;
+    pushLocked(id, job);
+    return true;
+}
+
+void DeadlineScheduler::pushLocked(JobId id, Job& job) {
+    bool new_top = heap_.empty() || job.next_deadline < heap_.top().deadline;
+    heap_.push({job.next_deadline, id, job.generation});
+    if (new_top) {
+        cv_.notify_one();
+    }
+}
+
+void DeadlineScheduler::addToGroupLocked(JobId id, Job& job) {
+    stagger_groups_[job.period.count()].push_back(id);
+    rebalanceGroupLocked(job.period);
+}
+
+void DeadlineScheduler::removeFromGroupLocked(JobId id, const Job& job) {
+    auto group = stagger_groups_.find(job.period.count());
+    if (group == stagger_groups_.end()) {
+        return;
+    }
+    auto& members = group->second;
+    members.erase(std::remove(members.begin(), members.end(), id), members.end());
+    if (members.empty()) {
+        stagger_groups_.erase(group);
+    } else {
+        rebalanceGroupLocked(job.period);
+    }
+}
+
+// Repartir uniformemente las fases de un grupo en orden de hash
+void DeadlineScheduler::rebalanceGroupLocked(std::chrono::microseconds period) {
+    auto group = stagger_groups_.find(period.count());
+    if (group == stagger_groups_.end()) {
+        return;
+    }
+
+    auto& members = group->second;
+    std::sort(members.begin(), members.end(), [this](JobId a, JobId b) {
+        const Job& ja = jobs_.at(a);
+        const Job& jb = jobs_.at(b);
+        return ja.stagger_hash != jb.stagger_hash ? ja.stagger_hash < jb.stagger_hash : a < b;
+    });
+
+    auto now = Clock::now();
+    for (size_t rank = 0; rank < members.size(); rank++) {
+        Job& job = jobs_.at(members[rank]);
+        auto phase = period * rank / members.size();
+        if (job.phase == phase) {
+            continue;
+        }
+
+        // Primer hueco alineado a no menos de medio periodo de la última ejecución
+        job.phase = phase;
+        job.generation++;
+        job.next_deadline = alignedDeadline(period, phase, std::max(now, job.last_deadline + period / 2));
+        pushLocked(members[rank], job);
+    }
+}
+
+// Primer deadline epoch_ + phase + k * period que no es anterior a after
+DeadlineScheduler::Clock::time_point DeadlineScheduler::alignedDeadline(std::chrono::microseconds period,
+                                                                        std::chrono::microseconds phase,
+                                                                        Clock::time_point after) const {
+    Clock::time_point base = epoch_ + phase;
+    if (after <= base) {
+        return base;
+    }
+    auto periods = (after - base + period - Clock::duration(1)) / period;
+    return base + period * periods;
+}
+
+void DeadlineScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_requested_) {
+        return;
+    }
+    running_ = true;
+
+    while (!stop_requested_) {
+        if (heap_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        HeapEntry top = heap_.top();
+        auto it = jobs_.find(top.id);
+        if (it == jobs_.end() || it->second.generation != top.generation) {
+            heap_.pop();  // Entrada cancelada o reprogramada
+            continue;
+        }
+
+        auto now = Clock::now();
+        if (top.deadline > now) {
+            // Dormir exactamente hasta el siguiente deadline (o hasta un alta anterior)
+            cv_.wait_until(lock, top.deadline);
+            continue;
+        }
+
+        heap_.pop();
+        Job& job = it->second;
+        DispatchInfo info{top.id, top.deadline, now, job.period, job.pending_missed};
+        recordJitterLocked(std::chrono::duration_cast<std::chrono::microseconds>(now - top.deadline));
+        job.runs++;
+        job.pending_missed = 0;
+        job.last_deadline = top.deadline;
+        job.executing = true;
+
+        Callback callback = job.callback;  // Copia: el trabajo puede cancelarse durante la ejecución
+        uint64_t generation = job.generation;
+
+        lock.unlock();
+        try {
+            callback(info);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Excepción en trabajo programado: " + std::string(e.what()));
+        }
+        lock.lock();
+
+        it = jobs_.find(top.id);
+        if (it == jobs_.end()) {
+            continue;
+        }
+        Job& done = it->second;
+        done.executing = false;
+        if (done.generation != generation) {
+            continue;  // Reprogramado durante la ejecución: ya tiene entrada nueva
+        }
+        if (done.period.count() == 0) {
+            jobs_.erase(it);
+            continue;
+        }
+
+        // Tasa fija: si se perdieron periodos se saltan y se ejecuta una sola vez
+        Clock::time_point next = top.deadline + done.period;
+        auto after = Clock::now();
+        if (done.trigger_pending) {
+            done.trigger_pending = false;
+            next = after;
+        } else if (!done.stagger_key.empty() && top.deadline != alignedDeadline(done.period, done.phase, top.deadline)) {
+            // Tras un triggerNow el trabajo escalonado vuelve a su hueco
+            next = alignedDeadline(done.period, done.phase, std::max(after, top.deadline + done.period / 2));
+        } else if (next <= after) {
+            uint64_t skipped = static_cast<uint64_t>((after - next) / done.period);
+            next += done.period * skipped;
+            done.missed += skipped;
+            done.pending_missed = skipped;
+            missed_total_ += skipped;
+        }
+        done.next_deadline = next;
+        heap_.push({next, top.id, done.generation});
+    }
+
+    running_ = false;
+}
+
+void DeadlineScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    cv_.notify_all();
+}
+
+size_t DeadlineScheduler::jobCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+void DeadlineScheduler::recordJitterLocked(std::chrono::microseconds jitter) {
+    int64_t jitter_us = std::max<int64_t>(0, jitter.count());
+    dispatches_++;
+    jitter_sum_us_ += jitter_us;
+    jitter_max_us_ = std::max(jitter_max_us_, jitter_us);
+
+    size_t bucket = 0;
+    while (bucket < JITTER_BUCKETS - 1 && jitter_us >= JITTER_BUCKET_LIMITS_US[bucket]) {
+        bucket++;
+    }
+    jitter_buckets_[bucket]++;
+}
+
+void DeadlineScheduler::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dispatches_ = 0;
+    missed_total_ = 0;
+    jitter_sum_us_ = 0;
+    jitter_max_us_ = 0;
+    std::fill(std::begin(jitter_buckets_), std::end(jitter_buckets_), 0);
+}
+
+nlohmann::json DeadlineScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    nlohmann::json stats;
+    stats["jobs"] = jobs_.size();
+    stats["heap_entries"] = heap_.size();
+    stats["dispatches"] = dispatches_;
+    stats["missed_periods"] = missed_total_;
+    stats["jitter_mean_us"] = dispatches_ > 0 ? static_cast<double>(jitter_sum_us_) / dispatches_ : 0.0;
+    stats["jitter_max_us"] = jitter_max_us_;
+
+    nlohmann::json histogram = nlohmann::json::object();
+    for (size_t i = 0; i < JITTER_BUCKETS; i++) {
+        histogram[JITTER_BUCKET_LABELS[i]] = jitter_buckets_[i];
+    }
+    stats["jitter_histogram"] = histogram;
+
+    // Detalle por trabajo solo para tamaños manejables
+    if (jobs_.size() <= 64) {
+        stats["job_list"] = nlohmann::json::array();
+        for (const auto& [id, job] : jobs_) {
+            stats["job_list"].push_back({
+                {"id", id},
+                {"name", job.name},
+                {"period_ms", job.period.count() / 1000.0},
+                {"runs", job.runs},
+                {"missed", job.missed}
+            });
+        }
+    }
+    return stats;
+}
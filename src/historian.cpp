@@ -0,0 +1,343 @@
+#include "historian.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Peor caso de un punto: timestamp 4+64, valor 2+5+6+64 y calidad 1+8 bits
+static constexpr uint32_t MAX_POINT_BITS = 160;
+
+static void writeBits(uint8_t* data, uint32_t& position, uint64_t value, uint32_t count) {
+    while (count > 0) {
+        uint32_t offset = position & 7;
+        uint32_t take = std::min<uint32_t>(8 - offset, count);
+        uint64_t chunk = (value >> (count - take)) & ((1ULL << take) - 1);
+        data[position >> 3] |= static_cast<uint8_t>(chunk << (8 - offset - take));
+        position += take;
+        count -= take;
+    }
+}
+
+static uint64_t readBits(const uint8_t* data, uint32_t& position, uint32_t count) {
+    uint64_t value = 0;
+    while (count > 0) {
+        uint32_t offset = position & 7;
+        uint32_t take = std::min<uint32_t>(8 - offset, count);
+        uint64_t chunk = (data[position >> 3] >> (8 - offset - take)) & ((1ULL << take) - 1);
+        value = (value << take) | chunk;
+        position += take;
+        count -= take;
+    }
+    return value;
+}
+
+static uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool HistorianCompression::parse(const nlohmann::json& config, HistorianCompression& out, std::string& error) {
+    if (!config.is_object()) {
+        error = "la compresión debe ser un objeto";
+        return false;
+    }
+
+    std::string mode = config.value("mode", std::string(modeName(out.mode)));
+    if (mode == "none") {
+        out.mode = Mode::NONE;
+    } else if (mode == "deadband") {
+        out.mode = Mode::DEADBAND;
+    } else if (mode == "swinging_door" || mode == "swinging-door") {
+        out.mode = Mode::SWINGING_DOOR;
+    } else {
+        error = "modo de compresión desconocido: " + mode;
+        return false;
+    }
+
+    out.deviation = config.value("deviation", out.deviation);
+    if (!(out.deviation >= 0.0)) {
+        error = "deviation debe ser >= 0";
+        return false;
+    }
+
+    if (config.contains("retention_hours")) {
+        double hours = config["retention_hours"].get<double>();
+        if (!(hours >= 0.0)) {
+            error = "retention_hours debe ser >= 0";
+            return false;
+        }
+        out.retention_ms = static_cast<uint64_t>(hours * 3600.0 * 1000.0);
+    }
+    return true;
+}
+
+const char* HistorianCompression::modeName(Mode mode) {
+    switch (mode) {
+        case Mode::NONE: return "none";
+        case Mode::DEADBAND: return "deadband";
+        default: return "swinging_door";
+    }
+}
+
+void HistorianBlock::decode(std::vector<HistorianPoint>& out) const {
+    if (count == 0) {
+        return;
+    }
+    out.reserve(out.size() + count);
+
+    uint32_t position = 0;
+    uint64_t timestamp = readBits(data, position, 64);
+    uint64_t value_bits = readBits(data, position, 64);
+    TagQuality quality = static_cast<TagQuality>(readBits(data, position, 8));
+    out.push_back({timestamp, bitsDouble(value_bits), quality});
+
+    int64_t delta = 0;
+    uint32_t leading = 0;
+    uint32_t meaningful = 0;
+    for (uint32_t i = 1; i < count; i++) {
+        // Delta de deltas con prefijo de longitud variable
+        int64_t dod = 0;
+        if (readBits(data, position, 1) != 0) {
+            if (readBits(data, position, 1) == 0) {
+                dod = static_cast<int64_t>(readBits(data, position, 7)) - 63;
+            } else if (readBits(data, position, 1) == 0) {
+                dod = static_cast<int64_t>(readBits(data, position, 9)) - 255;
+            } else if (readBits(data, position, 1) == 0) {
+                dod = static_cast<int64_t>(readBits(data, position, 12)) - 2047;
+            } else {
+                dod = static_cast<int64_t>(readBits(data, position, 64));
+            }
+        }
+        delta += dod;
+        timestamp += static_cast<uint64_t>(delta);
+
+        // XOR con el valor anterior: misma ventana o ventana nueva
+        if (readBits(data, position, 1) != 0) {
+            if (readBits(data, position, 1) != 0) {
+                leading = static_cast<uint32_t>(readBits(data, position, 5));
+                meaningful = static_cast<uint32_t>(readBits(data, position, 6)) + 1;
+            }
+            uint64_t xor_bits = readBits(data, position, meaningful);
+            value_bits ^= xor_bits << (64 - leading - meaningful);
+        }
+
+        if (readBits(data, position, 1) != 0) {
+            quality = static_cast<TagQuality>(readBits(data, position, 8));
+        }
+        out.push_back({timestamp, bitsDouble(value_bits), quality});
+    }
+}
+
+HistorianSeries::HistorianSeries(const HistorianCompression& compression)
+    : compression_(compression)
+{
+}
+
+void HistorianSeries::setCompression(const HistorianCompression& compression) {
+    compression_ = compression;
+}
+
+void HistorianSeries::append(uint64_t timestamp, double value, TagQuality quality) {
+    received_++;
+    if (!has_archived_) {
+        archive(timestamp, value, quality);
+        return;
+    }
+
+    // Puntos fuera de orden o repetidos en el instante archivado se descartan
+    uint64_t last_timestamp = has_pending_ ? pending_.timestamp : last_archived_.timestamp;
+    if (timestamp < last_timestamp || timestamp == last_archived_.timestamp) {
+        return;
+    }
+
+    // Cambio de calidad o valor no finito: se cierra el tramo y se archiva el punto
+    TagQuality last_quality = has_pending_ ? pending_.quality : last_archived_.quality;
+    if (compression_.mode == HistorianCompression::Mode::NONE || quality != last_quality || !std::isfinite(value)) {
+        if (has_pending_) {
+            archive(pending_.timestamp, pending_.value, pending_.quality);
+        }
+        archive(timestamp, value, quality);
+        return;
+    }
+
+    double deviation = compression_.deviation;
+    if (compression_.mode == HistorianCompression::Mode::DEADBAND) {
+        if (std::abs(value - last_archived_.value) > deviation ||
+            (deviation == 0.0 && value != last_archived_.value)) {
+            archive(timestamp, value, quality);
+        } else {
+            pending_ = {timestamp, value, quality};
+            has_pending_ = true;
+        }
+        return;
+    }
+
+    // Puerta oscilante: pendientes desde el último archivado que mantienen todos
+    // los puntos recibidos dentro de ±deviation
+    double dt = static_cast<double>(timestamp - last_archived_.timestamp);
+    double upper = (value + deviation - last_archived_.value) / dt;
+    double lower = (value - deviation - last_archived_.value) / dt;
+    if (has_pending_) {
+        upper = std::min(upper, slope_upper_);
+        lower = std::max(lower, slope_lower_);
+        if (lower > upper) {
+            // La puerta se cierra: el último punto dentro del corredor se archiva
+            archive(pending_.timestamp, pending_.value, pending_.quality);
+            dt = static_cast<double>(timestamp - last_archived_.timestamp);
+            upper = (value + deviation - last_archived_.value) / dt;
+            lower = (value - deviation - last_archived_.value) / dt;
+        }
+    }
+    slope_upper_ = upper;
+    slope_lower_ = lower;
+    pending_ = {timestamp, value, quality};
+    has_pending_ = true;
+}
+
+void HistorianSeries::archive(uint64_t timestamp, double value, TagQuality quality) {
+    last_archived_ = {timestamp, value, quality};
+    has_archived_ = true;
+    has_pending_ = false;
+    archived_++;
+
+    if (open_ && open_->bits + MAX_POINT_BITS > HistorianBlock::BYTES * 8) {
+        seal();
+    }
+    uint64_t value_bits = doubleBits(value);
+
+    if (!open_) {
+        // Primer punto del bloque en claro
+        open_ = std::make_unique<HistorianBlock>();
+        writeBits(open_->data, open_->bits, timestamp, 64);
+        writeBits(open_->data, open_->bits, value_bits, 64);
+        writeBits(open_->data, open_->bits, static_cast<uint8_t>(quality), 8);
+        open_->first_timestamp = timestamp;
+        open_->last_timestamp = timestamp;
+        open_->count = 1;
+        prev_timestamp_ = timestamp;
+        prev_delta_ = 0;
+        prev_bits_ = value_bits;
+        prev_leading_ = 0xFF;
+        prev_trailing_ = 0;
+        prev_quality_ = quality;
+        return;
+    }
+
+    HistorianBlock& block = *open_;
+    int64_t delta = static_cast<int64_t>(timestamp - prev_timestamp_);
+    int64_t dod = delta - prev_delta_;
+    if (dod == 0) {
+        writeBits(block.data, block.bits, 0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        writeBits(block.data, block.bits, 0b10, 2);
+        writeBits(block.data, block.bits, static_cast<uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        writeBits(block.data, block.bits, 0b110, 3);
+        writeBits(block.data, block.bits, static_cast<uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        writeBits(block.data, block.bits, 0b1110, 4);
+        writeBits(block.data, block.bits, static_cast<uint64_t>(dod + 2047), 12);
+    } else {
+        writeBits(block.data, block.bits, 0b1111, 4);
+        writeBits(block.data, block.bits, static_cast<uint64_t>(dod), 64);
+    }
+
+    uint64_t xor_bits = value_bits ^ prev_bits_;
+    if (xor_bits == 0) {
+        writeBits(block.data, block.bits, 0, 1);
+    } else {
+        uint8_t leading = static_cast<uint8_t>(std::min(__builtin_clzll(xor_bits), 31));
+        uint8_t trailing = static_cast<uint8_t>(__builtin_ctzll(xor_bits));
+        if (prev_leading_ != 0xFF && leading >= prev_leading_ && trailing >= prev_trailing_) {
+            uint32_t meaningful = 64 - prev_leading_ - prev_trailing_;
+            writeBits(block.data, block.bits, 0b10, 2);
+            writeBits(block.data, block.bits, xor_bits >> prev_trailing_, meaningful);
+        } else {
+            uint32_t meaningful = 64 - leading - trailing;
+            writeBits(block.data, block.bits, 0b11, 2);
+            writeBits(block.data, block.bits, leading, 5);
+            writeBits(block.data, block.bits, meaningful - 1, 6);
+            writeBits(block.data, block.bits, xor_bits >> trailing, meaningful);
+            prev_leading_ = leading;
+            prev_trailing_ = trailing;
+        }
+    }
+
+    if (quality == prev_quality_) {
+        writeBits(block.data, block.bits, 0, 1);
+    } else {
+        writeBits(block.data, block.bits, 1, 1);
+        writeBits(block.data, block.bits, static_cast<uint8_t>(quality), 8);
+    }
+
+    block.last_timestamp = timestamp;
+    block.count++;
+    prev_timestamp_ = timestamp;
+    prev_delta_ = delta;
+    prev_bits_ = value_bits;
+    prev_quality_ = quality;
+}
+
+void HistorianSeries::seal() {
+    sealed_.push_back(std::move(open_));
+
+    // Retención por antigüedad respecto al bloque más reciente
+    uint64_t newest = sealed_.back()->last_timestamp;
+    while (compression_.retention_ms > 0 && sealed_.size() > 1 &&
+           sealed_.front()->last_timestamp + compression_.retention_ms < newest) {
+        sealed_.pop_front();
+    }
+}
+
+void HistorianSeries::query(uint64_t start, uint64_t end, size_t max_points, std::vector<HistorianPoint>& out) const {
+    if (start > end || max_points == 0) {
+        return;
+    }
+    size_t limit = out.size() + max_points;
+
+    // Primer bloque cerrado que puede contener start (bloques ordenados por tiempo)
+    auto first = std::lower_bound(sealed_.begin(), sealed_.end(), start,
+        [](const std::unique_ptr<HistorianBlock>& block, uint64_t time) { return block->last_timestamp < time; });
+
+    std::vector<HistorianPoint> decoded;
+    auto collect = [&](const HistorianBlock& block) {
+        if (block.first_timestamp > end || block.last_timestamp < start) {
+            return;
+        }
+        decoded.clear();
+        block.decode(decoded);
+        for (const auto& point : decoded) {
+            if (point.timestamp >= start && point.timestamp <= end && out.size() < limit) {
+                out.push_back(point);
+            }
+        }
+    };
+    for (auto it = first; it != sealed_.end() && (*it)->first_timestamp <= end && out.size() < limit; ++it) {
+        collect(**it);
+    }
+    if (open_ && out.size() < limit) {
+        collect(*open_);
+    }
+
+    // Cola: último punto recibido aún no archivado
+    if (has_pending_ && pending_.timestamp >= start && pending_.timestamp <= end && out.size() < limit) {
+        out.push_back(pending_);
+    }
+}
+
+size_t HistorianSeries::encodedBytes() const {
+    size_t total = 0;
+    for (const auto& block : sealed_) {
+        total += (block->bits + 7) / 8;
+    }
+    if (open_) {
+        total += (open_->bits + 7) / 8;
+    }
+    return total;
+}
@@ -0,0 +1,736 @@
+#include "history_store.h"
+#include "warm_state.h"
+#include "common.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint64_t DAY_MS = 24 * 3600 * 1000ULL;
+
+bool HistoryStore::Options::parse(const nlohmann::json& config, Options& out, std::string& error) {
+    if (!config.is_object()) {
+        error = "\"history_store\" debe ser un objeto";
+        return false;
+    }
+    out.flush_interval_ms = config.value("flush_interval_ms", out.flush_interval_ms);
+    if (out.flush_interval_ms == 0) {
+        error = "flush_interval_ms debe ser > 0";
+        return false;
+    }
+    if (config.contains("retention_days")) {
+        double days = config["retention_days"].get<double>();
+        if (!(days >= 0.0)) {
+            error = "retention_days debe ser >= 0";
+            return false;
+        }
+        out.retention_ms = static_cast<uint64_t>(days * DAY_MS);
+    }
+    if (config.contains("max_mb")) {
+        double mb = config["max_mb"].get<double>();
+        if (!(mb >= 0.0)) {
+            error = "max_mb debe ser >= 0";
+            return false;
+        }
+        out.max_bytes = static_cast<uint64_t>(mb * 1024 * 1024);
+    }
+    out.max_buffered = config.value("max_buffered", out.max_buffered);
+    return true;
+}
+
+HistoryStore::Segment::~Segment() {
+    if (mapping) {
+        munmap(const_cast<uint8_t*>(mapping), bytes);
+    }
+}
+
+HistoryStore::HistoryStore()
+    : open_(false)
+    , stop_writer_(false)
+    , flushed_samples_(0)
+    , dropped_samples_(0)
+    , commits_(0)
+    , removed_segments_(0)
+{
+}
+
+HistoryStore::~HistoryStore() {
+    close();
+}
+
+uint64_t HistoryStore::hashName(const std::string& name) {
+    return WarmStateFile::hashName(name);
+}
+
+uint64_t HistoryStore::checksum(const void* data, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ULL ^ bytes;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool HistoryStore::writeAll(int fd, const void* data, size_t bytes, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = pwrite(fd, p, bytes, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        bytes -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool HistoryStore::open(const std::string& directory, const Options& options) {
+    close();
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        LOG_ERROR("🗄️ No se pudo crear el directorio de histórico " + directory + ": " + ec.message());
+        return false;
+    }
+
+    directory_ = directory;
+    options_ = options;
+    options_.shards = std::max<size_t>(options_.shards, 1);
+    shards_.clear();
+    for (size_t i = 0; i < options_.shards; i++) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+
+    // Segmentos existentes: sellados se mapean, los de una caída se recuperan y sellan
+    size_t segments = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("history-", 0) != 0 || entry.path().extension() != ".seg") {
+            continue;
+        }
+        std::string path = entry.path().string();
+        auto segment = mapSegment(path);
+        if (!segment) {
+            segment = recoverSegment(path);
+        }
+        if (!segment) {
+            continue;
+        }
+        // Los sellados se consultan desde todas las particiones: basta repartirlos
+        shards_[segments % shards_.size()]->sealed.push_back(segment);
+        segments++;
+    }
+    for (auto& shard : shards_) {
+        std::sort(shard->sealed.begin(), shard->sealed.end(), [](const auto& a, const auto& b) {
+            return a->first_timestamp < b->first_timestamp;
+        });
+    }
+
+    stop_writer_ = false;
+    open_.store(true, std::memory_order_release);
+    writer_ = std::thread(&HistoryStore::writerLoop, this);
+    LOG_INFO("🗄️ Histórico persistente en " + directory + ": " + std::to_string(segments) + " segmentos sellados");
+    return true;
+}
+
+void HistoryStore::close() {
+    if (!open_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stop_writer_ = true;
+    }
+    writer_cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    for (size_t i = 0; i < shards_.size(); i++) {
+        flushShard(i);
+        sealShard(*shards_[i]);
+    }
+}
+
+void HistoryStore::append(uint64_t name_hash, uint64_t timestamp, double value, TagQuality quality) {
+    if (!isOpen()) {
+        return;
+    }
+    Shard& shard = *shards_[name_hash % shards_.size()];
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.buffer.size() >= options_.max_buffered) {
+            // El escritor no da abasto: se pierde la muestra, no se bloquea al productor
+            dropped_samples_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        shard.buffer.push_back({name_hash, timestamp, value, quality});
+        wake = shard.buffer.size() == options_.max_buffered;
+    }
+    if (wake) {
+        writer_cv_.notify_one();
+    }
+}
+
+void HistoryStore::writerLoop() {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (!stop_writer_) {
+        writer_cv_.wait_for(lock, std::chrono::milliseconds(options_.flush_interval_ms));
+        if (stop_writer_) {
+            break;
+        }
+        lock.unlock();
+        flush();
+        applyRetention();
+        lock.lock();
+    }
+}
+
+void HistoryStore::flush() {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    uint64_t dropped = dropped_samples_.load(std::memory_order_relaxed);
+    if (dropped != reported_drops_) {
+        LOG_WARNING("🗄️ Buffer de histórico lleno: " + std::to_string(dropped - reported_drops_) +
+                    " muestras descartadas (max_buffered " + std::to_string(options_.max_buffered) + ")");
+        reported_drops_ = dropped;
+    }
+    for (size_t i = 0; i < shards_.size(); i++) {
+        flushShard(i);
+    }
+}
+
+HistoryStore::ActiveFile::~ActiveFile() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+// Crear el segmento activo del día (solo el escritor, sin el mutex durante la E/S)
+bool HistoryStore::openActive(Shard& shard, size_t shard_index, uint64_t day) {
+    time_t seconds = static_cast<time_t>(day * (DAY_MS / 1000));
+    struct tm date;
+    gmtime_r(&seconds, &date);
+    char stamp[32];
+    std::snprintf(stamp, sizeof(stamp), "%04d%02d%02d", date.tm_year + 1900, date.tm_mon + 1, date.tm_mday);
+
+    // Un reinicio en el mismo día abre un segmento nuevo con el siguiente sufijo
+    for (int sequence = 0; sequence < 10000; sequence++) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "history-%s-s%02zu-%d.seg", stamp, shard_index, sequence);
+        std::string path = directory_ + "/" + name;
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0) {
+            auto file = std::make_shared<ActiveFile>();
+            file->fd = fd;
+            file->path = path;
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.active = std::move(file);
+            shard.day = day;
+            shard.bytes = 0;
+            shard.first_timestamp = UINT64_MAX;
+            shard.last_timestamp = 0;
+            shard.index.clear();
+            return true;
+        }
+        if (errno != EEXIST) {
+            LOG_ERROR("🗄️ No se pudo crear " + path + ": " + std::strerror(errno));
+            return false;
+        }
+    }
+    return false;
+}
+
+bool HistoryStore::flushShard(size_t shard_index) {
+    Shard& shard = *shards_[shard_index];
+    std::shared_ptr<const std::vector<Sample>> batch;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.buffer.empty()) {
+            return true;
+        }
+        // El lote pasa a "en escritura": las consultas lo siguen viendo hasta que se indexa
+        auto pending = std::make_shared<std::vector<Sample>>();
+        pending->reserve(shard.buffer.size());
+        pending->swap(shard.buffer);
+        batch = pending;
+        shard.inflight = batch;
+    }
+    const std::vector<Sample>& pending = *batch;
+
+    // Agrupar por tag conservando el orden de llegada de cada uno (el lote es
+    // compartido con las consultas: se ordena una permutación)
+    std::vector<uint32_t> order(pending.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        order[k] = static_cast<uint32_t>(k);
+    }
+    std::stable_sort(order.begin(), order.end(), [&pending](uint32_t a, uint32_t b) {
+        const Sample& x = pending[a];
+        const Sample& y = pending[b];
+        return x.name_hash != y.name_hash ? x.name_hash < y.name_hash : x.timestamp < y.timestamp;
+    });
+    uint64_t newest = 0;
+    for (const auto& sample : pending) {
+        newest = std::max(newest, sample.timestamp);
+    }
+
+    // Solo el escritor cambia el segmento activo: se lee sin el mutex
+    if (shard.active && newest / DAY_MS > shard.day) {
+        sealShard(shard);
+    }
+    if (!shard.active && !openActive(shard, shard_index, newest / DAY_MS)) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.inflight.reset();
+        return false;
+    }
+    uint64_t offset = shard.bytes;
+    std::shared_ptr<const ActiveFile> file = shard.active;
+
+    // Un chunk por tag (se parte si supera el rango de offset_ms)
+    std::vector<uint8_t> bytes;
+    bytes.reserve(pending.size() * sizeof(Record) + 64 * sizeof(ChunkHeader));
+    std::vector<IndexEntry> entries;
+    size_t i = 0;
+    while (i < order.size()) {
+        const Sample& head = pending[order[i]];
+        size_t j = i;
+        while (j < order.size() && pending[order[j]].name_hash == head.name_hash &&
+               pending[order[j]].timestamp - head.timestamp <= UINT32_MAX) {
+            j++;
+        }
+
+        size_t header_at = bytes.size();
+        bytes.resize(header_at + sizeof(ChunkHeader) + (j - i) * sizeof(Record));
+        Record* records = reinterpret_cast<Record*>(bytes.data() + header_at + sizeof(ChunkHeader));
+        for (size_t k = i; k < j; k++) {
+            const Sample& sample = pending[order[k]];
+            Record& record = records[k - i];
+            std::memset(&record, 0, sizeof(record));
+            record.offset_ms = static_cast<uint32_t>(sample.timestamp - head.timestamp);
+            record.quality = static_cast<uint8_t>(sample.quality);
+            record.value = sample.value;
+        }
+        ChunkHeader header{CHUNK_MAGIC, static_cast<uint32_t>(j - i), head.name_hash, head.timestamp,
+                           pending[order[j - 1]].timestamp, checksum(records, (j - i) * sizeof(Record))};
+        std::memcpy(bytes.data() + header_at, &header, sizeof(header));
+        entries.push_back({header.name_hash, header.first_timestamp, header.last_timestamp, offset + header_at,
+                           header.count, 0});
+        i = j;
+    }
+
+    // Group commit: una escritura y un fdatasync por segmento
+    if (!writeAll(file->fd, bytes.data(), bytes.size(), offset) || fdatasync(file->fd) != 0) {
+        LOG_ERROR("🗄️ Error escribiendo histórico en " + file->path + ": " + std::strerror(errno));
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.inflight.reset();
+        return false;
+    }
+
+    // Indexar y retirar el lote en la misma sección: una consulta ve uno u otro, nunca ambos
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : entries) {
+            shard.index[entry.name_hash].push_back(entry);
+            shard.first_timestamp = std::min(shard.first_timestamp, entry.first_timestamp);
+            shard.last_timestamp = std::max(shard.last_timestamp, entry.last_timestamp);
+        }
+        shard.bytes = offset + bytes.size();
+        shard.inflight.reset();
+    }
+    flushed_samples_.fetch_add(pending.size(), std::memory_order_relaxed);
+    commits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Sellar el segmento activo: índice, fdatasync, trailer (con checksum del índice) y
+// fdatasync; después se mapea. Solo el escritor (o close/recuperación); la E/S se hace
+// sin el mutex y el activo sigue consultable hasta que el sellado lo sustituye
+bool HistoryStore::sealShard(Shard& shard) {
+    std::shared_ptr<const ActiveFile> file = shard.active;
+    if (!file) {
+        return true;
+    }
+
+    std::vector<IndexEntry> entries;
+    uint64_t index_offset;
+    Trailer trailer;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [hash, chunks] : shard.index) {
+            entries.insert(entries.end(), chunks.begin(), chunks.end());
+        }
+        index_offset = shard.bytes;
+        trailer = Trailer{TRAILER_MAGIC, VERSION, 0, index_offset, shard.first_timestamp, shard.last_timestamp, 0};
+    }
+    std::sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.name_hash != b.name_hash ? a.name_hash < b.name_hash : a.first_timestamp < b.first_timestamp;
+    });
+
+    std::shared_ptr<const Segment> segment;
+    if (entries.empty()) {
+        unlink(file->path.c_str());
+    } else {
+        size_t index_bytes = entries.size() * sizeof(IndexEntry);
+        trailer.entries = static_cast<uint32_t>(entries.size());
+        trailer.index_checksum = checksum(entries.data(), index_bytes);
+        // El trailer solo llega a disco con el índice ya persistido
+        bool ok = writeAll(file->fd, entries.data(), index_bytes, index_offset) &&
+                  fdatasync(file->fd) == 0 &&
+                  writeAll(file->fd, &trailer, sizeof(trailer), index_offset + index_bytes) &&
+                  fdatasync(file->fd) == 0;
+        if (!ok) {
+            LOG_ERROR("🗄️ No se pudo sellar " + file->path + ": " + std::strerror(errno));
+        } else {
+            segment = mapSegment(file->path);
+        }
+    }
+
+    // Sin mapeo el fichero queda sin sellar y se recupera en el próximo arranque
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (segment) {
+        shard.sealed.push_back(segment);
+    }
+    shard.active.reset();
+    shard.index.clear();
+    return entries.empty() || segment != nullptr;
+}
+
+std::shared_ptr<const HistoryStore::Segment> HistoryStore::mapSegment(const std::string& path) const {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Trailer)) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto segment = std::make_shared<Segment>();
+    segment->path = path;
+    segment->mapping = static_cast<const uint8_t*>(mapping);
+    segment->bytes = bytes;
+
+    // Sin sellar o corrupto: nullptr (el destructor desmapea) y el llamador lo recupera
+    Trailer trailer;
+    std::memcpy(&trailer, segment->mapping + bytes - sizeof(Trailer), sizeof(trailer));
+    size_t index_space = bytes - sizeof(Trailer);
+    if (trailer.magic != TRAILER_MAGIC || trailer.version != VERSION ||
+        trailer.index_offset > index_space || trailer.index_offset % alignof(IndexEntry) != 0 ||
+        (index_space - trailer.index_offset) / sizeof(IndexEntry) != trailer.entries ||
+        (index_space - trailer.index_offset) % sizeof(IndexEntry) != 0) {
+        return nullptr;
+    }
+    const auto* index = reinterpret_cast<const IndexEntry*>(segment->mapping + trailer.index_offset);
+    if (checksum(index, trailer.entries * sizeof(IndexEntry)) != trailer.index_checksum) {
+        return nullptr;
+    }
+    // Cada chunk del índice debe caber antes del índice y coincidir con su cabecera
+    for (size_t e = 0; e < trailer.entries; e++) {
+        const IndexEntry& entry = index[e];
+        if (entry.offset % alignof(ChunkHeader) != 0 || entry.offset > trailer.index_offset ||
+            entry.count == 0 || entry.first_timestamp > entry.last_timestamp) {
+            return nullptr;
+        }
+        uint64_t room = trailer.index_offset - entry.offset;
+        if (room < sizeof(ChunkHeader) || (room - sizeof(ChunkHeader)) / sizeof(Record) < entry.count) {
+            return nullptr;
+        }
+        const auto* header = reinterpret_cast<const ChunkHeader*>(segment->mapping + entry.offset);
+        if (header->magic != CHUNK_MAGIC || header->count != entry.count || header->name_hash != entry.name_hash ||
+            header->first_timestamp != entry.first_timestamp) {
+            return nullptr;
+        }
+    }
+    segment->index = index;
+    segment->entries = trailer.entries;
+    segment->first_timestamp = trailer.first_timestamp;
+    segment->last_timestamp = trailer.last_timestamp;
+    return segment;
+}
+
+// Segmento activo de una ejecución que no lo selló: conservar los chunks válidos y sellarlo
+std::shared_ptr<const HistoryStore::Segment> HistoryStore::recoverSegment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto file = std::make_shared<ActiveFile>();
+    file->fd = fd;
+    file->path = path;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return nullptr;
+    }
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+
+    Shard shard;
+    shard.active = file;
+    uint64_t offset = 0;
+    std::vector<Record> records;
+    while (offset + sizeof(ChunkHeader) <= size) {
+        ChunkHeader header;
+        if (pread(fd, &header, sizeof(header), static_cast<off_t>(offset)) != sizeof(header) ||
+            header.magic != CHUNK_MAGIC || header.count == 0 ||
+            offset + sizeof(header) + header.count * sizeof(Record) > size) {
+            break;
+        }
+        records.resize(header.count);
+        size_t record_bytes = header.count * sizeof(Record);
+        if (pread(fd, records.data(), record_bytes, static_cast<off_t>(offset + sizeof(header))) !=
+                static_cast<ssize_t>(record_bytes) ||
+            checksum(records.data(), record_bytes) != header.checksum) {
+            break;
+        }
+        shard.index[header.name_hash].push_back({header.name_hash, header.first_timestamp, header.last_timestamp,
+                                                 offset, header.count, 0});
+        shard.first_timestamp = std::min(shard.first_timestamp, header.first_timestamp);
+        shard.last_timestamp = std::max(shard.last_timestamp, header.last_timestamp);
+        offset += sizeof(header) + record_bytes;
+    }
+
+    if (offset < size && ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        LOG_ERROR("🗄️ No se pudo truncar " + path + ": " + std::strerror(errno));
+    }
+    LOG_WARNING("🗄️ Segmento sin sellar recuperado: " + path + " (" + std::to_string(offset) + " de " +
+                std::to_string(size) + " bytes válidos)");
+    shard.bytes = offset;
+    file.reset();
+    sealShard(shard);
+    return shard.sealed.empty() ? nullptr : shard.sealed.front();
+}
+
+void HistoryStore::collect(const ChunkHeader& header, const Record* records, uint64_t start, uint64_t end,
+                           std::vector<HistorianPoint>& out) {
+    uint64_t first = header.first_timestamp;
+    uint32_t from = start > first ? static_cast<uint32_t>(std::min<uint64_t>(start - first, UINT32_MAX)) : 0;
+    const Record* it = std::lower_bound(records, records + header.count, from,
+        [](const Record& record, uint32_t offset) { return record.offset_ms < offset; });
+    for (; it != records + header.count; ++it) {
+        uint64_t timestamp = first + it->offset_ms;
+        if (timestamp > end) {
+            break;
+        }
+        out.push_back({timestamp, it->value, static_cast<TagQuality>(it->quality)});
+    }
+}
+
+void HistoryStore::query(uint64_t name_hash, uint64_t start, uint64_t end, size_t max_points,
+                         std::vector<HistorianPoint>& out, HistoryOrder order) const {
+    if (!isOpen() || start > end || max_points == 0) {
+        return;
+    }
+    size_t first_out = out.size();
+    size_t owner = name_hash % shards_.size();
+    bool newest_first = order == HistoryOrder::NEWEST_FIRST;
+
+    // Bajo el mutex solo se copian referencias y entradas del índice; la E/S va después
+    std::vector<std::shared_ptr<const Segment>> segments;
+    std::shared_ptr<const ActiveFile> active;
+    std::vector<IndexEntry> active_entries;
+    std::shared_ptr<const std::vector<Sample>> inflight;
+    for (size_t s = 0; s < shards_.size(); s++) {
+        Shard& shard = *shards_[s];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& segment : shard.sealed) {
+            if (segment->first_timestamp <= end && segment->last_timestamp >= start) {
+                segments.push_back(segment);
+            }
+        }
+        if (s != owner) {
+            continue;
+        }
+
+        auto chunks = shard.index.find(name_hash);
+        if (shard.active && chunks != shard.index.end()) {
+            active = shard.active;
+            for (const auto& entry : chunks->second) {
+                if (entry.first_timestamp <= end && entry.last_timestamp >= start) {
+                    active_entries.push_back(entry);
+                }
+            }
+        }
+        inflight = shard.inflight;
+        for (const auto& sample : shard.buffer) {
+            if (sample.name_hash == name_hash && sample.timestamp >= start && sample.timestamp <= end) {
+                out.push_back({sample.timestamp, sample.value, sample.quality});
+            }
+        }
+    }
+
+    // Lote en escritura (aún sin indexar)
+    if (inflight) {
+        for (const auto& sample : *inflight) {
+            if (sample.name_hash == name_hash && sample.timestamp >= start && sample.timestamp <= end) {
+                out.push_back({sample.timestamp, sample.value, sample.quality});
+            }
+        }
+    }
+
+    // Chunks del tag en el rango: segmentos sellados (búsqueda binaria en el índice
+    // mapeado) y activo (pread sobre el fichero compartido, abierto aunque se selle)
+    struct ChunkRef {
+        const Segment* segment;         // nullptr: segmento activo
+        IndexEntry entry;
+    };
+    std::vector<ChunkRef> chunks;
+    for (const auto& entry : active_entries) {
+        chunks.push_back({nullptr, entry});
+    }
+    for (const auto& segment : segments) {
+        const IndexEntry* begin = segment->index;
+        const IndexEntry* finish = segment->index + segment->entries;
+        const IndexEntry* entry = std::lower_bound(begin, finish, name_hash,
+            [](const IndexEntry& e, uint64_t hash) { return e.name_hash < hash; });
+        for (; entry != finish && entry->name_hash == name_hash; ++entry) {
+            if (entry->first_timestamp <= end && entry->last_timestamp >= start) {
+                chunks.push_back({segment.get(), *entry});
+            }
+        }
+    }
+
+    // Se recorren desde el extremo pedido y se para cuando ningún chunk restante
+    // puede entrar entre los max_points primeros (normalmente tras uno o dos chunks)
+    auto by_time = [](const HistorianPoint& a, const HistorianPoint& b) { return a.timestamp < b.timestamp; };
+    auto keep_best = [&]() {
+        if (!std::is_sorted(out.begin() + first_out, out.end(), by_time)) {
+            std::stable_sort(out.begin() + first_out, out.end(), by_time);
+        }
+        if (out.size() - first_out > max_points) {
+            if (newest_first) {
+                out.erase(out.begin() + first_out, out.end() - max_points);
+            } else {
+                out.resize(first_out + max_points);
+            }
+        }
+    };
+    std::sort(chunks.begin(), chunks.end(), [newest_first](const ChunkRef& a, const ChunkRef& b) {
+        return newest_first ? a.entry.last_timestamp > b.entry.last_timestamp
+                            : a.entry.first_timestamp < b.entry.first_timestamp;
+    });
+    std::vector<Record> records;
+    for (const auto& chunk : chunks) {
+        if (out.size() - first_out >= max_points) {
+            keep_best();
+            uint64_t bound = newest_first ? out[first_out].timestamp : out.back().timestamp;
+            if (newest_first ? chunk.entry.last_timestamp < bound : chunk.entry.first_timestamp > bound) {
+                break;
+            }
+        }
+        ChunkHeader header{CHUNK_MAGIC, chunk.entry.count, chunk.entry.name_hash, chunk.entry.first_timestamp,
+                           chunk.entry.last_timestamp, 0};
+        if (chunk.segment) {
+            collect(header, reinterpret_cast<const Record*>(chunk.segment->mapping + chunk.entry.offset +
+                                                            sizeof(ChunkHeader)), start, end, out);
+            continue;
+        }
+        records.resize(chunk.entry.count);
+        size_t record_bytes = chunk.entry.count * sizeof(Record);
+        if (pread(active->fd, records.data(), record_bytes, static_cast<off_t>(chunk.entry.offset + sizeof(ChunkHeader))) ==
+                static_cast<ssize_t>(record_bytes)) {
+            collect(header, records.data(), start, end, out);
+        }
+    }
+
+    keep_best();
+    if (newest_first) {
+        std::reverse(out.begin() + first_out, out.end());
+    }
+}
+
+void HistoryStore::applyRetention() {
+    if (options_.retention_ms == 0 && options_.max_bytes == 0) {
+        return;
+    }
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    struct Candidate {
+        size_t shard;
+        std::shared_ptr<const Segment> segment;
+    };
+    std::vector<Candidate> candidates;
+    uint64_t total = 0;
+    for (size_t s = 0; s < shards_.size(); s++) {
+        std::lock_guard<std::mutex> lock(shards_[s]->mutex);
+        total += shards_[s]->bytes;
+        for (const auto& segment : shards_[s]->sealed) {
+            candidates.push_back({s, segment});
+            total += segment->bytes;
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.segment->last_timestamp < b.segment->last_timestamp;
+    });
+
+    for (const auto& candidate : candidates) {
+        bool expired = options_.retention_ms > 0 && candidate.segment->last_timestamp + options_.retention_ms < now;
+        bool oversize = options_.max_bytes > 0 && total > options_.max_bytes;
+        if (!expired && !oversize) {
+            break;
+        }
+        {
+            Shard& shard = *shards_[candidate.shard];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.sealed.erase(std::remove(shard.sealed.begin(), shard.sealed.end(), candidate.segment),
+                               shard.sealed.end());
+        }
+        // Las consultas en curso conservan el mapeo hasta soltar su referencia
+        unlink(candidate.segment->path.c_str());
+        total -= candidate.segment->bytes;
+        removed_segments_.fetch_add(1, std::memory_order_relaxed);
+        LOG_INFO("🗄️ Retención: eliminado " + candidate.segment->path);
+    }
+}
+
+nlohmann::json HistoryStore::getStatus() const {
+    nlohmann::json status;
+    status["path"] = directory_;
+    status["open"] = isOpen();
+    size_t segments = 0, pending = 0;
+    uint64_t bytes = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        segments += shard->sealed.size() + (shard->active ? 1 : 0);
+        pending += shard->buffer.size() + (shard->inflight ? shard->inflight->size() : 0);
+        bytes += shard->bytes;
+        for (const auto& segment : shard->sealed) {
+            bytes += segment->bytes;
+        }
+    }
+    status["segments"] = segments;
+    status["bytes"] = bytes;
+    status["pending_samples"] = pending;
+    status["flushed_samples"] = flushed_samples_.load();
+    status["dropped_samples"] = dropped_samples_.load();
+    status["commits"] = commits_.load();
+    status["removed_segments"] = removed_segments_.load();
+    status["flush_interval_ms"] = options_.flush_interval_ms;
+    return status;
+}
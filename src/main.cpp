@@ -3,6 +3,9 @@
 #include "tag_management_api.h"
 #include "opcua_server.h"
 #include "pac_control_client.h"
+#include "cycle_monitor.h"
+#include "deadline_scheduler.h"
+#include "benchmarks.h"
 #include <iostream>
 #include <signal.h>
 #include <atomic>
@@ -15,6 +18,8 @@ std::unique_ptr<TagManager> g_tag_manager;
 std::unique_ptr<TagManagementAPI::TagManagementServer> g_api_server;
 std::unique_ptr<OPCUAServer> g_opcua_server;
 std::unique_ptr<PACControlClient> g_pac_client;
+std::unique_ptr<CycleMonitor> g_cycle_monitor;
+std::unique_ptr<DeadlineScheduler> g_scheduler;
 
 // Handler para señales del sistema
 void signalHandler(int signal) {
@@ -62,17 +67,37 @@ void createExampleTags(TagManager& tag_manager) {
     estado_tag->setValue("OPERATIVO");
     
     // Agregar tags al manager
-    tag_manager.addTag(temp_tag);
-    tag_manager.addTag(pressure_tag);
-    tag_manager.addTag(flow_tag);
-    tag_manager.addTag(alarm_tag);
-    tag_manager.addTag(estado_tag);
+    tag_manager.addTags({temp_tag, pressure_tag, flow_tag, alarm_tag, estado_tag});
     
     LOG_SUCCESS("✅ Tags de ejemplo creados");
 }
 
-// Función de monitoreo básico
-void monitoringLoop() {
+// Estado de polling por tabla PAC (lectura guiada por demanda)
+struct TablePollState {
+    std::string table_name;
+    std::string tag_name;        // Tag padre asociado a la tabla
+    bool is_alarm_table;
+    bool had_demand;
+    uint32_t consecutive_sheds;  // Ciclos descartados seguidos por sobrecarga
+    DeadlineScheduler::JobId job_id;
+};
+
+// Leer intervalo de la sección "optimization" de la configuración
+static std::chrono::milliseconds getOptimizationInterval(const nlohmann::json& config,
+                                                         const std::string& key, int default_ms) {
+    if (config.contains("optimization") && config["optimization"].contains(key)) {
+        return std::chrono::milliseconds(config["optimization"][key].get<int>());
+    }
+    return std::chrono::milliseconds(default_ms);
+}
+
+static std::chrono::milliseconds toMs(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d);
+}
+
+// Función de monitoreo básico: registra los trabajos periódicos en el
+// scheduler de deadlines y despacha en el hilo principal hasta el cierre
+void monitoringLoop(const nlohmann::json& config) {
     // ¡MENSAJE CRÍTICO PARA DEBUG!
     std::cout << "🚀🚀🚀 MONITORINGLOOP INICIADO - HILO PRINCIPAL FUNCIONA 🚀🚀🚀" << std::endl;
     std::cerr << "🚀🚀🚀 MONITORINGLOOP INICIADO - HILO PRINCIPAL FUNCIONA 🚀🚀🚀" << std::endl;
@@ -80,166 +105,240 @@ void monitoringLoop() {
     LOG_INFO("🧪 g_running al inicio = " + std::string(g_running ? "true" : "false"));
     LOG_INFO("🔄 Iniciando loop de monitoreo...");
     
-    int counter = 0;
+    if (!g_scheduler) {
+        g_scheduler = std::make_unique<DeadlineScheduler>();
+    }
+    DeadlineScheduler& scheduler = *g_scheduler;
+    
     auto last_opcua_read = std::chrono::steady_clock::now();
-    auto last_individual_read = std::chrono::steady_clock::now();
-    auto last_reconnect_attempt = std::chrono::steady_clock::now();
     const auto opcua_polling_interval = std::chrono::milliseconds(2000); // Polling cada 2 segundos para TBL_OPCUA
-    const auto individual_polling_interval = std::chrono::milliseconds(10000); // Polling cada 10 segundos para tablas individuales
-    const auto reconnect_interval = std::chrono::milliseconds(15000); // Intentar reconectar cada 15 segundos
+    // Tablas con consumidores activos (ítems monitoreados OPC UA o suscriptores SSE)
+    // se leen a tasa completa; el resto baja a una tasa de integridad en segundo plano
+    const auto demand_polling_interval = getOptimizationInterval(config, "demand_polling_interval_ms", 10000);
+    const auto integrity_polling_interval = getOptimizationInterval(config, "background_integrity_interval_ms", 60000);
     
-    while (g_running) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        counter++;
-        auto now = std::chrono::steady_clock::now();
-        
-        // Intentar reconexión automática si PAC no está conectado
-        if (g_pac_client && !g_pac_client->isConnected() && 
-            (now - last_reconnect_attempt) >= reconnect_interval) {
-            
-            LOG_WARNING("🔄 PAC desconectado - Intentando reconectar...");
-            if (g_pac_client->connect()) {
-                LOG_SUCCESS("✅ Reconexión exitosa con PAC");
-            } else {
-                LOG_ERROR("❌ Error en reconexión - reintentando en " + 
-                         std::to_string(reconnect_interval.count() / 1000) + " segundos");
+    // Publicación OPC UA: se dispara tras cada lectura y los disparos se fusionan
+    DeadlineScheduler::JobId publish_job = scheduler.schedule("opcua_publish", integrity_polling_interval,
+        integrity_polling_interval, [](const DeadlineScheduler::DispatchInfo&) {
+            // Actualizar los nodos OPC UA solo cuando hay datos nuevos del PAC
+            if (g_opcua_server) {
+                g_opcua_server->updateTagsFromPAC();
+            }
+        });
+    
+    // Cierre: detener el despacho cuando llega una señal
+    scheduler.schedule("shutdown_watch", std::chrono::milliseconds(200), std::chrono::milliseconds(200),
+        [&scheduler](const DeadlineScheduler::DispatchInfo&) {
+            if (!g_running) {
+                scheduler.stop();
+            }
+        });
+    
+    // Plazos de refresco por clase: los tags sin refresco a tiempo pasan a
+    // UNCERTAIN y después a STALE (barrido en el hilo de polling de TagManager)
+    if (g_tag_manager) {
+        StalenessEngine& staleness = g_tag_manager->getStalenessEngine();
+        staleness.setPeriod(RateClass::FAST, opcua_polling_interval);
+        staleness.setPeriod(RateClass::MEDIUM, demand_polling_interval);
+        staleness.setPeriod(RateClass::SLOW, integrity_polling_interval);
+    }
+    
+    // Cambios de calidad (y cualquier otro cambio publicado en el bus) y caídas o
+    // reconexiones de fuentes adelantan la publicación OPC UA; los disparos se
+    // fusionan con los de las lecturas
+    std::shared_ptr<ChangeSubscriber> publish_watch = g_tag_manager ?
+        g_tag_manager->getChangeBus().subscribe("opcua_publish") : nullptr;
+    scheduler.schedule("change_watch", std::chrono::milliseconds(250), std::chrono::milliseconds(250),
+        [&scheduler, publish_watch, publish_job, source_generation = uint64_t(0)](const DeadlineScheduler::DispatchInfo&) mutable {
+            if (!publish_watch) {
+                return;
+            }
+            std::vector<ChangeSubscriber::ChangeSetPtr> sets;
+            bool changed = publish_watch->poll(sets, 64) > 0 || publish_watch->takeOverflow();
+            uint64_t generation = g_tag_manager->getSourceEpochs().generation();
+            if (generation != source_generation) {
+                source_generation = generation;
+                changed = true;
+            }
+            if (changed) {
+                scheduler.triggerNow(publish_job);
+            }
+        });
+    
+    // Polling de TBL_OPCUA (crítico - cada 2 segundos)
+    DeadlineScheduler::JobId opcua_job = scheduler.schedule("TBL_OPCUA", opcua_polling_interval, opcua_polling_interval,
+        [&](const DeadlineScheduler::DispatchInfo& info) {
+            if (!g_pac_client || !g_pac_client->isConnected()) {
+                return;
             }
-            last_reconnect_attempt = now;
-        }
-        
-        // Polling de TBL_OPCUA (crítico - cada 2 segundos)
-        if (g_pac_client && g_pac_client->isConnected() && 
-            (now - last_opcua_read) >= opcua_polling_interval) {
             
             LOG_INFO("🔄 Intentando leer TBL_OPCUA...");
-            if (g_pac_client->readOPCUATable()) {
+            bool ok = g_pac_client->readOPCUATable();
+            auto end = std::chrono::steady_clock::now();
+            if (g_cycle_monitor) {
+                g_cycle_monitor->recordExecution(RateClass::FAST, opcua_polling_interval,
+                    toMs(info.start - info.deadline), toMs(end - info.start));
+            }
+            if (ok) {
                 LOG_SUCCESS("📊 TBL_OPCUA actualizada exitosamente");
-                // Actualizar los nodos OPC UA solo cuando hay datos nuevos del PAC
-                if (g_opcua_server) {
-                    g_opcua_server->updateTagsFromPAC();
-                }
+                scheduler.triggerNow(publish_job);
             } else {
                 LOG_ERROR("💥 Error leyendo TBL_OPCUA");
             }
-            last_opcua_read = now;
-        }
-        
-        // Polling de tablas individuales (cada 10 segundos para otras variables)
-        if (g_pac_client && g_pac_client->isConnected() && 
-            (now - last_individual_read) >= individual_polling_interval) {
-            
-            LOG_INFO("🔧 Intentando leer tablas individuales...");
-            if (g_pac_client->readIndividualTables()) {
-                LOG_SUCCESS("📋 Tablas individuales actualizadas exitosamente");
-                // Actualizar los nodos OPC UA solo cuando hay datos nuevos del PAC
-                if (g_opcua_server) {
-                    g_opcua_server->updateTagsFromPAC();
-                }
-            } else {
-                LOG_ERROR("💥 Error leyendo tablas individuales");
+            last_opcua_read = info.start;
+        });
+    
+    // La reconexión corre en segundo plano en PACControlClient; al volver el
+    // enlace se adelanta la lectura de TBL_OPCUA en lugar de esperar al periodo
+    if (g_pac_client) {
+        g_pac_client->setOnConnected([opcua_job]() {
+            if (g_scheduler) {
+                g_scheduler->triggerNow(opcua_job);
             }
-            
-            // Leer tablas de alarmas (usando nombres correctos del config)
-            LOG_INFO("🚨 Intentando leer tablas de alarmas...");
-            std::vector<std::string> alarm_tables = {
-                "TBL_EA_1601", "TBL_EA_1602", "TBL_EA_1603", "TBL_EA_1604", "TBL_EA_1605",
-                "TBL_CA_1201", "TBL_CA_1202", "TBL_CA_1203", "TBL_CA_1204",  // PRC control alarmas
-                "TBL_PA_1201", "TBL_PA_1303", "TBL_PA_1303A", "TBL_PA_1404", 
-                "TBL_PA_1502", "TBL_PA_1758"
-            };
-            
-            size_t alarm_updates = 0;
-            for (const auto& alarm_table : alarm_tables) {
-                try {
-                    // Leer tabla de alarmas (típicamente 5 variables int32 por tabla: ALARM_HH, ALARM_H, ALARM_L, ALARM_LL, ALARM_Color)
-                    std::vector<int32_t> alarm_values = g_pac_client->readInt32Table(alarm_table, 0, 4);
-                    
-                    if (!alarm_values.empty()) {
-                        // Actualizar TagManager con los valores de alarma
-                        if (g_pac_client->updateTagManagerFromAlarmTable(alarm_table, alarm_values)) {
-                            alarm_updates += alarm_values.size();
-                            LOG_DEBUG("✅ " + alarm_table + ": " + std::to_string(alarm_values.size()) + " alarmas actualizadas");
-                        }
-                    } else {
-                        LOG_DEBUG("⚠️ " + alarm_table + " devolvió datos vacíos");
-                    }
-                    
-                    // Pequeña pausa para no saturar el PAC
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                    
-                } catch (const std::exception& e) {
-                    LOG_ERROR("Error leyendo " + alarm_table + ": " + std::string(e.what()));
+        });
+    }
+    
+    // Un trabajo por tabla individual / de alarmas; arrancan a tasa de integridad
+    std::vector<TablePollState> table_states;
+    for (const auto& table_name : PACControlClient::getValueTables()) {
+        table_states.push_back({table_name, PACControlClient::tagNameForValueTable(table_name), false, false, 0, 0});
+    }
+    for (const auto& table_name : PACControlClient::getAlarmTables()) {
+        table_states.push_back({table_name, PACControlClient::tagNameForAlarmTable(table_name), true, false, 0, 0});
+    }
+    
+    // Los trabajos del mismo periodo se escalonan por hash del nombre de la tabla,
+    // repartiendo las peticiones al PAC uniformemente dentro del periodo
+    for (auto& state : table_states) {
+        TablePollState* table = &state;
+        state.job_id = scheduler.scheduleStaggered("table:" + state.table_name, integrity_polling_interval, state.table_name,
+            [&, table](const DeadlineScheduler::DispatchInfo& info) {
+                if (!g_pac_client || !g_pac_client->isConnected()) {
+                    return;
                 }
-            }
-            
-            if (alarm_updates > 0) {
-                LOG_SUCCESS("🚨 Tablas de alarmas: " + std::to_string(alarm_updates) + 
-                           " variables actualizadas exitosamente");
-                // Actualizar los nodos OPC UA con las nuevas alarmas
-                if (g_opcua_server) {
-                    g_opcua_server->updateTagsFromPAC();
+                
+                // Tablas con demanda son MEDIUM; a tasa de integridad son SLOW
+                RateClass rate_class = table->had_demand ? RateClass::MEDIUM : RateClass::SLOW;
+                if (g_cycle_monitor && g_cycle_monitor->shouldShed(rate_class)) {
+                    g_cycle_monitor->recordShed(rate_class, table->table_name);
+                    table->consecutive_sheds++;
+                    g_pac_client->markTableQuality(table->table_name, table->is_alarm_table,
+                        table->consecutive_sheds > 1 ? TagQuality::STALE : TagQuality::UNCERTAIN);
+                    scheduler.triggerNow(publish_job);
+                    return;
                 }
-            } else {
-                LOG_WARNING("⚠️ No se actualizaron variables de alarma");
+                
+                bool ok = table->is_alarm_table ? 
+                    g_pac_client->readAlarmTable(table->table_name, rate_class) :
+                    g_pac_client->readIndividualTable(table->table_name, rate_class);
+                auto end = std::chrono::steady_clock::now();
+                if (g_cycle_monitor) {
+                    g_cycle_monitor->recordExecution(rate_class,
+                        std::chrono::duration_cast<std::chrono::milliseconds>(info.period),
+                        toMs(info.start - info.deadline), toMs(end - info.start));
+                }
+                if (ok) {
+                    table->consecutive_sheds = 0;
+                    scheduler.triggerNow(publish_job);
+                }
+            });
+    }
+    LOG_INFO("📋 Polling por demanda: " + std::to_string(table_states.size()) + " tablas (" +
+             std::to_string(demand_polling_interval.count()) + "ms con demanda, " +
+             std::to_string(integrity_polling_interval.count()) + "ms sin demanda)");
+    
+    // Seguimiento de demanda: cambiar la tasa de cada tabla y leer de inmediato
+    // cuando aparece un consumidor
+    scheduler.schedule("demand_check", std::chrono::milliseconds(250), std::chrono::milliseconds(250),
+        [&](const DeadlineScheduler::DispatchInfo&) {
+            for (auto& state : table_states) {
+                bool has_demand = g_tag_manager && g_tag_manager->hasDemand(state.tag_name);
+                if (has_demand == state.had_demand) {
+                    continue;
+                }
+                state.had_demand = has_demand;
+                scheduler.reschedule(state.job_id, has_demand ? demand_polling_interval : integrity_polling_interval);
+                // Leer ya en ambos sentidos: con demanda para servirla y sin ella para que
+                // el plazo de sus tags pase a ser el de la clase SLOW
+                scheduler.triggerNow(state.job_id);
             }
-            
-            last_individual_read = now;
-        }
-        
-        // Debug de por qué no se ejecutan los pollings
-        if (counter % 10 == 0) {
+        });
+    
+    // Debug de por qué no se ejecutan los pollings
+    scheduler.schedule("debug_status", std::chrono::seconds(5), std::chrono::seconds(5),
+        [&](const DeadlineScheduler::DispatchInfo& info) {
             if (!g_pac_client) {
                 LOG_WARNING("⚠️ g_pac_client es null");
             } else if (!g_pac_client->isConnected()) {
-                auto time_since_reconnect = std::chrono::duration_cast<std::chrono::seconds>(now - last_reconnect_attempt);
-                LOG_WARNING("⚠️ PAC desconectado - Próximo intento en " + 
-                           std::to_string((reconnect_interval.count() / 1000) - time_since_reconnect.count()) + "s");
+                auto link = g_pac_client->getLinkStatus();
+                LOG_WARNING("⚠️ PAC desconectado (" + link["state"].get<std::string>() + ", intento " +
+                           std::to_string(link["attempts"].get<uint32_t>()) + ") - " +
+                           link["last_error"].get<std::string>());
             } else {
-                auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_opcua_read);
+                auto time_since_last = toMs(info.start - last_opcua_read);
                 LOG_DEBUG("🕐 PAC conectado - Próximo polling TBL_OPCUA en " + 
                          std::to_string(opcua_polling_interval.count() - time_since_last.count()) + "ms");
             }
-        }
-        
-        // Mostrar estado cada 30 segundos (counter * 0.5s = tiempo)
-        if (counter % 60 == 0) {
-            if (g_tag_manager) {
-                auto status = g_tag_manager->getStatus();
-                std::string pac_status = g_pac_client ? 
-                    (g_pac_client->isConnected() ? "🟢 CONECTADO" : "🔴 DESCONECTADO") : 
-                    "❌ NO INICIALIZADO";
-                
-                LOG_INFO("📊 Estado sistema - Tags: " + 
-                        std::to_string(status["total_tags"].get<int>()) + 
-                        " | OPC UA Server: " + 
-                        (status["running"].get<bool>() ? "🟢 ACTIVO" : "🔴 INACTIVO") +
-                        " | PAC: " + pac_status);
-                
-                // Mostrar estadísticas PAC si está disponible
-                if (g_pac_client && g_pac_client->isConnected()) {
-                    auto stats_report = g_pac_client->getStatsReport();
-                    LOG_DEBUG("Estadísticas PAC:\n" + stats_report);
-                } else if (g_pac_client) {
-                    LOG_DEBUG("PAC desconectado - valores mantenidos desde última comunicación exitosa");
-                }
-                
-                // Mostrar algunos valores de ejemplo
-                auto tags = g_tag_manager->getAllTags();
-                if (!tags.empty()) {
-                    LOG_DEBUG("Valores actuales:");
-                    for (const auto& tag : tags) {
-                        if (tag->getName().find("Temperatura") != std::string::npos ||
-                            tag->getName().find("Presion") != std::string::npos) {
-                            LOG_DEBUG("  • " + tag->getName() + " = " + 
-                                    tag->getValueAsString() + " " + tag->getUnit());
-                        }
+        });
+    
+    // Mostrar estado cada 30 segundos
+    scheduler.schedule("status_log", std::chrono::seconds(30), std::chrono::seconds(30),
+        [&](const DeadlineScheduler::DispatchInfo&) {
+            if (!g_tag_manager) {
+                return;
+            }
+            
+            auto status = g_tag_manager->getStatus();
+            std::string pac_status = g_pac_client ? 
+                (g_pac_client->isConnected() ? "🟢 CONECTADO" : "🔴 DESCONECTADO") : 
+                "❌ NO INICIALIZADO";
+            
+            LOG_INFO("📊 Estado sistema - Tags: " + 
+                    std::to_string(status["total_tags"].get<int>()) + 
+                    " | OPC UA Server: " + 
+                    (status["running"].get<bool>() ? "🟢 ACTIVO" : "🔴 INACTIVO") +
+                    " | PAC: " + pac_status);
+            
+            if (g_cycle_monitor && g_cycle_monitor->getShedLevel() > CycleMonitor::SHED_NONE) {
+                LOG_WARNING("🔻 Descarte de carga activo - nivel " +
+                           std::to_string(g_cycle_monitor->getShedLevel()));
+            }
+            
+            auto dispatch = scheduler.getStats();
+            LOG_DEBUG("⏲️ Scheduler: " + std::to_string(dispatch["jobs"].get<size_t>()) + " trabajos, jitter medio " +
+                     std::to_string(dispatch["jitter_mean_us"].get<double>()) + "us, máx " +
+                     std::to_string(dispatch["jitter_max_us"].get<int64_t>()) + "us");
+            
+            // Mostrar estadísticas PAC si está disponible
+            if (g_pac_client && g_pac_client->isConnected()) {
+                auto stats_report = g_pac_client->getStatsReport();
+                LOG_DEBUG("Estadísticas PAC:\n" + stats_report);
+            } else if (g_pac_client) {
+                LOG_DEBUG("PAC desconectado - valores mantenidos desde última comunicación exitosa");
+            }
+            
+            // Mostrar algunos valores de ejemplo
+            auto snapshot = g_tag_manager->getSnapshot();
+            const auto& tags = snapshot->tags;
+            if (!tags.empty()) {
+                LOG_DEBUG("Valores actuales:");
+                for (const auto& tag : tags) {
+                    if (tag->getName().find("Temperatura") != std::string::npos ||
+                        tag->getName().find("Presion") != std::string::npos) {
+                        LOG_DEBUG("  • " + tag->getName() + " = " + 
+                                tag->getValueAsString() + " " + tag->getUnit());
                     }
                 }
             }
-        }
-        
-        // Simular algunos cambios en los valores
-        if (counter % 3 == 0 && g_tag_manager) {
+        });
+    
+    // Simular algunos cambios en los valores
+    scheduler.schedule("simulation", std::chrono::milliseconds(1500), std::chrono::milliseconds(1500),
+        [](const DeadlineScheduler::DispatchInfo&) {
+            if (!g_tag_manager) {
+                return;
+            }
+            
             // Simular variación en temperatura
             auto temp_tag = g_tag_manager->getTag("Temperatura_Reactor");
             if (temp_tag) {
@@ -255,9 +354,13 @@ void monitoringLoop() {
                 float new_pressure = current_pressure + ((rand() % 11 - 5) * 0.01f); // ±0.05 bar
                 pressure_tag->setValue(new_pressure);
             }
-        }
-    }
+        });
+    
+    scheduler.run();
     
+    if (publish_watch && g_tag_manager) {
+        g_tag_manager->getChangeBus().unsubscribe(publish_watch);
+    }
     LOG_INFO("🛑 Loop de monitoreo finalizado");
 }
 
@@ -298,6 +401,7 @@ int main(int argc, char* argv[]) {
         bool show_help = false;
         bool validate_config = false;
         bool test_mode = false;
+        std::string benchmark_name;
         std::string config_file = "config/tags_planta_gas.json";
         
         for (int i = 1; i < argc; i++) {
@@ -308,6 +412,8 @@ int main(int argc, char* argv[]) {
                 validate_config = true;
             } else if (arg == "--test") {
                 test_mode = true;
+            } else if (arg == "--benchmark" && i + 1 < argc) {
+                benchmark_name = argv[++i];
             } else if (arg == "--config" && i + 1 < argc) {
                 config_file = argv[++i];
             }
@@ -320,30 +426,48 @@ int main(int argc, char* argv[]) {
                       << "  --config <archivo>   Especificar archivo de configuración\n"
                       << "  --validate-config    Validar configuración y salir\n"
                       << "  --test              Ejecutar en modo test\n"
+                      << "  --benchmark <nombre> Ejecutar benchmark (scheduler, stagger, snapshot, tag-stress, value-scan, hierarchy, frame, bus, shards, names, arena, indexes, staleness, epochs, warm-restart, values, scaling, history, historian, history-store, history-range, all)\n"
                       << std::endl;
             return 0;
         }
         
-        LOG_INFO("🚀 Iniciando PlantaGas OPC-UA Server...");
+        if (!benchmark_name.empty()) {
+            return Benchmarks::run(benchmark_name);
+        }
         
-        // Crear e inicializar TagManager
-        g_tag_manager = std::make_unique<TagManager>();
+        LOG_INFO("🚀 Iniciando PlantaGas OPC-UA Server...");
         
         // Variable para almacenar configuración JSON completa
         nlohmann::json full_config;
+        bool config_found = fileExists(config_file);
         
-        // Intentar cargar configuración
-        if (fileExists(config_file)) {
+        // Cargar JSON completo para OPCUAServer
+        if (config_found) {
             LOG_INFO("📄 Cargando configuración desde: " + config_file);
-            
-            // Cargar JSON completo para OPCUAServer
             try {
                 std::ifstream config_stream(config_file);
                 config_stream >> full_config;
             } catch (const std::exception& e) {
                 LOG_ERROR("Error al cargar JSON: " + std::string(e.what()));
             }
-            
+        }
+        
+        // Crear e inicializar TagManager (particiones del registro: "registry_shards")
+        size_t registry_shards = 1;
+        if (full_config.is_object() && full_config.contains("registry_shards")) {
+            const auto& shards_value = full_config["registry_shards"];
+            if (shards_value.is_number_unsigned() && shards_value.get<uint64_t>() >= 1 &&
+                shards_value.get<uint64_t>() <= TagManager::MAX_SHARDS) {
+                registry_shards = shards_value.get<size_t>();
+            } else {
+                LOG_WARNING("⚠️  registry_shards fuera de rango (1-" + std::to_string(TagManager::MAX_SHARDS) +
+                            "): " + shards_value.dump() + ", se usa 1");
+            }
+        }
+        g_tag_manager = std::make_unique<TagManager>(registry_shards);
+        
+        // Intentar cargar configuración
+        if (config_found) {
             if (g_tag_manager->loadFromFile(config_file)) {
                 LOG_SUCCESS("✅ Configuración cargada correctamente");
             } else {
@@ -355,6 +479,26 @@ int main(int argc, char* argv[]) {
             createExampleTags(*g_tag_manager);
         }
         
+        // Arranque en caliente: restaurar el último estado antes del primer ciclo PAC
+        if (!validate_config && full_config.is_object() && full_config.contains("warm_state_file")) {
+            std::string warm_state_file = full_config["warm_state_file"].get<std::string>();
+            if (!g_tag_manager->enableWarmState(warm_state_file)) {
+                LOG_WARNING("⚠️  Estado persistente no disponible: " + warm_state_file);
+            }
+        }
+
+        // Histórico persistente en disco (tercer nivel)
+        if (!validate_config && full_config.is_object() && full_config.contains("history_store")) {
+            HistoryStore::Options store_options;
+            std::string error;
+            const auto& store_config = full_config["history_store"];
+            if (!HistoryStore::Options::parse(store_config, store_options, error) || !store_config.contains("path")) {
+                LOG_WARNING("⚠️  \"history_store\" inválido: " + (error.empty() ? std::string("falta \"path\"") : error));
+            } else if (!g_tag_manager->enableHistoryStore(store_config["path"].get<std::string>(), store_options)) {
+                LOG_WARNING("⚠️  Histórico persistente no disponible: " + store_config["path"].get<std::string>());
+            }
+        }
+
         if (validate_config) {
             LOG_INFO("✅ Configuración validada correctamente");
             return 0;
@@ -376,12 +520,29 @@ int main(int argc, char* argv[]) {
         g_tag_manager->start();
         LOG_SUCCESS("✅ TagManager iniciado correctamente");
         
+        // Monitor de ciclos del polling PAC (overruns y descarte de carga)
+        g_cycle_monitor = std::make_unique<CycleMonitor>();
+        g_scheduler = std::make_unique<DeadlineScheduler>();
+        
         // Iniciar API HTTP
         LOG_INFO("🌐 Iniciando API HTTP...");
         std::shared_ptr<TagManager> shared_tag_manager(g_tag_manager.get(), [](TagManager*) {
             // Empty deleter since we don't want shared_ptr to delete the object
         });
         g_api_server = TagManagementAPI::createTagManagementServer(shared_tag_manager, config_file);
+        if (g_api_server) {
+            g_api_server->setSchedulerStatusProvider([]() {
+                nlohmann::json status = g_cycle_monitor ? g_cycle_monitor->getStatus() : nlohmann::json::object();
+                if (g_scheduler) {
+                    status["dispatch"] = g_scheduler->getStats();
+                }
+                if (g_pac_client) {
+                    status["pac_request_rate"] = g_pac_client->getRequestRateStats();
+                    status["pac_link"] = g_pac_client->getLinkStatus();
+                }
+                return status;
+            });
+        }
         if (g_api_server && g_api_server->startServer(DEFAULT_HTTP_PORT)) {
             LOG_SUCCESS("✅ API HTTP iniciada en puerto " + std::to_string(DEFAULT_HTTP_PORT));
         } else {
@@ -420,6 +581,12 @@ int main(int argc, char* argv[]) {
                 int pac_port = full_config["pac_port"];
                 g_pac_client->setConnectionParams(pac_ip, pac_port);
             }
+            if (!full_config.is_null() && full_config.contains("pac_reconnect")) {
+                const auto& reconnect = full_config["pac_reconnect"];
+                g_pac_client->setReconnectPolicy(reconnect.value("connect_timeout_ms", 1000),
+                                                 reconnect.value("backoff_base_ms", 100),
+                                                 reconnect.value("backoff_max_ms", 1000));
+            }
             
             // Intentar conectar
             if (g_pac_client->connect()) {
@@ -432,6 +599,9 @@ int main(int argc, char* argv[]) {
             } else {
                 LOG_WARNING("⚠️ No se pudo conectar al PAC Control, funcionando en modo offline");
             }
+            
+            // Reintentos en segundo plano mientras el enlace esté caído
+            g_pac_client->startAutoReconnect();
         } catch (const std::exception& e) {
             LOG_ERROR("💥 Excepción al inicializar cliente PAC: " + std::string(e.what()));
             LOG_WARNING("⚠️ Continuando sin cliente PAC (modo offline)");
@@ -456,12 +626,17 @@ int main(int argc, char* argv[]) {
         }
         
         // Loop principal de monitoreo
-        monitoringLoop();
+        monitoringLoop(full_config);
+        
+        if (g_pac_client) {
+            g_pac_client->setOnConnected(nullptr);
+        }
         
         // Cierre limpio del sistema
         LOG_INFO("🛑 Iniciando cierre limpio del sistema...");
         
         if (g_pac_client) {
+            g_pac_client->stopAutoReconnect();
             g_pac_client->disconnect();
             LOG_SUCCESS("✅ Cliente PAC desconectado");
             g_pac_client.reset();
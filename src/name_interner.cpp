@@ -0,0 +1,47 @@
+#include "name_interner.h"
+#include <mutex>
+
+NameInterner& NameInterner::instance() {
+    static NameInterner interner;
+    return interner;
+}
+
+NameInterner::NameId NameInterner::intern(std::string_view name) {
+    NameId id = find(name);
+    if (id != INVALID_NAME) {
+        return id;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(name);
+    if (it != index_.end()) {
+        return it->second;      // Internado por otro hilo entre find() y el bloqueo
+    }
+
+    id = static_cast<NameId>(entries_.size());
+    entries_.push_back({std::string(name), std::hash<std::string_view>{}(name)});
+    index_.emplace(std::string_view(entries_.back().text), id);
+    return id;
+}
+
+NameInterner::NameId NameInterner::find(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(name);
+    return it != index_.end() ? it->second : INVALID_NAME;
+}
+
+const std::string& NameInterner::name(NameId id) const {
+    static const std::string empty;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < entries_.size() ? entries_[id].text : empty;
+}
+
+size_t NameInterner::hash(NameId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < entries_.size() ? entries_[id].hash : 0;
+}
+
+size_t NameInterner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
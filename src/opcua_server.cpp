@@ -15,6 +15,7 @@
 #include <chrono>
 #include <set>
 #include <unordered_set>
+#include <string_view>
 
 OPCUAServer::OPCUAServer(std::shared_ptr<TagManager> tag_manager)
     : ua_server_(nullptr)
@@ -23,6 +24,8 @@ OPCUAServer::OPCUAServer(std::shared_ptr<TagManager> tag_manager)
     , server_port_(4841)
     , tag_manager_(tag_manager)
     , callback_id_(0)
+    , monitored_items_(0)
+    , published_source_generation_(0)
     , namespace_index_(1)  // Valor por defecto, se actualizará dinámicamente
 {
     LOG_INFO("🏗️ OPCUAServer inicializado con TagManager integrado");
@@ -137,6 +140,9 @@ bool OPCUAServer::setupServerConfiguration(int port) {
     server_config_->maxSessions = 100;
     // Note: maxSessionsPerEndpoint not available in this open62541 version
     
+    // Registrar demanda cuando los clientes crean/eliminan ítems monitoreados
+    server_config_->monitoredItemRegisterCallback = monitoredItemCallback;
+    
     LOG_DEBUG("🔧 Configuración OPC UA establecida en puerto " + std::to_string(port));
     LOG_INFO("🌐 URL del servidor: opc.tcp://localhost:" + std::to_string(port));
     return true;
@@ -275,24 +281,13 @@ bool OPCUAServer::createOrganizedFolders() {
 }
 
 bool OPCUAServer::createTagNodes() {
-    const auto& tags = tag_manager_->getAllTags();
+    auto build_start = std::chrono::steady_clock::now();
+    auto snapshot = tag_manager_->getSnapshot();
+    const auto& tags = snapshot->tags;
     size_t created_tags = 0;
     
-    // Paso 1: Identificar tags padre únicos (sin punto en el nombre)
-    std::set<std::string> parent_tags;
-    for (const auto& tag : tags) {
-        std::string tag_name = tag->getName();
-        size_t dot_pos = tag_name.find('.');
-        if (dot_pos != std::string::npos) {
-            // Es un sub-tag, extraer el nombre padre
-            std::string parent_name = tag_name.substr(0, dot_pos);
-            parent_tags.insert(parent_name);
-
-        } else {
-            // Es un tag padre
-            parent_tags.insert(tag_name);
-        }
-    }
+    // Paso 1: Tags padre únicos desde el índice jerárquico de TagManager
+    const auto& parent_tags = snapshot->family_names;
     
     LOG_INFO("📊 Identificados " + std::to_string(parent_tags.size()) + " tags padre únicos");
     
@@ -300,8 +295,12 @@ bool OPCUAServer::createTagNodes() {
     for (const auto& parent_tag_name : parent_tags) {
 
         try {
-            // Determinar carpeta padre basada en el nombre del tag
-            std::string folder_key = getFolderForTag(parent_tag_name);
+            // Determinar carpeta padre por el prefijo indexado de la familia
+            const TagFamily* family = snapshot->family(parent_tag_name);
+            std::string folder_key = getFolderForTag(family ? family->prefix : parent_tag_name);
+            
+            // Controladores PID (TRC_, PRC_, FRC_, LRC_) ya clasificados por prefijo
+            bool isPIDController = (folder_key == "ControladorsPID");
             
             if (folder_map_.find(folder_key) == folder_map_.end()) {
                 LOG_WARNING("Carpeta no encontrada para tag: " + parent_tag_name + ", usando Instrumentos");
@@ -313,28 +312,12 @@ bool OPCUAServer::createTagNodes() {
             // Crear nodo según grupo/categoría
             bool success = false;
             
-            // Identificar controladores PID por el prefijo del nombre del tag
-            bool isPIDController = (parent_tag_name.substr(0, 3) == "TRC" ||  // Temperature Rate Controller
-                                  parent_tag_name.substr(0, 3) == "PRC" ||   // Pressure Rate Controller
-                                  parent_tag_name.substr(0, 3) == "FRC" ||   // Flow Rate Controller
-                                  parent_tag_name.substr(0, 3) == "LRC");    // Level Rate Controller
-            
-            // Buscar tag padre en la lista para usar como referencia
+            // Tag padre como referencia; si no existe, el primer sub-tag
             std::shared_ptr<Tag> reference_tag = nullptr;
-            for (const auto& tag : tags) {
-                if (tag->getName() == parent_tag_name) {
-                    reference_tag = tag;
-                    break;
-                }
-            }
-            
-            // Si no hay tag padre, usar el primer sub-tag como referencia
-            if (!reference_tag) {
-                for (const auto& tag : tags) {
-                    if (tag->getName().substr(0, parent_tag_name.length() + 1) == parent_tag_name + ".") {
-                        reference_tag = tag;
-                        break;
-                    }
+            if (family) {
+                reference_tag = family->parent;
+                if (!reference_tag && !family->children.empty()) {
+                    reference_tag = family->children.front().tag;
                 }
             }
             
@@ -364,7 +347,10 @@ bool OPCUAServer::createTagNodes() {
         }
     }
     
-    LOG_INFO("📊 Tags OPC UA creados: " + std::to_string(created_tags) + "/" + std::to_string(tags.size()));
+    auto build_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - build_start).count();
+    LOG_INFO("📊 Tags OPC UA creados: " + std::to_string(created_tags) + "/" + std::to_string(tags.size()) +
+             " en " + std::to_string(build_ms) + "ms");
     return created_tags > 0;
 }
 
@@ -489,18 +475,16 @@ bool OPCUAServer::createInstrumentTagNode(std::shared_ptr<Tag> reference_tag, co
         return false;
     }
     
-    // Obtener todas las variables de este tag padre desde TagManager
-    const auto& all_tags = tag_manager_->getAllTags();
+    // Variables de este tag padre desde el índice jerárquico de TagManager
+    auto snapshot = tag_manager_->getSnapshot();
+    const TagFamily* family = snapshot->family(parent_tag_name);
     std::vector<std::string> variables;
+    std::unordered_map<std::string, std::shared_ptr<Tag>> sub_tags;
     
-    // Buscar todos los sub-tags que corresponden a este tag padre
-    for (const auto& tag : all_tags) {
-        std::string tag_name = tag->getName();
-        if (tag_name.length() > parent_tag_name.length() + 1 && 
-            tag_name.substr(0, parent_tag_name.length() + 1) == parent_tag_name + ".") {
-            // Es un sub-tag de este padre, extraer la variable
-            std::string variable = tag_name.substr(parent_tag_name.length() + 1);
-            variables.push_back(variable);
+    if (family) {
+        for (const auto& child : family->children) {
+            variables.push_back(child.variable);
+            sub_tags[child.variable] = child.tag;
         }
     }
     
@@ -526,21 +510,9 @@ bool OPCUAServer::createInstrumentTagNode(std::shared_ptr<Tag> reference_tag, co
     // Crear variables OPC UA para cada propiedad del tag
     int created_vars = 0;
     for (const std::string& variable_name : variables) {
-        // Buscar el tag correspondiente en TagManager
-        std::shared_ptr<Tag> sub_tag = nullptr;
-        std::string full_tag_name = parent_tag_name + "." + variable_name;
-        
-        for (const auto& tag : all_tags) {
-            if (tag->getName() == full_tag_name) {
-                sub_tag = tag;
-                break;
-            }
-        }
-        
-        // Usar reference_tag si no se encuentra el sub-tag específico
-        if (!sub_tag) {
-            sub_tag = reference_tag;
-        }
+        // Sub-tag correspondiente; reference_tag si no existe
+        auto sub_it = sub_tags.find(variable_name);
+        std::shared_ptr<Tag> sub_tag = sub_it != sub_tags.end() ? sub_it->second : reference_tag;
         
         UA_NodeId var_node = createVariableNode(tag_folder, variable_name, sub_tag);
         if (!UA_NodeId_isNull(&var_node)) {
@@ -564,18 +536,16 @@ bool OPCUAServer::createPIDTagNode(std::shared_ptr<Tag> reference_tag, const UA_
         return false;
     }
     
-    // Obtener todas las variables de este tag padre desde TagManager
-    const auto& all_tags = tag_manager_->getAllTags();
+    // Variables de este tag padre desde el índice jerárquico de TagManager
+    auto snapshot = tag_manager_->getSnapshot();
+    const TagFamily* family = snapshot->family(parent_tag_name);
     std::vector<std::string> variables;
+    std::unordered_map<std::string, std::shared_ptr<Tag>> sub_tags;
     
-    // Buscar todos los sub-tags que corresponden a este tag padre
-    for (const auto& tag : all_tags) {
-        std::string tag_name = tag->getName();
-        if (tag_name.length() > parent_tag_name.length() + 1 && 
-            tag_name.substr(0, parent_tag_name.length() + 1) == parent_tag_name + ".") {
-            // Es un sub-tag de este padre, extraer la variable
-            std::string variable = tag_name.substr(parent_tag_name.length() + 1);
-            variables.push_back(variable);
+    if (family) {
+        for (const auto& child : family->children) {
+            variables.push_back(child.variable);
+            sub_tags[child.variable] = child.tag;
         }
     }
     
@@ -602,21 +572,9 @@ bool OPCUAServer::createPIDTagNode(std::shared_ptr<Tag> reference_tag, const UA_
     // Crear variables OPC UA para cada propiedad del controlador PID
     int created_vars = 0;
     for (const std::string& variable_name : variables) {
-        // Buscar el tag correspondiente en TagManager
-        std::shared_ptr<Tag> sub_tag = nullptr;
-        std::string full_tag_name = parent_tag_name + "." + variable_name;
-        
-        for (const auto& tag : all_tags) {
-            if (tag->getName() == full_tag_name) {
-                sub_tag = tag;
-                break;
-            }
-        }
-        
-        // Usar reference_tag si no se encuentra el sub-tag específico
-        if (!sub_tag) {
-            sub_tag = reference_tag;
-        }
+        // Sub-tag correspondiente; reference_tag si no existe
+        auto sub_it = sub_tags.find(variable_name);
+        std::shared_ptr<Tag> sub_tag = sub_it != sub_tags.end() ? sub_it->second : reference_tag;
         
         UA_NodeId var_node = createVariableNode(pid_folder, variable_name, sub_tag);
         if (!UA_NodeId_isNull(&var_node)) {
@@ -687,6 +645,11 @@ UA_NodeId OPCUAServer::createVariableNode(const UA_NodeId& parent, const std::st
         nullptr
     );
     
+    // Contexto del nodo: lo usan writeCallback y monitoredItemCallback
+    if (result == UA_STATUSCODE_GOOD) {
+        UA_Server_setNodeContext(ua_server_, variable_id, this);
+    }
+    
     // Configurar callback de escritura si es writable
     if (result == UA_STATUSCODE_GOOD && !tag->isReadOnly()) {
         UA_ValueCallback callback;
@@ -696,9 +659,6 @@ UA_NodeId OPCUAServer::createVariableNode(const UA_NodeId& parent, const std::st
         // Configurar el callback con contexto
         UA_StatusCode callback_result = UA_Server_setVariableNode_valueCallback(ua_server_, variable_id, callback);
         
-        // También establecer el contexto del nodo
-        UA_Server_setNodeContext(ua_server_, variable_id, this);
-        
         if (callback_result == UA_STATUSCODE_GOOD) {
             LOG_DEBUG("   📝 WriteCallback configurado para: " + variable_name);
         }
@@ -734,6 +694,39 @@ bool OPCUAServer::registerUpdateCallback() {
     }
 }
 
+// Alta/baja de ítems monitoreados sobre variables creadas en createVariableNode
+void OPCUAServer::monitoredItemCallback(UA_Server* server, const UA_NodeId* sessionId,
+                                        void* sessionContext, const UA_NodeId* nodeId,
+                                        void* nodeContext, UA_UInt32 attributeId,
+                                        UA_Boolean removed) {
+    auto* opcua_server = static_cast<OPCUAServer*>(nodeContext);
+    if (!opcua_server || !nodeId || attributeId != UA_ATTRIBUTEID_VALUE ||
+        nodeId->identifierType != UA_NODEIDTYPE_STRING ||
+        nodeId->namespaceIndex != opcua_server->namespace_index_) {
+        return;
+    }
+    
+    // NodeId string: "PARENT.VAR"
+    std::string node_path(reinterpret_cast<const char*>(nodeId->identifier.string.data),
+                          nodeId->identifier.string.length);
+    
+    if (!opcua_server->tag_manager_) {
+        return;
+    }
+    
+    if (removed) {
+        opcua_server->tag_manager_->releaseDemand(node_path);
+        if (opcua_server->monitored_items_ > 0) {
+            opcua_server->monitored_items_--;
+        }
+        LOG_DEBUG("👁️ Ítem monitoreado eliminado: " + node_path);
+    } else {
+        opcua_server->tag_manager_->acquireDemand(node_path);
+        opcua_server->monitored_items_++;
+        LOG_DEBUG("👁️ Ítem monitoreado creado: " + node_path);
+    }
+}
+
 // Static wrapper function for the callback - DESHABILITADO
 void OPCUAServer::staticUpdateCallback(UA_Server* server, void* data) {
     // Callback deshabilitado: Sistema de actualización manual vía updateTagsFromPAC()
@@ -741,6 +734,26 @@ void OPCUAServer::staticUpdateCallback(UA_Server* server, void* data) {
 }
 
 
+// Calidad del tag -> StatusCode OPC UA (UNKNOWN se publica como GOOD, igual que antes).
+// STALE: sin refresco de la fuente durante varios periodos o enlace PAC caído
+static UA_StatusCode qualityToStatusCode(TagQuality quality) {
+    switch (quality) {
+        case TagQuality::UNCERTAIN: return UA_STATUSCODE_UNCERTAINLASTUSABLEVALUE;
+        case TagQuality::STALE: return UA_STATUSCODE_BADNOCOMMUNICATION;
+        case TagQuality::BAD: return UA_STATUSCODE_BADOUTOFRANGE;
+        case TagQuality::GOOD:
+        case TagQuality::UNKNOWN:
+        default: return UA_STATUSCODE_GOOD;
+    }
+}
+
+static UA_Variant convertValueToUAVariant(TagDataType type, const TagValue& tag_value);
+
+// ms desde epoch Unix -> UA_DateTime (intervalos de 100 ns desde 1601)
+static UA_DateTime toUADateTime(uint64_t unix_ms) {
+    return UA_DATETIME_UNIX_EPOCH + static_cast<UA_DateTime>(unix_ms) * UA_DATETIME_MSEC;
+}
+
 // Nuevo método para actualizar solo tags específicos cuando cambian
 void OPCUAServer::updateSpecificTag(std::shared_ptr<Tag> tag) {
     if (!tag || !running_) {
@@ -766,19 +779,20 @@ void OPCUAServer::updateSpecificTag(std::shared_ptr<Tag> tag) {
     }
     
     // ✅ SOLUCIÓN: Usar tag_name directamente como NodeId (como en implementación funcional anterior)
-    std::string tag_name = tag->getName();
+    const std::string& tag_name = tag->getName();
     size_t dot_pos = tag_name.find('.');
     
     if (dot_pos != std::string::npos) {
         // 🔧 USAR TAG_NAME COMPLETO COMO NodeId (no buildNodePath)
         // En la implementación funcional, se usa var.opcua_name directamente
-        std::string opcua_node_id = tag_name;  // "ET_1601.PV", "PRC_1201.SP", etc.
+        const std::string& opcua_node_id = tag_name;  // "ET_1601.PV", "PRC_1201.SP", etc.
         
         // DEBUG: Mostrar mapping correcto - MÁS DETALLADO
         static int debug_count = 0;
-        if ((tag_name.find(".PV") != std::string::npos || 
+        if (debug_count < 10 &&
+            (tag_name.find(".PV") != std::string::npos || 
              tag_name.find(".SP") != std::string::npos || 
-             tag_name.find(".CV") != std::string::npos) && debug_count < 10) {
+             tag_name.find(".CV") != std::string::npos)) {
             LOG_DEBUG("🔍 DEBUG updateSpecificTag: \"" + tag_name + "\" -> NodeId: \"" + opcua_node_id + "\"");
             LOG_DEBUG("🔍     node_map_.size() = " + std::to_string(node_map_.size()));
             LOG_DEBUG("🔍     Buscando en node_map_...");
@@ -792,24 +806,19 @@ void OPCUAServer::updateSpecificTag(std::shared_ptr<Tag> tag) {
             // LOG_DEBUG("🔍     ENCONTRADO en node_map_!");
             UA_DataValue data_value;
             UA_DataValue_init(&data_value);
-            data_value.value = convertTagToUAVariant(tag);
+            // Valor y timestamps de una sola lectura consistente de la celda
+            TagSample sample = tag->getSample();
+            data_value.value = convertValueToUAVariant(tag->getDataType(), sample.value);
             data_value.hasValue = true;
+            data_value.sourceTimestamp = toUADateTime(sample.source_timestamp);
+            data_value.hasSourceTimestamp = sample.source_timestamp != 0;
+            data_value.serverTimestamp = toUADateTime(sample.server_timestamp);
+            data_value.hasServerTimestamp = sample.server_timestamp != 0;
             data_value.hasStatus = true;
-            data_value.status = UA_STATUSCODE_GOOD;
+            data_value.status = qualityToStatusCode(tag_manager_->effectiveQuality(*tag));
             
             UA_StatusCode result = UA_Server_writeDataValue(ua_server_, it->second, data_value);
-            if (result == UA_STATUSCODE_GOOD) {
-                // Solo loguear PV y valores importantes para debug
-                if (tag_name.find(".PV") != std::string::npos || 
-                    tag_name.find(".SP") != std::string::npos || 
-                    tag_name.find(".CV") != std::string::npos) {
-                    std::string value_str = "?";
-                    if (auto* f_val = std::get_if<float>(&tag->getValue())) {
-                        value_str = std::to_string(*f_val);
-                    }
-                    LOG_DEBUG("✅ " + opcua_node_id + " = " + value_str);
-                }
-            } else {
+            if (result != UA_STATUSCODE_GOOD) {
                 // Solo reportar errores para variables críticas
                 if (tag_name.find(".PV") != std::string::npos || 
                     tag_name.find(".SP") != std::string::npos || 
@@ -843,7 +852,8 @@ void OPCUAServer::updateTagsFromPAC() {
     }
     
     try {
-        const auto& tags = tag_manager_->getAllTags();
+        auto snapshot = tag_manager_->getSnapshot();
+        const auto& by_id = snapshot->by_id;
         int updated_count = 0;
         int skipped_count = 0;
         
@@ -864,23 +874,54 @@ void OPCUAServer::updateTagsFromPAC() {
             debug_shown = true;
         }
         
-        for (const auto& tag : tags) {
-            // Solo actualizar sub-tags (que contienen punto) Y que existan en node_map
-            if (tag->getName().find('.') != std::string::npos) {
-                std::string tag_name = tag->getName();
-                // ✅ USAR tag_name completo como node_path (ya tiene formato "TAG.VARIABLE")
-                std::string node_path = tag_name;
-                
-                // CRÍTICO: Solo procesar si el tag existe en node_map
-                if (node_map_.find(node_path) != node_map_.end()) {
-                    updateSpecificTag(tag);
-                    updated_count++;
-                } else {
-                    skipped_count++;
+        // Una caída o reconexión de fuente cambia la calidad efectiva sin tocar los tags:
+        // marcar como dirty los tags alimentados por fuentes para republicar su estado
+        TagValueStore& live_store = tag_manager_->getLiveStore();
+        uint64_t source_generation = tag_manager_->getSourceEpochs().generation();
+        if (source_generation != published_source_generation_) {
+            published_source_generation_ = source_generation;
+            for (const auto& tag : by_id) {
+                uint16_t source;
+                uint32_t epoch;
+                if (tag) {
+                    tag->getSourceEpoch(source, epoch);
+                    if (source != SourceEpochs::NO_SOURCE) {
+                        live_store.markDirty(tag->getId());
+                    }
                 }
             }
         }
         
+        // Pasada lineal sobre los flags dirty del almacén SoA: solo se publican
+        // los tags cuyo valor, calidad o timestamp cambió desde la última vez
+        std::vector<TagValueStore::TagId> retry_ids;
+        live_store.drainDirty([&](TagValueStore::TagId id) {
+            if (id >= by_id.size()) {
+                retry_ids.push_back(id);    // Registrado después de la instantánea
+                return;
+            }
+            const auto& tag = by_id[id];
+            // Solo actualizar sub-tags (que contienen punto) Y que existan en node_map
+            if (!tag || tag->getName().find('.') == std::string::npos) {
+                return;
+            }
+            // CRÍTICO: Solo procesar si el tag existe en node_map
+            if (node_map_.find(tag->getName()) == node_map_.end()) {
+                skipped_count++;
+                return;
+            }
+            // Escrito recientemente por un cliente: publicar cuando expire la protección
+            if (tag->wasRecentlyWrittenByClient(5000)) {
+                retry_ids.push_back(id);
+                return;
+            }
+            updateSpecificTag(tag);
+            updated_count++;
+        });
+        for (TagValueStore::TagId id : retry_ids) {
+            live_store.markDirty(id);
+        }
+        
         if (updated_count > 0) {
             // Comentado para debug limpio de escrituras
             // LOG_DEBUG("🔄 Actualizados " + std::to_string(updated_count) + " tags en OPC UA desde datos PAC recientes");
@@ -926,31 +967,32 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
         LOG_INFO("📋 SessionId: " + std::to_string(sessionId->namespaceIndex) + 
                  ":" + std::to_string(sessionId->identifier.numeric));
 
-        // Buscar el NodeId en node_map_ para obtener el path del tag
-        std::string found_node_path;
-        for (const auto& [path, node_id] : opcua_server->node_map_) {
-            if (UA_NodeId_equal(nodeId, &node_id)) {
-                found_node_path = path;
-                break;
-            }
-        }
-
-        if (found_node_path.empty()) {
+        // El NodeId string de las variables es el path del tag ("TAG.Variable")
+        if (nodeId->identifierType != UA_NODEIDTYPE_STRING) {
             LOG_ERROR("❌ NodeId no encontrado en node_map");
             return;
         }
+        std::string_view found_node_path(reinterpret_cast<const char*>(nodeId->identifier.string.data),
+                                         nodeId->identifier.string.length);
 
-        LOG_INFO("🎯 Variable: " + found_node_path);
+        LOG_INFO("🎯 Variable: " + std::string(found_node_path));
 
-        // Extraer tag parent y variable desde el path (formato: "TAG.Variable")
+        // Separar tag parent y variable sin copiar y resolverlos como nombres internados
         size_t dot_pos = found_node_path.find('.');
-        if (dot_pos == std::string::npos) {
-            LOG_ERROR("❌ Formato de path inválido: " + found_node_path);
+        if (dot_pos == std::string_view::npos) {
+            LOG_ERROR("❌ Formato de path inválido: " + std::string(found_node_path));
             return;
         }
         
-        std::string parent_tag = found_node_path.substr(0, dot_pos);
-        std::string variable_name = found_node_path.substr(dot_pos + 1);
+        NameInterner& interner = NameInterner::instance();
+        NameInterner::NameId parent_id = interner.find(found_node_path.substr(0, dot_pos));
+        NameInterner::NameId variable_id = interner.find(found_node_path.substr(dot_pos + 1));
+        if (parent_id == NameInterner::INVALID_NAME || variable_id == NameInterner::INVALID_NAME) {
+            LOG_ERROR("❌ NodeId no encontrado en node_map");
+            return;
+        }
+        const std::string& parent_tag = interner.name(parent_id);
+        const std::string& variable_name = interner.name(variable_id);
 
         LOG_INFO("🏷️  Tag: " + parent_tag + " → Variable: " + variable_name);        // Convertir el valor de OPC UA a float
         float new_value = 0.0f;
@@ -961,7 +1003,7 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
         } else if (data->value.type == &UA_TYPES[UA_TYPES_INT32]) {
             new_value = (float)*((int32_t*)data->value.data);
         } else {
-            LOG_ERROR("❌ Tipo de dato no soportado para " + found_node_path);
+            LOG_ERROR("❌ Tipo de dato no soportado para " + std::string(found_node_path));
             return;
         }
 
@@ -969,8 +1011,8 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
 
         // Buscar el tag correspondiente en TagManager y actualizarlo
         if (opcua_server->tag_manager_) {
-            std::string full_tag_name = parent_tag + "." + variable_name;
-            auto tag = opcua_server->tag_manager_->getTag(full_tag_name);
+            std::string full_tag_name(found_node_path);
+            auto tag = opcua_server->tag_manager_->getTag(parent_id, variable_id);
             if (tag) {
                 // CRÍTICO: Marcar timestamp de escritura por cliente para evitar sobrescritura
                 uint64_t current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -995,21 +1037,25 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
                     if (is_alarm_variable) {
                         // VARIABLES DE ALARMA: Usar tabla correcta según tipo de tag
                         std::string pac_alarm_table = "";
+                        auto snapshot = opcua_server->tag_manager_->getSnapshot();
+                        const TagFamily* family = snapshot->family(parent_tag);
                         
-                        // Mapear tag a tabla de alarma correcta según prefijo
-                        if (parent_tag.substr(0, 3) == "ET_") {
+                        // Preferir la tabla de alarmas de la configuración; si no, mapear según prefijo
+                        if (family && !family->alarm_table.empty()) {
+                            pac_alarm_table = family->alarm_table;
+                        } else if (parent_tag.compare(0, 3, "ET_") == 0) {
                             pac_alarm_table = "TBL_EA_" + parent_tag.substr(3); // ET_1601 -> TBL_EA_1601
-                        } else if (parent_tag.substr(0, 4) == "FIT_") {
+                        } else if (parent_tag.compare(0, 4, "FIT_") == 0) {
                             pac_alarm_table = "TBL_FA_" + parent_tag.substr(4); // FIT_1404 -> TBL_FA_1404
-                        } else if (parent_tag.substr(0, 4) == "PIT_") {
+                        } else if (parent_tag.compare(0, 4, "PIT_") == 0) {
                             pac_alarm_table = "TBL_PA_" + parent_tag.substr(4); // PIT_1201 -> TBL_PA_1201
-                        } else if (parent_tag.substr(0, 4) == "TIT_") {
+                        } else if (parent_tag.compare(0, 4, "TIT_") == 0) {
                             pac_alarm_table = "TBL_TA_" + parent_tag.substr(4); // TIT_1201A -> TBL_TA_1201A
-                        } else if (parent_tag.substr(0, 5) == "PDIT_") {
+                        } else if (parent_tag.compare(0, 5, "PDIT_") == 0) {
                             pac_alarm_table = "TBL_PDA_" + parent_tag.substr(5); // PDIT_1501 -> TBL_PDA_1501
-                        } else if (parent_tag.substr(0, 4) == "PRC_") {
+                        } else if (parent_tag.compare(0, 4, "PRC_") == 0) {
                             pac_alarm_table = "TBL_CA_" + parent_tag.substr(4); // PRC_1201 -> TBL_CA_1201
-                        } else if (parent_tag.substr(0, 4) == "LIT_") {
+                        } else if (parent_tag.compare(0, 4, "LIT_") == 0) {
                             pac_alarm_table = "TBL_TA_" + parent_tag; // LIT_1501 -> TBL_TA_LIT_1501
                         } else {
                             LOG_ERROR("🚫 Tipo de tag desconocido para alarma: " + parent_tag);
@@ -1042,8 +1088,8 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
                         int variable_index = -1;
                         
                         // Determinar tipo de tag basado en prefijo para mapeo correcto
-                        if (parent_tag.substr(0, 3) == "PRC" || parent_tag.substr(0, 3) == "FRC" || 
-                            parent_tag.substr(0, 3) == "TRC" || parent_tag.substr(0, 3) == "LRC") {
+                        if (parent_tag.compare(0, 3, "PRC") == 0 || parent_tag.compare(0, 3, "FRC") == 0 || 
+                            parent_tag.compare(0, 3, "TRC") == 0 || parent_tag.compare(0, 3, "LRC") == 0) {
                             // CONTROLLERS: ["PV", "SP", "CV", "KP", "KI", "KD", "auto_manual", "OUTPUT_HIGH", "OUTPUT_LOW", "PID_ENABLE"]
                             if (variable_name == "PV") variable_index = 0;
                             else if (variable_name == "SP") variable_index = 1;
@@ -1056,9 +1102,9 @@ void OPCUAServer::writeCallback(UA_Server* server, const UA_NodeId* sessionId,
                             else if (variable_name == "OUTPUT_LOW") variable_index = 8;
                             else if (variable_name == "PID_ENABLE") variable_index = 9;
                         } 
-                        else if (parent_tag.substr(0, 2) == "ET" || parent_tag.substr(0, 3) == "FIT" || 
-                                 parent_tag.substr(0, 3) == "PIT" || parent_tag.substr(0, 3) == "TIT" || 
-                                 parent_tag.substr(0, 3) == "LIT" || parent_tag.substr(0, 4) == "PDIT") {
+                        else if (parent_tag.compare(0, 2, "ET") == 0 || parent_tag.compare(0, 3, "FIT") == 0 || 
+                                 parent_tag.compare(0, 3, "PIT") == 0 || parent_tag.compare(0, 3, "TIT") == 0 || 
+                                 parent_tag.compare(0, 3, "LIT") == 0 || parent_tag.compare(0, 4, "PDIT") == 0) {
                             // TRANSMITTERS: ["Input", "SetHH", "SetH", "SetL", "SetLL", "SIM_Value", "PV", "min", "max", "percent"]
                             // ⚠️ ADVERTENCIA: Los transmisores suelen ser de solo lectura en el PAC
                             LOG_WARNING("⚠️ TRANSMITTER WRITE: " + parent_tag + "." + variable_name + 
@@ -1117,42 +1163,56 @@ std::string OPCUAServer::buildNodePath(const std::string& tag_opcua_name, const
 }
 
 std::string OPCUAServer::getFolderForTag(const std::string& tag_name) {
-    return categorizeTagByName(tag_name);
+    // Prefijos de familia (TagFamily::prefix) resueltos con una sola búsqueda
+    static const std::unordered_map<std::string, std::string> folder_by_prefix = {
+        {"TRC", "ControladorsPID"}, {"PRC", "ControladorsPID"},
+        {"FRC", "ControladorsPID"}, {"LRC", "ControladorsPID"},
+        {"FQI", "Totalizers"}
+    };
+    auto it = folder_by_prefix.find(tag_name);
+    if (it != folder_by_prefix.end()) {
+        return it->second;
+    }
+    return tag_name.find('_') != std::string::npos ? categorizeTagByName(tag_name) : "Instrumentos";
 }
 
 UA_Variant OPCUAServer::convertTagToUAVariant(std::shared_ptr<Tag> tag) {
+    return convertValueToUAVariant(tag->getDataType(), tag->getValue());
+}
+
+// El valor compacto se convierte sin reservar memoria (salvo strings)
+static UA_Variant convertValueToUAVariant(TagDataType type, const TagValue& tag_value) {
     UA_Variant variant;
     UA_Variant_init(&variant);
     
-    switch (tag->getDataType()) {
+    switch (type) {
         case TagDataType::FLOAT: {
             UA_Float* value = UA_Float_new();
-            *value = tag->getValueAsFloat();
+            *value = static_cast<float>(tag_value.toDouble());
             UA_Variant_setScalar(&variant, value, &UA_TYPES[UA_TYPES_FLOAT]);
             break;
         }
         case TagDataType::DOUBLE: {
             UA_Double* value = UA_Double_new();
-            *value = tag->getValueAsDouble();
+            *value = tag_value.toDouble();
             UA_Variant_setScalar(&variant, value, &UA_TYPES[UA_TYPES_DOUBLE]);
             break;
         }
         case TagDataType::INT32: {
             UA_Int32* value = UA_Int32_new();
-            *value = tag->getValueAsInt32();
+            *value = tag_value.holds<int32_t>() ? tag_value.get<int32_t>() : static_cast<int32_t>(tag_value.toDouble());
             UA_Variant_setScalar(&variant, value, &UA_TYPES[UA_TYPES_INT32]);
             break;
         }
         case TagDataType::BOOLEAN: {
             UA_Boolean* value = UA_Boolean_new();
-            *value = tag->getValueAsBool();
+            *value = tag_value.toDouble() != 0.0;
             UA_Variant_setScalar(&variant, value, &UA_TYPES[UA_TYPES_BOOLEAN]);
             break;
         }
         case TagDataType::STRING: {
-            std::string str_value = tag->getValueAsString();
             UA_String* value = UA_String_new();
-            *value = UA_STRING_ALLOC(str_value.c_str());
+            *value = UA_STRING_ALLOC(tagValueToString(tag_value).c_str());
             UA_Variant_setScalar(&variant, value, &UA_TYPES[UA_TYPES_STRING]);
             break;
         }
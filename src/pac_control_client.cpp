@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <map>
+#include <poll.h>
 
 // Constructor adaptado para shared_ptr (nueva versión)
 PACControlClient::PACControlClient(std::shared_ptr<TagManager> tag_manager)
@@ -24,8 +26,29 @@ PACControlClient::PACControlClient(std::shared_ptr<TagManager> tag_manager)
     , connected_(false)
     , enabled_(true)
     , socket_fd_(-1)
+    , opcua_table_source_timestamp_(0)
+    , last_rtt_us_(0)
+    , connect_timeout_ms_(1000)
+    , backoff_base_ms_(100)
+    , backoff_max_ms_(1000)
+    , reconnect_running_(false)
+    , link_state_(LinkState::DISCONNECTED)
+    , reconnect_attempts_(0)
+    , total_reconnects_(0)
+    , current_backoff_ms_(0)
+    , last_outage_ms_(0)
+    , link_down_since_(std::chrono::steady_clock::now())
+    , link_down_pending_(true)
+    , backoff_rng_(std::random_device{}())
+    , source_id_(SourceEpochs::NO_SOURCE)
 {
     opcua_table_cache_.resize(52, 0.0f);
+    
+    // La fuente arranca caída (igual que link_down_pending_) hasta la primera conexión
+    if (tag_manager_) {
+        source_id_ = tag_manager_->getSourceEpochs().registerSource("pac");
+        tag_manager_->getSourceEpochs().linkDown(source_id_);
+    }
     stats_.last_success = std::chrono::steady_clock::now();
     
     if (!initializeSocket()) {
@@ -49,6 +72,7 @@ PACControlClient::PACControlClient(TagManager* tag_manager)
 }
 
 PACControlClient::~PACControlClient() {
+    stopAutoReconnect();
     disconnect();
     cleanupSocket();
 }
@@ -65,9 +89,17 @@ void PACControlClient::cleanupSocket() {
     }
 }
 
+static const char* linkStateToString(PACControlClient::LinkState state) {
+    switch (state) {
+        case PACControlClient::LinkState::DISCONNECTED: return "DISCONNECTED";
+        case PACControlClient::LinkState::CONNECTING: return "CONNECTING";
+        case PACControlClient::LinkState::CONNECTED: return "CONNECTED";
+        case PACControlClient::LinkState::BACKOFF: return "BACKOFF";
+        default: return "UNKNOWN";
+    }
+}
+
 bool PACControlClient::connect() {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    
     if (!enabled_) {
         LOG_ERROR("PAC client is disabled");
         return false;
@@ -80,18 +112,25 @@ bool PACControlClient::connect() {
     
     LOG_INFO("🔌 Conectando al PAC " + pac_ip_ + ":" + std::to_string(pac_port_) + " usando protocolo MMP...");
     
-    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
-        LOG_ERROR("Error creando socket: " + std::string(strerror(errno)));
+    std::string error;
+    if (!connectOnce(error)) {
+        LOG_ERROR("❌ Error conectando al PAC: " + error);
         return false;
     }
     
-    // Configurar timeout para socket
-    struct timeval timeout;
-    timeout.tv_sec = 3; // 3 segundos timeout
-    timeout.tv_usec = 0;
-    setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
-    setsockopt(socket_fd_, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+    LOG_INFO("🔄 Lectura inicial de TBL_OPCUA diferida a monitoringLoop()");
+    return true;
+}
+
+// Un intento de conexión no bloqueante: connect + poll(POLLOUT) con deadline.
+// socket_mutex_ solo se toma para instalar el socket ya conectado, de modo que
+// un PAC caído no bloquea a los lectores durante el timeout SYN del kernel.
+bool PACControlClient::connectOnce(std::string& error) {
+    std::lock_guard<std::mutex> connect_lock(connect_mutex_);
+    
+    if (connected_) {
+        return true;
+    }
     
     struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
@@ -99,36 +138,211 @@ bool PACControlClient::connect() {
     server_addr.sin_port = htons(pac_port_);
     
     if (inet_pton(AF_INET, pac_ip_.c_str(), &server_addr.sin_addr) <= 0) {
-        LOG_ERROR("Dirección IP inválida: " + pac_ip_);
-        close(socket_fd_);
-        socket_fd_ = -1;
+        error = "Dirección IP inválida: " + pac_ip_;
         return false;
     }
     
-    if (::connect(socket_fd_, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_ERROR("❌ Error conectando al PAC: " + std::string(strerror(errno)));
-        close(socket_fd_);
-        socket_fd_ = -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        error = "Error creando socket: " + std::string(strerror(errno));
         return false;
     }
     
-    connected_ = true;
-    LOG_SUCCESS("✅ Conectado al PAC exitosamente usando protocolo MMP");
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
     
-    // DEBUGGING TEMPORAL: Comentar lectura inicial para evitar bloqueo
-    /*
-    // Leer TBL_OPCUA inicial para verificar comunicación
-    if (readOPCUATable()) {
-        LOG_SUCCESS("📊 TBL_OPCUA leída exitosamente (" + std::to_string(opcua_table_cache_.size()) + " variables)");
-    } else {
-        LOG_WARNING("⚠️ No se pudo leer TBL_OPCUA inicial, pero conexión establecida");
+    if (::connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        if (errno != EINPROGRESS) {
+            error = strerror(errno);
+            close(fd);
+            return false;
+        }
+        
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, connect_timeout_ms_);
+        if (ready <= 0) {
+            error = ready == 0 ? "timeout de conexión (" + std::to_string(connect_timeout_ms_) + "ms)"
+                               : std::string(strerror(errno));
+            close(fd);
+            return false;
+        }
+        
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+        if (so_error != 0) {
+            error = strerror(so_error);
+            close(fd);
+            return false;
+        }
     }
-    */
-    LOG_INFO("🔄 Lectura inicial de TBL_OPCUA diferida a monitoringLoop()");
     
+    // Volver a modo bloqueante con timeout para el protocolo MMP
+    fcntl(fd, F_SETFL, flags);
+    struct timeval timeout;
+    timeout.tv_sec = 3; // 3 segundos timeout
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+    
+    {
+        std::lock_guard<std::mutex> lock(socket_mutex_);
+        if (socket_fd_ >= 0) {
+            close(socket_fd_);
+        }
+        socket_fd_ = fd;
+        connected_ = true;
+    }
+    
+    std::function<void()> on_connected;
+    int64_t outage_ms = 0;
+    {
+        std::lock_guard<std::mutex> lock(reconnect_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        outage_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - link_down_since_).count();
+        last_outage_ms_ = outage_ms;
+        link_down_pending_ = false;
+        link_state_ = LinkState::CONNECTED;
+        if (tag_manager_) {
+            tag_manager_->getSourceEpochs().linkUp(source_id_);
+        }
+        reconnect_attempts_ = 0;
+        current_backoff_ms_ = 0;
+        last_connect_error_.clear();
+        total_reconnects_++;
+        on_connected = on_connected_;
+    }
+    
+    LOG_SUCCESS("✅ Conectado al PAC exitosamente usando protocolo MMP (sin enlace " +
+                std::to_string(outage_ms) + "ms)");
+    
+    if (on_connected) {
+        on_connected();
+    }
     return true;
 }
 
+// Llamado con socket_mutex_ tomado por los caminos de E/S que detectan la caída
+void PACControlClient::markLinkDown(const std::string& reason) {
+    connected_ = false;
+    
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    if (!link_down_pending_) {
+        link_down_pending_ = true;
+        link_down_since_ = std::chrono::steady_clock::now();
+        link_state_ = LinkState::DISCONNECTED;
+        // Todos los tags del PAC pasan a STALE de una vez (un incremento de época)
+        if (tag_manager_) {
+            tag_manager_->getSourceEpochs().linkDown(source_id_);
+        }
+        last_connect_error_ = reason;
+        LOG_WARNING("🔌 Enlace con el PAC perdido: " + reason);
+    }
+    reconnect_cv_.notify_all();
+}
+
+std::chrono::milliseconds PACControlClient::nextBackoff() {
+    // Backoff exponencial con jitter completo: uniforme en [0, min(max, base * 2^intentos)]
+    uint32_t shift = std::min<uint32_t>(reconnect_attempts_, 16);
+    int64_t ceiling = std::min<int64_t>(backoff_max_ms_, static_cast<int64_t>(backoff_base_ms_) << shift);
+    std::uniform_int_distribution<int64_t> dist(0, std::max<int64_t>(ceiling, 1));
+    return std::chrono::milliseconds(dist(backoff_rng_));
+}
+
+void PACControlClient::reconnectLoop() {
+    LOG_INFO("🔁 Reconexión PAC en segundo plano activa (deadline " + std::to_string(connect_timeout_ms_) +
+             "ms, backoff " + std::to_string(backoff_base_ms_) + "-" + std::to_string(backoff_max_ms_) + "ms)");
+    
+    while (reconnect_running_) {
+        {
+            std::unique_lock<std::mutex> lock(reconnect_mutex_);
+            reconnect_cv_.wait(lock, [this] { return !reconnect_running_ || !connected_; });
+            if (!reconnect_running_) {
+                break;
+            }
+            link_state_ = LinkState::CONNECTING;
+        }
+        
+        std::string error;
+        if (!enabled_ || connectOnce(error)) {
+            if (!enabled_) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(backoff_max_ms_));
+            }
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(reconnect_mutex_);
+        reconnect_attempts_++;
+        last_connect_error_ = error;
+        // Primer fallo y uno de cada 30 para no inundar el log durante una caída larga
+        if (reconnect_attempts_ == 1 || reconnect_attempts_ % 30 == 0) {
+            LOG_WARNING("🔌 Reintento de conexión PAC " + std::to_string(reconnect_attempts_) + " fallido: " + error);
+        }
+        
+        auto backoff = nextBackoff();
+        current_backoff_ms_ = backoff.count();
+        link_state_ = LinkState::BACKOFF;
+        reconnect_cv_.wait_for(lock, backoff, [this] { return !reconnect_running_.load(); });
+    }
+}
+
+void PACControlClient::startAutoReconnect() {
+    if (reconnect_running_.exchange(true)) {
+        return;
+    }
+    reconnect_thread_ = std::make_unique<std::thread>(&PACControlClient::reconnectLoop, this);
+}
+
+void PACControlClient::stopAutoReconnect() {
+    if (!reconnect_running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(reconnect_mutex_);
+        reconnect_cv_.notify_all();
+    }
+    if (reconnect_thread_ && reconnect_thread_->joinable()) {
+        reconnect_thread_->join();
+    }
+    reconnect_thread_.reset();
+    LOG_INFO("🔁 Reconexión PAC en segundo plano detenida");
+}
+
+void PACControlClient::setReconnectPolicy(int connect_timeout_ms, int backoff_base_ms, int backoff_max_ms) {
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    connect_timeout_ms_ = std::max(1, connect_timeout_ms);
+    backoff_base_ms_ = std::max(1, backoff_base_ms);
+    backoff_max_ms_ = std::max(backoff_base_ms_, backoff_max_ms);
+}
+
+void PACControlClient::setOnConnected(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    on_connected_ = std::move(callback);
+}
+
+nlohmann::json PACControlClient::getLinkStatus() const {
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    
+    nlohmann::json status;
+    status["state"] = linkStateToString(connected_ ? LinkState::CONNECTED : link_state_);
+    status["auto_reconnect"] = reconnect_running_.load();
+    status["attempts"] = reconnect_attempts_;
+    status["total_connects"] = total_reconnects_;
+    status["last_error"] = last_connect_error_;
+    status["last_outage_ms"] = last_outage_ms_;
+    status["current_backoff_ms"] = current_backoff_ms_;
+    status["connect_timeout_ms"] = connect_timeout_ms_;
+    status["last_rtt_us"] = last_rtt_us_.load(std::memory_order_relaxed);
+    if (!connected_) {
+        status["down_for_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - link_down_since_).count();
+    }
+    return status;
+}
+
 void PACControlClient::disconnect() {
     std::lock_guard<std::mutex> lock(socket_mutex_);
     
@@ -139,6 +353,9 @@ void PACControlClient::disconnect() {
     
     if (connected_) {
         connected_ = false;
+        if (tag_manager_) {
+            tag_manager_->getSourceEpochs().linkDown(source_id_);
+        }
         LOG_INFO("🔌 Desconectado del PAC");
     }
 }
@@ -161,11 +378,31 @@ bool PACControlClient::readOPCUATable() {
         return false;
     }
     
+    // Los instrumentos escalados en el gateway no usan el PV de TBL_OPCUA. Si todos los PV
+    // mapeados se escalan y ningún Input llega por la tabla, no se pide
+    if (tag_manager_ && !opcua_pv_indices_.empty() && opcua_input_indices_.empty()) {
+        static const NameInterner::NameId pv_id = NameInterner::instance().intern("PV");
+        auto snapshot = tag_manager_->getSnapshot();
+        bool all_derived = true;
+        for (const auto& mapping : opcua_pv_indices_) {
+            const std::shared_ptr<Tag>* pv_tag = snapshot->child(mapping.first, pv_id);
+            if (!pv_tag || !tag_manager_->isDerivedValue((*pv_tag)->getId())) {
+                all_derived = false;
+                break;
+            }
+        }
+        if (all_derived) {
+            LOG_DEBUG("📐 TBL_OPCUA omitida: todos sus PV se escalan en el gateway");
+            return true;
+        }
+    }
+    
     auto start_time = std::chrono::steady_clock::now();
     
     try {
         // Comando MMP para leer TBL_OPCUA completa (52 floats)
-        std::vector<float> values = readFloatTable("TBL_OPCUA", 0, 51);
+        uint64_t source_timestamp = 0;
+        std::vector<float> values = readFloatTable("TBL_OPCUA", 0, 51, &source_timestamp);
         
         if (values.empty()) {
             LOG_ERROR("Empty response from TBL_OPCUA");
@@ -198,6 +435,7 @@ bool PACControlClient::readOPCUATable() {
         
         // Copiar datos al cache
         opcua_table_cache_ = values;
+        opcua_table_source_timestamp_ = source_timestamp;
         
         auto end_time = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -221,18 +459,22 @@ bool PACControlClient::readOPCUATable() {
     return false;
 }
 
-// **NUEVA ESTRATEGIA**: Leer tablas individuales con datos reales
-bool PACControlClient::readIndividualTables() {
-    if (!connected_ || !enabled_) {
-        return false;
+// Instrumento escalado en el gateway: su PV (o percent) lo deriva applyFrame del Input
+bool PACControlClient::isScaledInstrument(const TagSnapshot& snapshot, NameInterner::NameId parent_id) const {
+    static const NameInterner::NameId pv_id = NameInterner::instance().intern("PV");
+    static const NameInterner::NameId percent_id = NameInterner::instance().intern("percent");
+    const std::shared_ptr<Tag>* pv_tag = snapshot.child(parent_id, pv_id);
+    if (pv_tag && tag_manager_->isDerivedValue((*pv_tag)->getId())) {
+        return true;
     }
-    
-    LOG_INFO("🔄 Leyendo tablas individuales con datos reales...");
-    auto start_time = std::chrono::steady_clock::now();
-    size_t total_updates = 0;
-    
-    // Lista de tablas principales basada en configuración
-    std::vector<std::string> main_tables = {
+    const std::shared_ptr<Tag>* percent_tag = snapshot.child(parent_id, percent_id);
+    return percent_tag && tag_manager_->isDerivedValue((*percent_tag)->getId());
+}
+
+// **NUEVA ESTRATEGIA**: Leer tablas individuales con datos reales
+// Tablas de valores individuales (11 floats por tabla)
+const std::vector<std::string>& PACControlClient::getValueTables() {
+    static const std::vector<std::string> value_tables = {
         "TBL_ET_1601",   // Flow Transmitter 1601 - valores 1-10 ✓
         "TBL_ET_1602",   // Flow Transmitter 1602
         "TBL_ET_1603",   // Flow Transmitter 1603
@@ -245,37 +487,75 @@ bool PACControlClient::readIndividualTables() {
         "TBL_PIT_1502",  // Pressure Transmitter
         "TBL_PIT_1758"   // Pressure Transmitter
     };
+    return value_tables;
+}
+
+// Tablas de alarmas (5 int32 por tabla: ALARM_HH, ALARM_H, ALARM_L, ALARM_LL, ALARM_Color)
+const std::vector<std::string>& PACControlClient::getAlarmTables() {
+    static const std::vector<std::string> alarm_tables = {
+        "TBL_EA_1601", "TBL_EA_1602", "TBL_EA_1603", "TBL_EA_1604", "TBL_EA_1605",
+        "TBL_CA_1201", "TBL_CA_1202", "TBL_CA_1203", "TBL_CA_1204",  // PRC control alarmas
+        "TBL_PA_1201", "TBL_PA_1303", "TBL_PA_1303A", "TBL_PA_1404", 
+        "TBL_PA_1502", "TBL_PA_1758"
+    };
+    return alarm_tables;
+}
+
+// "TBL_ET_1601" -> "ET_1601"
+std::string PACControlClient::tagNameForValueTable(const std::string& table_name) {
+    if (table_name.substr(0, 4) == "TBL_") {
+        return table_name.substr(4); // Remover prefijo "TBL_"
+    }
+    return table_name;
+}
+
+// Extraer nombre del tag de la tabla de alarmas según prefijos correctos
+std::string PACControlClient::tagNameForAlarmTable(const std::string& table_name) {
+    std::string tag_name = table_name;
+    if (tag_name.substr(0, 7) == "TBL_EA_") {
+        tag_name = "ET_" + tag_name.substr(7); // "TBL_EA_1601" -> "ET_1601"
+    } else if (tag_name.substr(0, 7) == "TBL_FA_") {
+        tag_name = "FIT_" + tag_name.substr(7); // "TBL_FA_1404" -> "FIT_1404"
+    } else if (tag_name.substr(0, 7) == "TBL_PA_") {
+        tag_name = "PIT_" + tag_name.substr(7); // "TBL_PA_1201" -> "PIT_1201"
+    } else if (tag_name.substr(0, 7) == "TBL_TA_") {
+        tag_name = "TIT_" + tag_name.substr(7); // "TBL_TA_1201A" -> "TIT_1201A"
+    } else if (tag_name.substr(0, 8) == "TBL_PDA_") {
+        tag_name = "PDIT_" + tag_name.substr(8); // "TBL_PDA_1501" -> "PDIT_1501"
+    } else if (tag_name.substr(0, 7) == "TBL_CA_") {
+        tag_name = "PRC_" + tag_name.substr(7); // "TBL_CA_1201" -> "PRC_1201"
+    } else if (tag_name.substr(0, 7) == "TBL_XA_") {
+        // Mantener compatibilidad con nombres antiguos
+        tag_name = tag_name.substr(7); // Remover prefijo "TBL_XA_"
+    }
+    return tag_name;
+}
+
+bool PACControlClient::readIndividualTables() {
+    if (!connected_ || !enabled_) {
+        return false;
+    }
     
-    for (const auto& table_name : main_tables) {
-        try {
-            // Leer tabla individual (típicamente 11 variables por tabla)
-            std::vector<float> table_values = readFloatTable(table_name, 0, 10);
-            
-            if (!table_values.empty()) {
-                // Actualizar TagManager con los valores de esta tabla
-                if (updateTagManagerFromIndividualTable(table_name, table_values)) {
-                    total_updates += table_values.size();
-                    LOG_DEBUG("✅ " + table_name + ": " + std::to_string(table_values.size()) + " valores actualizados");
-                }
-            } else {
-                LOG_DEBUG("⚠️ " + table_name + " devolvió datos vacíos");
-            }
-            
-            // Pequeña pausa para no saturar el PAC
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            
-        } catch (const std::exception& e) {
-            LOG_ERROR("Error leyendo " + table_name + ": " + std::string(e.what()));
+    LOG_INFO("🔄 Leyendo tablas individuales con datos reales...");
+    auto start_time = std::chrono::steady_clock::now();
+    size_t tables_updated = 0;
+    
+    for (const auto& table_name : getValueTables()) {
+        if (readIndividualTable(table_name)) {
+            tables_updated++;
         }
+        
+        // Pequeña pausa para no saturar el PAC
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
     
     auto end_time = std::chrono::steady_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
     
-    if (total_updates > 0) {
+    if (tables_updated > 0) {
         updateStats(true, elapsed.count());
-        LOG_SUCCESS("📊 Tablas individuales: " + std::to_string(total_updates) + 
-                   " variables actualizadas en " + std::to_string(elapsed.count()) + "ms");
+        LOG_SUCCESS("📊 Tablas individuales: " + std::to_string(tables_updated) + 
+                   " tablas actualizadas en " + std::to_string(elapsed.count()) + "ms");
         return true;
     }
     
@@ -283,8 +563,65 @@ bool PACControlClient::readIndividualTables() {
     return false;
 }
 
+bool PACControlClient::readIndividualTable(const std::string& table_name, RateClass rate_class) {
+    if (!connected_ || !enabled_) {
+        return false;
+    }
+    
+    try {
+        // Leer tabla individual (típicamente 11 variables por tabla). En un instrumento
+        // escalado percent se deriva: basta Input..max, o SetHH..max si Input llega por TBL_OPCUA
+        NameInterner::NameId parent_id = parentIdForTable(table_name, false);
+        bool scaled = tag_manager_ && isScaledInstrument(*tag_manager_->getSnapshot(), parent_id);
+        int first = scaled && opcua_input_parents_.count(parent_id) ? SCALED_TABLE_FIRST : 0;
+        int last = scaled ? SCALED_TABLE_LAST : 10;
+        uint64_t source_timestamp = 0;
+        std::vector<float> table_values = readFloatTable(table_name, first, last, &source_timestamp);
+        
+        if (table_values.empty()) {
+            LOG_DEBUG("⚠️ " + table_name + " devolvió datos vacíos");
+            return false;
+        }
+        
+        // Actualizar TagManager con los valores de esta tabla
+        if (updateTagManagerFromIndividualTable(table_name, table_values, source_timestamp, rate_class,
+                                                static_cast<size_t>(first))) {
+            LOG_DEBUG("✅ " + table_name + ": " + std::to_string(table_values.size()) + " valores actualizados");
+            return true;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error leyendo " + table_name + ": " + std::string(e.what()));
+    }
+    return false;
+}
+
+bool PACControlClient::readAlarmTable(const std::string& table_name, RateClass rate_class) {
+    if (!connected_ || !enabled_) {
+        return false;
+    }
+    
+    try {
+        uint64_t source_timestamp = 0;
+        std::vector<int32_t> alarm_values = readInt32Table(table_name, 0, 4, &source_timestamp);
+        
+        if (alarm_values.empty()) {
+            LOG_DEBUG("⚠️ " + table_name + " devolvió datos vacíos");
+            return false;
+        }
+        
+        if (updateTagManagerFromAlarmTable(table_name, alarm_values, source_timestamp, rate_class)) {
+            LOG_DEBUG("✅ " + table_name + ": " + std::to_string(alarm_values.size()) + " alarmas actualizadas");
+            return true;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error leyendo " + table_name + ": " + std::string(e.what()));
+    }
+    return false;
+}
+
 // Lectura de tablas usando protocolo MMP de Opto 22
-std::vector<float> PACControlClient::readFloatTable(const std::string& table_name, int start_pos, int end_pos) {
+std::vector<float> PACControlClient::readFloatTable(const std::string& table_name, int start_pos, int end_pos,
+                                                  uint64_t* source_timestamp) {
     std::lock_guard<std::mutex> lock(socket_mutex_);
     
     if (!connected_) {
@@ -304,6 +641,9 @@ std::vector<float> PACControlClient::readFloatTable(const std::string& table_nam
     // Limpiar buffer del socket
     flushSocketBuffer();
     
+    // Único muestreo del reloj de pared de la trama, justo antes de enviar
+    uint64_t sent_ms = getCurrentTimestamp();
+    auto sent = std::chrono::steady_clock::now();
     if (!sendCommand(command)) {
         LOG_ERROR("Error enviando comando MMP");
         return {};
@@ -318,6 +658,10 @@ std::vector<float> PACControlClient::readFloatTable(const std::string& table_nam
         LOG_ERROR("Error recibiendo datos binarios de tabla: " + table_name);
         return {};
     }
+    uint64_t frame_timestamp = frameSourceTimestamp(sent_ms, sent);
+    if (source_timestamp) {
+        *source_timestamp = frame_timestamp;
+    }
     
     if (!validateDataIntegrity(raw_data, table_name)) {
         LOG_WARNING("⚠️ Posible contaminación en datos de " + table_name);
@@ -335,7 +679,8 @@ std::vector<float> PACControlClient::readFloatTable(const std::string& table_nam
 }
 
 // Lectura de tablas de enteros usando protocolo MMP de Opto 22
-std::vector<int32_t> PACControlClient::readInt32Table(const std::string& table_name, int start_pos, int end_pos) {
+std::vector<int32_t> PACControlClient::readInt32Table(const std::string& table_name, int start_pos, int end_pos,
+                                                  uint64_t* source_timestamp) {
     std::lock_guard<std::mutex> lock(socket_mutex_);
     
     if (!connected_) {
@@ -368,6 +713,9 @@ std::vector<int32_t> PACControlClient::readInt32Table(const std::string& table_n
     // Limpiar buffer del socket
     flushSocketBuffer();
     
+    // Único muestreo del reloj de pared de la trama, justo antes de enviar
+    uint64_t sent_ms = getCurrentTimestamp();
+    auto sent = std::chrono::steady_clock::now();
     if (!sendCommand(command)) {
         LOG_ERROR("Error enviando comando MMP");
         return {};
@@ -393,6 +741,10 @@ std::vector<int32_t> PACControlClient::readInt32Table(const std::string& table_n
         LOG_ERROR("Error recibiendo datos binarios de tabla: " + table_name);
         return {};
     }
+    uint64_t frame_timestamp = frameSourceTimestamp(sent_ms, sent);
+    if (source_timestamp) {
+        *source_timestamp = frame_timestamp;
+    }
     
     if (!validateDataIntegrity(raw_data, table_name)) {
         LOG_WARNING("⚠️ Posible contaminación en datos de " + table_name);
@@ -413,15 +765,17 @@ std::vector<int32_t> PACControlClient::readInt32Table(const std::string& table_n
 bool PACControlClient::sendCommand(const std::string& command) {
     if (socket_fd_ < 0) {
         LOG_ERROR("Socket inválido - Marcando como desconectado");
-        connected_ = false;
+        markLinkDown("socket inválido");
         return false;
     }
     
+    recordRequest();
+    
     ssize_t bytes_sent = send(socket_fd_, command.c_str(), command.length(), 0);
     if (bytes_sent != (ssize_t)command.length()) {
         LOG_ERROR("Error enviando comando MMP - Esperado: " + std::to_string(command.length()) + 
                  " Enviado: " + std::to_string(bytes_sent) + " (errno: " + std::to_string(errno) + ")");
-        connected_ = false;
+        markLinkDown("error enviando comando MMP");
         return false;
     }
     
@@ -451,7 +805,7 @@ std::vector<uint8_t> PACControlClient::receiveData(size_t expected_bytes) {
         // Timeout después de 3 segundos
         if (elapsed.count() > 3000) {
             LOG_DEBUG("⏰ TIMEOUT recibiendo datos después de " + std::to_string(elapsed.count()) + "ms - Marcando como desconectado");
-            connected_ = false;
+            markLinkDown("timeout de recepción");
             break;
         }
         
@@ -464,11 +818,11 @@ std::vector<uint8_t> PACControlClient::receiveData(size_t expected_bytes) {
             //          std::to_string(bytes_received) + "/" + std::to_string(total_expected));
         } else if (result == 0) {
             LOG_DEBUG("❌ Conexión cerrada por el servidor - Marcando como desconectado");
-            connected_ = false;
+            markLinkDown("conexión cerrada por el PAC");
             break;
         } else {
             LOG_DEBUG("❌ Error recv: " + std::string(strerror(errno)) + " - Marcando como desconectado");
-            connected_ = false;
+            markLinkDown("error de recepción");
             break;
         }
     }
@@ -604,6 +958,14 @@ bool PACControlClient::validateDataIntegrity(const std::vector<uint8_t>& data, c
     return true;
 }
 
+// Timestamp de origen de una trama: el PAC muestrea la tabla entre el envío y la
+// respuesta; sin reloj propio se toma el punto medio (envío + RTT/2)
+uint64_t PACControlClient::frameSourceTimestamp(uint64_t sent_ms, std::chrono::steady_clock::time_point sent) {
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent);
+    last_rtt_us_.store(rtt.count(), std::memory_order_relaxed);
+    return sent_ms + static_cast<uint64_t>(rtt.count() / 2000);
+}
+
 // Funciones auxiliares que deben estar implementadas para compatibilidad
 bool PACControlClient::updateTagManagerFromOPCUATable() {
     if (!tag_manager_) {
@@ -616,39 +978,52 @@ bool PACControlClient::updateTagManagerFromOPCUATable() {
         return false;
     }
     
-    LOG_INFO("🔄 Iniciando actualización TagManager desde TBL_OPCUA - Cache: " + std::to_string(opcua_table_cache_.size()) + " valores, Mapeos: " + std::to_string(tag_opcua_index_map_.size()));
+    LOG_INFO("🔄 Iniciando actualización TagManager desde TBL_OPCUA - Cache: " + std::to_string(opcua_table_cache_.size()) + " valores, Mapeos: " + std::to_string(opcua_pv_indices_.size()));
     
     size_t updates_processed = 0;
+    std::vector<TagUpdate> frame;
+    frame.reserve(opcua_pv_indices_.size() + opcua_input_indices_.size());
+    uint64_t source_timestamp = opcua_table_source_timestamp_ ? opcua_table_source_timestamp_ : getCurrentTimestamp();
+    static const NameInterner::NameId pv_id = NameInterner::instance().intern("PV");
+    auto snapshot = tag_manager_->getSnapshot();
     
     // CORRECCIÓN: Solo iterar sobre tags que tienen mapeo en TBL_OPCUA
-    for (const auto& mapping : tag_opcua_index_map_) {
-        const std::string& tag_name = mapping.first;
-        int opcua_index = mapping.second;
-        
-        try {
-            if (opcua_index >= 0 && opcua_index < static_cast<int>(opcua_table_cache_.size())) {
-                float new_value = opcua_table_cache_[opcua_index];
-                
-                // TBL_OPCUA contiene solo valores PV, actualizar SOLO el PV del tag
-                std::string pv_tag_name = tag_name + ".PV";
-                auto pv_tag = tag_manager_->getTag(pv_tag_name);
-                
-                if (pv_tag) {
-                    TagValue new_tag_value = new_value;
-                    tag_manager_->updateTagValue(pv_tag_name, new_tag_value);
-                    updates_processed++;
-                    // LOG_DEBUG("✅ Actualizado " + pv_tag_name + " [índice " + std::to_string(opcua_index) + "] = " + std::to_string(new_value));
-                } else {
-                    LOG_DEBUG("⚠️ Tag PV no encontrado: " + pv_tag_name);
-                }
-            } else {
-                LOG_DEBUG("⚠️ Índice fuera de rango para " + tag_name + ": " + std::to_string(opcua_index));
-            }
-        } catch (const std::exception& e) {
-            LOG_DEBUG("Error actualizando tag desde TBL_OPCUA " + tag_name + ": " + std::string(e.what()));
+    for (const auto& [parent_id, opcua_index] : opcua_pv_indices_) {
+        if (opcua_index < 0 || opcua_index >= static_cast<int>(opcua_table_cache_.size())) {
+            LOG_DEBUG("⚠️ Índice fuera de rango para " + NameInterner::instance().name(parent_id) + ": " + std::to_string(opcua_index));
+            continue;
+        }
+        
+        // TBL_OPCUA contiene solo valores PV, actualizar SOLO el PV del tag
+        const std::shared_ptr<Tag>* pv_tag = snapshot->child(parent_id, pv_id);
+        if (pv_tag && tag_manager_->isDerivedValue((*pv_tag)->getId())) {
+            continue;       // Escalado en el gateway desde el Input de su tabla
+        }
+        if (pv_tag) {
+            frame.push_back({(*pv_tag)->getId(), TagValue(opcua_table_cache_[opcua_index]), TagQuality::GOOD});
+            updates_processed++;
+        } else {
+            LOG_DEBUG("⚠️ Tag PV no encontrado: " + NameInterner::instance().name(parent_id) + ".PV");
         }
     }
     
+    // Input crudo de los instrumentos escalados: en la misma trama, applyFrame deriva PV y percent
+    static const NameInterner::NameId input_id = NameInterner::instance().intern("Input");
+    for (const auto& [parent_id, opcua_index] : opcua_input_indices_) {
+        if (opcua_index < 0 || opcua_index >= static_cast<int>(opcua_table_cache_.size())) {
+            LOG_DEBUG("⚠️ Índice de Input fuera de rango para " + NameInterner::instance().name(parent_id) + ": " + std::to_string(opcua_index));
+            continue;
+        }
+        const std::shared_ptr<Tag>* input_tag = snapshot->child(parent_id, input_id);
+        if (input_tag) {
+            frame.push_back({(*input_tag)->getId(), TagValue(opcua_table_cache_[opcua_index]), TagQuality::GOOD});
+            updates_processed++;
+        }
+    }
+    
+    // Toda la tabla se aplica como una sola trama
+    tag_manager_->applyFrame(frame, source_timestamp, RateClass::FAST, source_id_);
+    
     if (updates_processed > 0) {
         LOG_SUCCESS("📊 TBL_OPCUA: " + std::to_string(updates_processed) + " tags actualizados exitosamente");
         return true;
@@ -659,74 +1034,78 @@ bool PACControlClient::updateTagManagerFromOPCUATable() {
     return false;
 }
 
+// Tag padre internado de una tabla PAC ("TBL_ET_1601" -> ID de "ET_1601")
+NameInterner::NameId PACControlClient::parentIdForTable(const std::string& table_name, bool is_alarm_table) {
+    std::lock_guard<std::mutex> lock(table_parent_mutex_);
+    auto it = table_parent_ids_.find(table_name);
+    if (it != table_parent_ids_.end()) {
+        return it->second;
+    }
+    std::string tag_name = is_alarm_table ? tagNameForAlarmTable(table_name) : tagNameForValueTable(table_name);
+    NameInterner::NameId parent_id = NameInterner::instance().intern(tag_name);
+    table_parent_ids_.emplace(table_name, parent_id);
+    return parent_id;
+}
+
 // Actualizar TagManager desde tabla individual con datos reales
-bool PACControlClient::updateTagManagerFromIndividualTable(const std::string& table_name, const std::vector<float>& values) {
+bool PACControlClient::updateTagManagerFromIndividualTable(const std::string& table_name, const std::vector<float>& values,
+                                                            uint64_t source_timestamp, RateClass rate_class,
+                                                            size_t first_index) {
     if (!tag_manager_ || values.empty()) {
         return false;
     }
     
-    // Extraer nombre del tag de la tabla (ej: "TBL_ET_1601" -> "ET_1601")
-    std::string tag_name = table_name;
-    if (tag_name.substr(0, 4) == "TBL_") {
-        tag_name = tag_name.substr(4); // Remover prefijo "TBL_"
-    }
+    // Tag padre de la tabla (ej: "TBL_ET_1601" -> "ET_1601"), resuelto una sola vez
+    NameInterner::NameId parent_id = parentIdForTable(table_name, false);
     
-    // Variables típicas por orden en tablas PAC (según configuración JSON)
-    // Orden correcto: Input(0), SetHH(1), SetH(2), SetL(3), SetLL(4), SIM_Value(5), PV(6), min(7), max(8), percent(9)
-    std::vector<std::string> variable_names = {
-        "Input", "SetHH", "SetH", "SetL", "SetLL", "SIM_Value",
-        "PV", "min", "max", "percent"
-    };
-    
-    size_t updates_processed = 0;
+    const std::vector<NameInterner::NameId>& variable_ids = valueTableVariableIds();
+    static const NameInterner::NameId pv_id = NameInterner::instance().intern("PV");
     
     // CORRECCIÓN CRÍTICA: No sobrescribir valores PV que vienen de TBL_OPCUA
     // Los valores PV reales están en TBL_OPCUA, las tablas individuales pueden tener datos obsoletos
+    bool pv_from_opcua = opcua_pv_parents_.count(parent_id) > 0;
     
-    // Actualizar cada variable del tag, EXCEPTO PV si tiene mapeo en TBL_OPCUA
-    for (size_t i = 0; i < values.size() && i < variable_names.size(); i++) {
-        try {
-            std::string variable_name = variable_names[i];
-            
-            // SKIP PV si este tag tiene mapeo en TBL_OPCUA (datos más actualizados)
-            if (variable_name == "PV" && tag_opcua_index_map_.find(tag_name) != tag_opcua_index_map_.end()) {
-                LOG_DEBUG("⏭️ Saltando " + tag_name + ".PV (se actualiza desde TBL_OPCUA)");
-                continue;
-            }
-            
-            std::string full_tag_name = tag_name + "." + variable_name;
-            TagValue new_tag_value = values[i];
-            
-            // 🛡️ PROTECCIÓN CRÍTICA: No sobrescribir si fue escrito por cliente recientemente
-            auto tag = tag_manager_->getTag(full_tag_name);
-            if (tag) {
-                uint64_t current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()
-                ).count();
-                
-                uint64_t client_write_time = tag->getClientWriteTimestamp();
-                uint64_t time_since_client_write = (current_time > client_write_time) ? 
-                    (current_time - client_write_time) : 0;
-                
-                // Si fue escrito por cliente en los últimos 60 segundos, NO sobrescribir
-                if (client_write_time > 0 && time_since_client_write < 60000) {
-                    LOG_SUCCESS("🛡️ PROTECCIÓN: " + full_tag_name + " escrito por cliente hace " + 
-                              std::to_string(time_since_client_write) + "ms - NO sobrescribir");
-                    continue;
-                }
-            }
-            
-            // Actualizar la variable en el TagManager
-            tag_manager_->updateTagValue(full_tag_name, new_tag_value);
-            updates_processed++;
-            
-            LOG_DEBUG("📊 " + full_tag_name + " = " + std::to_string(values[i]));
-            
-        } catch (const std::exception& e) {
-            LOG_DEBUG("Error actualizando " + tag_name + "." + variable_names[i] + ": " + std::string(e.what()));
+    size_t updates_processed = 0;
+    std::vector<TagUpdate> frame;
+    frame.reserve(values.size());
+    auto snapshot = tag_manager_->getSnapshot();
+    
+    // Actualizar cada variable del tag, EXCEPTO PV si tiene mapeo en TBL_OPCUA.
+    // values[0] corresponde a la variable first_index de la tabla
+    for (size_t i = 0; i < values.size() && first_index + i < variable_ids.size(); i++) {
+        NameInterner::NameId variable_id = variable_ids[first_index + i];
+        if (variable_id == pv_id && pv_from_opcua) {
+            continue;
+        }
+        
+        const std::shared_ptr<Tag>* tag = snapshot->child(parent_id, variable_id);
+        if (!tag) {
+            continue;
+        }
+        // PV/percent escalados en el gateway: el valor del PAC no se usa
+        if (tag_manager_->isDerivedValue((*tag)->getId())) {
+            continue;
+        }
+        
+        // 🛡️ PROTECCIÓN CRÍTICA: No sobrescribir si fue escrito por cliente recientemente
+        uint64_t client_write_time = (*tag)->getClientWriteTimestamp();
+        uint64_t time_since_client_write = (source_timestamp > client_write_time) ? 
+            (source_timestamp - client_write_time) : 0;
+        
+        // Si fue escrito por cliente en los últimos 60 segundos, NO sobrescribir
+        if (client_write_time > 0 && time_since_client_write < 60000) {
+            LOG_SUCCESS("🛡️ PROTECCIÓN: " + (*tag)->getName() + " escrito por cliente hace " + 
+                      std::to_string(time_since_client_write) + "ms - NO sobrescribir");
+            continue;
         }
+        
+        // Agregar la variable a la trama de la tabla
+        frame.push_back({(*tag)->getId(), TagValue(values[i]), TagQuality::GOOD});
+        updates_processed++;
     }
     
+    tag_manager_->applyFrame(frame, source_timestamp, rate_class, source_id_);
+    
     if (updates_processed > 0) {
         LOG_DEBUG("✅ " + table_name + ": " + std::to_string(updates_processed) + " variables actualizadas");
         return true;
@@ -736,77 +1115,48 @@ bool PACControlClient::updateTagManagerFromIndividualTable(const std::string& ta
 }
 
 // Actualizar TagManager desde tabla de alarmas (TBL_XA_XXXX) con datos int32
-bool PACControlClient::updateTagManagerFromAlarmTable(const std::string& table_name, const std::vector<int32_t>& values) {
+bool PACControlClient::updateTagManagerFromAlarmTable(const std::string& table_name, const std::vector<int32_t>& values,
+                                                       uint64_t source_timestamp, RateClass rate_class) {
     if (!tag_manager_ || values.empty()) {
         return false;
     }
     
-    // Extraer nombre del tag de la tabla según prefijos correctos
-    std::string tag_name = table_name;
-    if (tag_name.substr(0, 7) == "TBL_EA_") {
-        tag_name = "ET_" + tag_name.substr(7); // "TBL_EA_1601" -> "ET_1601"
-    } else if (tag_name.substr(0, 7) == "TBL_FA_") {
-        tag_name = "FIT_" + tag_name.substr(7); // "TBL_FA_1404" -> "FIT_1404"
-    } else if (tag_name.substr(0, 7) == "TBL_PA_") {
-        tag_name = "PIT_" + tag_name.substr(7); // "TBL_PA_1201" -> "PIT_1201"
-    } else if (tag_name.substr(0, 7) == "TBL_TA_") {
-        tag_name = "TIT_" + tag_name.substr(7); // "TBL_TA_1201A" -> "TIT_1201A"
-    } else if (tag_name.substr(0, 8) == "TBL_PDA_") {
-        tag_name = "PDIT_" + tag_name.substr(8); // "TBL_PDA_1501" -> "PDIT_1501"
-    } else if (tag_name.substr(0, 7) == "TBL_CA_") {
-        tag_name = "PRC_" + tag_name.substr(7); // "TBL_CA_1201" -> "PRC_1201"
-    } else if (tag_name.substr(0, 7) == "TBL_XA_") {
-        // Mantener compatibilidad con nombres antiguos
-        tag_name = tag_name.substr(7); // Remover prefijo "TBL_XA_"
-    }
+    // Tag padre según prefijos de tabla de alarmas, resuelto una sola vez
+    NameInterner::NameId parent_id = parentIdForTable(table_name, true);
     
-    // Variables de alarma por orden en tablas PAC (según definición en opcua_server.cpp)
-    // Orden: ALARM_HH(0), ALARM_H(1), ALARM_L(2), ALARM_LL(3), ALARM_Color(4)
-    std::vector<std::string> alarm_variable_names = {
-        "ALARM_HH", "ALARM_H", "ALARM_L", "ALARM_LL", "ALARM_Color"
-    };
+    const std::vector<NameInterner::NameId>& alarm_variable_ids = alarmTableVariableIds();
     
     size_t updates_processed = 0;
+    std::vector<TagUpdate> frame;
+    frame.reserve(values.size());
+    auto snapshot = tag_manager_->getSnapshot();
     
     // Actualizar cada variable de alarma del tag
-    for (size_t i = 0; i < values.size() && i < alarm_variable_names.size(); i++) {
-        try {
-            std::string variable_name = alarm_variable_names[i];
-            std::string full_tag_name = tag_name + "." + variable_name;
-            
-            // Las variables de alarma son int32, convertir a TagValue
-            TagValue new_tag_value = values[i];
-            
-            // 🛡️ PROTECCIÓN CRÍTICA: No sobrescribir si fue escrito por cliente recientemente
-            auto tag = tag_manager_->getTag(full_tag_name);
-            if (tag) {
-                uint64_t current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()
-                ).count();
-                
-                uint64_t client_write_time = tag->getClientWriteTimestamp();
-                uint64_t time_since_client_write = (current_time > client_write_time) ? 
-                    (current_time - client_write_time) : 0;
-                
-                // Si fue escrito por cliente en los últimos 60 segundos, NO sobrescribir
-                if (client_write_time > 0 && time_since_client_write < 60000) {
-                    LOG_DEBUG("🛡️ PROTECCIÓN ALARMA: " + full_tag_name + " escrito por cliente hace " + 
-                              std::to_string(time_since_client_write) + "ms - NO sobrescribir");
-                    continue;
-                }
-            }
-            
-            // Actualizar la variable de alarma en el TagManager
-            tag_manager_->updateTagValue(full_tag_name, new_tag_value);
-            updates_processed++;
-            
-            LOG_DEBUG("🚨 " + full_tag_name + " = " + std::to_string(values[i]));
-            
-        } catch (const std::exception& e) {
-            LOG_DEBUG("Error actualizando alarma " + tag_name + "." + alarm_variable_names[i] + ": " + std::string(e.what()));
+    for (size_t i = 0; i < values.size() && i < alarm_variable_ids.size(); i++) {
+        const std::shared_ptr<Tag>* tag = snapshot->child(parent_id, alarm_variable_ids[i]);
+        if (!tag) {
+            continue;
+        }
+        
+        // 🛡️ PROTECCIÓN CRÍTICA: No sobrescribir si fue escrito por cliente recientemente
+        uint64_t client_write_time = (*tag)->getClientWriteTimestamp();
+        uint64_t time_since_client_write = (source_timestamp > client_write_time) ? 
+            (source_timestamp - client_write_time) : 0;
+        
+        // Si fue escrito por cliente en los últimos 60 segundos, NO sobrescribir
+        if (client_write_time > 0 && time_since_client_write < 60000) {
+            LOG_DEBUG("🛡️ PROTECCIÓN ALARMA: " + (*tag)->getName() + " escrito por cliente hace " + 
+                      std::to_string(time_since_client_write) + "ms - NO sobrescribir");
+            continue;
         }
+        
+        // Las variables de alarma son int32; agregarlas a la trama de la tabla
+        frame.push_back({(*tag)->getId(), TagValue(values[i]), TagQuality::GOOD});
+        updates_processed++;
     }
     
+    tag_manager_->applyFrame(frame, source_timestamp, rate_class, source_id_);
+    
     if (updates_processed > 0) {
         LOG_DEBUG("✅ " + table_name + ": " + std::to_string(updates_processed) + " variables de alarma actualizadas");
         return true;
@@ -815,6 +1165,80 @@ bool PACControlClient::updateTagManagerFromAlarmTable(const std::string& table_n
     return false;
 }
 
+// Variables típicas por orden en tablas PAC (según configuración JSON)
+// Orden correcto: Input(0), SetHH(1), SetH(2), SetL(3), SetLL(4), SIM_Value(5), PV(6), min(7), max(8), percent(9)
+const std::vector<std::string>& PACControlClient::valueTableVariables() {
+    static const std::vector<std::string> variable_names = {
+        "Input", "SetHH", "SetH", "SetL", "SetLL", "SIM_Value",
+        "PV", "min", "max", "percent"
+    };
+    return variable_names;
+}
+
+// Variables de alarma por orden en tablas PAC (según definición en opcua_server.cpp)
+// Orden: ALARM_HH(0), ALARM_H(1), ALARM_L(2), ALARM_LL(3), ALARM_Color(4)
+const std::vector<std::string>& PACControlClient::alarmTableVariables() {
+    static const std::vector<std::string> alarm_variable_names = {
+        "ALARM_HH", "ALARM_H", "ALARM_L", "ALARM_LL", "ALARM_Color"
+    };
+    return alarm_variable_names;
+}
+
+// Mismas listas como nombres internados, en el mismo orden
+static std::vector<NameInterner::NameId> internAll(const std::vector<std::string>& names) {
+    std::vector<NameInterner::NameId> ids;
+    ids.reserve(names.size());
+    for (const auto& name : names) {
+        ids.push_back(NameInterner::instance().intern(name));
+    }
+    return ids;
+}
+
+const std::vector<NameInterner::NameId>& PACControlClient::valueTableVariableIds() {
+    static const std::vector<NameInterner::NameId> variable_ids = internAll(valueTableVariables());
+    return variable_ids;
+}
+
+const std::vector<NameInterner::NameId>& PACControlClient::alarmTableVariableIds() {
+    static const std::vector<NameInterner::NameId> alarm_variable_ids = internAll(alarmTableVariables());
+    return alarm_variable_ids;
+}
+
+// Marcar calidad de las variables que provee una tabla (p.ej. tabla descartada por sobrecarga)
+// por el camino normal de cambios de TagManager: bus, histórico y comprimido
+void PACControlClient::markTableQuality(const std::string& table_name, bool is_alarm_table, TagQuality quality) {
+    if (!tag_manager_) {
+        return;
+    }
+    
+    NameInterner::NameId parent_id = parentIdForTable(table_name, is_alarm_table);
+    const auto& variable_ids = is_alarm_table ? alarmTableVariableIds() : valueTableVariableIds();
+    static const NameInterner::NameId pv_id = NameInterner::instance().intern("PV");
+    static const NameInterner::NameId input_id = NameInterner::instance().intern("Input");
+    bool pv_from_opcua = opcua_pv_parents_.count(parent_id) > 0;
+    bool input_from_opcua = !is_alarm_table && opcua_input_parents_.count(parent_id) > 0;
+    auto snapshot = tag_manager_->getSnapshot();
+    std::vector<uint32_t> ids;
+    ids.reserve(variable_ids.size());
+    
+    for (NameInterner::NameId variable_id : variable_ids) {
+        // PV llega por TBL_OPCUA, que nunca se descarta
+        if (variable_id == pv_id && pv_from_opcua) {
+            continue;
+        }
+        // Instrumento escalado: PV/percent siguen a su Input. Si este llega por TBL_OPCUA
+        // ninguno depende de la tabla; si llega con ella, se marcan los tres
+        if (variable_id == input_id && input_from_opcua) {
+            continue;
+        }
+        const std::shared_ptr<Tag>* tag = snapshot->child(parent_id, variable_id);
+        if (tag && !(input_from_opcua && tag_manager_->isDerivedValue((*tag)->getId()))) {
+            ids.push_back((*tag)->getId());
+        }
+    }
+    tag_manager_->markTagsQuality(ids, quality);
+}
+
 int PACControlClient::getTagOPCUATableIndex(const std::string& tag_name) const {
     auto it = tag_opcua_index_map_.find(tag_name);
     if (it != tag_opcua_index_map_.end()) {
@@ -848,9 +1272,31 @@ bool PACControlClient::loadTagOPCUAMapping(const std::string& config_file) {
                     int index = tag_config["opcua_table_index"];
                     tag_opcua_index_map_[tag_name] = index;
                 }
+                // Posición del Input crudo de un instrumento escalado en el gateway
+                if (tag_config.contains("name") && tag_config.contains("opcua_input_index")) {
+                    std::string tag_name = tag_config["name"];
+                    int index = tag_config["opcua_input_index"];
+                    tag_opcua_input_map_[tag_name] = index;
+                }
             }
         }
         
+        // Resolver el mapeo a nombres internados para el ciclo de polling
+        opcua_pv_indices_.clear();
+        opcua_pv_parents_.clear();
+        for (const auto& [tag_name, index] : tag_opcua_index_map_) {
+            NameInterner::NameId parent_id = NameInterner::instance().intern(tag_name);
+            opcua_pv_indices_.emplace_back(parent_id, index);
+            opcua_pv_parents_.insert(parent_id);
+        }
+        opcua_input_indices_.clear();
+        opcua_input_parents_.clear();
+        for (const auto& [tag_name, index] : tag_opcua_input_map_) {
+            NameInterner::NameId parent_id = NameInterner::instance().intern(tag_name);
+            opcua_input_indices_.emplace_back(parent_id, index);
+            opcua_input_parents_.insert(parent_id);
+        }
+        
         LOG_INFO("📊 Cargado mapeo TBL_OPCUA: " + std::to_string(tag_opcua_index_map_.size()) + " tags");
         
         // DEBUG: Mostrar algunos mapeos cargados
@@ -894,6 +1340,60 @@ std::string PACControlClient::getStatsReport() const {
     return ss.str();
 }
 
+static int64_t steadySeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PACControlClient::recordRequest() {
+    int64_t second = steadySeconds();
+    size_t slot = static_cast<size_t>(second) % REQUEST_RATE_WINDOW_S;
+    
+    std::lock_guard<std::mutex> lock(rate_mutex_);
+    if (request_seconds_[slot] != second) {
+        request_seconds_[slot] = second;
+        request_counts_[slot] = 0;
+    }
+    request_counts_[slot]++;
+}
+
+nlohmann::json PACControlClient::getRequestRateStats() const {
+    int64_t now = steadySeconds();
+    std::vector<uint32_t> per_second;
+    per_second.reserve(REQUEST_RATE_WINDOW_S);
+    
+    {
+        std::lock_guard<std::mutex> lock(rate_mutex_);
+        // Del segundo más antiguo al actual
+        for (int64_t second = now - static_cast<int64_t>(REQUEST_RATE_WINDOW_S) + 1; second <= now; second++) {
+            size_t slot = static_cast<size_t>(second) % REQUEST_RATE_WINDOW_S;
+            per_second.push_back(request_seconds_[slot] == second ? request_counts_[slot] : 0);
+        }
+    }
+    
+    uint32_t peak = 0;
+    uint64_t total = 0;
+    std::map<uint32_t, uint32_t> distribution;  // peticiones/s -> segundos
+    for (uint32_t count : per_second) {
+        peak = std::max(peak, count);
+        total += count;
+        distribution[count]++;
+    }
+    
+    nlohmann::json histogram = nlohmann::json::object();
+    for (const auto& [requests, seconds] : distribution) {
+        histogram[std::to_string(requests)] = seconds;
+    }
+    
+    return {
+        {"window_s", REQUEST_RATE_WINDOW_S},
+        {"per_second", per_second},
+        {"peak_per_second", peak},
+        {"mean_per_second", static_cast<double>(total) / REQUEST_RATE_WINDOW_S},
+        {"histogram", histogram}
+    };
+}
+
 void PACControlClient::resetStats() {
     stats_ = ClientStats{};
     stats_.last_success = std::chrono::steady_clock::now();
@@ -1191,7 +1691,7 @@ bool PACControlClient::receiveWriteConfirmation() {
                 bytes_received += result;
             } else if (result == 0) {
                 LOG_DEBUG("❌ Conexión cerrada durante confirmación de escritura");
-                connected_ = false;
+                markLinkDown("conexión cerrada durante escritura");
                 return false;
             } else {
                 if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -1199,7 +1699,7 @@ bool PACControlClient::receiveWriteConfirmation() {
                     continue;
                 } else {
                     LOG_DEBUG("❌ Error recv confirmación: " + std::string(strerror(errno)));
-                    connected_ = false;
+                    markLinkDown("error de recepción en escritura");
                     return false;
                 }
             }
@@ -0,0 +1,233 @@
+#include "scaling_plan.h"
+#include "tag_manager.h"
+#include <algorithm>
+#include <cmath>
+
+bool ScalingPlan::parse(const nlohmann::json& scaling, Config& out, std::string& error) {
+    if (!scaling.is_object()) {
+        error = "\"scaling\" debe ser un objeto";
+        return false;
+    }
+
+    std::string mode = scaling.value("mode", std::string("linear"));
+    if (mode == "linear") {
+        out.mode = Mode::LINEAR;
+    } else if (mode == "sqrt" || mode == "square_root") {
+        out.mode = Mode::SQRT;
+    } else if (mode == "piecewise") {
+        out.mode = Mode::PIECEWISE;
+    } else {
+        error = "modo de escalado desconocido: " + mode;
+        return false;
+    }
+
+    out.raw_min = scaling.value("raw_min", 0.0f);
+    out.raw_max = scaling.value("raw_max", 100.0f);
+    if (out.mode != Mode::PIECEWISE && out.raw_max == out.raw_min) {
+        error = "raw_min y raw_max iguales";
+        return false;
+    }
+
+    out.has_eu_range = scaling.contains("eu_min") || scaling.contains("eu_max");
+    if (out.has_eu_range) {
+        if (!scaling.contains("eu_min") || !scaling.contains("eu_max")) {
+            error = "eu_min y eu_max deben configurarse juntos";
+            return false;
+        }
+        out.eu_min = scaling["eu_min"].get<float>();
+        out.eu_max = scaling["eu_max"].get<float>();
+    }
+
+    out.points.clear();
+    if (out.mode == Mode::PIECEWISE) {
+        if (!scaling.contains("points") || !scaling["points"].is_array() || scaling["points"].size() < 2) {
+            error = "piecewise requiere al menos dos puntos [crudo, ingeniería]";
+            return false;
+        }
+        for (const auto& point : scaling["points"]) {
+            if (!point.is_array() || point.size() != 2) {
+                error = "cada punto debe ser [crudo, ingeniería]";
+                return false;
+            }
+            float raw = point[0].get<float>();
+            if (!out.points.empty() && raw <= out.points.back().first) {
+                error = "los puntos deben tener valores crudos crecientes";
+                return false;
+            }
+            out.points.emplace_back(raw, point[1].get<float>());
+        }
+    }
+    return true;
+}
+
+void ScalingPlan::add(const Targets& targets, const Config& config) {
+    if (targets.input == NO_TAG) {
+        return;
+    }
+    uint32_t index = static_cast<uint32_t>(targets_.size());
+    targets_.push_back(targets);
+    configs_.push_back(config);
+    modes_.push_back(config.mode);
+    raw_min_.push_back(config.raw_min);
+    raw_span_inv_.push_back(config.mode == Mode::PIECEWISE ? 0.0f : 1.0f / (config.raw_max - config.raw_min));
+    mode_counts_[static_cast<size_t>(config.mode)]++;
+
+    // Rango de ingeniería: configurado, extremos de la tabla piecewise o sub-tags min/max
+    float eu_min = config.eu_min;
+    float eu_max = config.eu_max;
+    bool dynamic = false;
+    if (!config.has_eu_range && config.mode == Mode::PIECEWISE) {
+        eu_min = config.points.front().second;
+        eu_max = config.points.back().second;
+    } else if (!config.has_eu_range) {
+        eu_min = 0.0f;
+        eu_max = 100.0f;
+        dynamic = targets.min != NO_TAG || targets.max != NO_TAG;
+    }
+    eu_min_.push_back(eu_min);
+    eu_span_.push_back(eu_max - eu_min);
+    dynamic_range_.push_back(dynamic ? 1 : 0);
+    dynamic_count_ += dynamic ? 1 : 0;
+
+    if (instrument_by_input_.size() <= targets.input) {
+        instrument_by_input_.resize(static_cast<size_t>(targets.input) + 1, NOT_SCALED);
+    }
+    instrument_by_input_[targets.input] = index;
+    for (TagId id : {targets.pv, targets.percent}) {
+        if (id != NO_TAG) {
+            if (derived_.size() <= id) {
+                derived_.resize(static_cast<size_t>(id) + 1, 0);
+            }
+            derived_[id] = 1;
+        }
+    }
+}
+
+float ScalingPlan::interpolate(const std::vector<std::pair<float, float>>& points, float raw) {
+    // Fuera de la tabla se extrapola con el primer / último tramo
+    auto upper = std::upper_bound(points.begin() + 1, points.end() - 1, raw,
+        [](float value, const std::pair<float, float>& point) { return value < point.first; });
+    const auto& b = *upper;
+    const auto& a = *(upper - 1);
+    return a.second + (raw - a.first) * (b.second - a.second) / (b.first - a.first);
+}
+
+size_t ScalingPlan::apply(const std::vector<TagUpdate>& frame, const TagSnapshot& snapshot,
+                          std::vector<TagUpdate>& derived) const {
+    if (targets_.empty()) {
+        return 0;
+    }
+
+    // Columnas de trabajo por hilo: sin reservas de memoria en régimen estable
+    struct Scratch {
+        std::vector<uint32_t> instrument;
+        std::vector<TagQuality> quality;
+        std::vector<Mode> mode;
+        std::vector<float> raw, raw_min, raw_span_inv, eu_min, eu_span, fraction, pv;
+    };
+    thread_local Scratch scratch;
+    Scratch& s = scratch;
+    // Reunir los Input escalados de la trama
+    s.instrument.resize(frame.size());
+    s.quality.resize(frame.size());
+    s.raw.resize(frame.size());
+    const uint32_t* instrument_by_input = instrument_by_input_.data();
+    size_t inputs = instrument_by_input_.size();
+    size_t n = 0;
+    for (const auto& update : frame) {
+        if (update.id < inputs && instrument_by_input[update.id] != NOT_SCALED) {
+            s.instrument[n] = instrument_by_input[update.id];
+            s.quality[n] = update.quality;
+            s.raw[n] = static_cast<float>(update.value.toDouble());
+            n++;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    for (auto* column : {&s.raw_min, &s.raw_span_inv, &s.eu_min, &s.eu_span, &s.fraction, &s.pv}) {
+        column->resize(n);
+    }
+    s.mode.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t instrument = s.instrument[i];
+        s.mode[i] = modes_[instrument];
+        s.raw_min[i] = raw_min_[instrument];
+        s.raw_span_inv[i] = raw_span_inv_[instrument];
+        s.eu_min[i] = eu_min_[instrument];
+        s.eu_span[i] = eu_span_[instrument];
+    }
+
+    // Rango vivo de los sub-tags min/max (valor por defecto si el tag no existe)
+    if (dynamic_count_ > 0) {
+        auto limit = [&snapshot](TagId id, float fallback) {
+            return id < snapshot.by_id.size() && snapshot.by_id[id] ?
+                static_cast<float>(snapshot.by_id[id]->getValueAsDouble()) : fallback;
+        };
+        for (size_t i = 0; i < n; i++) {
+            if (dynamic_range_[s.instrument[i]]) {
+                const Targets& targets = targets_[s.instrument[i]];
+                float low = limit(targets.min, 0.0f);
+                s.eu_min[i] = low;
+                s.eu_span[i] = limit(targets.max, 100.0f) - low;
+            }
+        }
+    }
+
+    // Pasadas sobre columnas contiguas: fracción del rango crudo y valor lineal
+    const float* raw = s.raw.data();
+    const float* raw_min = s.raw_min.data();
+    const float* raw_span_inv = s.raw_span_inv.data();
+    const float* eu_min = s.eu_min.data();
+    const float* eu_span = s.eu_span.data();
+    const Mode* mode = s.mode.data();
+    float* fraction = s.fraction.data();
+    float* pv = s.pv.data();
+    for (size_t i = 0; i < n; i++) {
+        fraction[i] = (raw[i] - raw_min[i]) * raw_span_inv[i];
+    }
+    if (mode_counts_[static_cast<size_t>(Mode::SQRT)] > 0) {
+        for (size_t i = 0; i < n; i++) {
+            // Caudal por presión diferencial: raíz con corte en cero
+            float root = std::sqrt(std::max(fraction[i], 0.0f));
+            fraction[i] = mode[i] == Mode::SQRT ? root : fraction[i];
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        pv[i] = eu_min[i] + fraction[i] * eu_span[i];
+    }
+    if (mode_counts_[static_cast<size_t>(Mode::PIECEWISE)] > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (mode[i] == Mode::PIECEWISE) {
+                pv[i] = interpolate(configs_[s.instrument[i]].points, raw[i]);
+                fraction[i] = eu_span[i] != 0.0f ? (pv[i] - eu_min[i]) / eu_span[i] : 0.0f;
+            }
+        }
+    }
+
+    // Escritura directa sobre la cola de derived (sin comprobar capacidad por valor)
+    size_t base = derived.size();
+    derived.resize(base + 2 * n);
+    TagUpdate* out = derived.data() + base;
+    for (size_t i = 0; i < n; i++) {
+        const Targets& targets = targets_[s.instrument[i]];
+        if (targets.pv != NO_TAG) {
+            *out++ = {targets.pv, TagValue(pv[i]), s.quality[i]};
+        }
+        if (targets.percent != NO_TAG) {
+            *out++ = {targets.percent, TagValue(fraction[i] * 100.0f), s.quality[i]};
+        }
+    }
+    derived.resize(static_cast<size_t>(out - derived.data()));
+    return n;
+}
+
+nlohmann::json ScalingPlan::getStatus() const {
+    nlohmann::json status;
+    status["instruments"] = targets_.size();
+    status["linear"] = mode_counts_[static_cast<size_t>(Mode::LINEAR)];
+    status["sqrt"] = mode_counts_[static_cast<size_t>(Mode::SQRT)];
+    status["piecewise"] = mode_counts_[static_cast<size_t>(Mode::PIECEWISE)];
+    return status;
+}
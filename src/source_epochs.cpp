@@ -0,0 +1,68 @@
+#include "source_epochs.h"
+
+SourceEpochs::SourceEpochs() {
+    for (auto& epoch : epochs_) {
+        epoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+SourceEpochs::SourceId SourceEpochs::registerSource(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < names_.size(); i++) {
+        if (names_[i] == name) {
+            return static_cast<SourceId>(i);
+        }
+    }
+    if (names_.size() >= MAX_SOURCES) {
+        return NO_SOURCE;
+    }
+    names_.push_back(name);
+    return static_cast<SourceId>(names_.size() - 1);
+}
+
+bool SourceEpochs::linkDown(SourceId source) {
+    if (source >= MAX_SOURCES) {
+        return false;
+    }
+    uint32_t epoch = epochs_[source].load(std::memory_order_relaxed);
+    while (isUp(epoch)) {
+        if (epochs_[source].compare_exchange_weak(epoch, epoch + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SourceEpochs::linkUp(SourceId source) {
+    if (source >= MAX_SOURCES) {
+        return false;
+    }
+    uint32_t epoch = epochs_[source].load(std::memory_order_relaxed);
+    while (!isUp(epoch)) {
+        if (epochs_[source].compare_exchange_weak(epoch, epoch + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t SourceEpochs::generation() const {
+    uint64_t sum = 0;
+    for (const auto& epoch : epochs_) {
+        sum += epoch.load(std::memory_order_acquire);
+    }
+    return sum;
+}
+
+nlohmann::json SourceEpochs::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json status = nlohmann::json::object();
+    for (size_t i = 0; i < names_.size(); i++) {
+        uint32_t epoch = epochs_[i].load(std::memory_order_acquire);
+        status[names_[i]] = {
+            {"epoch", epoch},
+            {"link_up", isUp(epoch)}
+        };
+    }
+    return status;
+}
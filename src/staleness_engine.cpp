@@ -0,0 +1,164 @@
+#include "staleness_engine.h"
+#include <algorithm>
+
+StalenessEngine::StalenessEngine()
+    : periods_ms_{2000, 10000, 60000}
+    , stale_after_periods_(3)
+    , stage_counts_{0, 0, 0, 0}
+    , sweeps_(0)
+    , uncertain_marked_(0)
+    , stale_marked_(0)
+{
+}
+
+void StalenessEngine::setPeriod(RateClass rate_class, std::chrono::milliseconds period) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    periods_ms_[static_cast<size_t>(rate_class)] = std::max<int64_t>(period.count(), 1);
+}
+
+std::chrono::milliseconds StalenessEngine::getPeriod(RateClass rate_class) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::chrono::milliseconds(periods_ms_[static_cast<size_t>(rate_class)]);
+}
+
+void StalenessEngine::setStaleAfterPeriods(uint32_t periods) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stale_after_periods_ = std::max<uint32_t>(periods, 2);
+}
+
+void StalenessEngine::append(TagId id, List& list) {
+    Slot& slot = slots_[id];
+    slot.prev = list.tail;
+    slot.next = NIL;
+    if (list.tail != NIL) {
+        slots_[list.tail].next = id;
+    } else {
+        list.head = id;
+    }
+    list.tail = id;
+}
+
+void StalenessEngine::unlink(TagId id, List& list) {
+    Slot& slot = slots_[id];
+    if (slot.prev != NIL) {
+        slots_[slot.prev].next = slot.next;
+    } else {
+        list.head = slot.next;
+    }
+    if (slot.next != NIL) {
+        slots_[slot.next].prev = slot.prev;
+    } else {
+        list.tail = slot.prev;
+    }
+    slot.prev = NIL;
+    slot.next = NIL;
+}
+
+void StalenessEngine::setStage(Slot& slot, Stage stage) {
+    stage_counts_[slot.stage]--;
+    stage_counts_[stage]++;
+    slot.stage = stage;
+}
+
+void StalenessEngine::refresh(const std::vector<TagId>& ids, RateClass rate_class, uint64_t now_ms) {
+    if (ids.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    TagId max_id = *std::max_element(ids.begin(), ids.end());
+    if (slots_.size() <= max_id) {
+        stage_counts_[UNTRACKED] += static_cast<size_t>(max_id) + 1 - slots_.size();
+        slots_.resize(static_cast<size_t>(max_id) + 1);
+    }
+
+    // Las listas deben quedar ordenadas: tramas concurrentes leen el reloj antes del mutex
+    List& fresh = lists_[static_cast<size_t>(rate_class)][0];
+    if (fresh.tail != NIL) {
+        now_ms = std::max(now_ms, slots_[fresh.tail].refreshed_ms);
+    }
+
+    for (TagId id : ids) {
+        Slot& slot = slots_[id];
+        if (slot.stage == FRESH || slot.stage == UNCERTAIN) {
+            unlink(id, listFor(slot));
+        }
+        setStage(slot, FRESH);
+        slot.rate_class = static_cast<uint8_t>(rate_class);
+        slot.refreshed_ms = now_ms;
+        append(id, fresh);
+    }
+}
+
+void StalenessEngine::expireList(List& list, uint64_t max_age_ms, uint64_t now_ms, Stage stage,
+                                 std::vector<TagId>& out) {
+    while (list.head != NIL && slots_[list.head].refreshed_ms + max_age_ms <= now_ms) {
+        TagId id = list.head;
+        Slot& slot = slots_[id];
+        unlink(id, list);
+        setStage(slot, stage);
+        out.push_back(id);
+        // UNCERTAIN sigue pendiente de escalar; llega en orden de refresco
+        if (stage == UNCERTAIN) {
+            append(id, listFor(slot));
+        }
+    }
+}
+
+StalenessEngine::Expired StalenessEngine::sweep(uint64_t now_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sweepLocked(now_ms);
+}
+
+StalenessEngine::Expired StalenessEngine::sweepLocked(uint64_t now_ms) {
+    Expired expired;
+    sweeps_++;
+    for (size_t rate_class = 0; rate_class < RATE_CLASSES; rate_class++) {
+        uint64_t period = periods_ms_[rate_class];
+        // Margen de medio periodo sobre el plazo nominal para absorber el jitter del sondeo
+        expireList(lists_[rate_class][0], period + period / 2, now_ms, UNCERTAIN, expired.uncertain);
+        expireList(lists_[rate_class][1], period * stale_after_periods_, now_ms, STALE, expired.stale);
+    }
+    uncertain_marked_ += expired.uncertain.size();
+    stale_marked_ += expired.stale.size();
+    return expired;
+}
+
+void StalenessEngine::forget(TagId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= slots_.size()) {
+        return;
+    }
+    Slot& slot = slots_[id];
+    if (slot.stage == FRESH || slot.stage == UNCERTAIN) {
+        unlink(id, listFor(slot));
+    }
+    setStage(slot, UNTRACKED);
+}
+
+void StalenessEngine::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_.clear();
+    std::fill(std::begin(stage_counts_), std::end(stage_counts_), 0);
+    for (auto& per_class : lists_) {
+        for (List& list : per_class) {
+            list = List();
+        }
+    }
+}
+
+nlohmann::json StalenessEngine::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json status;
+    status["fresh"] = stage_counts_[FRESH];
+    status["uncertain"] = stage_counts_[UNCERTAIN];
+    status["stale"] = stage_counts_[STALE];
+    for (size_t rate_class = 0; rate_class < RATE_CLASSES; rate_class++) {
+        status["periods_ms"][rateClassToString(static_cast<RateClass>(rate_class))] = periods_ms_[rate_class];
+    }
+    status["stale_after_periods"] = stale_after_periods_;
+    status["sweeps"] = sweeps_;
+    status["uncertain_marked"] = uncertain_marked_;
+    status["stale_marked"] = stale_marked_;
+    return status;
+}
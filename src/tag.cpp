@@ -1,15 +1,136 @@
 #include "tag.h"
+#include "tag_value_store.h"
 #include <iomanip>
 #include <ctime>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+#include <thread>
+
+static uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// ============== TagValueCell ==============
+
+TagValueCell::TagValueCell()
+    : sequence_(0)
+{
+    for (auto& word : words_) {
+        word.store(0, std::memory_order_relaxed);
+    }
+    store(std::string(""), TagQuality::UNKNOWN, 0, 0);
+}
+
+TagValueCell::~TagValueCell() {
+    if ((words_[KIND_QUALITY].load(std::memory_order_relaxed) & 0xFF) == static_cast<uint64_t>(TagValueKind::STRING)) {
+        TagStringPool::instance().release(words_[BITS].load(std::memory_order_relaxed));
+    }
+}
+
+void TagValueCell::writeLocked(const uint64_t (&words)[WORDS]) {
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) {
+        words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void TagValueCell::readWords(uint64_t (&words)[WORDS]) const {
+    while (true) {
+        uint32_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < WORDS; i++) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+void TagValueCell::store(const TagValue& value, TagQuality quality, uint64_t source_timestamp, uint64_t server_timestamp) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    
+    // Retener el texto nuevo antes de soltar el anterior (puede ser el mismo)
+    uint64_t previous_kind = words_[KIND_QUALITY].load(std::memory_order_relaxed) & 0xFF;
+    uint64_t previous_bits = words_[BITS].load(std::memory_order_relaxed);
+    if (value.isString()) {
+        TagStringPool::instance().acquire(value.bits());
+    }
+    
+    uint64_t words[WORDS];
+    words[KIND_QUALITY] = static_cast<uint64_t>(value.index()) | (static_cast<uint64_t>(quality) << 8);
+    words[SOURCE_TS] = source_timestamp;
+    words[SERVER_TS] = server_timestamp;
+    words[BITS] = value.bits();
+    writeLocked(words);
+    
+    if (previous_kind == static_cast<uint64_t>(TagValueKind::STRING)) {
+        TagStringPool::instance().release(previous_bits);
+    }
+}
+
+void TagValueCell::storeQuality(TagQuality quality) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    
+    // Único escritor: las palabras actuales no pueden cambiar bajo write_mutex_
+    uint64_t words[WORDS];
+    for (size_t i = 0; i < WORDS; i++) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    words[KIND_QUALITY] = (words[KIND_QUALITY] & 0xFF) | (static_cast<uint64_t>(quality) << 8);
+    writeLocked(words);
+}
+
+void TagValueCell::storeTimestamps(uint64_t source_timestamp, uint64_t server_timestamp) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    
+    uint64_t words[WORDS];
+    for (size_t i = 0; i < WORDS; i++) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    words[SOURCE_TS] = source_timestamp;
+    words[SERVER_TS] = server_timestamp;
+    writeLocked(words);
+}
+
+TagSample TagValueCell::load() const {
+    uint64_t words[WORDS];
+    readWords(words);
+    return TagSample{TagValue::fromBits(static_cast<TagValueKind>(words[KIND_QUALITY] & 0xFF), words[BITS]),
+                     static_cast<TagQuality>((words[KIND_QUALITY] >> 8) & 0xFF),
+                     words[SOURCE_TS], words[SERVER_TS]};
+}
+
+TagQuality TagValueCell::loadQuality() const {
+    return static_cast<TagQuality>((words_[KIND_QUALITY].load(std::memory_order_acquire) >> 8) & 0xFF);
+}
+
+uint64_t TagValueCell::loadSourceTimestamp() const {
+    return words_[SOURCE_TS].load(std::memory_order_acquire);
+}
+
+uint64_t TagValueCell::loadServerTimestamp() const {
+    return words_[SERVER_TS].load(std::memory_order_acquire);
+}
+
+// ============== Tag ==============
 
 // Constructor por defecto
 Tag::Tag() 
     : name_(""), address_(""), description_(""), unit_(""), group_("")
     , data_type_(TagDataType::UNKNOWN), access_mode_(TagAccessMode::READ_WRITE)
-    , value_(std::string("")), quality_(TagQuality::UNKNOWN)
-    , timestamp_(0), client_write_timestamp_(0), min_value_(0.0), max_value_(0.0), has_limits_(false)
+    , client_write_timestamp_(0), live_store_(nullptr), id_(UINT32_MAX), source_epoch_(NO_SOURCE_STAMP)
+    , min_value_(0.0), max_value_(0.0), has_limits_(false)
     , enabled_(true)
 {
     updateTimestamp();
@@ -19,35 +140,37 @@ Tag::Tag()
 Tag::Tag(const std::string& name, const std::string& address, TagDataType type)
     : name_(name), address_(address), description_(""), unit_(""), group_("")
     , data_type_(type), access_mode_(TagAccessMode::READ_WRITE)
-    , quality_(TagQuality::UNKNOWN), timestamp_(0), client_write_timestamp_(0)
+    , client_write_timestamp_(0), live_store_(nullptr), id_(UINT32_MAX), source_epoch_(NO_SOURCE_STAMP)
     , min_value_(0.0), max_value_(0.0), has_limits_(false), enabled_(true)
 {
     // Inicializar valor según el tipo
+    TagValue initial;
     switch (type) {
         case TagDataType::BOOLEAN:
-            value_ = false;
+            initial = false;
             break;
         case TagDataType::INT32:
-            value_ = int32_t(0);
+            initial = int32_t(0);
             break;
         case TagDataType::UINT32:
-            value_ = uint32_t(0);
+            initial = uint32_t(0);
             break;
         case TagDataType::INT64:
-            value_ = int64_t(0);
+            initial = int64_t(0);
             break;
         case TagDataType::FLOAT:
-            value_ = 0.0f;
+            initial = 0.0f;
             break;
         case TagDataType::DOUBLE:
-            value_ = 0.0;
+            initial = 0.0;
             break;
         case TagDataType::STRING:
         default:
-            value_ = std::string("");
+            initial = std::string("");
             break;
     }
-    updateTimestamp();
+    uint64_t now = nowMs();
+    cell_.store(initial, TagQuality::UNKNOWN, now, now);
 }
 
 // Configurar tipo de datos desde string
@@ -61,148 +184,201 @@ std::string Tag::getDataTypeString() const {
 }
 
 // Métodos setValue
+// Valor, calidad y timestamp se publican juntos en una sola escritura de la celda
+void Tag::storeValue(const TagValue& value, bool validate) {
+    TagQuality quality = cell_.loadQuality();
+    if (validate) {
+        double numeric = has_limits_ ? numericValue(value) : 0.0;
+        bool in_range = !has_limits_ || (numeric >= min_value_ && numeric <= max_value_);
+        quality = in_range ? TagQuality::GOOD : TagQuality::BAD;
+    }
+    uint64_t now = nowMs();
+    cell_.store(value, quality, now, now);
+    syncLiveStore();
+}
+
+void Tag::setSample(const TagValue& value, TagQuality quality, uint64_t source_timestamp, uint64_t server_timestamp) {
+    if (quality == TagQuality::GOOD && has_limits_) {
+        double numeric = numericValue(value);
+        if (numeric < min_value_ || numeric > max_value_) {
+            quality = TagQuality::BAD;
+        }
+    }
+    cell_.store(value, quality, source_timestamp, server_timestamp);
+    syncLiveStore();
+}
+
+void Tag::setQuality(TagQuality quality) {
+    cell_.storeQuality(quality);
+    syncLiveStore();
+}
+
+void Tag::setTimestamp(uint64_t timestamp) {
+    cell_.storeTimestamps(timestamp, timestamp);
+    syncLiveStore();
+}
+
+// Reflejar la celda en la ranura del almacén SoA (si el tag está registrado)
+void Tag::syncLiveStore() {
+    TagValueStore* store = live_store_.load(std::memory_order_acquire);
+    if (store) {
+        store->update(id_.load(std::memory_order_relaxed), [this]() { return cell_.load(); });
+    }
+}
+
+void Tag::bindLiveStore(TagValueStore* store, uint32_t id) {
+    id_.store(id, std::memory_order_relaxed);
+    live_store_.store(store, std::memory_order_release);
+    syncLiveStore();
+}
+
+void Tag::unbindLiveStore() {
+    live_store_.store(nullptr, std::memory_order_release);
+    id_.store(UINT32_MAX, std::memory_order_relaxed);
+}
+
 void Tag::setValue(const TagValue& value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(bool value) {
-    value_ = value;
-    updateTimestamp();
+    storeValue(value, false);
 }
 
 void Tag::setValue(int32_t value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(uint32_t value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(int64_t value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(float value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(double value) {
-    value_ = value;
-    validateValue();
-    updateTimestamp();
+    storeValue(value, true);
 }
 
 void Tag::setValue(const std::string& value) {
-    value_ = value;
-    updateTimestamp();
+    storeValue(value, false);
 }
 
 // Conversiones de valor
 std::string Tag::getValueAsString() const {
-    return tagValueToString(value_);
+    return tagValueToString(getValue());
 }
 
 bool Tag::getValueAsBool() const {
-    if (std::holds_alternative<bool>(value_)) {
-        return std::get<bool>(value_);
+    TagValue value = getValue();
+    if (value.holds<bool>()) {
+        return value.get<bool>();
     }
     
     // Intentar conversión desde otros tipos
-    if (std::holds_alternative<std::string>(value_)) {
-        const std::string& str = std::get<std::string>(value_);
+    if (value.isString()) {
+        const std::string& str = value.text();
         return (str == "true" || str == "1" || str == "TRUE");
     }
     
     // Conversión numérica
-    double num = getValueAsNumeric();
+    double num = numericValue(value);
     return num != 0.0;
 }
 
 int32_t Tag::getValueAsInt32() const {
-    if (std::holds_alternative<int32_t>(value_)) {
-        return std::get<int32_t>(value_);
+    TagValue value = getValue();
+    if (value.holds<int32_t>()) {
+        return value.get<int32_t>();
     }
-    return static_cast<int32_t>(getValueAsNumeric());
+    return static_cast<int32_t>(numericValue(value));
 }
 
 uint32_t Tag::getValueAsUInt32() const {
-    if (std::holds_alternative<uint32_t>(value_)) {
-        return std::get<uint32_t>(value_);
+    TagValue value = getValue();
+    if (value.holds<uint32_t>()) {
+        return value.get<uint32_t>();
     }
-    return static_cast<uint32_t>(getValueAsNumeric());
+    return static_cast<uint32_t>(numericValue(value));
 }
 
 int64_t Tag::getValueAsInt64() const {
-    if (std::holds_alternative<int64_t>(value_)) {
-        return std::get<int64_t>(value_);
+    TagValue value = getValue();
+    if (value.holds<int64_t>()) {
+        return value.get<int64_t>();
     }
-    return static_cast<int64_t>(getValueAsNumeric());
+    return static_cast<int64_t>(numericValue(value));
 }
 
 float Tag::getValueAsFloat() const {
-    if (std::holds_alternative<float>(value_)) {
-        return std::get<float>(value_);
+    TagValue value = getValue();
+    if (value.holds<float>()) {
+        return value.get<float>();
     }
-    return static_cast<float>(getValueAsNumeric());
+    return static_cast<float>(numericValue(value));
 }
 
 double Tag::getValueAsDouble() const {
-    if (std::holds_alternative<double>(value_)) {
-        return std::get<double>(value_);
+    TagValue value = getValue();
+    if (value.holds<double>()) {
+        return value.get<double>();
     }
-    return getValueAsNumeric();
+    return numericValue(value);
 }
 
 // Obtener calidad como string
 std::string Tag::getQualityString() const {
-    return tagQualityToString(quality_);
+    return tagQualityToString(getQuality());
 }
 
 // Actualizar timestamp
 void Tag::updateTimestamp() {
-    timestamp_ = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    uint64_t now = nowMs();
+    cell_.storeTimestamps(now, now);
+    syncLiveStore();
 }
 
 // Obtener timestamp como string
 std::string Tag::getTimestampString() const {
-    auto time_point = std::chrono::system_clock::from_time_t(timestamp_ / 1000);
+    uint64_t timestamp = getTimestamp();
+    auto time_point = std::chrono::system_clock::from_time_t(timestamp / 1000);
     auto time_t = std::chrono::system_clock::to_time_t(time_point);
     
     std::stringstream ss;
     ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << (timestamp_ % 1000);
+    ss << "." << std::setfill('0') << std::setw(3) << (timestamp % 1000);
     
     return ss.str();
 }
 
+void Tag::setClientWriteTimestamp(uint64_t timestamp) {
+    client_write_timestamp_ = timestamp;
+    TagValueStore* store = live_store_.load(std::memory_order_acquire);
+    if (store) {
+        store->mirrorClientWrite(id_.load(std::memory_order_relaxed), timestamp);
+    }
+}
+
 // Verificar si fue escrito recientemente por un cliente OPC UA
 bool Tag::wasRecentlyWrittenByClient(uint64_t protection_window_ms) const {
-    if (client_write_timestamp_ == 0) {
+    uint64_t client_write_timestamp = client_write_timestamp_.load();
+    if (client_write_timestamp == 0) {
         return false; // Nunca fue escrito por cliente
     }
     
-    uint64_t current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    uint64_t current_time = nowMs();
     
-    return (current_time - client_write_timestamp_) < protection_window_ms;
+    return (current_time - client_write_timestamp) < protection_window_ms;
 }
 
 // Validación
 bool Tag::isValid() const {
-    return quality_ == TagQuality::GOOD && enabled_;
+    return getQuality() == TagQuality::GOOD && enabled_;
 }
 
 bool Tag::isInRange() const {
@@ -210,7 +386,7 @@ bool Tag::isInRange() const {
         return true;
     }
     
-    double numeric_value = getValueAsNumeric();
+    double numeric_value = numericValue(getValue());
     return (numeric_value >= min_value_ && numeric_value <= max_value_);
 }
 
@@ -238,29 +414,14 @@ void Tag::print() const {
 }
 
 // Métodos privados
-double Tag::getValueAsNumeric() const {
-    return std::visit([](const auto& value) -> double {
-        using T = std::decay_t<decltype(value)>;
-        if constexpr (std::is_same_v<T, bool>) {
-            return value ? 1.0 : 0.0;
-        } else if constexpr (std::is_arithmetic_v<T>) {
-            return static_cast<double>(value);
-        } else if constexpr (std::is_same_v<T, std::string>) {
-            try {
-                return std::stod(value);
-            } catch (...) {
-                return 0.0;
-            }
-        }
+double Tag::numericValue(const TagValue& value) {
+    if (!value.isString()) {
+        return value.toDouble();
+    }
+    try {
+        return std::stod(value.text());
+    } catch (...) {
         return 0.0;
-    }, value_);
-}
-
-void Tag::validateValue() {
-    if (has_limits_ && !isInRange()) {
-        quality_ = TagQuality::BAD;
-    } else {
-        quality_ = TagQuality::GOOD;
     }
 }
 
@@ -306,7 +467,7 @@ std::string tagQualityToString(TagQuality quality) {
 }
 
 std::string tagValueToString(const TagValue& value) {
-    return std::visit([](const auto& v) -> std::string {
+    return value.visit([](const auto& v) -> std::string {
         using T = std::decay_t<decltype(v)>;
         if constexpr (std::is_same_v<T, bool>) {
             return v ? "true" : "false";
@@ -315,7 +476,7 @@ std::string tagValueToString(const TagValue& value) {
         } else {
             return std::to_string(v);
         }
-    }, value);
+    });
 }
 
 // Operador de salida
@@ -0,0 +1,26 @@
+#include "tag_arena.h"
+#include <algorithm>
+
+TagArena::TagArena(size_t initial_bytes)
+    : resource_(std::max<size_t>(initial_bytes, 4096))
+    , bytes_used_(0)
+    , allocations_(0)
+{
+}
+
+void* TagArena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_used_ += bytes;
+    allocations_++;
+    return resource_.allocate(bytes, alignment);
+}
+
+size_t TagArena::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_used_;
+}
+
+size_t TagArena::allocations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocations_;
+}
@@ -0,0 +1,159 @@
+#include "tag_history.h"
+#include <algorithm>
+#include <charconv>
+
+static_assert(sizeof(TagHistoryRing) <= 48, "TagHistoryRing debe ser ligero por tag");
+
+TagHistoryRing::TagHistoryRing(size_t capacity)
+    : entries_(std::max<size_t>(capacity, 1))
+    , head_(0)
+    , count_(0)
+{
+}
+
+TagHistoryRing::~TagHistoryRing() {
+    releaseStrings(0, count_);
+}
+
+TagHistoryRing::TagHistoryRing(TagHistoryRing&& other) noexcept
+    : entries_(std::move(other.entries_))
+    , head_(other.head_)
+    , count_(other.count_)
+{
+    other.head_ = 0;
+    other.count_ = 0;
+}
+
+TagHistoryRing& TagHistoryRing::operator=(TagHistoryRing&& other) noexcept {
+    if (this != &other) {
+        releaseStrings(0, count_);
+        entries_ = std::move(other.entries_);
+        head_ = other.head_;
+        count_ = other.count_;
+        other.head_ = 0;
+        other.count_ = 0;
+    }
+    return *this;
+}
+
+void TagHistoryRing::releaseStrings(size_t first, size_t n) {
+    for (size_t i = first; i < first + n; i++) {
+        const Entry& entry = at(i);
+        if (entry.kind == TagValueKind::STRING) {
+            TagStringPool::instance().release(entry.bits);
+        }
+    }
+}
+
+void TagHistoryRing::latest(const std::string& tag_name, size_t max_entries, std::vector<TagHistory>& out) const {
+    size_t n = std::min(max_entries, count_);
+    out.reserve(out.size() + n);
+    size_t position = head_;
+    for (size_t i = 0; i < n; i++) {
+        position = position == 0 ? entries_.size() - 1 : position - 1;
+        const Entry& entry = entries_[position];
+        out.push_back({tag_name, TagValue::fromBits(entry.kind, entry.bits), entry.quality, entry.timestamp});
+    }
+}
+
+size_t TagHistoryRing::lowerBound(uint64_t timestamp, bool after) const {
+    size_t low = 0, high = count_;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        uint64_t value = at(middle).timestamp;
+        if (value < timestamp || (after && value == timestamp)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void TagHistoryRing::range(const std::string& tag_name, uint64_t start, uint64_t end, size_t max_entries,
+                           HistoryOrder order, std::vector<TagHistory>& out) const {
+    if (start > end) {
+        return;
+    }
+    size_t first = lowerBound(start, false);
+    size_t last = lowerBound(end, true);        // Una después de la última del rango
+    size_t n = std::min(max_entries, last - first);
+    out.reserve(out.size() + n);
+    for (size_t i = 0; i < n; i++) {
+        const Entry& entry = at(order == HistoryOrder::NEWEST_FIRST ? last - 1 - i : first + i);
+        out.push_back({tag_name, TagValue::fromBits(entry.kind, entry.bits), entry.quality, entry.timestamp});
+    }
+}
+
+void TagHistoryRing::resize(size_t capacity) {
+    capacity = std::max<size_t>(capacity, 1);
+    if (capacity == entries_.size()) {
+        return;
+    }
+
+    // Copiar de la más antigua a la más reciente las que caben
+    std::vector<Entry> entries(capacity);
+    size_t keep = std::min(count_, capacity);
+    releaseStrings(0, count_ - keep);
+    size_t position = (head_ + entries_.size() - keep) % entries_.size();
+    for (size_t i = 0; i < keep; i++) {
+        entries[i] = entries_[position];
+        position = position + 1 == entries_.size() ? 0 : position + 1;
+    }
+    entries_ = std::move(entries);
+    count_ = keep;
+    head_ = keep == capacity ? 0 : keep;
+}
+
+// Entero sin signo decimal que ocupa todo el texto ("12abc", "-1" o "" no valen)
+static bool parseUnsigned(const std::string& text, uint64_t& out) {
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    auto [end, error] = std::from_chars(first, last, out);
+    return !text.empty() && error == std::errc() && end == last;
+}
+
+bool HistoryQueryParams::parse(const std::multimap<std::string, std::string>& params, uint64_t now_ms,
+                               HistoryQueryParams& out, std::string& error) {
+    auto value_of = [&params](const char* key) -> const std::string* {
+        auto it = params.find(key);
+        return it != params.end() ? &it->second : nullptr;
+    };
+
+    out = HistoryQueryParams();
+    out.end = now_ms;
+    if (const std::string* end = value_of("end")) {
+        if (!parseUnsigned(*end, out.end)) {
+            error = "Invalid end parameter: " + *end;
+            return false;
+        }
+    }
+    out.start = out.end - std::min(out.end, DEFAULT_WINDOW_MS);
+    if (const std::string* start = value_of("start")) {
+        if (!parseUnsigned(*start, out.start)) {
+            error = "Invalid start parameter: " + *start;
+            return false;
+        }
+    }
+    if (const std::string* max = value_of("max")) {
+        uint64_t max_points;
+        if (!parseUnsigned(*max, max_points)) {
+            error = "Invalid max parameter: " + *max;
+            return false;
+        }
+        out.max_points = static_cast<size_t>(std::min<uint64_t>(max_points, MAX_POINTS));
+    }
+    if (const std::string* order = value_of("order")) {
+        if (*order == "newest") {
+            out.order = HistoryOrder::NEWEST_FIRST;
+        } else if (*order != "oldest") {
+            error = "Invalid order (oldest|newest): " + *order;
+            return false;
+        }
+    }
+    if (out.start > out.end) {
+        error = "start must be <= end";
+        return false;
+    }
+    return true;
+}
@@ -8,6 +8,7 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <unordered_set>
 
 using namespace TagManagementAPI;
 
@@ -102,6 +103,10 @@ void TagManagementServer::setupRoutes() {
         handleGetTag(req, res);
     });
     
+    server->Get(R"(/api/tags/([^/]+)/history)", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetTagHistory(req, res);
+    });
+    
     server->Post("/api/tags", [this](const httplib::Request& req, httplib::Response& res) {
         handleCreateTag(req, res);
     });
@@ -178,6 +183,14 @@ void TagManagementServer::setupRoutes() {
     server->Get("/api/health", [this](const httplib::Request& req, httplib::Response& res) {
         handleHealthCheck(req, res);
     });
+    
+    server->Get("/api/stream", [this](const httplib::Request& req, httplib::Response& res) {
+        handleStreamTags(req, res);
+    });
+    
+    server->Get("/api/scheduler", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetSchedulerStatus(req, res);
+    });
 
     // === DUPLICATE ROUTES WITHOUT /api/ PREFIX FOR FRONTEND COMPATIBILITY ===
     server->Get("/tags", [this](const httplib::Request& req, httplib::Response& res) {
@@ -285,10 +298,52 @@ void TagManagementServer::handleGetAllTags(const httplib::Request& req, httplib:
     std::lock_guard<std::mutex> lock(api_mutex_);
     
     try {
-        const auto& tags = tag_manager_->getAllTags();
+        auto snapshot = tag_manager_->getSnapshot();
+        
+        // Filtros opcionales (?group=, ?category=, ?value_table=, ?alarm_table=, ?prefix=)
+        // servidos desde los índices secundarios; con varios se parte del más pequeño
+        static const std::pair<const char*, TagIndexKind> filters[] = {
+            {"group", TagIndexKind::GROUP},
+            {"category", TagIndexKind::CATEGORY},
+            {"value_table", TagIndexKind::VALUE_TABLE},
+            {"alarm_table", TagIndexKind::ALARM_TABLE},
+            {"prefix", TagIndexKind::PREFIX}
+        };
+        static const TagList no_tags;
+        std::vector<const TagList*> matches;
+        for (const auto& [param, kind] : filters) {
+            if (req.has_param(param)) {
+                const TagList* indexed = snapshot->indexed(kind, req.get_param_value(param));
+                matches.push_back(indexed ? indexed : &no_tags);
+            }
+        }
+        
+        const TagList* tags = &snapshot->tags;
+        std::vector<std::unordered_set<const Tag*>> other_filters;
+        if (!matches.empty()) {
+            auto smallest = std::min_element(matches.begin(), matches.end(),
+                [](const TagList* a, const TagList* b) { return a->size() < b->size(); });
+            tags = *smallest;
+            for (const TagList* match : matches) {
+                if (match != tags) {
+                    std::unordered_set<const Tag*> members;
+                    for (const auto& tag : *match) {
+                        members.insert(tag.get());
+                    }
+                    other_filters.push_back(std::move(members));
+                }
+            }
+        }
+        
         nlohmann::json tag_list = nlohmann::json::array();
         
-        for (const auto& tag : tags) {
+        for (const auto& tag : *tags) {
+            bool matches_all = std::all_of(other_filters.begin(), other_filters.end(),
+                [&tag](const std::unordered_set<const Tag*>& members) { return members.count(tag.get()) > 0; });
+            if (!matches_all) {
+                continue;
+            }
+            
             nlohmann::json tag_json = {
                 {"name", tag->getName()},
                 {"opcua_name", tag->getName()},
@@ -327,15 +382,19 @@ void TagManagementServer::handleGetTag(const httplib::Request& req, httplib::Res
             return;
         }
         
+        // Atributos de la familia (tablas y categoría de configuración) si existen
+        auto snapshot = tag_manager_->getSnapshot();
+        const TagFamily* family = snapshot->family(tag_name.substr(0, tag_name.find('.')));
+        
         // Construir JSON completo del tag
         nlohmann::json tag_json = {
             {"name", tag->getName()},
             {"opcua_name", tag->getName()},
             {"value_table", tag->getAddress()},
-            {"alarm_table", ""},
+            {"alarm_table", family ? family->alarm_table : ""},
             {"description", tag->getDescription()},
             {"units", tag->getUnit()},
-            {"category", tag->getGroup()},
+            {"category", family && !family->category.empty() ? family->category : tag->getGroup()},
             {"associated_instrument", ""},
             {"variables", nlohmann::json::object()},
             {"alarms", nlohmann::json::object()},
@@ -354,6 +413,7 @@ void TagManagementServer::handleGetTag(const httplib::Request& req, httplib::Res
             {"polling_group", "medium"},
             {"description", tag->getDescription()},
             {"current_value", tag->getValueAsString()},
+            {"quality", tagQualityToString(tag_manager_->effectiveQuality(*tag))},
             {"last_update", std::chrono::duration_cast<std::chrono::seconds>(
                 std::chrono::system_clock::now().time_since_epoch()).count()}
         };
@@ -366,6 +426,49 @@ void TagManagementServer::handleGetTag(const httplib::Request& req, httplib::Res
     }
 }
 
+void TagManagementServer::handleGetTagHistory(const httplib::Request& req, httplib::Response& res) {
+    std::string tag_name = req.matches[1];
+    if (!tag_manager_->getTag(tag_name)) {
+        sendErrorResponse(res, "Tag not found: " + tag_name, 404);
+        return;
+    }
+    
+    // Por defecto la última hora, en orden de tiempo y como mucho 1000 puntos
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    HistoryQueryParams query;
+    std::string error;
+    if (!HistoryQueryParams::parse(req.params, now, query, error)) {
+        sendErrorResponse(res, error, 400);
+        return;
+    }
+    
+    try {
+        auto range = tag_manager_->queryHistory(tag_name, query.start, query.end, query.max_points, query.order);
+        nlohmann::json points = nlohmann::json::array();
+        for (const auto& entry : range.points) {
+            points.push_back({
+                {"timestamp", entry.timestamp},
+                {"value", entry.value.isString() ? nlohmann::json(entry.value.text())
+                                                 : nlohmann::json(entry.value.toDouble())},
+                {"quality", tagQualityToString(entry.quality)}
+            });
+        }
+        nlohmann::json data = {
+            {"tag", tag_name},
+            {"start", query.start},
+            {"end", query.end},
+            {"order", query.order == HistoryOrder::NEWEST_FIRST ? "newest" : "oldest"},
+            {"source", range.source},
+            {"count", range.points.size()},
+            {"points", points}
+        };
+        sendResponse(res, APIResponse::Success(data, "History retrieved"));
+    } catch (const std::exception& e) {
+        sendErrorResponse(res, "Error retrieving history: " + std::string(e.what()), 500);
+    }
+}
+
 void TagManagementServer::handleCreateTag(const httplib::Request& req, httplib::Response& res) {
     std::lock_guard<std::mutex> lock(api_mutex_);
     
@@ -730,8 +833,12 @@ void TagManagementServer::handleGetSystemStatus(const httplib::Request& req, htt
             {"api_running", server_running_.load()},
             {"total_tags", stats["total_tags"]},
             {"polling_interval_ms", stats["polling_interval_ms"]},
-            {"max_history_size", stats["max_history_size"]},
+            {"history_depth", stats["history_depth"]},
             {"history_entries", stats["history_entries"]},
+            {"tags_with_demand", stats["tags_with_demand"]},
+            {"demand", tag_manager_->getDemandStatus()},
+            {"stream_subscribers", stream_subscribers_.load()},
+            {"change_bus", tag_manager_->getChangeBus().getStatus()},
             {"config_file", config_file_path_},
             {"backup_directory", backup_directory_},
             {"last_config_save", std::filesystem::last_write_time(config_file_path_).time_since_epoch().count()}
@@ -745,6 +852,175 @@ void TagManagementServer::handleGetSystemStatus(const httplib::Request& req, htt
     }
 }
 
+void TagManagementServer::handleGetSchedulerStatus(const httplib::Request& req, httplib::Response& res) {
+    if (!scheduler_status_provider_) {
+        sendErrorResponse(res, "Scheduler status not available", 503);
+        return;
+    }
+    
+    try {
+        auto response = APIResponse::Success(scheduler_status_provider_(), "Scheduler status retrieved");
+        sendResponse(res, response);
+    } catch (const std::exception& e) {
+        sendErrorResponse(res, "Error retrieving scheduler status: " + std::string(e.what()), 500);
+    }
+}
+
+// Tags de un stream SSE en una instantánea: cada padre pedido y sus variables, por ID
+struct StreamTags {
+    uint64_t version = 0;                   // TagSnapshot::version con que se resolvieron
+    std::vector<std::shared_ptr<Tag>> tags;
+    std::unordered_map<uint32_t, std::shared_ptr<Tag>> by_id;
+};
+
+static void resolveStreamTags(const TagSnapshot& snapshot, const std::vector<std::string>& parents,
+                              StreamTags& stream) {
+    stream.version = snapshot.version;
+    stream.tags.clear();
+    stream.by_id.clear();
+    for (const auto& parent : parents) {
+        const TagFamily* family = snapshot.family(parent);
+        if (!family) {
+            continue;
+        }
+        if (family->parent) {
+            stream.tags.push_back(family->parent);
+        }
+        for (const auto& child : family->children) {
+            stream.tags.push_back(child.tag);
+        }
+    }
+    for (const auto& tag : stream.tags) {
+        stream.by_id[tag->getId()] = tag;
+    }
+}
+
+void TagManagementServer::handleStreamTags(const httplib::Request& req, httplib::Response& res) {
+    if (!req.has_param("tags")) {
+        sendErrorResponse(res, "Missing 'tags' parameter", 400);
+        return;
+    }
+    
+    // Tags padre solicitados: "ET_1601,PIT_1201"
+    std::vector<std::string> parents;
+    std::stringstream ss(req.get_param_value("tags"));
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            parents.push_back(item);
+        }
+    }
+    if (parents.empty()) {
+        sendErrorResponse(res, "Empty 'tags' parameter", 400);
+        return;
+    }
+    
+    int interval_ms = DEFAULT_STREAM_INTERVAL_MS;
+    if (req.has_param("interval_ms")) {
+        try {
+            interval_ms = std::max(MIN_STREAM_INTERVAL_MS, std::stoi(req.get_param_value("interval_ms")));
+        } catch (const std::exception&) {
+            sendErrorResponse(res, "Invalid 'interval_ms' parameter", 400);
+            return;
+        }
+    }
+    
+    // Solo se guardan los nombres padre: los tags se vuelven a resolver con cada
+    // instantánea nueva, ya que una recarga de configuración crea otros objetos Tag
+    auto stream = std::make_shared<StreamTags>();
+    resolveStreamTags(*tag_manager_->getSnapshot(), parents, *stream);
+    if (stream->tags.empty()) {
+        sendErrorResponse(res, "No tags found for stream", 404);
+        return;
+    }
+    
+    // Registrar demanda mientras la conexión esté abierta
+    for (const auto& parent : parents) {
+        tag_manager_->acquireDemand(parent);
+    }
+    stream_subscribers_++;
+    LOG_INFO("📡 Suscriptor SSE conectado (" + std::to_string(parents.size()) + " tags)");
+    
+    // Cola propia en el bus de cambios: tras el primer evento completo solo se
+    // envían los tags cambiados; si la cola desborda se reenvía todo
+    auto subscriber = tag_manager_->getChangeBus().subscribe("sse:" + req.get_param_value("tags"));
+    auto full_resync = std::make_shared<bool>(true);
+    auto source_generation = std::make_shared<uint64_t>(tag_manager_->getSourceEpochs().generation());
+    
+    res.set_header("Cache-Control", "no-cache");
+    if (server_config_.enable_cors) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+    }
+    
+    res.set_chunked_content_provider("text/event-stream",
+        [this, parents, stream, subscriber, full_resync, source_generation, interval_ms](size_t offset, httplib::DataSink& sink) {
+            if (!server_running_) {
+                sink.done();
+                return true;
+            }
+            
+            std::vector<ChangeSubscriber::ChangeSetPtr> change_sets;
+            subscriber->poll(change_sets);
+            if (subscriber->takeOverflow()) {
+                *full_resync = true;
+            }
+            // Caída o reconexión de una fuente: la calidad efectiva cambió sin pasar por el bus
+            uint64_t generation = tag_manager_->getSourceEpochs().generation();
+            if (generation != *source_generation) {
+                *source_generation = generation;
+                *full_resync = true;
+            }
+            // Registro republicado (recarga, altas o bajas): resolver de nuevo y reenviar todo
+            auto snapshot = tag_manager_->getSnapshot();
+            if (snapshot->version != stream->version) {
+                resolveStreamTags(*snapshot, parents, *stream);
+                *full_resync = true;
+            }
+            
+            auto describe = [this](const std::shared_ptr<Tag>& tag) {
+                return nlohmann::json{
+                    {"value", tag->getValueAsString()},
+                    {"quality", tagQualityToString(tag_manager_->effectiveQuality(*tag))},
+                    {"timestamp", tag->getTimestamp()}
+                };
+            };
+            
+            nlohmann::json event = nlohmann::json::object();
+            if (*full_resync) {
+                for (const auto& tag : stream->tags) {
+                    event[tag->getName()] = describe(tag);
+                }
+                *full_resync = false;
+            } else {
+                for (const auto& change_set : change_sets) {
+                    for (uint32_t id : change_set->ids) {
+                        auto it = stream->by_id.find(id);
+                        if (it != stream->by_id.end()) {
+                            event[it->second->getName()] = describe(it->second);
+                        }
+                    }
+                }
+            }
+            
+            // Sin cambios: comentario SSE para detectar desconexiones
+            std::string chunk = event.empty() ? std::string(": keepalive\n\n") : "data: " + event.dump() + "\n\n";
+            if (!sink.write(chunk.data(), chunk.size())) {
+                return false;
+            }
+            
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+            return true;
+        },
+        [this, parents, subscriber](bool success) {
+            tag_manager_->getChangeBus().unsubscribe(subscriber);
+            for (const auto& parent : parents) {
+                tag_manager_->releaseDemand(parent);
+            }
+            stream_subscribers_--;
+            LOG_INFO("📡 Suscriptor SSE desconectado");
+        });
+}
+
 void TagManagementServer::handleGetStatistics(const httplib::Request& req, httplib::Response& res) {
     try {
         const auto& stats = tag_manager_->getStatus();
@@ -1058,7 +1334,8 @@ nlohmann::json TagManagementServer::buildOPCUATableStatus() {
         }
         
         // Get all tags and check their OPC UA assignments
-        auto tags = tag_manager_->getAllTags();
+        auto snapshot = tag_manager_->getSnapshot();
+        const auto& tags = snapshot->tags;
         int assigned_count = 0;
         
         for (const auto& tag : tags) {
@@ -1162,13 +1439,16 @@ nlohmann::json TagManagementServer::generateConfigurationJSON() {
         {"opcua_table_size", 52},
         {"fast_polling_interval_ms", 250},
         {"medium_polling_interval_ms", 2000},
-        {"slow_polling_interval_ms", 30000}
+        {"slow_polling_interval_ms", 30000},
+        {"demand_polling_interval_ms", 10000},
+        {"background_integrity_interval_ms", 60000}
     };
     
     // Build TBL_tags array from current tags
     config["TBL_tags"] = nlohmann::json::array();
     
-    auto tags = tag_manager_->getAllTags();
+    auto snapshot = tag_manager_->getSnapshot();
+    const auto& tags = snapshot->tags;
     for (const auto& tag : tags) {
         nlohmann::json tag_json;
         tag_json["name"] = tag->getName();
@@ -1238,7 +1518,8 @@ nlohmann::json TagManagementServer::generateOPCUAStructurePreview() {
         
         // Group tags by category
         std::map<std::string, std::vector<std::shared_ptr<Tag>>> tags_by_category;
-        auto tags = tag_manager_->getAllTags();
+        auto snapshot = tag_manager_->getSnapshot();
+        const auto& tags = snapshot->tags;
         
         for (const auto& tag : tags) {
             std::string category = tag->getGroup();
@@ -1574,7 +1855,8 @@ std::vector<int> TagManagementServer::getAvailableOPCUAIndices() {
         std::set<int> assigned_indices;
         
         // Get all tags and check their assignments
-        auto tags = tag_manager_->getAllTags();
+        auto snapshot = tag_manager_->getSnapshot();
+        const auto& tags = snapshot->tags;
         for (const auto& tag : tags) {
             std::string tag_name = tag->getName();
             
@@ -1773,7 +2055,7 @@ bool TagManagementServer::updateTagInternal(const std::string& tag_name, const n
             std::string group = config.contains("category") ? 
                 config["category"].get<std::string>() : 
                 config["group"].get<std::string>();
-            tag->setGroup(group);
+            tag_manager_->setTagGroup(tag_name, group);
         }
         
         // Update limits for float tags
@@ -2016,7 +2298,7 @@ void TagManagementServer::handleRestoreBackup(const httplib::Request& req, httpl
                 {"backup_file", backup_filename},
                 {"restored_at", std::chrono::duration_cast<std::chrono::seconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count()},
-                {"tags_count", tag_manager_->getAllTags().size()}
+                {"tags_count", tag_manager_->getSnapshot()->tags.size()}
             };
             
             auto response = APIResponse::Success(result, "Backup restored successfully");
@@ -8,16 +8,40 @@
 #include <stdexcept>
 #include <atomic>
 
-TagManager::TagManager() 
-    : running_(false)
+// Versión global de instantáneas: única entre instancias, para la caché por hilo
+static std::atomic<uint64_t> g_snapshot_version{0};
+
+static_assert(TagManager::MAX_SHARDS <= 256, "TagSnapshot::shard_by_id guarda la partición en 8 bits");
+
+TagManager::TagManager(size_t num_shards) 
+    : snapshot_(std::make_shared<const TagSnapshot>())
+    , snapshot_version_(++g_snapshot_version)
+    , running_(false)
     , polling_interval_(1000)
-    , max_history_size_(1000)
+    , history_depth_(DEFAULT_HISTORY_DEPTH)
+    , historian_enabled_(true)
+    , arena_storage_(false)
 {
-    std::cout << "TagManager inicializado" << std::endl;
+    num_shards = std::min(std::max<size_t>(num_shards, 1), MAX_SHARDS);
+    for (size_t i = 0; i < num_shards; i++) {
+        shards_.push_back(std::make_unique<RegistryShard>());
+    }
+    std::cout << "TagManager inicializado (" << num_shards << " particiones)" << std::endl;
 }
 
 TagManager::~TagManager() {
     stop();
+    
+    // Los tags pueden sobrevivir al manager: desvincularlos del almacén
+    auto locks = lockAllShards();
+    for (const auto& shard : shards_) {
+        for (const auto& pair : shard->tags) {
+            pair.second->unbindLiveStore();
+        }
+    }
+    live_store_.setMirror(nullptr);
+    warm_state_.flush();
+    history_store_.close();
 }
 
 bool TagManager::loadFromFile(const std::string& config_file) {
@@ -40,24 +64,75 @@ bool TagManager::loadFromFile(const std::string& config_file) {
 }
 
 bool TagManager::loadFromConfig(const nlohmann::json& config) {
+    // Las particiones se toman durante toda la carga: si falla, el registro anterior
+    // se restaura antes de que otro escritor o una publicación vea el intermedio
+    auto locks = lockAllShards();
+    
+    // Tablas de la configuración anterior, intactas hasta confirmar la nueva
+    struct PreviousTables {
+        std::unordered_map<std::string, std::shared_ptr<Tag>> tags;
+        std::unordered_map<std::string, TagFamily> families;
+        std::unordered_map<std::string, TagParentRef> parent_of;
+        TagIndex indexes[TAG_INDEX_KINDS];
+        std::unordered_map<std::string, std::array<std::string, TAG_INDEX_KINDS>> index_keys;
+    };
+    std::vector<PreviousTables> previous_tables(shards_.size());
+    std::unordered_map<std::string, PreviousTag> previous_tags;
+    std::shared_ptr<TagArena> previous_arena = std::atomic_load(&arena_);
+    bool committed = false;
+    
     try {
-        // Limpiar tags existentes
-        std::lock_guard<std::mutex> lock(tags_mutex_);
-        tags_.clear();
-        
-        // Configuración general
+        // Configuración general: se valida antes de tocar el registro y se aplica al confirmar
+        uint32_t polling_interval = polling_interval_;
         if (config.contains("polling_interval_ms")) {
-            polling_interval_ = config["polling_interval_ms"].get<uint32_t>();
+            polling_interval = config["polling_interval_ms"].get<uint32_t>();
+        }
+        
+        size_t history_depth = history_depth_;
+        if (config.contains("history_depth")) {
+            history_depth = std::max<size_t>(config["history_depth"].get<size_t>(), 1);
+        }
+        
+        bool arena_storage = arena_storage_;
+        if (config.contains("tag_storage")) {
+            arena_storage = config["tag_storage"].get<std::string>() == "arena";
+        }
+        
+        // Retirar los tags existentes; sus IDs, históricos y registros persistentes
+        // quedan reservados para los tags del mismo nombre en la configuración nueva
+        reload_previous_.clear();
+        for (size_t i = 0; i < shards_.size(); i++) {
+            RegistryShard& shard = *shards_[i];
+            PreviousTables& tables = previous_tables[i];
+            tables.tags.swap(shard.tags);
+            tables.families.swap(shard.families);
+            tables.parent_of.swap(shard.parent_of);
+            for (size_t kind = 0; kind < TAG_INDEX_KINDS; kind++) {
+                tables.indexes[kind].swap(shard.indexes[kind]);
+            }
+            tables.index_keys.swap(shard.index_keys);
+            for (const auto& pair : tables.tags) {
+                reload_previous_[pair.first] = {pair.second, pair.second->getId()};
+                pair.second->unbindLiveStore();
+            }
         }
+        previous_tags = reload_previous_;
         
-        if (config.contains("max_history_size")) {
-            max_history_size_ = config["max_history_size"].get<size_t>();
+        // Nueva generación: la arena anterior se libera con su último Tag
+        std::shared_ptr<TagArena> arena;
+        if (arena_storage && config.contains("tags")) {
+            size_t estimated_tags = 0;
+            for (const auto& tag_config : config["tags"]) {
+                estimated_tags += 1 + (tag_config.contains("variables") ? tag_config["variables"].size() : 0);
+            }
+            arena = std::make_shared<TagArena>(estimated_tags * TagArena::BYTES_PER_TAG);
         }
+        std::atomic_store(&arena_, arena);
         
         // Cargar tags desde un solo array unificado
         if (config.contains("tags")) {
             for (const auto& tag_config : config["tags"]) {
-                auto tag = std::make_shared<Tag>();
+                auto tag = newTag();
                 
 
                 
@@ -114,7 +189,7 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                 }
                 
                 // Agregar tag principal
-                tags_[tag->getName()] = tag;
+                registerTagLocked(tag, &tag_config);
                 
                 // Crear sub-tags basados en las variables definidas
                 if (tag_config.contains("variables")) {
@@ -127,7 +202,7 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
         // Cargar totalizadores desde array separado
         if (config.contains("Totalizer")) {
             for (const auto& tag_config : config["Totalizer"]) {
-                auto tag = std::make_shared<Tag>();
+                auto tag = newTag();
                 
 
                 
@@ -184,7 +259,7 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                 }
                 
                 // Agregar tag principal
-                tags_[tag->getName()] = tag;
+                registerTagLocked(tag, &tag_config);
                 
                 // Crear sub-tags basados en las variables definidas
                 if (tag_config.contains("variables")) {
@@ -197,7 +272,7 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
         // Cargar controladores PID desde array separado
         if (config.contains("PID_controllers")) {
             for (const auto& tag_config : config["PID_controllers"]) {
-                auto tag = std::make_shared<Tag>();
+                auto tag = newTag();
                 
                 if (tag_config.contains("name")) {
                     tag->setName(tag_config["name"].get<std::string>());
@@ -251,13 +326,13 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                     }
                 }
                 
-                tags_[tag->getName()] = tag;
+                registerTagLocked(tag, &tag_config);
             }
         }
         // Compatibilidad con formato anterior (TBL_tags)
         else if (config.contains("TBL_tags")) {
             for (const auto& tag_config : config["TBL_tags"]) {
-                auto tag = std::make_shared<Tag>();
+                auto tag = newTag();
                 
                 if (tag_config.contains("name")) {
                     tag->setName(tag_config["name"].get<std::string>());
@@ -311,13 +386,13 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                     }
                 }
                 
-                tags_[tag->getName()] = tag;
+                registerTagLocked(tag, &tag_config);
             }
             
             // Cargar devices adicionales si existen
             if (config.contains("devices")) {
                 for (const auto& tag_config : config["devices"]) {
-                    auto tag = std::make_shared<Tag>();
+                    auto tag = newTag();
                     
                     if (tag_config.contains("name")) {
                         tag->setName(tag_config["name"].get<std::string>());
@@ -371,14 +446,14 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                         }
                     }
                     
-                    tags_[tag->getName()] = tag;
+                    registerTagLocked(tag, &tag_config);
                 }
             }
             
             // Cargar PID_tags adicionales si existen
             if (config.contains("PID_tags")) {
                 for (const auto& tag_config : config["PID_tags"]) {
-                    auto tag = std::make_shared<Tag>();
+                    auto tag = newTag();
                     
                     if (tag_config.contains("name")) {
                         tag->setName(tag_config["name"].get<std::string>());
@@ -432,16 +507,74 @@ bool TagManager::loadFromConfig(const nlohmann::json& config) {
                         }
                     }
                     
-                    tags_[tag->getName()] = tag;
+                    registerTagLocked(tag, &tag_config);
+                }
+            }
+        }
+        
+        // Confirmar: a partir de aquí la configuración nueva es la vigente
+        committed = true;
+        releasePreviousTagsLocked();
+        staleness_.clear();
+        polling_interval_ = polling_interval;
+        arena_storage_ = arena_storage;
+        if (history_depth != history_depth_) {
+            history_depth_ = history_depth;
+            for (const auto& shard : shards_) {
+                for (auto& [id, state] : shard->history) {
+                    state.ring.resize(history_depth);
                 }
             }
         }
         
-        std::cout << "Cargados " << tags_.size() << " tags desde configuración" << std::endl;
+        publishSnapshotLocked();
+        configureHistorianLocked(config);
+        buildScalingPlan(config);
+        std::cout << "Cargados " << getSnapshot()->tags.size() << " tags desde configuración" << std::endl;
         return true;
         
     } catch (const std::exception& e) {
         std::cerr << "Error procesando configuración: " << e.what() << std::endl;
+        if (committed) {
+            return false;
+        }
+        
+        // Deshacer la carga parcial: los tags nuevos con ID propio lo liberan; los que
+        // heredaron uno se desvinculan sin tocar su histórico ni su registro persistente
+        for (const auto& shard : shards_) {
+            for (const auto& [name, tag] : shard->tags) {
+                auto previous = previous_tags.find(name);
+                if (previous != previous_tags.end() && previous->second.id == tag->getId()) {
+                    tag->unbindLiveStore();
+                } else {
+                    unregisterTagLocked(tag);
+                }
+            }
+        }
+        
+        // Restaurar las tablas y volver a vincular los tags anteriores con sus IDs
+        for (size_t i = 0; i < shards_.size(); i++) {
+            RegistryShard& shard = *shards_[i];
+            PreviousTables& tables = previous_tables[i];
+            shard.tags.swap(tables.tags);
+            shard.families.swap(tables.families);
+            shard.parent_of.swap(tables.parent_of);
+            for (size_t kind = 0; kind < TAG_INDEX_KINDS; kind++) {
+                shard.indexes[kind].swap(tables.indexes[kind]);
+            }
+            shard.index_keys.swap(tables.index_keys);
+            for (const auto& [name, tag] : shard.tags) {
+                auto previous = previous_tags.find(name);
+                if (previous != previous_tags.end() && previous->second.id != TagValueStore::INVALID_ID) {
+                    tag->bindLiveStore(&live_store_, previous->second.id);
+                }
+            }
+        }
+        reload_previous_.clear();
+        std::atomic_store(&arena_, previous_arena);
+        publishSnapshotLocked();
+        LOG_WARNING("⚠️ Configuración rechazada, se mantiene la anterior (" +
+                    std::to_string(getSnapshot()->tags.size()) + " tags)");
         return false;
     }
 }
@@ -472,136 +605,985 @@ void TagManager::stop() {
     std::cout << "TagManager detenido" << std::endl;
 }
 
-std::shared_ptr<Tag> TagManager::getTag(const std::string& name) {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+// Nombre del tag padre: clave de partición y de demanda ("ET_1601.PV" -> "ET_1601")
+static std::string parentKey(const std::string& tag_name) {
+    size_t dot_pos = tag_name.find('.');
+    return dot_pos == std::string::npos ? tag_name : tag_name.substr(0, dot_pos);
+}
+
+size_t TagManager::shardIndex(const std::string& tag_name) const {
+    if (shards_.size() == 1) {
+        return 0;
+    }
+    return std::hash<std::string>{}(parentKey(tag_name)) % shards_.size();
+}
+
+TagManager::RegistryShard& TagManager::shardFor(const std::string& tag_name) const {
+    return *shards_[shardIndex(tag_name)];
+}
+
+std::vector<std::unique_lock<std::mutex>> TagManager::lockAllShards() const {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+// Asignar ID denso y ranura en el almacén SoA
+void TagManager::registerTagLocked(const std::shared_ptr<Tag>& tag, const nlohmann::json* tag_config) {
+    RegistryShard& shard = shardFor(tag->getName());
+    auto it = shard.tags.find(tag->getName());
+    if (it != shard.tags.end()) {
+        if (it->second == tag) {
+            return;
+        }
+        unregisterTagLocked(it->second);
+    }
     
-    auto it = tags_.find(name);
-    if (it != tags_.end()) {
-        return it->second;
+    // En una recarga el tag hereda el ID del anterior con el mismo nombre: su ranura
+    // y su registro persistente siguen siendo suyos y conservan la última muestra
+    TagValueStore::TagId id = TagValueStore::INVALID_ID;
+    auto previous = reload_previous_.find(tag->getName());
+    if (previous != reload_previous_.end()) {
+        const std::shared_ptr<Tag>& old_tag = previous->second.tag;
+        id = previous->second.id;
+        if (old_tag->getDataType() == tag->getDataType()) {
+            TagSample sample = old_tag->getSample();
+            tag->setSample(sample.value, sample.quality, sample.source_timestamp, sample.server_timestamp);
+            tag->setClientWriteTimestamp(old_tag->getClientWriteTimestamp());
+        }
+        reload_previous_.erase(previous);
+    }
+    if (id == TagValueStore::INVALID_ID) {
+        id = live_store_.allocate();
+        if (id == TagValueStore::INVALID_ID) {
+            LOG_WARNING("⚠️ Almacén de valores lleno, " + tag->getName() + " sin ID denso");
+        } else if (warm_state_.isOpen()) {
+            if (warm_state_.reserve(id)) {
+                warm_state_.bind(id, WarmStateFile::hashName(tag->getName()));
+            } else {
+                LOG_WARNING("⚠️ Estado persistente lleno, " + tag->getName() + " no se conservará");
+            }
+        }
+    }
+    if (id != TagValueStore::INVALID_ID) {
+        tag->bindLiveStore(&live_store_, id);
     }
+    shard.tags[tag->getName()] = tag;
     
-    return nullptr;
+    // Índice jerárquico: "PADRE.VARIABLE" es hijo de "PADRE" (misma partición)
+    const std::string& name = tag->getName();
+    size_t dot_pos = name.find('.');
+    std::string parent_name = name.substr(0, dot_pos);
+    std::string variable;
+    TagFamily& family = shard.families[parent_name];
+    if (dot_pos == std::string::npos) {
+        family.parent = tag;
+    } else {
+        variable = name.substr(dot_pos + 1);
+        family.children.push_back({variable, tag});
+        shard.parent_of[name] = {parent_name, variable};
+    }
+    
+    // Atributos de familia: prefijo del nombre y, si viene de configuración, categoría y tablas
+    if (family.prefix.empty()) {
+        family.prefix = parent_name.substr(0, parent_name.find('_'));
+    }
+    if (tag_config && dot_pos == std::string::npos) {
+        family.category = tag_config->value("category", family.category);
+        family.value_table = tag_config->value("value_table", family.value_table);
+        family.alarm_table = tag_config->value("alarm_table", family.alarm_table);
+    }
+    
+    // Índices secundarios con las claves conocidas al registrar; se guardan
+    // para deshacer exactamente la misma entrada al eliminar el tag
+    bool is_alarm = variable.compare(0, 6, "ALARM_") == 0;
+    std::array<std::string, TAG_INDEX_KINDS> keys = {
+        tag->getGroup(),
+        family.category,
+        is_alarm ? std::string() : family.value_table,
+        is_alarm ? family.alarm_table : std::string(),
+        family.prefix
+    };
+    for (size_t kind = 0; kind < TAG_INDEX_KINDS; kind++) {
+        if (!keys[kind].empty()) {
+            shard.indexes[kind][keys[kind]].push_back(tag);
+        }
+    }
+    shard.index_keys[name] = std::move(keys);
 }
 
-std::vector<std::shared_ptr<Tag>> TagManager::getAllTags() {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+void TagManager::unregisterTagLocked(const std::shared_ptr<Tag>& tag, bool release_id) {
+    TagValueStore::TagId id = tag->getId();
+    tag->unbindLiveStore();
+    if (release_id && id != TagValueStore::INVALID_ID) {
+        live_store_.release(id);
+        warm_state_.clear(id);
+        staleness_.forget(id);     // El ID puede reasignarse a otro tag
+    }
     
-    std::vector<std::shared_ptr<Tag>> result;
-    result.reserve(tags_.size());
+    RegistryShard& shard = shardFor(tag->getName());
+    const std::string& name = tag->getName();
+    if (release_id) {
+        shard.history.erase(id);
+        shard.archive.erase(id);
+    }
+    auto ref = shard.parent_of.find(name);
+    std::string parent_name = ref != shard.parent_of.end() ? ref->second.parent : name;
+    auto family = shard.families.find(parent_name);
+    if (family != shard.families.end()) {
+        if (ref != shard.parent_of.end()) {
+            auto& children = family->second.children;
+            children.erase(std::remove_if(children.begin(), children.end(),
+                [&tag](const TagChild& child) { return child.tag == tag; }), children.end());
+        } else if (family->second.parent == tag) {
+            family->second.parent = nullptr;
+        }
+        if (!family->second.parent && family->second.children.empty()) {
+            shard.families.erase(family);
+        }
+    }
+    if (ref != shard.parent_of.end()) {
+        shard.parent_of.erase(ref);
+    }
     
-    for (const auto& pair : tags_) {
-        result.push_back(pair.second);
+    auto keys = shard.index_keys.find(name);
+    if (keys != shard.index_keys.end()) {
+        for (size_t kind = 0; kind < TAG_INDEX_KINDS; kind++) {
+            auto list = shard.indexes[kind].find(keys->second[kind]);
+            if (list == shard.indexes[kind].end()) {
+                continue;
+            }
+            list->second.erase(std::remove(list->second.begin(), list->second.end(), tag), list->second.end());
+            if (list->second.empty()) {
+                shard.indexes[kind].erase(list);
+            }
+        }
+        shard.index_keys.erase(keys);
+    }
+}
+
+// Liberar los IDs, registros persistentes e históricos en memoria de los tags de la
+// configuración anterior que la nueva no ha vuelto a registrar (llamar con lockAllShards)
+void TagManager::releasePreviousTagsLocked() {
+    for (const auto& [name, previous] : reload_previous_) {
+        if (previous.id != TagValueStore::INVALID_ID) {
+            live_store_.release(previous.id);
+            warm_state_.clear(previous.id);
+        }
+        RegistryShard& shard = shardFor(name);
+        shard.history.erase(previous.id);
+        shard.archive.erase(previous.id);
     }
+    reload_previous_.clear();
+}
+
+// Construir y publicar una nueva instantánea uniendo las particiones (llamar con lockAllShards)
+void TagManager::publishSnapshotLocked() {
+    NameInterner& interner = NameInterner::instance();
+    auto snapshot = std::make_shared<TagSnapshot>();
+    snapshot->by_id.resize(live_store_.size());
+    snapshot->shard_by_id.resize(live_store_.size());
+    for (size_t shard_index = 0; shard_index < shards_.size(); shard_index++) {
+        const auto& shard = shards_[shard_index];
+        for (const auto& pair : shard->tags) {
+            snapshot->by_name.emplace(pair.first, pair.second);
+            snapshot->tags.push_back(pair.second);
+            TagValueStore::TagId id = pair.second->getId();
+            if (id < snapshot->by_id.size()) {
+                snapshot->by_id[id] = pair.second;
+                snapshot->shard_by_id[id] = static_cast<uint8_t>(shard_index);
+            }
+        }
+        snapshot->families.insert(shard->families.begin(), shard->families.end());
+        snapshot->parent_of.insert(shard->parent_of.begin(), shard->parent_of.end());
+        for (const auto& [name, ref] : shard->parent_of) {
+            snapshot->by_path[NameInterner::pathKey(interner.intern(ref.parent), interner.intern(ref.variable))] =
+                shard->tags.at(name);
+        }
+        for (const auto& pair : shard->families) {
+            snapshot->family_names.push_back(pair.first);
+        }
+        for (size_t kind = 0; kind < TAG_INDEX_KINDS; kind++) {
+            for (const auto& [key, list] : shard->indexes[kind]) {
+                TagList& merged = snapshot->indexes[kind][key];
+                merged.insert(merged.end(), list.begin(), list.end());
+            }
+        }
+    }
+    std::sort(snapshot->family_names.begin(), snapshot->family_names.end());
+    snapshot->version = ++g_snapshot_version;
     
-    return result;
+    // Primero la instantánea, después la versión que invalida las cachés de los lectores
+    std::atomic_store(&snapshot_, Snapshot(std::move(snapshot)));
+    snapshot_version_.store(g_snapshot_version.load(), std::memory_order_release);
 }
 
-std::vector<std::shared_ptr<Tag>> TagManager::getTagsByGroup(const std::string& group) {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+TagManager::Snapshot TagManager::getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+// Instantánea cacheada por hilo: en régimen estable la lectura es una carga
+// atómica de la versión y una copia del puntero, sin mutex. Se devuelve fijada:
+// una publicación posterior renueva la caché sin liberar la que usa el llamador
+TagManager::Snapshot TagManager::currentSnapshot() const {
+    struct ThreadCache {
+        const TagManager* owner = nullptr;
+        uint64_t version = 0;
+        Snapshot snapshot;
+    };
+    thread_local ThreadCache cache;
     
-    std::vector<std::shared_ptr<Tag>> result;
+    uint64_t version = snapshot_version_.load(std::memory_order_acquire);
+    if (cache.owner != this || cache.version != version || !cache.snapshot) {
+        cache.snapshot = std::atomic_load(&snapshot_);
+        cache.owner = this;
+        cache.version = version;
+    }
+    return cache.snapshot;
+}
+
+std::shared_ptr<Tag> TagManager::getTag(const std::string& name) {
+    Snapshot snapshot = currentSnapshot();
     
-    for (const auto& pair : tags_) {
-        if (pair.second->getGroup() == group) {
-            result.push_back(pair.second);
-        }
+    auto it = snapshot->by_name.find(name);
+    if (it != snapshot->by_name.end()) {
+        return it->second;
     }
     
-    return result;
+    return nullptr;
+}
+
+// Tag de la generación actual: en la arena si está activa, en el heap si no
+std::shared_ptr<Tag> TagManager::newTag() {
+    auto arena = std::atomic_load(&arena_);
+    if (arena) {
+        return std::allocate_shared<Tag>(TagArenaAllocator<Tag>(arena));
+    }
+    return std::make_shared<Tag>();
+}
+
+std::shared_ptr<Tag> TagManager::getTag(NameInterner::NameId parent, NameInterner::NameId variable) {
+    Snapshot snapshot = currentSnapshot();
+    const std::shared_ptr<Tag>* tag = snapshot->child(parent, variable);
+    return tag ? *tag : nullptr;
+}
+
+std::vector<std::shared_ptr<Tag>> TagManager::getAllTags() {
+    return currentSnapshot()->tags;
+}
+
+std::vector<std::shared_ptr<Tag>> TagManager::getTagsByGroup(const std::string& group) {
+    return getTagsByIndex(TagIndexKind::GROUP, group);
+}
+
+std::vector<std::shared_ptr<Tag>> TagManager::getTagsByIndex(TagIndexKind kind, const std::string& key) {
+    Snapshot snapshot = currentSnapshot();
+    const TagList* tags = snapshot->indexed(kind, key);
+    return tags ? *tags : std::vector<std::shared_ptr<Tag>>();
 }
 
 bool TagManager::addTag(std::shared_ptr<Tag> tag) {
-    if (!tag) {
-        return false;
+    return tag && addTags({tag}) == 1;
+}
+
+size_t TagManager::addTags(const std::vector<std::shared_ptr<Tag>>& tags) {
+    // La instantánea se reconstruye entera (O(N)): una sola vez por lote
+    auto locks = lockAllShards();
+    size_t added = 0;
+    for (const auto& tag : tags) {
+        if (!tag) {
+            continue;
+        }
+        RegistryShard& shard = shardFor(tag->getName());
+        if (shard.tags.find(tag->getName()) != shard.tags.end()) {
+            std::cerr << "Tag '" << tag->getName() << "' ya existe" << std::endl;
+            continue;
+        }
+        registerTagLocked(tag);
+        added++;
+        std::cout << "Tag '" << tag->getName() << "' agregado" << std::endl;
     }
     
-    std::lock_guard<std::mutex> lock(tags_mutex_);
-    
-    if (tags_.find(tag->getName()) != tags_.end()) {
-        std::cerr << "Tag '" << tag->getName() << "' ya existe" << std::endl;
-        return false;
+    if (added > 0) {
+        publishSnapshotLocked();
+    }
+    return added;
+}
+
+bool TagManager::removeTag(const std::string& name) {
+    {
+        RegistryShard& shard = shardFor(name);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.tags.find(name);
+        if (it == shard.tags.end()) {
+            return false;
+        }
+        unregisterTagLocked(it->second);
+        shard.tags.erase(it);
     }
     
-    tags_[tag->getName()] = tag;
-    std::cout << "Tag '" << tag->getName() << "' agregado" << std::endl;
+    auto locks = lockAllShards();
+    publishSnapshotLocked();
+    std::cout << "Tag '" << name << "' eliminado" << std::endl;
     
     return true;
 }
 
-bool TagManager::removeTag(const std::string& name) {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
-    
-    auto it = tags_.find(name);
-    if (it == tags_.end()) {
+bool TagManager::setTagGroup(const std::string& name, const std::string& group) {
+    auto locks = lockAllShards();
+    RegistryShard& shard = shardFor(name);
+    auto it = shard.tags.find(name);
+    if (it == shard.tags.end()) {
         return false;
     }
+    const std::shared_ptr<Tag>& tag = it->second;
     
-    tags_.erase(it);
-    std::cout << "Tag '" << name << "' eliminado" << std::endl;
+    // Mover el tag de la lista de su clave de grupo anterior a la nueva
+    std::string& key = shard.index_keys[name][static_cast<size_t>(TagIndexKind::GROUP)];
+    if (key != group) {
+        TagIndex& index = shard.indexes[static_cast<size_t>(TagIndexKind::GROUP)];
+        auto list = index.find(key);
+        if (list != index.end()) {
+            list->second.erase(std::remove(list->second.begin(), list->second.end(), tag), list->second.end());
+            if (list->second.empty()) {
+                index.erase(list);
+            }
+        }
+        if (!group.empty()) {
+            index[group].push_back(tag);
+        }
+        key = group;
+    }
+    tag->setGroup(group);
     
+    publishSnapshotLocked();
     return true;
 }
 
 void TagManager::updateTagValue(const std::string& name, const TagValue& value) {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+    Snapshot snapshot = currentSnapshot();
     
-    auto it = tags_.find(name);
-    if (it != tags_.end()) {
-        it->second->setValue(value);
-        it->second->updateTimestamp();
+    auto it = snapshot->by_name.find(name);
+    if (it != snapshot->by_name.end()) {
+        // Un solo muestreo del reloj: mismo instante de origen y de servidor
+        bool changed = it->second->getValue() != value;
+        uint64_t now = getCurrentTimestamp();
+        it->second->setSample(value, TagQuality::GOOD, now, now);
         
         // Agregar a histórico
         addToHistory(it->second);
+        
+        if (changed) {
+            change_bus_.publish({it->second->getId()}, it->second->getSourceTimestamp());
+        }
     }
 }
 
-std::vector<TagHistory> TagManager::getTagHistory(const std::string& tag_name, size_t max_entries) {
-    std::lock_guard<std::mutex> lock(history_mutex_);
+std::vector<uint32_t> TagManager::applyFrame(const std::vector<TagUpdate>& updates, uint64_t source_timestamp,
+                                             RateClass rate_class, SourceEpochs::SourceId source) {
+    Snapshot pinned = currentSnapshot();
+    const TagSnapshot& snapshot = *pinned;
+    // Época leída antes de escribir: si el enlace cae durante la trama sus valores ya nacen STALE
+    uint32_t epoch = source_epochs_.current(source);
+    uint64_t server_timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
     
-    std::vector<TagHistory> result;
+    // Escalado en el gateway: PV y percent de los instrumentos escalados se derivan
+    // de su Input en la misma trama; los que envía la fuente se descartan
+    std::shared_ptr<const ScalingPlan> scaling = std::atomic_load(&scaling_);
+    std::vector<TagUpdate> derived;
+    if (scaling) {
+        scaling->apply(updates, snapshot, derived);
+    }
+    
+    // Muestras para el histórico: ID y tag de la instantánea fijada, sin copiar nombres
+    struct HistoryEntry {
+        uint32_t id;
+        const Tag* tag;
+        TagValue value;
+        TagQuality quality;
+    };
+    std::vector<uint32_t> changed_ids;
+    std::vector<uint32_t> refreshed_ids;
+    std::vector<HistoryEntry> history_entries;
+    changed_ids.reserve(updates.size() + derived.size());
+    refreshed_ids.reserve(updates.size() + derived.size());
+    history_entries.reserve(updates.size() + derived.size());
+    
+    // Un solo bucket de plazo para toda la trama, antes de escribir: un barrido concurrente
+    // marca sus calidades antes de que la trama escriba las suyas (ver sweepStaleness)
+    auto applies = [&](const TagUpdate& update) {
+        return update.id < snapshot.by_id.size() && snapshot.by_id[update.id];
+    };
+    for (const auto& update : updates) {
+        if ((!scaling || !scaling->isDerived(update.id)) && applies(update)) {
+            refreshed_ids.push_back(update.id);
+        }
+    }
+    for (const auto& update : derived) {
+        if (applies(update)) {
+            refreshed_ids.push_back(update.id);
+        }
+    }
+    staleness_.refresh(refreshed_ids, rate_class, StalenessEngine::nowMs());
+    
+    auto applyUpdate = [&](const TagUpdate& update) {
+        if (!applies(update)) {
+            return;
+        }
+        const auto& tag = snapshot.by_id[update.id];
+        
+        TagSample previous = tag->getSample();
+        tag->setSample(update.value, update.quality, source_timestamp, server_timestamp);
+        if (source != SourceEpochs::NO_SOURCE) {
+            tag->setSourceEpoch(source, epoch);
+        }
+        if (previous.value != update.value || previous.quality != tag->getQuality()) {
+            changed_ids.push_back(update.id);
+        }
+        history_entries.push_back({update.id, tag.get(), update.value, tag->getQuality()});
+    };
+    for (const auto& update : updates) {
+        if (!scaling || !scaling->isDerived(update.id)) {
+            applyUpdate(update);
+        }
+    }
+    for (const auto& update : derived) {
+        applyUpdate(update);
+    }
+    
+    // Una toma de mutex por partición afectada, en orden de índice
+    if (shards_.size() == 1 && !history_entries.empty()) {
+        RegistryShard& shard = *shards_[0];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : history_entries) {
+            appendHistoryLocked(shard, entry.id, *entry.tag, entry.value, entry.quality, source_timestamp);
+        }
+    } else if (!history_entries.empty()) {
+        std::vector<std::vector<HistoryEntry>> by_shard(shards_.size());
+        for (auto& entry : history_entries) {
+            by_shard[snapshot.shard_by_id[entry.id]].push_back(std::move(entry));
+        }
+        for (size_t i = 0; i < shards_.size(); i++) {
+            if (by_shard[i].empty()) {
+                continue;
+            }
+            RegistryShard& shard = *shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& entry : by_shard[i]) {
+                appendHistoryLocked(shard, entry.id, *entry.tag, entry.value, entry.quality, source_timestamp);
+            }
+        }
+    }
+    
+    if (!changed_ids.empty()) {
+        change_bus_.publish(changed_ids, source_timestamp);
+    }
     
-    auto range = history_.equal_range(tag_name);
-    for (auto it = range.first; it != range.second && result.size() < max_entries; ++it) {
-        result.push_back(it->second);
+    return changed_ids;
+}
+
+// Plan de escalado de la configuración: instrumentos con "scaling" y los IDs de sus sub-tags
+void TagManager::buildScalingPlan(const nlohmann::json& config) {
+    auto plan = std::make_shared<ScalingPlan>();
+    Snapshot snapshot = getSnapshot();
+    auto idOf = [&snapshot](const std::string& name) {
+        auto it = snapshot->by_name.find(name);
+        return it != snapshot->by_name.end() ? it->second->getId() : ScalingPlan::NO_TAG;
+    };
+    
+    for (const char* section : {"tags", "Totalizer", "PID_controllers"}) {
+        if (!config.contains(section)) {
+            continue;
+        }
+        for (const auto& tag_config : config[section]) {
+            if (!tag_config.contains("scaling") || !tag_config.contains("name")) {
+                continue;
+            }
+            std::string name = tag_config["name"].get<std::string>();
+            ScalingPlan::Config scaling;
+            std::string error;
+            if (!ScalingPlan::parse(tag_config["scaling"], scaling, error)) {
+                LOG_WARNING("⚠️ Escalado ignorado para " + name + ": " + error);
+                continue;
+            }
+            ScalingPlan::Targets targets;
+            targets.input = idOf(name + ".Input");
+            targets.pv = idOf(name + ".PV");
+            targets.percent = idOf(name + ".percent");
+            targets.min = idOf(name + ".min");
+            targets.max = idOf(name + ".max");
+            if (targets.input == ScalingPlan::NO_TAG) {
+                LOG_WARNING("⚠️ Escalado ignorado para " + name + ": sin variable Input");
+                continue;
+            }
+            plan->add(targets, scaling);
+        }
     }
     
-    // Ordenar por timestamp descendente (más reciente primero)
-    std::sort(result.begin(), result.end(), 
-        [](const TagHistory& a, const TagHistory& b) {
-            return a.timestamp > b.timestamp;
+    if (!plan->empty()) {
+        LOG_INFO("📐 Escalado en gateway para " + std::to_string(plan->size()) + " instrumentos");
+    }
+    std::atomic_store(&scaling_, std::shared_ptr<const ScalingPlan>(plan->empty() ? nullptr : plan));
+}
+
+bool TagManager::isDerivedValue(uint32_t id) const {
+    auto scaling = std::atomic_load(&scaling_);
+    return scaling && scaling->isDerived(id);
+}
+
+size_t TagManager::sweepStaleness() {
+    // Las calidades se escriben con el motor tomado: applyFrame refresca los plazos antes
+    // de escribir sus valores, así que un GOOD de una trama concurrente no se pisa
+    Snapshot pinned = currentSnapshot();
+    std::vector<uint32_t> changed_ids;
+    StalenessEngine::Expired expired = staleness_.sweep(StalenessEngine::nowMs(),
+        [&](const StalenessEngine::Expired& due) {
+            markQuality(*pinned, due.uncertain, TagQuality::UNCERTAIN, changed_ids);
+            markQuality(*pinned, due.stale, TagQuality::STALE, changed_ids);
         });
+    if (!expired.stale.empty()) {
+        LOG_WARNING("⌛ " + std::to_string(expired.stale.size()) + " tags sin refresco pasan a STALE");
+    }
+    if (!changed_ids.empty()) {
+        change_bus_.publish(changed_ids, getCurrentTimestamp());
+    }
+    return changed_ids.size();
+}
+
+size_t TagManager::markTagsQuality(const std::vector<uint32_t>& ids, TagQuality quality) {
+    Snapshot pinned = currentSnapshot();
+    std::vector<uint32_t> changed_ids;
+    markQuality(*pinned, ids, quality, changed_ids);
+    if (changed_ids.empty()) {
+        return 0;
+    }
+    
+    // El histórico guarda el último valor con la calidad nueva, una toma de mutex por partición
+    uint64_t timestamp = getCurrentTimestamp();
+    std::vector<std::vector<uint32_t>> by_shard(shards_.size());
+    for (uint32_t id : changed_ids) {
+        by_shard[pinned->shard_by_id[id]].push_back(id);
+    }
+    for (size_t i = 0; i < shards_.size(); i++) {
+        if (by_shard[i].empty()) {
+            continue;
+        }
+        RegistryShard& shard = *shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (uint32_t id : by_shard[i]) {
+            const Tag& tag = *pinned->by_id[id];
+            appendHistoryLocked(shard, id, tag, tag.getValue(), quality, timestamp);
+        }
+    }
     
+    change_bus_.publish(changed_ids, timestamp);
+    return changed_ids.size();
+}
+
+// Cambiar solo la calidad (valor y timestamps intactos); el llamador publica changed_ids
+void TagManager::markQuality(const TagSnapshot& snapshot, const std::vector<uint32_t>& ids, TagQuality quality,
+                             std::vector<uint32_t>& changed_ids) {
+    for (uint32_t id : ids) {
+        if (id >= snapshot.by_id.size() || !snapshot.by_id[id]) {
+            continue;
+        }
+        const auto& tag = snapshot.by_id[id];
+        if (tag->getQuality() != quality) {
+            tag->setQuality(quality);
+            changed_ids.push_back(id);
+        }
+    }
+}
+
+bool TagManager::enableWarmState(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    if (!warm_state_.open(path)) {
+        return false;
+    }
+    
+    // Restaurar por ID; si el registro es de otro nombre (configuración cambiada), por hash
+    Snapshot snapshot = getSnapshot();
+    size_t restored = 0;
+    if (warm_state_.hasPreviousState()) {
+        std::unordered_map<uint64_t, TagValueStore::TagId> by_name;
+        bool name_index_built = false;
+        for (size_t id = 0; id < snapshot->by_id.size(); id++) {
+            const auto& tag = snapshot->by_id[id];
+            if (!tag) {
+                continue;
+            }
+            uint64_t hash = WarmStateFile::hashName(tag->getName());
+            WarmStateFile::Restored previous;
+            bool found = warm_state_.read(static_cast<TagValueStore::TagId>(id), hash, previous);
+            if (!found) {
+                if (!name_index_built) {
+                    by_name = warm_state_.indexByName();
+                    name_index_built = true;
+                }
+                auto it = by_name.find(hash);
+                found = it != by_name.end() && warm_state_.read(it->second, hash, previous);
+            }
+            if (found) {
+                tag->setSample(previous.sample.value, TagQuality::UNCERTAIN,
+                               previous.sample.source_timestamp, previous.sample.server_timestamp);
+                tag->setClientWriteTimestamp(previous.client_write_timestamp);
+                restored++;
+            }
+        }
+    }
+    
+    // Rehacer el fichero con los IDs actuales y activar el espejo; cada ranura se
+    // vuelca con la ranura tomada para no pisar una escritura concurrente
+    auto locks = lockAllShards();
+    snapshot = getSnapshot();
+    if (!warm_state_.reset(live_store_.size())) {
+        warm_state_.close();
+        return false;
+    }
+    for (size_t id = 0; id < snapshot->by_id.size(); id++) {
+        if (snapshot->by_id[id]) {
+            warm_state_.bind(static_cast<TagValueStore::TagId>(id),
+                             WarmStateFile::hashName(snapshot->by_id[id]->getName()));
+        }
+    }
+    live_store_.setMirror(&warm_state_);
+    for (size_t id = 0; id < snapshot->by_id.size(); id++) {
+        const auto& tag = snapshot->by_id[id];
+        if (tag) {
+            live_store_.update(static_cast<TagValueStore::TagId>(id), [&tag]() { return tag->getSample(); });
+            warm_state_.writeClientTimestamp(static_cast<TagValueStore::TagId>(id), tag->getClientWriteTimestamp());
+        }
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    LOG_INFO("💾 Estado persistente " + path + ": " + std::to_string(restored) + " tags restaurados (UNCERTAIN) en " +
+             std::to_string(elapsed.count()) + " ms");
+    return true;
+}
+
+// Nombre del tag padre usado como clave de demanda
+static std::string demandKey(const std::string& tag_name) {
+    return parentKey(tag_name);
+}
+
+void TagManager::acquireDemand(const std::string& tag_name) {
+    std::string key = demandKey(tag_name);
+    std::lock_guard<std::mutex> lock(demand_mutex_);
+    if (++demand_counts_[key] == 1) {
+        LOG_DEBUG("👁️ Demanda activa para " + key);
+    }
+}
+
+void TagManager::releaseDemand(const std::string& tag_name) {
+    std::string key = demandKey(tag_name);
+    std::lock_guard<std::mutex> lock(demand_mutex_);
+    auto it = demand_counts_.find(key);
+    if (it == demand_counts_.end()) {
+        return;
+    }
+    if (--it->second == 0) {
+        demand_counts_.erase(it);
+        LOG_DEBUG("💤 Sin demanda para " + key);
+    }
+}
+
+bool TagManager::hasDemand(const std::string& tag_name) const {
+    std::string key = demandKey(tag_name);
+    std::lock_guard<std::mutex> lock(demand_mutex_);
+    return demand_counts_.find(key) != demand_counts_.end();
+}
+
+nlohmann::json TagManager::getDemandStatus() const {
+    std::lock_guard<std::mutex> lock(demand_mutex_);
+    nlohmann::json demand = nlohmann::json::object();
+    for (const auto& [tag_name, count] : demand_counts_) {
+        demand[tag_name] = count;
+    }
+    return demand;
+}
+
+std::vector<TagHistory> TagManager::getTagHistory(const std::string& tag_name, size_t max_entries) {
+    std::vector<TagHistory> result;
+    uint32_t id = historyIdOf(tag_name);
+    RegistryShard& shard = shardFor(tag_name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    
+    // El buffer ya está en orden de inserción: se recorre hacia atrás desde la más reciente
+    auto it = shard.history.find(id);
+    if (it != shard.history.end()) {
+        it->second.ring.latest(tag_name, max_entries, result);
+    }
     return result;
 }
 
+// ID denso con que se guarda el histórico en memoria del tag (INVALID_ID si no existe)
+uint32_t TagManager::historyIdOf(const std::string& tag_name) const {
+    Snapshot snapshot = currentSnapshot();
+    auto it = snapshot->by_name.find(tag_name);
+    return it != snapshot->by_name.end() ? it->second->getId() : TagValueStore::INVALID_ID;
+}
+
+TagManager::HistoryRange TagManager::queryHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                                                  size_t max_points, HistoryOrder order) const {
+    HistoryRange result;
+    if (start > end || max_points == 0) {
+        return result;
+    }
+    
+    // Los tags de texto solo tienen histórico en el buffer: los niveles inferiores son numéricos
+    uint32_t id = TagValueStore::INVALID_ID;
+    bool text = false;
+    {
+        Snapshot snapshot = currentSnapshot();
+        auto it = snapshot->by_name.find(tag_name);
+        if (it != snapshot->by_name.end()) {
+            id = it->second->getId();
+            text = it->second->getValue().isString();
+        }
+    }
+    
+    std::vector<HistorianPoint> points;
+    {
+        RegistryShard& shard = shardFor(tag_name);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto ring = shard.history.find(id);
+        auto archive = shard.archive.find(id);
+        bool has_ring = ring != shard.history.end() && ring->second.ring.size() > 0;
+        bool has_archive = archive != shard.archive.end();
+        
+        // Buffer (resolución completa) si retiene el inicio del rango, si el tag es de
+        // texto o si no hay otro nivel
+        if (has_ring && (ring->second.ring.oldestTimestamp() <= start || text ||
+                         (!history_store_.isOpen() && !has_archive))) {
+            ring->second.ring.range(tag_name, start, end, max_points, order, result.points);
+            result.source = "buffer";
+            return result;
+        }
+        if (text) {
+            return result;
+        }
+        
+        if (!history_store_.isOpen()) {
+            if (!has_archive) {
+                return result;
+            }
+            // El comprimido devuelve los más antiguos: con NEWEST_FIRST se pide el rango entero
+            archive->second.query(start, end, order == HistoryOrder::OLDEST_FIRST ? max_points : SIZE_MAX, points);
+            if (order == HistoryOrder::NEWEST_FIRST) {
+                std::reverse(points.begin(), points.end());
+            }
+            result.source = "historian";
+        }
+    }
+    if (history_store_.isOpen()) {
+        history_store_.query(HistoryStore::hashName(tag_name), start, end, max_points, points, order);
+        result.source = "store";
+    }
+    
+    // Niveles inferiores: solo valores numéricos, ya en el orden pedido
+    size_t n = std::min(max_points, points.size());
+    result.points.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        const auto& point = points[i];
+        result.points.push_back({tag_name, TagValue(point.value), point.quality, point.timestamp});
+    }
+    return result;
+}
+
+void TagManager::setHistoryDepth(size_t depth) {
+    depth = std::max<size_t>(depth, 1);
+    auto locks = lockAllShards();
+    history_depth_ = depth;
+    for (const auto& shard : shards_) {
+        for (auto& [id, state] : shard->history) {
+            state.ring.resize(depth);
+        }
+    }
+}
+
 void TagManager::clearHistory() {
-    std::lock_guard<std::mutex> lock(history_mutex_);
-    history_.clear();
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->history.clear();
+        shard->archive.clear();
+    }
+}
+
+std::vector<HistorianPoint> TagManager::getArchivedHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                                                           size_t max_points) {
+    std::vector<HistorianPoint> result;
+    uint32_t id = historyIdOf(tag_name);
+    RegistryShard& shard = shardFor(tag_name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    
+    auto it = shard.archive.find(id);
+    if (it != shard.archive.end()) {
+        it->second.query(start, end, max_points, result);
+    }
+    return result;
+}
+
+bool TagManager::enableHistoryStore(const std::string& directory, HistoryStore::Options options) {
+    if (options.shards == 0) {
+        options.shards = shards_.size();
+    }
+    return history_store_.open(directory, options);
+}
+
+std::vector<HistorianPoint> TagManager::getStoredHistory(const std::string& tag_name, uint64_t start, uint64_t end,
+                                                         size_t max_points) const {
+    std::vector<HistorianPoint> result;
+    history_store_.query(HistoryStore::hashName(tag_name), start, end, max_points, result);
+    return result;
+}
+
+// Compresión global ("historian") y por instrumento ("compression"); llamar con todas las particiones
+void TagManager::configureHistorianLocked(const nlohmann::json& config) {
+    std::string error;
+    historian_default_ = HistorianCompression();
+    historian_overrides_.clear();
+    historian_enabled_ = true;
+    if (config.contains("historian")) {
+        historian_enabled_ = config["historian"].value("enabled", true);
+        if (!HistorianCompression::parse(config["historian"], historian_default_, error)) {
+            LOG_WARNING("⚠️ Configuración \"historian\" ignorada: " + error);
+            historian_default_ = HistorianCompression();
+        }
+    }
+    
+    for (const char* section : {"tags", "Totalizer", "PID_controllers"}) {
+        if (!config.contains(section)) {
+            continue;
+        }
+        for (const auto& tag_config : config[section]) {
+            if (!tag_config.contains("compression") || !tag_config.contains("name")) {
+                continue;
+            }
+            std::string name = tag_config["name"].get<std::string>();
+            HistorianCompression compression = historian_default_;
+            if (!HistorianCompression::parse(tag_config["compression"], compression, error)) {
+                LOG_WARNING("⚠️ Compresión ignorada para " + name + ": " + error);
+                continue;
+            }
+            historian_overrides_[name] = compression;
+        }
+    }
+    
+    // Las series existentes siguen acumulando con la compresión nueva
+    for (const auto& shard : shards_) {
+        if (!historian_enabled_) {
+            shard->archive.clear();
+            continue;
+        }
+        for (const auto& [name, tag] : shard->tags) {
+            auto series = shard->archive.find(tag->getId());
+            if (series != shard->archive.end()) {
+                series->second.setCompression(historianCompressionFor(*shard, name));
+            }
+        }
+    }
+}
+
+// Compresión del instrumento padre del tag o la global. El padre sale de la copia de
+// trabajo de la partición (la familia vive entera en ella); llamar con su mutex
+const HistorianCompression& TagManager::historianCompressionFor(const RegistryShard& shard,
+                                                                const std::string& tag_name) const {
+    if (!historian_overrides_.empty()) {
+        auto parent = shard.parent_of.find(tag_name);
+        auto it = historian_overrides_.find(parent != shard.parent_of.end() ? parent->second.parent : tag_name);
+        if (it != historian_overrides_.end()) {
+            return it->second;
+        }
+    }
+    return historian_default_;
 }
 
 nlohmann::json TagManager::getStatus() {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+    Snapshot snapshot = getSnapshot();
     
     nlohmann::json status;
     status["running"] = running_.load();  // Convertir atomic<bool> a bool
-    status["total_tags"] = tags_.size();
+    status["total_tags"] = snapshot->tags.size();
+    status["snapshot_version"] = snapshot->version;
+    status["live_slots"] = live_store_.liveCount();
+    status["ids_allocated"] = live_store_.size();
+    status["parent_tags"] = snapshot->families.size();
+    status["change_bus"] = change_bus_.getStatus();
+    status["staleness"] = staleness_.getStatus();
+    status["sources"] = source_epochs_.getStatus();
+    if (auto scaling = std::atomic_load(&scaling_)) {
+        status["scaling"] = scaling->getStatus();
+    }
+    if (warm_state_.isOpen()) {
+        status["warm_state"] = {
+            {"path", warm_state_.path()},
+            {"records", warm_state_.capacity()}
+        };
+    }
     status["polling_interval_ms"] = polling_interval_;
-    status["max_history_size"] = max_history_size_;
+    status["history_depth"] = history_depth_.load();
     
-    std::lock_guard<std::mutex> history_lock(history_mutex_);
-    status["history_entries"] = history_.size();
+    status["registry_shards"] = shards_.size();
+    
+    auto arena = std::atomic_load(&arena_);
+    status["tag_storage"] = arena ? "arena" : "heap";
+    if (arena) {
+        status["arena_bytes"] = arena->bytesUsed();
+        status["arena_allocations"] = arena->allocations();
+    }
+    
+    size_t history_entries = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& [id, state] : shard->history) {
+            history_entries += state.ring.size();
+        }
+    }
+    status["history_entries"] = history_entries;
+    
+    size_t series = 0, blocks = 0, encoded_bytes = 0;
+    uint64_t received = 0, archived = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& [id, archive] : shard->archive) {
+            series++;
+            blocks += archive.blocks();
+            encoded_bytes += archive.encodedBytes();
+            received += archive.receivedPoints();
+            archived += archive.archivedPoints();
+        }
+    }
+    status["historian"] = {
+        {"enabled", historian_enabled_.load()},
+        {"series", series},
+        {"received_points", received},
+        {"archived_points", archived},
+        {"blocks", blocks},
+        {"bytes", blocks * sizeof(HistorianBlock)},
+        {"encoded_bytes", encoded_bytes}
+    };
+    if (history_store_.isOpen()) {
+        status["history_store"] = history_store_.getStatus();
+    }
+    
+    std::lock_guard<std::mutex> demand_lock(demand_mutex_);
+    status["tags_with_demand"] = demand_counts_.size();
     
     return status;
 }
 
 nlohmann::json TagManager::exportTags() {
-    std::lock_guard<std::mutex> lock(tags_mutex_);
+    Snapshot snapshot = getSnapshot();
     
     nlohmann::json export_data;
     export_data["tags"] = nlohmann::json::array();
     
-    for (const auto& pair : tags_) {
-        auto tag = pair.second;
+    for (const auto& tag : snapshot->tags) {
         nlohmann::json tag_json;
         
         tag_json["name"] = tag->getName();
@@ -611,7 +1593,7 @@ nlohmann::json TagManager::exportTags() {
         tag_json["description"] = tag->getDescription();
         tag_json["group"] = tag->getGroup();
         tag_json["value"] = tag->getValueAsString();
-        tag_json["quality"] = static_cast<int>(tag->getQuality());
+        tag_json["quality"] = static_cast<int>(effectiveQuality(*tag));
         tag_json["timestamp"] = tag->getTimestamp();
         
         export_data["tags"].push_back(tag_json);
@@ -627,8 +1609,8 @@ nlohmann::json TagManager::exportTags() {
 void TagManager::pollingLoop() {
     while (running_) {
         try {
-            // Aquí irían las actualizaciones reales de los tags
-            // Por ahora solo simulamos actividad
+            // Barrido de plazos: solo se recorren los buckets vencidos
+            sweepStaleness();
             
             std::this_thread::sleep_for(std::chrono::milliseconds(polling_interval_));
             
@@ -640,27 +1622,39 @@ void TagManager::pollingLoop() {
 }
 
 void TagManager::addToHistory(std::shared_ptr<Tag> tag) {
-    TagHistory history_entry;
-    history_entry.tag_name = tag->getName();
-    history_entry.value = tag->getValue();
-    history_entry.quality = tag->getQuality();
-    history_entry.timestamp = tag->getTimestamp();
-    
-    std::lock_guard<std::mutex> lock(history_mutex_);
-    
-    // Agregar nueva entrada
-    history_.emplace(tag->getName(), history_entry);
+    TagSample sample = tag->getSample();
+    RegistryShard& shard = shardFor(tag->getName());
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    appendHistoryLocked(shard, tag->getId(), *tag, sample.value, tag->getQuality(), sample.source_timestamp);
+}
+
+// Buffer del tag (reservado completo con su primera muestra) y escritura O(1);
+// el nombre solo se usa al crear el histórico del tag. Llamar con el mutex de la partición
+void TagManager::appendHistoryLocked(RegistryShard& shard, uint32_t id, const Tag& tag, const TagValue& value,
+                                     TagQuality quality, uint64_t timestamp) {
+    // Sin ID denso o con el ID ya reasignado (trama sobre una instantánea anterior a una recarga)
+    if (id == TagValueStore::INVALID_ID || tag.getId() != id) {
+        return;
+    }
+    auto it = shard.history.find(id);
+    if (it == shard.history.end()) {
+        it = shard.history.emplace(id, TagHistoryState{TagHistoryRing(history_depth_),
+                                                       HistoryStore::hashName(tag.getName())}).first;
+    }
+    it->second.ring.push(value, quality, timestamp);
     
-    // Limpiar entradas antiguas si excedemos el límite
-    if (history_.size() > max_history_size_) {
-        // Encontrar la entrada más antigua y eliminarla
-        auto oldest_it = history_.begin();
-        for (auto it = history_.begin(); it != history_.end(); ++it) {
-            if (it->second.timestamp < oldest_it->second.timestamp) {
-                oldest_it = it;
-            }
+    // Segundo nivel comprimido: solo valores numéricos
+    if (historian_enabled_ && !value.isString()) {
+        auto series = shard.archive.find(id);
+        if (series == shard.archive.end()) {
+            series = shard.archive.emplace(id, HistorianSeries(historianCompressionFor(shard, tag.getName()))).first;
         }
-        history_.erase(oldest_it);
+        series->second.append(timestamp, value.toDouble(), quality);
+    }
+    
+    // Tercer nivel persistente: solo encola, el disco lo escribe su hilo
+    if (!value.isString() && history_store_.isOpen()) {
+        history_store_.append(it->second.store_key, timestamp, value.toDouble(), quality);
     }
 }
 
@@ -682,12 +1676,12 @@ void TagManager::createSubTags(const std::string& parent_name, const nlohmann::j
         std::string sub_tag_name = parent_name + "." + variable_name;
         
         // Verificar si el sub-tag ya existe
-        if (tags_.find(sub_tag_name) != tags_.end()) {
+        if (shardFor(sub_tag_name).tags.count(sub_tag_name)) {
             continue;
         }
         
         // Crear sub-tag
-        auto sub_tag = std::make_shared<Tag>();
+        auto sub_tag = newTag();
         sub_tag->setName(sub_tag_name);
         
         // Heredar propiedades del tag padre
@@ -756,7 +1750,7 @@ void TagManager::createSubTags(const std::string& parent_name, const nlohmann::j
         }
         
         // Agregar sub-tag al mapa
-        tags_[sub_tag_name] = sub_tag;
+        registerTagLocked(sub_tag);
         
         LOG_DEBUG("Sub-tag creado: " + sub_tag_name);
     }
@@ -0,0 +1,130 @@
+#include "tag_value.h"
+#include <mutex>
+
+TagStringPool& TagStringPool::instance() {
+    static TagStringPool pool;
+    return pool;
+}
+
+TagStringPool::TagStringPool()
+    : operations_(0)
+    , live_(1)
+    , bytes_(0)
+{
+    entries_.emplace_back();
+    entries_.back().refs = 1;       // "" fijo
+    index_.emplace(std::string_view(entries_.back().text), 0);
+}
+
+TagStringPool::StringId TagStringPool::intern(std::string_view text) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = index_.find(text);
+        if (it != index_.end() && entries_[it->second].refs > 0) {
+            return makeId(it->second, entries_[it->second].generation);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(text);
+    if (it != index_.end()) {
+        touchLocked(it->second);    // Sin propietario: su cuarentena vuelve a empezar
+        return makeId(it->second, entries_[it->second].generation);
+    }
+
+    reclaimLocked();
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+    }
+    Entry& entry = entries_[slot];
+    entry.text.assign(text.data(), text.size());
+    entry.refs = 0;
+    index_.emplace(std::string_view(entry.text), slot);
+    live_++;
+    bytes_ += text.size();
+    touchLocked(slot);
+    return makeId(slot, entry.generation);
+}
+
+std::string TagStringPool::text(StringId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    uint32_t slot = slotOf(id);
+    if (slot >= entries_.size() || entries_[slot].generation != generationOf(id)) {
+        return std::string();
+    }
+    return entries_[slot].text;
+}
+
+void TagStringPool::acquire(StringId id) {
+    uint32_t slot = slotOf(id);
+    if (slot == 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (slot < entries_.size() && entries_[slot].generation == generationOf(id)) {
+        entries_[slot].refs++;
+    }
+}
+
+void TagStringPool::release(StringId id) {
+    uint32_t slot = slotOf(id);
+    if (slot == 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (slot < entries_.size() && entries_[slot].generation == generationOf(id) && entries_[slot].refs > 0 &&
+        --entries_[slot].refs == 0) {
+        touchLocked(slot);
+        reclaimLocked();
+    }
+}
+
+// Marcar la ranura como recién usada y, si no está ya, ponerla en la cola de candidatas
+void TagStringPool::touchLocked(uint32_t slot) {
+    Entry& entry = entries_[slot];
+    entry.touched = operations_++;
+    if (!entry.queued) {
+        entry.queued = true;
+        candidates_.push_back(slot);
+    }
+}
+
+// Revisar como mucho dos candidatas por operación: el ritmo de liberación sigue al de
+// creación y ninguna operación recorre el pool entero
+void TagStringPool::reclaimLocked() {
+    for (int i = 0; i < 2 && !candidates_.empty(); i++) {
+        uint32_t slot = candidates_.front();
+        candidates_.pop_front();
+        Entry& entry = entries_[slot];
+        if (entry.refs > 0) {
+            entry.queued = false;           // Volverá a la cola cuando pierda su último propietario
+            continue;
+        }
+        if (operations_ - entry.touched < QUARANTINE) {
+            candidates_.push_back(slot);    // Sigue en cuarentena (internado de nuevo hace poco)
+            continue;
+        }
+        entry.queued = false;
+        index_.erase(std::string_view(entry.text));
+        bytes_ -= entry.text.size();
+        live_--;
+        std::string().swap(entry.text);
+        entry.generation++;
+        free_slots_.push_back(slot);
+    }
+}
+
+size_t TagStringPool::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return live_;
+}
+
+size_t TagStringPool::bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return bytes_;
+}
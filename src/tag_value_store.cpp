@@ -0,0 +1,146 @@
+#include "tag_value_store.h"
+#include "warm_state.h"
+
+TagValueStore::Chunk::Chunk() {
+    for (size_t i = 0; i < CHUNK_SIZE; i++) {
+        sequence[i].store(0, std::memory_order_relaxed);
+        value_bits[i].store(0, std::memory_order_relaxed);
+        source_timestamp[i].store(0, std::memory_order_relaxed);
+        server_timestamp[i].store(0, std::memory_order_relaxed);
+        quality[i].store(static_cast<uint8_t>(TagQuality::UNKNOWN), std::memory_order_relaxed);
+        dirty[i].store(0, std::memory_order_relaxed);
+        live[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+TagValueStore::TagValueStore()
+    : chunks_(new std::atomic<Chunk*>[MAX_CHUNKS])
+    , next_id_(0)
+    , live_count_(0)
+    , mirror_(nullptr)
+{
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TagValueStore::~TagValueStore() {
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+        delete chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+TagValueStore::TagId TagValueStore::allocate() {
+    std::lock_guard<std::mutex> lock(allocate_mutex_);
+
+    // Reutilizar un ID liberado: la ranura vuelve a su estado inicial antes
+    // de marcarse viva (nadie escribe en ella desde release())
+    if (!free_ids_.empty()) {
+        TagId id = free_ids_.back();
+        free_ids_.pop_back();
+        Chunk* chunk = chunks_[id / CHUNK_SIZE].load(std::memory_order_relaxed);
+        size_t slot = id % CHUNK_SIZE;
+        chunk->value_bits[slot].store(0, std::memory_order_relaxed);
+        chunk->source_timestamp[slot].store(0, std::memory_order_relaxed);
+        chunk->server_timestamp[slot].store(0, std::memory_order_relaxed);
+        chunk->quality[slot].store(static_cast<uint8_t>(TagQuality::UNKNOWN), std::memory_order_relaxed);
+        chunk->dirty[slot].store(1, std::memory_order_relaxed);
+        chunk->live[slot].store(1, std::memory_order_release);
+        live_count_++;
+        return id;
+    }
+
+    uint32_t id = next_id_.load(std::memory_order_relaxed);
+    size_t chunk_index = id / CHUNK_SIZE;
+    if (chunk_index >= MAX_CHUNKS) {
+        return INVALID_ID;
+    }
+    if (!chunks_[chunk_index].load(std::memory_order_relaxed)) {
+        chunks_[chunk_index].store(new Chunk(), std::memory_order_release);
+    }
+
+    Chunk* chunk = chunks_[chunk_index].load(std::memory_order_relaxed);
+    chunk->live[id % CHUNK_SIZE].store(1, std::memory_order_relaxed);
+    chunk->dirty[id % CHUNK_SIZE].store(1, std::memory_order_relaxed);
+    live_count_++;
+    next_id_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+void TagValueStore::release(TagId id) {
+    Chunk* chunk = chunkFor(id);
+    if (!chunk) {
+        return;
+    }
+    if (chunk->live[id % CHUNK_SIZE].exchange(0, std::memory_order_relaxed)) {
+        chunk->dirty[id % CHUNK_SIZE].store(0, std::memory_order_relaxed);
+        live_count_--;
+        std::lock_guard<std::mutex> lock(allocate_mutex_);
+        free_ids_.push_back(id);
+    }
+}
+
+TagValueStore::Chunk* TagValueStore::chunkFor(TagId id) const {
+    if (id >= next_id_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return chunks_[id / CHUNK_SIZE].load(std::memory_order_acquire);
+}
+
+void TagValueStore::writeSlot(Chunk& chunk, TagId id, const TagSample& sample) {
+    size_t slot = id % CHUNK_SIZE;
+    double value = sample.value.toDouble();     // Los strings no tienen representación numérica en caliente
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    chunk.value_bits[slot].store(bits, std::memory_order_relaxed);
+    chunk.source_timestamp[slot].store(sample.source_timestamp, std::memory_order_relaxed);
+    chunk.server_timestamp[slot].store(sample.server_timestamp, std::memory_order_relaxed);
+    chunk.quality[slot].store(static_cast<uint8_t>(sample.quality), std::memory_order_relaxed);
+
+    WarmStateFile* mirror = mirror_.load(std::memory_order_acquire);
+    if (mirror) {
+        mirror->write(id, sample);
+    }
+}
+
+void TagValueStore::mirrorClientWrite(TagId id, uint64_t timestamp) {
+    WarmStateFile* mirror = mirror_.load(std::memory_order_acquire);
+    if (mirror && chunkFor(id)) {
+        mirror->writeClientTimestamp(id, timestamp);
+    }
+}
+
+bool TagValueStore::read(TagId id, LiveValue& out) const {
+    Chunk* chunk = chunkFor(id);
+    if (!chunk) {
+        return false;
+    }
+    size_t slot = id % CHUNK_SIZE;
+    if (!chunk->live[slot].load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    while (true) {
+        uint32_t before = chunk->sequence[slot].load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t bits = chunk->value_bits[slot].load(std::memory_order_relaxed);
+        out.source_timestamp = chunk->source_timestamp[slot].load(std::memory_order_relaxed);
+        out.server_timestamp = chunk->server_timestamp[slot].load(std::memory_order_relaxed);
+        out.quality = static_cast<TagQuality>(chunk->quality[slot].load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (chunk->sequence[slot].load(std::memory_order_relaxed) == before) {
+            std::memcpy(&out.value, &bits, sizeof(bits));
+            return true;
+        }
+    }
+}
+
+void TagValueStore::markDirty(TagId id) {
+    Chunk* chunk = chunkFor(id);
+    if (chunk && chunk->live[id % CHUNK_SIZE].load(std::memory_order_relaxed)) {
+        chunk->dirty[id % CHUNK_SIZE].store(1, std::memory_order_release);
+    }
+}
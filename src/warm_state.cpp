@@ -0,0 +1,245 @@
+#include "warm_state.h"
+#include "common.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "registros mapeados requieren atómicos sin bloqueo");
+
+WarmStateFile::WarmStateFile()
+    : fd_(-1)
+    , mapping_(nullptr)
+    , header_(nullptr)
+    , records_(nullptr)
+    , capacity_(0)
+    , previous_state_(false)
+{
+}
+
+WarmStateFile::~WarmStateFile() {
+    close();
+}
+
+static size_t mappingBytes(size_t header_bytes, size_t record_bytes, size_t records) {
+    return header_bytes + record_bytes * records;
+}
+
+bool WarmStateFile::open(const std::string& path) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("💾 No se pudo abrir estado persistente " + path + ": " + std::strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+        LOG_ERROR("💾 fstat falló para " + path + ": " + std::strerror(errno));
+        close();
+        return false;
+    }
+    size_t file_bytes = static_cast<size_t>(info.st_size);
+    if (file_bytes < HEADER_BYTES && ftruncate(fd_, HEADER_BYTES) != 0) {
+        LOG_ERROR("💾 ftruncate falló para " + path + ": " + std::strerror(errno));
+        close();
+        return false;
+    }
+
+    // Espacio virtual para todos los IDs posibles; solo se tocan los que cubre el fichero
+    mapping_ = mmap(nullptr, mappingBytes(HEADER_BYTES, sizeof(Record), MAX_RECORDS),
+                    PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        LOG_ERROR("💾 mmap falló para " + path + ": " + std::strerror(errno));
+        close();
+        return false;
+    }
+    header_ = static_cast<Header*>(mapping_);
+    records_ = reinterpret_cast<Record*>(static_cast<char*>(mapping_) + HEADER_BYTES);
+    path_ = path;
+
+    previous_state_ = file_bytes >= HEADER_BYTES &&
+                      header_->magic == MAGIC &&
+                      header_->version == VERSION &&
+                      header_->record_size == sizeof(Record) &&
+                      header_->records <= MAX_RECORDS &&
+                      mappingBytes(HEADER_BYTES, sizeof(Record), header_->records) <= file_bytes;
+    if (previous_state_) {
+        capacity_.store(header_->records, std::memory_order_release);
+        return true;
+    }
+    return reset(0);
+}
+
+void WarmStateFile::close() {
+    if (mapping_) {
+        flush();
+        munmap(mapping_, mappingBytes(HEADER_BYTES, sizeof(Record), MAX_RECORDS));
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    mapping_ = nullptr;
+    header_ = nullptr;
+    records_ = nullptr;
+    capacity_.store(0, std::memory_order_release);
+    previous_state_ = false;
+}
+
+bool WarmStateFile::resizeFile(size_t records) {
+    if (ftruncate(fd_, static_cast<off_t>(mappingBytes(HEADER_BYTES, sizeof(Record), records))) != 0) {
+        LOG_ERROR("💾 No se pudo redimensionar " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+    header_->records = records;
+    capacity_.store(records, std::memory_order_release);
+    return true;
+}
+
+bool WarmStateFile::reset(size_t records) {
+    if (!mapping_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    records = std::min(records, MAX_RECORDS);
+
+    // Truncar a la cabecera descarta los registros; al crecer vuelven como ceros
+    capacity_.store(0, std::memory_order_release);
+    if (ftruncate(fd_, HEADER_BYTES) != 0) {
+        LOG_ERROR("💾 No se pudo truncar " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+    header_->magic = MAGIC;
+    header_->version = VERSION;
+    header_->record_size = sizeof(Record);
+    header_->records = 0;
+    return resizeFile(records);
+}
+
+bool WarmStateFile::reserve(TagId id) {
+    if (!mapping_ || id >= MAX_RECORDS) {
+        return false;
+    }
+    if (id < capacity()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    size_t current = capacity_.load(std::memory_order_relaxed);
+    if (id < current) {
+        return true;
+    }
+    size_t grown = std::max<size_t>({static_cast<size_t>(id) + 1, current * 2, 1024});
+    return resizeFile(std::min(grown, MAX_RECORDS));
+}
+
+WarmStateFile::Record* WarmStateFile::record(TagId id) const {
+    return id < capacity() ? &records_[id] : nullptr;
+}
+
+void WarmStateFile::bind(TagId id, uint64_t name_hash) {
+    Record* r = record(id);
+    if (!r) {
+        return;
+    }
+    uint32_t sequence = r->sequence.load(std::memory_order_relaxed) | 1;
+    r->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r->name_hash.store(name_hash, std::memory_order_relaxed);
+    r->value_kind.store(EMPTY_KIND, std::memory_order_relaxed);
+    r->client_write_timestamp.store(0, std::memory_order_relaxed);
+    r->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+void WarmStateFile::clear(TagId id) {
+    bind(id, 0);
+}
+
+void WarmStateFile::write(TagId id, const TagSample& sample) {
+    Record* r = record(id);
+    if (!r) {
+        return;
+    }
+
+    // Los StringId no son estables entre ejecuciones: los strings no se persisten
+    uint8_t kind = sample.value.isString() ? EMPTY_KIND : static_cast<uint8_t>(sample.value.kind());
+    uint64_t bits = sample.value.bits();
+
+    uint32_t sequence = r->sequence.load(std::memory_order_relaxed) | 1;
+    r->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r->value_kind.store(kind, std::memory_order_relaxed);
+    r->value_bits.store(bits, std::memory_order_relaxed);
+    r->quality.store(static_cast<uint8_t>(sample.quality), std::memory_order_relaxed);
+    r->source_timestamp.store(sample.source_timestamp, std::memory_order_relaxed);
+    r->server_timestamp.store(sample.server_timestamp, std::memory_order_relaxed);
+    r->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+void WarmStateFile::writeClientTimestamp(TagId id, uint64_t timestamp) {
+    Record* r = record(id);
+    if (r) {
+        r->client_write_timestamp.store(timestamp, std::memory_order_relaxed);
+    }
+}
+
+bool WarmStateFile::read(TagId id, uint64_t name_hash, Restored& out) const {
+    Record* r = record(id);
+    if (!r) {
+        return false;
+    }
+    uint32_t before = r->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return false;       // Escritura interrumpida (caída a mitad de registro)
+    }
+    uint64_t hash = r->name_hash.load(std::memory_order_relaxed);
+    uint8_t kind = r->value_kind.load(std::memory_order_relaxed);
+    uint64_t bits = r->value_bits.load(std::memory_order_relaxed);
+    out.sample.quality = static_cast<TagQuality>(r->quality.load(std::memory_order_relaxed));
+    out.sample.source_timestamp = r->source_timestamp.load(std::memory_order_relaxed);
+    out.sample.server_timestamp = r->server_timestamp.load(std::memory_order_relaxed);
+    out.client_write_timestamp = r->client_write_timestamp.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (r->sequence.load(std::memory_order_relaxed) != before || hash != name_hash) {
+        return false;
+    }
+
+    if (kind > static_cast<uint8_t>(TagValueKind::DOUBLE)) {
+        return false;
+    }
+    out.sample.value = TagValue::fromBits(static_cast<TagValueKind>(kind), bits);
+    return true;
+}
+
+std::unordered_map<uint64_t, WarmStateFile::TagId> WarmStateFile::indexByName() const {
+    std::unordered_map<uint64_t, TagId> index;
+    size_t records = capacity();
+    index.reserve(records);
+    for (size_t id = 0; id < records; id++) {
+        uint64_t hash = records_[id].name_hash.load(std::memory_order_relaxed);
+        if (hash != 0) {
+            index.emplace(hash, static_cast<TagId>(id));
+        }
+    }
+    return index;
+}
+
+void WarmStateFile::flush() {
+    if (mapping_) {
+        msync(mapping_, mappingBytes(HEADER_BYTES, sizeof(Record), capacity()), MS_ASYNC);
+    }
+}
+
+uint64_t WarmStateFile::hashName(const std::string& name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
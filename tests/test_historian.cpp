@@ -0,0 +1,110 @@
+#include "unit_test.h"
+#include "historian.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static bool sameBits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+static HistorianCompression noCompression() {
+    HistorianCompression compression;
+    compression.mode = HistorianCompression::Mode::NONE;
+    compression.retention_ms = 0;
+    return compression;
+}
+
+// Sin compresión, codificar y decodificar devuelve exactamente los puntos de entrada
+TEST_CASE(historian_codec_round_trip) {
+    HistorianSeries series(noCompression());
+    std::vector<HistorianPoint> input;
+    uint64_t timestamp = 1700000000000ULL;
+    uint64_t state = 12345;
+    for (size_t i = 0; i < 5000; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Intervalos regulares, jitter y saltos grandes; valores estables, ruido y extremos
+        uint64_t step = i % 50 == 0 ? 3600000 + (state >> 40) : 1000 + static_cast<int64_t>(state >> 60) - 8;
+        timestamp += step;
+        double value;
+        switch (i % 7) {
+            case 0: value = 42.0; break;
+            case 1: value = static_cast<double>(state >> 11) / 9007199254740992.0 * 1000.0; break;
+            case 2: value = -0.0; break;
+            case 3: value = std::numeric_limits<double>::max(); break;
+            case 4: value = std::numeric_limits<double>::denorm_min(); break;
+            default: value = static_cast<double>(i) * 0.25; break;
+        }
+        TagQuality quality = i % 97 == 0 ? TagQuality::UNCERTAIN : TagQuality::GOOD;
+        input.push_back({timestamp, value, quality});
+        series.append(timestamp, value, quality);
+    }
+    CHECK(series.blocks() > 1);
+
+    std::vector<HistorianPoint> output;
+    series.query(0, UINT64_MAX, SIZE_MAX, output);
+    CHECK(output.size() == input.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < std::min(input.size(), output.size()); i++) {
+        if (output[i].timestamp != input[i].timestamp || !sameBits(output[i].value, input[i].value) ||
+            output[i].quality != input[i].quality) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(series.encodedBytes() < input.size() * sizeof(HistorianPoint));
+}
+
+// Valores no finitos se archivan tal cual
+TEST_CASE(historian_codec_non_finite) {
+    HistorianSeries series(noCompression());
+    const double values[] = {1.0, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity(), 2.0};
+    for (size_t i = 0; i < 5; i++) {
+        series.append(1000 * (i + 1), values[i], TagQuality::GOOD);
+    }
+    std::vector<HistorianPoint> output;
+    series.query(0, UINT64_MAX, SIZE_MAX, output);
+    CHECK(output.size() == 5);
+    if (output.size() == 5) {
+        CHECK(output[0].value == 1.0);
+        CHECK(std::isnan(output[1].value));
+        CHECK(output[2].value == std::numeric_limits<double>::infinity());
+        CHECK(output[3].value == -std::numeric_limits<double>::infinity());
+        CHECK(output[4].value == 2.0);
+    }
+}
+
+// Rango y límite: los más antiguos del intervalo, en orden de tiempo
+TEST_CASE(historian_query_range) {
+    HistorianSeries series(noCompression());
+    for (uint64_t i = 0; i < 1000; i++) {
+        series.append(1000 * i, static_cast<double>(i), TagQuality::GOOD);
+    }
+    std::vector<HistorianPoint> output;
+    series.query(100000, 199999, 10, output);
+    CHECK(output.size() == 10);
+    if (output.size() == 10) {
+        CHECK(output.front().timestamp == 100000);
+        CHECK(output.back().timestamp == 109000);
+    }
+    output.clear();
+    series.query(100000, 199999, SIZE_MAX, output);
+    CHECK(output.size() == 100);
+}
+
+// Fuera de orden y repetidos no se archivan
+TEST_CASE(historian_drops_late_points) {
+    HistorianSeries series(noCompression());
+    series.append(2000, 1.0, TagQuality::GOOD);
+    series.append(1000, 2.0, TagQuality::GOOD);
+    series.append(2000, 3.0, TagQuality::GOOD);
+    series.append(3000, 4.0, TagQuality::GOOD);
+    std::vector<HistorianPoint> output;
+    series.query(0, UINT64_MAX, SIZE_MAX, output);
+    CHECK(output.size() == 2);
+    if (output.size() == 2) {
+        CHECK(output[0].value == 1.0);
+        CHECK(output[1].value == 4.0);
+    }
+}
@@ -0,0 +1,176 @@
+#include "unit_test.h"
+#include "history_store.h"
+#include <filesystem>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr uint64_t DAY_MS = 24 * 3600 * 1000ULL;
+static constexpr uint64_t BASE_MS = 1700000000000ULL / DAY_MS * DAY_MS;
+
+static HistoryStore::Options testOptions() {
+    HistoryStore::Options options;
+    options.shards = 2;
+    options.flush_interval_ms = 3600 * 1000;     // Solo volcados explícitos
+    options.retention_ms = 0;                    // Timestamps sintéticos del pasado
+    return options;
+}
+
+static std::vector<std::string> segmentFiles(const std::string& directory) {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".seg") {
+            files.push_back(entry.path().string());
+        }
+    }
+    return files;
+}
+
+// Un proceso que termina sin close() deja su segmento activo sin sellar: al
+// reabrir se recuperan todas las muestras volcadas y se descarta la cola rota
+TEST_CASE(history_store_crash_recovery) {
+    std::string directory = unit_test::tempDirectory("store_crash");
+    uint64_t hash = HistoryStore::hashName("FIT_1.PV");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        HistoryStore store;
+        if (!store.open(directory, testOptions())) {
+            _exit(1);
+        }
+        for (uint64_t i = 0; i < 1000; i++) {
+            store.append(hash, BASE_MS + i * 1000, static_cast<double>(i), TagQuality::GOOD);
+            if (i % 100 == 99) {
+                store.flush();
+            }
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Chunk a medio escribir al final del segmento
+    auto files = segmentFiles(directory);
+    CHECK(!files.empty());
+    for (const auto& file : files) {
+        std::ofstream(file, std::ios::binary | std::ios::app) << "HCHK-torn-chunk";
+    }
+
+    HistoryStore store;
+    CHECK(store.open(directory, testOptions()));
+    std::vector<HistorianPoint> points;
+    store.query(hash, 0, UINT64_MAX, SIZE_MAX, points);
+    CHECK(points.size() == 1000);
+    bool in_order = true;
+    for (size_t i = 0; i < points.size(); i++) {
+        in_order = in_order && points[i].timestamp == BASE_MS + i * 1000 && points[i].value == static_cast<double>(i);
+    }
+    CHECK(in_order);
+    store.close();
+
+    // Ya sellado: la siguiente apertura lo mapea sin recuperar
+    HistoryStore reopened;
+    CHECK(reopened.open(directory, testOptions()));
+    points.clear();
+    reopened.query(hash, 0, UINT64_MAX, SIZE_MAX, points);
+    CHECK(points.size() == 1000);
+}
+
+// Un índice que no coincide con su checksum no se mapea: el segmento se
+// recupera recorriendo sus chunks
+TEST_CASE(history_store_corrupt_index) {
+    std::string directory = unit_test::tempDirectory("store_index");
+    uint64_t hash = HistoryStore::hashName("PIT_1.PV");
+    {
+        HistoryStore store;
+        CHECK(store.open(directory, testOptions()));
+        for (uint64_t i = 0; i < 500; i++) {
+            store.append(hash, BASE_MS + i * 1000, static_cast<double>(i), TagQuality::GOOD);
+            if (i % 50 == 49) {
+                store.flush();
+            }
+        }
+        store.close();
+    }
+
+    auto files = segmentFiles(directory);
+    CHECK(files.size() == 1);
+    for (const auto& file : files) {
+        // Último byte de la última entrada del índice, justo antes del trailer (48 bytes)
+        std::fstream stream(file, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(-49, std::ios::end);
+        stream.put('\x5A');
+    }
+
+    HistoryStore store;
+    CHECK(store.open(directory, testOptions()));
+    std::vector<HistorianPoint> points;
+    store.query(hash, 0, UINT64_MAX, SIZE_MAX, points);
+    CHECK(points.size() == 500);
+}
+
+// Lo pendiente de volcar se consulta igual que lo volcado, y el buffer está acotado:
+// al llenarse despierta al escritor y lo que no cabe se descarta y se cuenta
+TEST_CASE(history_store_buffer_bound) {
+    std::string directory = unit_test::tempDirectory("store_buffer");
+    HistoryStore::Options options = testOptions();
+    options.shards = 1;
+    options.max_buffered = 10;
+    HistoryStore store;
+    CHECK(store.open(directory, options));
+    uint64_t hash = HistoryStore::hashName("TIT_1.PV");
+    for (uint64_t i = 0; i < 5000; i++) {
+        store.append(hash, BASE_MS + i, static_cast<double>(i), TagQuality::GOOD);
+        CHECK(store.getStatus()["pending_samples"].get<size_t>() <= 2 * options.max_buffered);
+    }
+    std::vector<HistorianPoint> points;
+    store.query(hash, 0, UINT64_MAX, SIZE_MAX, points);
+    uint64_t dropped = store.getStatus()["dropped_samples"].get<uint64_t>();
+    CHECK(points.size() + dropped == 5000);
+
+    store.flush();
+    store.append(hash, BASE_MS + 10000, 10000.0, TagQuality::GOOD);
+    points.clear();
+    store.query(hash, 0, UINT64_MAX, SIZE_MAX, points);
+    CHECK(points.size() + dropped == 5001);
+    CHECK(!points.empty() && points.back().value == 10000.0);
+}
+
+// max_points y order se resuelven en el almacén: mismos puntos que filtrar la consulta completa
+TEST_CASE(history_store_order_and_limit) {
+    std::string directory = unit_test::tempDirectory("store_order");
+    HistoryStore store;
+    CHECK(store.open(directory, testOptions()));
+    uint64_t hash = HistoryStore::hashName("ET_1.PV");
+    // Dos días: un segmento sellado, el activo y muestras sin volcar
+    for (uint64_t i = 0; i < 3000; i++) {
+        store.append(hash, BASE_MS + i * 60000, static_cast<double>(i), TagQuality::GOOD);
+        if (i % 100 == 99 && i < 2900) {
+            store.flush();
+        }
+    }
+
+    size_t mismatches = 0;
+    for (size_t max_points : {size_t(1), size_t(7), size_t(250), size_t(3000), size_t(5000)}) {
+        for (uint64_t start : {BASE_MS, BASE_MS + 500 * 60000}) {
+            std::vector<HistorianPoint> all, oldest, newest;
+            store.query(hash, start, UINT64_MAX, SIZE_MAX, all);
+            store.query(hash, start, UINT64_MAX, max_points, oldest, HistoryOrder::OLDEST_FIRST);
+            store.query(hash, start, UINT64_MAX, max_points, newest, HistoryOrder::NEWEST_FIRST);
+            size_t n = std::min(max_points, all.size());
+            if (oldest.size() != n || newest.size() != n) {
+                mismatches++;
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (oldest[i].timestamp != all[i].timestamp ||
+                    newest[i].timestamp != all[all.size() - 1 - i].timestamp) {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+}
@@ -0,0 +1,108 @@
+#include "unit_test.h"
+#include "tag_manager.h"
+#include <cstring>
+
+static constexpr uint64_t BASE_MS = 1700000000000ULL;
+
+// Un tag numérico y uno de texto con histórico de depth muestras en memoria
+struct HistoryFixture {
+    TagManager manager;
+    uint32_t pv_id;
+    uint32_t text_id;
+
+    explicit HistoryFixture(size_t depth) {
+        manager.addTags({TagFactory::createFloatTag("FIT_9.PV", ""), TagFactory::createStringTag("FIT_9.MODE", "")});
+        manager.setHistoryDepth(depth);
+        pv_id = manager.getTag("FIT_9.PV")->getId();
+        text_id = manager.getTag("FIT_9.MODE")->getId();
+    }
+
+    // Una trama por segundo desde BASE_MS: PV = ±i (en zigzag, el comprimido archiva
+    // todos los puntos) y MODE = "m<i>"
+    void feed(size_t samples) {
+        for (size_t i = 0; i < samples; i++) {
+            float pv = i % 2 ? static_cast<float>(i) : -static_cast<float>(i);
+            manager.applyFrame({{pv_id, TagValue(pv), TagQuality::GOOD},
+                                {text_id, TagValue("m" + std::to_string(i)), TagQuality::GOOD}},
+                               BASE_MS + i * 1000);
+        }
+    }
+};
+
+static bool isSource(const TagManager::HistoryRange& range, const char* source) {
+    return std::strcmp(range.source, source) == 0;
+}
+
+// El buffer responde si retiene el inicio del rango, aunque haya niveles inferiores
+TEST_CASE(query_history_buffer_covers_start) {
+    HistoryFixture fixture(8);
+    fixture.feed(20);
+    auto range = fixture.manager.queryHistory("FIT_9.PV", BASE_MS + 15000, BASE_MS + 19000);
+    CHECK(isSource(range, "buffer"));
+    CHECK(range.points.size() == 5);
+    CHECK(!range.points.empty() && range.points.front().timestamp == BASE_MS + 15000);
+}
+
+// Sin histórico persistente, lo que el buffer ya no retiene sale del comprimido
+TEST_CASE(query_history_falls_back_to_historian) {
+    HistoryFixture fixture(4);
+    fixture.feed(20);
+    auto range = fixture.manager.queryHistory("FIT_9.PV", BASE_MS, BASE_MS + 19000);
+    CHECK(isSource(range, "historian"));
+    CHECK(!range.points.empty() && range.points.front().timestamp == BASE_MS);
+
+    auto newest = fixture.manager.queryHistory("FIT_9.PV", BASE_MS, BASE_MS + 19000, 3, HistoryOrder::NEWEST_FIRST);
+    CHECK(isSource(newest, "historian"));
+    CHECK(newest.points.size() == 3);
+    bool descending = true;
+    for (size_t i = 1; i < newest.points.size(); i++) {
+        descending = descending && newest.points[i - 1].timestamp > newest.points[i].timestamp;
+    }
+    CHECK(descending);
+    CHECK(!newest.points.empty() && newest.points.front().timestamp == BASE_MS + 19000);
+}
+
+// Con histórico persistente se prefiere este (resolución completa) al comprimido
+TEST_CASE(query_history_prefers_store) {
+    HistoryFixture fixture(4);
+    HistoryStore::Options options;
+    options.retention_ms = 0;
+    CHECK(fixture.manager.enableHistoryStore(unit_test::tempDirectory("query_store"), options));
+    fixture.feed(20);
+
+    auto range = fixture.manager.queryHistory("FIT_9.PV", BASE_MS, BASE_MS + 19000);
+    CHECK(isSource(range, "store"));
+    CHECK(range.points.size() == 20);
+
+    auto newest = fixture.manager.queryHistory("FIT_9.PV", BASE_MS, BASE_MS + 19000, 3, HistoryOrder::NEWEST_FIRST);
+    CHECK(isSource(newest, "store"));
+    CHECK(newest.points.size() == 3);
+    if (newest.points.size() == 3) {
+        CHECK(newest.points[0].timestamp == BASE_MS + 19000);
+        CHECK(newest.points[2].timestamp == BASE_MS + 17000);
+        CHECK(newest.points[0].value == TagValue(19.0));
+    }
+}
+
+// Los tags de texto solo tienen histórico en memoria: nunca se remiten a niveles numéricos
+TEST_CASE(query_history_text_tag_uses_buffer) {
+    HistoryFixture fixture(4);
+    HistoryStore::Options options;
+    options.retention_ms = 0;
+    CHECK(fixture.manager.enableHistoryStore(unit_test::tempDirectory("query_text"), options));
+    fixture.feed(20);
+
+    auto range = fixture.manager.queryHistory("FIT_9.MODE", BASE_MS, BASE_MS + 19000);
+    CHECK(isSource(range, "buffer"));
+    CHECK(range.points.size() == 4);
+    CHECK(!range.points.empty() && range.points.back().value.text() == "m19");
+}
+
+// Tag desconocido o rango vacío: sin puntos
+TEST_CASE(query_history_empty) {
+    HistoryFixture fixture(4);
+    fixture.feed(5);
+    CHECK(isSource(fixture.manager.queryHistory("NO_EXISTE.PV", BASE_MS, BASE_MS + 5000), "none"));
+    CHECK(fixture.manager.queryHistory("FIT_9.PV", BASE_MS + 5000, BASE_MS).points.empty());
+    CHECK(fixture.manager.queryHistory("FIT_9.PV", BASE_MS, BASE_MS + 5000, 0).points.empty());
+}
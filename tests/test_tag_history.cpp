@@ -0,0 +1,121 @@
+#include "unit_test.h"
+#include "tag_history.h"
+
+static std::vector<uint64_t> timestamps(const std::vector<TagHistory>& entries) {
+    std::vector<uint64_t> out;
+    for (const auto& entry : entries) {
+        out.push_back(entry.timestamp);
+    }
+    return out;
+}
+
+// Una muestra tardía conserva su valor con el timestamp de la más reciente:
+// el anillo sigue ordenado y las búsquedas por rango no pierden muestras
+TEST_CASE(ring_clamps_late_samples) {
+    TagHistoryRing ring(8);
+    ring.push(TagValue(1.0f), TagQuality::GOOD, 1000);
+    ring.push(TagValue(2.0f), TagQuality::GOOD, 3000);
+    ring.push(TagValue(3.0f), TagQuality::GOOD, 2000);       // Escritura de cliente con "ahora" atrasado
+    ring.push(TagValue(4.0f), TagQuality::GOOD, 500);        // Paso atrás del reloj
+    ring.push(TagValue(5.0f), TagQuality::GOOD, 4000);
+
+    std::vector<TagHistory> all;
+    ring.range("T", 0, UINT64_MAX, SIZE_MAX, HistoryOrder::OLDEST_FIRST, all);
+    CHECK(timestamps(all) == (std::vector<uint64_t>{1000, 3000, 3000, 3000, 4000}));
+    CHECK(all.size() == 5 && all[2].value == TagValue(3.0f) && all[3].value == TagValue(4.0f));
+
+    std::vector<TagHistory> window;
+    ring.range("T", 3000, 3000, SIZE_MAX, HistoryOrder::OLDEST_FIRST, window);
+    CHECK(window.size() == 3);
+    window.clear();
+    ring.range("T", 3001, 5000, SIZE_MAX, HistoryOrder::NEWEST_FIRST, window);
+    CHECK(window.size() == 1 && window.front().value == TagValue(5.0f));
+}
+
+// Al dar la vuelta y al redimensionar se mantiene el orden por tiempo
+TEST_CASE(ring_range_after_wrap_and_resize) {
+    TagHistoryRing ring(4);
+    for (uint64_t i = 1; i <= 10; i++) {
+        ring.push(TagValue(static_cast<float>(i)), TagQuality::GOOD, i * 1000);
+    }
+    CHECK(ring.size() == 4);
+    CHECK(ring.oldestTimestamp() == 7000);
+
+    std::vector<TagHistory> newest;
+    ring.range("T", 0, UINT64_MAX, 2, HistoryOrder::NEWEST_FIRST, newest);
+    CHECK(timestamps(newest) == (std::vector<uint64_t>{10000, 9000}));
+
+    ring.resize(2);
+    ring.push(TagValue(0.0f), TagQuality::GOOD, 1);          // Tardía tras redimensionar
+    std::vector<TagHistory> all;
+    ring.range("T", 0, UINT64_MAX, SIZE_MAX, HistoryOrder::OLDEST_FIRST, all);
+    CHECK(timestamps(all) == (std::vector<uint64_t>{10000, 10000}));
+}
+
+// Los textos del histórico se retienen en el pool mientras el anillo los guarda
+TEST_CASE(ring_retains_strings) {
+    TagHistoryRing ring(2);
+    ring.push(TagValue(std::string("arranque")), TagQuality::GOOD, 1000);
+    ring.push(TagValue(std::string("marcha")), TagQuality::GOOD, 2000);
+    std::vector<TagHistory> all;
+    ring.range("T", 0, UINT64_MAX, SIZE_MAX, HistoryOrder::OLDEST_FIRST, all);
+    CHECK(all.size() == 2 && all[0].value.text() == "arranque" && all[1].value.text() == "marcha");
+}
+
+static bool parseParams(const std::multimap<std::string, std::string>& params, HistoryQueryParams& out,
+                        std::string& error) {
+    return HistoryQueryParams::parse(params, 10000000, out, error);
+}
+
+TEST_CASE(history_params_defaults) {
+    HistoryQueryParams query;
+    std::string error;
+    CHECK(parseParams({}, query, error));
+    CHECK(query.end == 10000000);
+    CHECK(query.start == 10000000 - HistoryQueryParams::DEFAULT_WINDOW_MS);
+    CHECK(query.max_points == 1000);
+    CHECK(query.order == HistoryOrder::OLDEST_FIRST);
+
+    // Menos de una hora desde la época: la ventana empieza en 0
+    CHECK(HistoryQueryParams::parse({}, 5000, query, error));
+    CHECK(query.start == 0 && query.end == 5000);
+}
+
+TEST_CASE(history_params_values) {
+    HistoryQueryParams query;
+    std::string error;
+    CHECK(parseParams({{"start", "100"}, {"end", "200"}, {"max", "5"}, {"order", "newest"}}, query, error));
+    CHECK(query.start == 100 && query.end == 200 && query.max_points == 5);
+    CHECK(query.order == HistoryOrder::NEWEST_FIRST);
+
+    CHECK(parseParams({{"order", "oldest"}, {"max", "999999999"}}, query, error));
+    CHECK(query.max_points == HistoryQueryParams::MAX_POINTS);
+    CHECK(query.order == HistoryOrder::OLDEST_FIRST);
+
+    // Con el parámetro repetido vale el primero, como en httplib::Request::get_param_value
+    CHECK(parseParams({{"max", "7"}, {"max", "8"}}, query, error));
+    CHECK(query.max_points == 7);
+
+    // Solo end: la ventana por defecto termina en end
+    CHECK(parseParams({{"end", "7200000"}}, query, error));
+    CHECK(query.start == 3600000 && query.end == 7200000);
+}
+
+TEST_CASE(history_params_rejects_invalid) {
+    HistoryQueryParams query;
+    std::string error;
+    const std::vector<std::pair<std::string, std::string>> invalid = {
+        {"start", ""}, {"start", "-1"}, {"start", "12abc"}, {"start", " 12"}, {"start", "+5"},
+        {"end", "1e6"}, {"end", "99999999999999999999999"}, {"max", "-3"}, {"max", "ten"},
+        {"order", "NEWEST"}, {"order", ""},
+    };
+    for (const auto& [key, value] : invalid) {
+        error.clear();
+        bool ok = parseParams({{key, value}}, query, error);
+        CHECK(!ok);
+        CHECK(!error.empty());
+    }
+
+    CHECK(!parseParams({{"start", "300"}, {"end", "200"}}, query, error));
+    CHECK(error == "start must be <= end");
+}
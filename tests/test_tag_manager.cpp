@@ -0,0 +1,115 @@
+#include "unit_test.h"
+#include "tag_manager.h"
+
+static constexpr uint64_t BASE_MS = 1700000000000ULL;
+
+static nlohmann::json baseConfig() {
+    return nlohmann::json::parse(R"({
+        "history_depth": 16,
+        "tags": [
+            {"name": "FIT_1", "value_table": "TBL_FIT_1", "variables": ["PV", "SV"]},
+            {"name": "LIT_2", "value_table": "TBL_LIT_2", "variables": ["PV"]}
+        ]
+    })");
+}
+
+static void feed(TagManager& manager, uint32_t id, size_t samples, uint64_t first_ms) {
+    for (size_t i = 0; i < samples; i++) {
+        manager.applyFrame({{id, TagValue(static_cast<float>(i)), TagQuality::GOOD}}, first_ms + i * 1000);
+    }
+}
+
+// Una configuración que falla a mitad de carga no deja rastro: los tags anteriores
+// conservan ID, valor, histórico e índices y siguen recibiendo tramas
+TEST_CASE(reload_rejects_malformed_config) {
+    TagManager manager;
+    CHECK(manager.loadFromConfig(baseConfig()));
+    auto pv = manager.getTag("FIT_1.PV");
+    CHECK(pv != nullptr);
+    if (!pv) {
+        return;
+    }
+    uint32_t id = pv->getId();
+    feed(manager, id, 5, BASE_MS);
+    size_t live = manager.getLiveStore().liveCount();
+    uint64_t version = manager.getSnapshot()->version;
+
+    // FIT_1 hereda su ID, NEW_3 recibe uno nuevo y el tercer tag lanza al leer su nombre
+    auto malformed = nlohmann::json::parse(R"({
+        "history_depth": 4,
+        "tags": [
+            {"name": "FIT_1", "value_table": "TBL_OTHER", "variables": ["PV", "CV"]},
+            {"name": "NEW_3", "variables": ["PV"]},
+            {"name": 7}
+        ]
+    })");
+    CHECK(!manager.loadFromConfig(malformed));
+
+    CHECK(manager.getSnapshot()->version > version);
+    CHECK(manager.getTag("FIT_1.PV") == pv);
+    CHECK(pv->getId() == id);
+    CHECK(manager.getTag("LIT_2.PV") != nullptr);
+    CHECK(manager.getTag("FIT_1.CV") == nullptr);
+    CHECK(manager.getTag("NEW_3") == nullptr);
+    CHECK(manager.getTagsByIndex(TagIndexKind::VALUE_TABLE, "TBL_FIT_1").size() == 3);
+    CHECK(manager.getTagsByIndex(TagIndexKind::VALUE_TABLE, "TBL_OTHER").empty());
+    CHECK(manager.getLiveStore().liveCount() == live);
+    CHECK(manager.getHistoryDepth() == 16);
+    CHECK(manager.getTagHistory("FIT_1.PV").size() == 5);
+
+    auto changed = manager.applyFrame({{id, TagValue(42.0f), TagQuality::GOOD}}, BASE_MS + 10000);
+    CHECK(changed.size() == 1);
+    CHECK(pv->getValue() == TagValue(42.0f));
+    auto history = manager.getTagHistory("FIT_1.PV");
+    CHECK(history.size() == 6);
+    CHECK(!history.empty() && history.front().value == TagValue(42.0f));
+}
+
+// Tras un rechazo, la siguiente recarga válida hereda los IDs y el histórico como siempre
+TEST_CASE(reload_after_rejected_config) {
+    TagManager manager;
+    CHECK(manager.loadFromConfig(baseConfig()));
+    auto pv = manager.getTag("FIT_1.PV");
+    CHECK(pv != nullptr);
+    if (!pv) {
+        return;
+    }
+    uint32_t id = pv->getId();
+    feed(manager, id, 3, BASE_MS);
+
+    CHECK(!manager.loadFromConfig(nlohmann::json::parse(R"({"tags": [{"name": "FIT_1"}, {"name": []}]})")));
+    CHECK(manager.loadFromConfig(baseConfig()));
+
+    auto reloaded = manager.getTag("FIT_1.PV");
+    CHECK(reloaded != nullptr && reloaded != pv);
+    CHECK(reloaded && reloaded->getId() == id);
+    CHECK(manager.getTagHistory("FIT_1.PV").size() == 3);
+    CHECK(manager.getSnapshot()->tags.size() == 5);
+}
+
+// Marcar calidad va por el camino normal: una publicación en el bus y una muestra en el histórico
+TEST_CASE(mark_tags_quality_publishes_once) {
+    TagManager manager;
+    CHECK(manager.loadFromConfig(baseConfig()));
+    uint32_t pv = manager.getTag("FIT_1.PV")->getId();
+    uint32_t sv = manager.getTag("FIT_1.SV")->getId();
+    manager.applyFrame({{pv, TagValue(3.5f), TagQuality::GOOD}, {sv, TagValue(1.0f), TagQuality::GOOD}}, BASE_MS);
+
+    auto subscriber = manager.getChangeBus().subscribe("test");
+    CHECK(manager.markTagsQuality({pv, sv, 999999}, TagQuality::UNCERTAIN) == 2);
+    CHECK(manager.markTagsQuality({pv, sv}, TagQuality::UNCERTAIN) == 0);
+
+    std::vector<ChangeSubscriber::ChangeSetPtr> change_sets;
+    subscriber->poll(change_sets);
+    CHECK(change_sets.size() == 1);
+    CHECK(!change_sets.empty() && change_sets[0]->ids == (std::vector<uint32_t>{pv, sv}));
+    manager.getChangeBus().unsubscribe(subscriber);
+
+    CHECK(manager.getTag("FIT_1.PV")->getQuality() == TagQuality::UNCERTAIN);
+    auto history = manager.getTagHistory("FIT_1.PV");
+    CHECK(history.size() == 2);
+    CHECK(!history.empty() && history.front().quality == TagQuality::UNCERTAIN &&
+          history.front().value == TagValue(3.5f));
+    auto archived = manager.getArchivedHistory("FIT_1.PV", 0, UINT64_MAX);
+    CHECK(!archived.empty() && archived.back().quality == TagQuality::UNCERTAIN);
+}
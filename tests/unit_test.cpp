@@ -0,0 +1,72 @@
+#include "unit_test.h"
+#include "common.h"
+#include <filesystem>
+#include <vector>
+#include <unistd.h>
+
+namespace unit_test {
+
+struct Case {
+    const char* name;
+    std::function<void()> body;
+};
+
+static std::vector<Case>& cases() {
+    static std::vector<Case> registered;
+    return registered;
+}
+
+static size_t failures = 0;
+
+void registerCase(const char* name, std::function<void()> body) {
+    cases().push_back({name, std::move(body)});
+}
+
+void fail(const char* file, int line, const std::string& expression) {
+    failures++;
+    LOG_ERROR("❌ " + std::string(file) + ":" + std::to_string(line) + ": CHECK(" + expression + ")");
+}
+
+static std::string tempRoot() {
+    static const std::string root = (std::filesystem::temp_directory_path() /
+                                     ("planta_gas_unit_tests." + std::to_string(getpid()))).string();
+    return root;
+}
+
+std::string tempDirectory(const std::string& name) {
+    std::string directory = tempRoot() + "/" + name;
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory, ec);
+    return directory;
+}
+
+}  // namespace unit_test
+
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    size_t run = 0, failed = 0;
+    for (const auto& test : unit_test::cases()) {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        size_t before = unit_test::failures;
+        test.body();
+        run++;
+        if (unit_test::failures != before) {
+            failed++;
+            LOG_ERROR("❌ " + std::string(test.name));
+        } else {
+            LOG_SUCCESS("✅ " + std::string(test.name));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(unit_test::tempRoot(), ec);
+    if (failed > 0) {
+        LOG_ERROR("💥 " + std::to_string(failed) + " de " + std::to_string(run) + " pruebas fallidas");
+        return 1;
+    }
+    LOG_SUCCESS("✅ " + std::to_string(run) + " pruebas correctas");
+    return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * unit_test.h - Pruebas unitarias del núcleo (make unit-tests)
+ *
+ * Sin dependencias externas: cada TEST_CASE se registra al cargar el binario
+ * y CHECK anota el fallo sin abortar el caso. unit_tests [filtro] ejecuta los
+ * casos cuyo nombre contiene el filtro y devuelve 1 si alguno falla.
+ */
+
+#ifndef UNIT_TEST_H
+#define UNIT_TEST_H
+
+#include <functional>
+#include <string>
+
+namespace unit_test {
+
+void registerCase(const char* name, std::function<void()> body);
+void fail(const char* file, int line, const std::string& expression);
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) { registerCase(name, std::move(body)); }
+};
+
+// Directorio temporal vacío y exclusivo del caso (se borra al terminar el binario)
+std::string tempDirectory(const std::string& name);
+
+}  // namespace unit_test
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static unit_test::Registrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            unit_test::fail(__FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#endif // UNIT_TEST_H